@@ -0,0 +1,376 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "batch_decoder.h"
+
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+  #define BATCH_DECODER_X86
+  #include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+  #define BATCH_DECODER_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace roomba {
+namespace sensor {
+
+namespace {
+	/// \brief Number of individual packets (7-58)
+	const uint_opt8_t INDIVIDUAL_PACKET_COUNT(STASIS - BUMPS_AND_WHEEL_DROPS + 1);
+
+	/// \brief Number of vectors of eight values in a decoded blob
+	const uint_opt8_t LANE_GROUP_COUNT(7);
+
+	/// \brief The byte shuffles of the vector kernels
+	/// \details Group g holds the values of packets 7+8g through 14+8g,
+	/// in 16-bit lanes. The packets of each group lie within 16 bytes of
+	/// the blob, so a group is a single load and a single shuffle. The
+	/// shuffle swaps the bytes of two byte packets, and leaves the upper
+	/// byte of single byte packets clear (an index with its high bit set
+	/// yields zero). A signed single byte packet is then sign extended
+	/// as ((x ^ 0x80) - 0x80), which is a no-op in every other lane.
+	struct shuffle_plan_t {
+		uint8_t source_offset[LANE_GROUP_COUNT]; ///< offset of the load of each group (within the blob)
+		uint8_t shuffle[LANE_GROUP_COUNT][16]; ///< byte indices of each group
+		uint16_t sign_extension[LANE_GROUP_COUNT][8]; ///< 0x80 in the lanes of signed single byte packets
+	};
+
+	/// \brief Build the byte shuffles of the vector kernels
+	/// \return The byte shuffles
+	inline
+	shuffle_plan_t
+	_buildShufflePlan (
+		void
+	) {
+		shuffle_plan_t plan = shuffle_plan_t();
+		for ( uint_opt8_t group = 0 ; group < LANE_GROUP_COUNT ; ++group ) {
+			// Never load past the end of the blob (the last group is short)
+			const uint8_t source_offset = static_cast<uint8_t>(std::min<size_t>(PACKET_DESCRIPTOR[(BUMPS_AND_WHEEL_DROPS + (8 * group))].offset, (batch_decoder::SENSOR_DATA_SIZE - 16)));
+			plan.source_offset[group] = source_offset;
+			for ( uint_opt8_t lane = 0 ; lane < 8 ; ++lane ) {
+				const uint_opt8_t column = static_cast<uint_opt8_t>((8 * group) + lane);
+				uint8_t * const lane_shuffle = &plan.shuffle[group][(2 * lane)];
+				if ( column >= INDIVIDUAL_PACKET_COUNT ) {
+					lane_shuffle[0] = lane_shuffle[1] = 0x80;
+					continue;
+				}
+				const packet_descriptor_t & descriptor = PACKET_DESCRIPTOR[(BUMPS_AND_WHEEL_DROPS + column)];
+				const uint8_t source = static_cast<uint8_t>(descriptor.offset - source_offset);
+				if ( 2 == descriptor.size ) {
+					lane_shuffle[0] = static_cast<uint8_t>(source + 1);
+					lane_shuffle[1] = source;
+				} else {
+					lane_shuffle[0] = source;
+					lane_shuffle[1] = 0x80;
+					if ( descriptor.is_signed ) { plan.sign_extension[group][lane] = 0x80; }
+				}
+			}
+		}
+		return plan;
+	}
+
+	/// \brief The byte shuffles of the vector kernels (built once)
+	inline
+	const shuffle_plan_t &
+	_shufflePlan (
+		void
+	) {
+		static const shuffle_plan_t plan = _buildShufflePlan();
+		return plan;
+	}
+
+	/// \brief Decode blobs one packet value at a time
+	/// \param [in] blobs_ The first sensor data blob
+	/// \param [in] blob_stride_ Bytes from one blob to the next
+	/// \param [in] first_ The first blob to decode
+	/// \param [in] last_ One past the last blob to decode
+	/// \param [out] columns_ The columns
+	/// \param [in] column_stride_ Values reserved for each column
+	inline
+	void
+	_decodeScalar (
+		const uint8_t * const blobs_,
+		const size_t blob_stride_,
+		const size_t first_,
+		const size_t last_,
+		uint16_t * const columns_,
+		const size_t column_stride_
+	) {
+		for ( size_t blob = first_ ; blob < last_ ; ++blob ) {
+			const uint8_t * const sensor_data = (blobs_ + (blob * blob_stride_));
+			for ( uint_opt8_t column = 0 ; column < INDIVIDUAL_PACKET_COUNT ; ++column ) {
+				const packet_descriptor_t & descriptor = PACKET_DESCRIPTOR[(BUMPS_AND_WHEEL_DROPS + column)];
+				const uint8_t * const value = (sensor_data + descriptor.offset);
+				uint16_t host_value;
+				if ( 2 == descriptor.size ) {
+					host_value = static_cast<uint16_t>((value[0] << 8) | value[1]);
+				} else {
+					host_value = ( descriptor.is_signed ? static_cast<uint16_t>(static_cast<int8_t>(value[0])) : value[0] );
+				}
+				columns_[((column * column_stride_) + blob)] = host_value;
+			}
+		}
+	}
+
+#if defined(BATCH_DECODER_X86)
+	/// \brief Decode blobs eight at a time, with SSSE3
+	/// \return The number of blobs decoded (a multiple of eight)
+	/// \see _decodeScalar
+	__attribute__((target("ssse3")))
+	size_t
+	_decodeSSSE3 (
+		const uint8_t * const blobs_,
+		const size_t blob_stride_,
+		const size_t blob_count_,
+		uint16_t * const columns_,
+		const size_t column_stride_
+	) {
+		const shuffle_plan_t & plan = _shufflePlan();
+		size_t blob(0);
+
+		for ( ; (blob + 8) <= blob_count_ ; blob += 8 ) {
+			const uint8_t * const sensor_data = (blobs_ + (blob * blob_stride_));
+			for ( uint_opt8_t group = 0 ; group < LANE_GROUP_COUNT ; ++group ) {
+				const __m128i shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i *>(plan.shuffle[group]));
+				const __m128i sign_extension = _mm_loadu_si128(reinterpret_cast<const __m128i *>(plan.sign_extension[group]));
+
+				// One row of lanes for each blob
+				__m128i r[8];
+				for ( uint_opt8_t row = 0 ; row < 8 ; ++row ) {
+					const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sensor_data + (row * blob_stride_) + plan.source_offset[group]));
+					r[row] = _mm_sub_epi16(_mm_xor_si128(_mm_shuffle_epi8(bytes, shuffle), sign_extension), sign_extension);
+				}
+
+				// Transpose the rows into one vector for each column
+				const __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]), a1 = _mm_unpackhi_epi16(r[0], r[1]);
+				const __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]), a3 = _mm_unpackhi_epi16(r[2], r[3]);
+				const __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]), a5 = _mm_unpackhi_epi16(r[4], r[5]);
+				const __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]), a7 = _mm_unpackhi_epi16(r[6], r[7]);
+				const __m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+				const __m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+				const __m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+				const __m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+				const __m128i c[8] = {
+					_mm_unpacklo_epi64(b0, b4), _mm_unpackhi_epi64(b0, b4),
+					_mm_unpacklo_epi64(b1, b5), _mm_unpackhi_epi64(b1, b5),
+					_mm_unpacklo_epi64(b2, b6), _mm_unpackhi_epi64(b2, b6),
+					_mm_unpacklo_epi64(b3, b7), _mm_unpackhi_epi64(b3, b7),
+				};
+				for ( uint_opt8_t lane = 0 ; lane < 8 ; ++lane ) {
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(columns_ + ((((8 * group) + lane) * column_stride_) + blob)), c[lane]);
+				}
+			}
+		}
+
+		return blob;
+	}
+
+	/// \brief Decode blobs sixteen at a time, with AVX2
+	/// \details Each 128-bit half of a register holds a row of its own (the
+	/// shuffles and unpacks of AVX2 do not cross halves), so the low half
+	/// transposes blobs 0-7 while the high half transposes blobs 8-15.
+	/// \return The number of blobs decoded (a multiple of sixteen)
+	/// \see _decodeSSSE3
+	__attribute__((target("avx2")))
+	size_t
+	_decodeAVX2 (
+		const uint8_t * const blobs_,
+		const size_t blob_stride_,
+		const size_t blob_count_,
+		uint16_t * const columns_,
+		const size_t column_stride_
+	) {
+		const shuffle_plan_t & plan = _shufflePlan();
+		size_t blob(0);
+
+		for ( ; (blob + 16) <= blob_count_ ; blob += 16 ) {
+			const uint8_t * const sensor_data = (blobs_ + (blob * blob_stride_));
+			for ( uint_opt8_t group = 0 ; group < LANE_GROUP_COUNT ; ++group ) {
+				const __m256i shuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(plan.shuffle[group])));
+				const __m256i sign_extension = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(plan.sign_extension[group])));
+
+				// One row of lanes for each pair of blobs (n, n + 8)
+				__m256i r[8];
+				for ( uint_opt8_t row = 0 ; row < 8 ; ++row ) {
+					const __m128i low_bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sensor_data + (row * blob_stride_) + plan.source_offset[group]));
+					const __m128i high_bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sensor_data + ((row + 8) * blob_stride_) + plan.source_offset[group]));
+					const __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(low_bytes), high_bytes, 1);
+					r[row] = _mm256_sub_epi16(_mm256_xor_si256(_mm256_shuffle_epi8(bytes, shuffle), sign_extension), sign_extension);
+				}
+
+				// Transpose the rows into one vector for each column
+				const __m256i a0 = _mm256_unpacklo_epi16(r[0], r[1]), a1 = _mm256_unpackhi_epi16(r[0], r[1]);
+				const __m256i a2 = _mm256_unpacklo_epi16(r[2], r[3]), a3 = _mm256_unpackhi_epi16(r[2], r[3]);
+				const __m256i a4 = _mm256_unpacklo_epi16(r[4], r[5]), a5 = _mm256_unpackhi_epi16(r[4], r[5]);
+				const __m256i a6 = _mm256_unpacklo_epi16(r[6], r[7]), a7 = _mm256_unpackhi_epi16(r[6], r[7]);
+				const __m256i b0 = _mm256_unpacklo_epi32(a0, a2), b1 = _mm256_unpackhi_epi32(a0, a2);
+				const __m256i b2 = _mm256_unpacklo_epi32(a1, a3), b3 = _mm256_unpackhi_epi32(a1, a3);
+				const __m256i b4 = _mm256_unpacklo_epi32(a4, a6), b5 = _mm256_unpackhi_epi32(a4, a6);
+				const __m256i b6 = _mm256_unpacklo_epi32(a5, a7), b7 = _mm256_unpackhi_epi32(a5, a7);
+				const __m256i c[8] = {
+					_mm256_unpacklo_epi64(b0, b4), _mm256_unpackhi_epi64(b0, b4),
+					_mm256_unpacklo_epi64(b1, b5), _mm256_unpackhi_epi64(b1, b5),
+					_mm256_unpacklo_epi64(b2, b6), _mm256_unpackhi_epi64(b2, b6),
+					_mm256_unpacklo_epi64(b3, b7), _mm256_unpackhi_epi64(b3, b7),
+				};
+				for ( uint_opt8_t lane = 0 ; lane < 8 ; ++lane ) {
+					_mm256_storeu_si256(reinterpret_cast<__m256i *>(columns_ + ((((8 * group) + lane) * column_stride_) + blob)), c[lane]);
+				}
+			}
+		}
+
+		return blob;
+	}
+#elif defined(BATCH_DECODER_NEON)
+	/// \brief Decode blobs eight at a time, with NEON
+	/// \return The number of blobs decoded (a multiple of eight)
+	/// \see _decodeScalar
+	size_t
+	_decodeNEON (
+		const uint8_t * const blobs_,
+		const size_t blob_stride_,
+		const size_t blob_count_,
+		uint16_t * const columns_,
+		const size_t column_stride_
+	) {
+		const shuffle_plan_t & plan = _shufflePlan();
+		size_t blob(0);
+
+		for ( ; (blob + 8) <= blob_count_ ; blob += 8 ) {
+			const uint8_t * const sensor_data = (blobs_ + (blob * blob_stride_));
+			for ( uint_opt8_t group = 0 ; group < LANE_GROUP_COUNT ; ++group ) {
+				const uint8x16_t shuffle = vld1q_u8(plan.shuffle[group]);
+				const uint16x8_t sign_extension = vld1q_u16(plan.sign_extension[group]);
+
+				// One row of lanes for each blob (an index out of range yields zero)
+				uint16x8_t r[8];
+				for ( uint_opt8_t row = 0 ; row < 8 ; ++row ) {
+					const uint8x16_t bytes = vld1q_u8(sensor_data + (row * blob_stride_) + plan.source_offset[group]);
+					r[row] = vsubq_u16(veorq_u16(vreinterpretq_u16_u8(vqtbl1q_u8(bytes, shuffle)), sign_extension), sign_extension);
+				}
+
+				// Transpose the rows into one vector for each column
+				const uint32x4_t a0 = vreinterpretq_u32_u16(vzip1q_u16(r[0], r[1])), a1 = vreinterpretq_u32_u16(vzip2q_u16(r[0], r[1]));
+				const uint32x4_t a2 = vreinterpretq_u32_u16(vzip1q_u16(r[2], r[3])), a3 = vreinterpretq_u32_u16(vzip2q_u16(r[2], r[3]));
+				const uint32x4_t a4 = vreinterpretq_u32_u16(vzip1q_u16(r[4], r[5])), a5 = vreinterpretq_u32_u16(vzip2q_u16(r[4], r[5]));
+				const uint32x4_t a6 = vreinterpretq_u32_u16(vzip1q_u16(r[6], r[7])), a7 = vreinterpretq_u32_u16(vzip2q_u16(r[6], r[7]));
+				const uint64x2_t b0 = vreinterpretq_u64_u32(vzip1q_u32(a0, a2)), b1 = vreinterpretq_u64_u32(vzip2q_u32(a0, a2));
+				const uint64x2_t b2 = vreinterpretq_u64_u32(vzip1q_u32(a1, a3)), b3 = vreinterpretq_u64_u32(vzip2q_u32(a1, a3));
+				const uint64x2_t b4 = vreinterpretq_u64_u32(vzip1q_u32(a4, a6)), b5 = vreinterpretq_u64_u32(vzip2q_u32(a4, a6));
+				const uint64x2_t b6 = vreinterpretq_u64_u32(vzip1q_u32(a5, a7)), b7 = vreinterpretq_u64_u32(vzip2q_u32(a5, a7));
+				const uint16x8_t c[8] = {
+					vreinterpretq_u16_u64(vzip1q_u64(b0, b4)), vreinterpretq_u16_u64(vzip2q_u64(b0, b4)),
+					vreinterpretq_u16_u64(vzip1q_u64(b1, b5)), vreinterpretq_u16_u64(vzip2q_u64(b1, b5)),
+					vreinterpretq_u16_u64(vzip1q_u64(b2, b6)), vreinterpretq_u16_u64(vzip2q_u64(b2, b6)),
+					vreinterpretq_u16_u64(vzip1q_u64(b3, b7)), vreinterpretq_u16_u64(vzip2q_u64(b3, b7)),
+				};
+				for ( uint_opt8_t lane = 0 ; lane < 8 ; ++lane ) {
+					vst1q_u16((columns_ + ((((8 * group) + lane) * column_stride_) + blob)), c[lane]);
+				}
+			}
+		}
+
+		return blob;
+	}
+#endif
+} // namespace
+
+const size_t batch_decoder::SENSOR_DATA_SIZE;
+const size_t batch_decoder::COLUMN_COUNT;
+
+batch_decoder::batch_decoder (
+	void
+) :
+	_column_stride(0),
+	_size(0)
+{}
+
+const uint16_t *
+batch_decoder::column (
+	const PacketId packet_id_
+) const {
+	if ( packet_id_ < BUMPS_AND_WHEEL_DROPS || packet_id_ > STASIS || _columns.empty() ) { return nullptr; }
+	return (_columns.data() + ((packet_id_ - BUMPS_AND_WHEEL_DROPS) * _column_stride));
+}
+
+ReturnCode
+batch_decoder::decode (
+	const uint8_t * const blobs_,
+	const size_t blob_count_,
+	const size_t blob_stride_,
+	const BatchKernel kernel_
+) {
+	if ( (!blobs_ && blob_count_) || blob_stride_ < SENSOR_DATA_SIZE || kernel_ > BATCH_KERNEL_NEON ) { return INVALID_PARAMETER; }
+
+	BatchKernel kernel = kernel_;
+	if ( BATCH_KERNEL_AUTO == kernel ) {
+		const BatchKernel preference[3] = { BATCH_KERNEL_AVX2, BATCH_KERNEL_SSSE3, BATCH_KERNEL_NEON };
+		kernel = BATCH_KERNEL_SCALAR;
+		for ( const BatchKernel candidate : preference ) {
+			if ( kernelSupported(candidate) ) { kernel = candidate; break; }
+		}
+	} else if ( !kernelSupported(kernel) ) {
+		return INVALID_MODE_FOR_REQUESTED_OPERATION;
+	}
+
+	// Columns are padded to a whole number of vector stores
+	_column_stride = ((blob_count_ + 15) & ~static_cast<size_t>(15));
+	_columns.resize(COLUMN_COUNT * _column_stride);
+	_size = blob_count_;
+
+	size_t blobs_decoded(0);
+	switch ( kernel ) {
+#if defined(BATCH_DECODER_X86)
+	  case BATCH_KERNEL_SSSE3:
+		blobs_decoded = _decodeSSSE3(blobs_, blob_stride_, blob_count_, _columns.data(), _column_stride);
+		break;
+	  case BATCH_KERNEL_AVX2:
+		blobs_decoded = _decodeAVX2(blobs_, blob_stride_, blob_count_, _columns.data(), _column_stride);
+		break;
+#elif defined(BATCH_DECODER_NEON)
+	  case BATCH_KERNEL_NEON:
+		blobs_decoded = _decodeNEON(blobs_, blob_stride_, blob_count_, _columns.data(), _column_stride);
+		break;
+#endif
+	  default:
+		break;
+	}
+	_decodeScalar(blobs_, blob_stride_, blobs_decoded, blob_count_, _columns.data(), _column_stride);
+
+	return SUCCESS;
+}
+
+bool
+batch_decoder::kernelSupported (
+	const BatchKernel kernel_
+) {
+	switch ( kernel_ ) {
+	  case BATCH_KERNEL_AUTO:
+	  case BATCH_KERNEL_SCALAR:
+		return true;
+#if defined(BATCH_DECODER_X86)
+	  case BATCH_KERNEL_SSSE3:
+		return __builtin_cpu_supports("ssse3");
+	  case BATCH_KERNEL_AVX2:
+		return __builtin_cpu_supports("avx2");
+#elif defined(BATCH_DECODER_NEON)
+	  case BATCH_KERNEL_NEON:
+		return true;
+#endif
+	  default:
+		return false;
+	}
+}
+
+size_t
+batch_decoder::size (
+	void
+) const {
+	return _size;
+}
+
+} // namespace sensor
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
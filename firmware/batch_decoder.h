@@ -0,0 +1,129 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef BATCH_DECODER_H
+#define BATCH_DECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "defines.h"
+#include "packets.h"
+
+namespace roomba {
+namespace sensor {
+
+/// \brief The implementation of a batch decode
+/// \see batch_decoder::decode
+enum BatchKernel : uint_opt8_t {
+	BATCH_KERNEL_AUTO = 0, ///< the fastest kernel supported by the processor
+	BATCH_KERNEL_SCALAR, ///< one packet value at a time (any processor)
+	BATCH_KERNEL_SSSE3, ///< eight frames at a time (x86)
+	BATCH_KERNEL_AVX2, ///< sixteen frames at a time (x86)
+	BATCH_KERNEL_NEON, ///< eight frames at a time (AArch64)
+};
+
+/// \brief Host type of a column of a batch decode
+/// \details Every value is widened to 16 bits, and extended according
+/// to the signedness of its packet (i.e. TEMPERATURE is sign extended).
+template <PacketId packet_id_>
+struct batch_column_traits {
+	typedef typename std::conditional<packet_traits<packet_id_>::is_signed, int16_t, uint16_t>::type value_type; ///< host type of the column
+};
+
+/// \brief Decodes many sensor data blobs into a column per packet
+/// \details Converts an array of raw sensor data blobs (80 bytes each,
+/// big endian, as returned by the Roomba) into one array of host values
+/// for each individual packet (7-58), for analysis of many frames at
+/// once.
+/// \n The vector kernels byte swap (and widen) the packets of a blob
+/// with a byte shuffle, then transpose the values of eight blobs at a
+/// time into their columns. Any blobs left over are decoded by the
+/// scalar kernel. Every kernel produces the same columns, bit for bit.
+/// \code
+/// sensor::batch_decoder batch;
+/// batch.decode(blobs, blob_count);
+/// const int16_t * left_motor_current = batch.column<sensor::LEFT_MOTOR_CURRENT>();
+/// \endcode
+/// \warning A batch decoder is not thread-safe.
+class batch_decoder {
+  public:
+	batch_decoder (
+		void
+	);
+
+	/// \brief Typed accessor for the column of a packet
+	/// \return The values of the packet, one for each blob decoded
+	template <PacketId packet_id_>
+	const typename batch_column_traits<packet_id_>::value_type *
+	column (
+		void
+	) const {
+		static_assert((packet_id_ >= BUMPS_AND_WHEEL_DROPS && packet_id_ <= STASIS), "columns are only decoded for individual packets (7-58)");
+		return reinterpret_cast<const typename batch_column_traits<packet_id_>::value_type *>(column(packet_id_));
+	}
+
+	/// \brief The column of a packet
+	/// \param [in] packet_id_ An individual packet (7-58)
+	/// \return The values of the packet (reinterpret as int16_t for a
+	/// signed packet), or nullptr for any other packet id
+	const uint16_t *
+	column (
+		const PacketId packet_id_
+	) const;
+
+	/// \brief Decode a batch of sensor data blobs
+	/// \details Replaces the columns of the previous batch.
+	/// \param [in] blobs_ The first sensor data blob
+	/// \param [in] blob_count_ The number of sensor data blobs
+	/// \param [in] blob_stride_ Bytes from one blob to the next, so blobs
+	/// may be decoded in place from within larger records (i.e. an array
+	/// of state::sensor_snapshot_t) [default value: SENSOR_DATA_SIZE]
+	/// \param [in] kernel_ The implementation [default value:
+	/// BATCH_KERNEL_AUTO]
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	/// \return INVALID_MODE_FOR_REQUESTED_OPERATION The kernel is not
+	/// supported by the processor
+	ReturnCode
+	decode (
+		const uint8_t * const blobs_,
+		const size_t blob_count_,
+		const size_t blob_stride_ = SENSOR_DATA_SIZE,
+		const BatchKernel kernel_ = BATCH_KERNEL_AUTO
+	);
+
+	/// \brief The number of blobs of the last batch
+	size_t
+	size (
+		void
+	) const;
+
+	/// \brief Whether a kernel is supported by the processor
+	/// \param [in] kernel_ The implementation
+	/// \return true when the kernel may be given to decode()
+	static
+	bool
+	kernelSupported (
+		const BatchKernel kernel_
+	);
+
+	/// \brief Size of a sensor data blob (in bytes)
+	static const size_t SENSOR_DATA_SIZE = packetDescriptor(PACKETS_7_THRU_58).size;
+
+  private:
+	/// \brief Columns decoded, rounded up to the eight lanes of a kernel
+	static const size_t COLUMN_COUNT = 56;
+
+	std::vector<uint16_t> _columns; ///< the columns (each column_stride values long)
+	size_t _column_stride; ///< values reserved for each column
+	size_t _size; ///< blobs of the last batch
+};
+
+} // namespace sensor
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,243 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "command_queue.h"
+
+#include <cstring>
+
+namespace roomba {
+namespace serial {
+
+namespace {
+	/// \brief Classes of commands which supersede one another
+	enum CommandClass : uint_opt8_t {
+		BARRIER = 0,
+		DRIVE,
+		MOTORS,
+		LEDS,
+		SCHEDULING_LEDS,
+		DISPLAY,
+	};
+
+	/// \brief Classify a command
+	/// \details A command is only classified when the write holds the
+	/// entire command and nothing else.
+	/// \param [in] serial_data_ The bytes written
+	/// \param [in] data_length_ The number of bytes written
+	/// \return The class of the command (BARRIER when not replaceable)
+	inline
+	CommandClass
+	_classify (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	) {
+		CommandClass command_class;
+		size_t command_length;
+		switch ( serial_data_[0] ) {
+		  case command::DRIVE:
+		  case command::DRIVE_DIRECT:
+		  case command::DRIVE_PWM:
+			command_class = DRIVE;
+			command_length = 5;
+			break;
+		  case command::MOTORS:
+			command_class = MOTORS;
+			command_length = 2;
+			break;
+		  case command::PWM_MOTORS:
+			command_class = MOTORS;
+			command_length = 4;
+			break;
+		  case command::LEDS:
+			command_class = LEDS;
+			command_length = 4;
+			break;
+		  case command::SCHEDULING_LEDS:
+			command_class = SCHEDULING_LEDS;
+			command_length = 3;
+			break;
+		  case command::DIGIT_LEDS_RAW:
+		  case command::DIGIT_LEDS_ASCII:
+			command_class = DISPLAY;
+			command_length = 5;
+			break;
+		  default:
+			return BARRIER;
+		}
+
+		return ( (data_length_ == command_length) ? command_class : BARRIER );
+	}
+} // namespace
+
+command_queue::command_queue (
+	port & port_
+) :
+	_port(port_),
+	_buffer_length(0),
+	_entry_count(0),
+	_first_replaceable(0),
+	_superseded(0)
+{}
+
+/// \brief Queue a command (the caller holds the lock)
+/// \return data_length_ once queued, 0 when the queue is full
+inline
+size_t
+command_queue::_enqueue (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	const CommandClass command_class = _classify(serial_data_, data_length_);
+
+	size_t superseded_index = _entry_count;
+	if ( BARRIER != command_class ) {
+		for ( size_t i = _first_replaceable ; i < _entry_count ; ++i ) {
+			if ( _entries[i].command_class == command_class ) { superseded_index = i; break; }
+		}
+	}
+
+	const bool superseding = (superseded_index < _entry_count);
+	const size_t entries_kept = (_entry_count - superseding);
+	const size_t bytes_kept = (_buffer_length - ( superseding ? _entries[superseded_index].length : 0 ));
+	if ( entries_kept == ENTRY_CAPACITY || (bytes_kept + data_length_) > QUEUE_CAPACITY ) { return 0; }
+	if ( superseding ) {
+		_removeEntry(superseded_index);
+		++_superseded;
+	}
+
+	::memcpy((_buffer + _buffer_length), serial_data_, data_length_);
+	_entries[_entry_count].offset = _buffer_length;
+	_entries[_entry_count].length = data_length_;
+	_entries[_entry_count].command_class = command_class;
+	_buffer_length += data_length_;
+	++_entry_count;
+	if ( BARRIER == command_class ) { _first_replaceable = _entry_count; }
+
+	return data_length_;
+}
+
+/// \brief Send the queued commands (the caller holds the lock)
+/// \return SUCCESS
+/// \return SERIAL_TRANSFER_FAILURE The commands were discarded
+inline
+ReturnCode
+command_queue::_flush (
+	void
+) {
+	if ( !_buffer_length ) { return SUCCESS; }
+	const bool complete = (_port.multiByteSerialWrite(_buffer, _buffer_length) == _buffer_length);
+	_buffer_length = 0;
+	_entry_count = 0;
+	_first_replaceable = 0;
+
+	return ( complete ? SUCCESS : SERIAL_TRANSFER_FAILURE );
+}
+
+/// \brief Remove a command from the queue
+/// \details The commands following it are moved forward, so the queue
+/// remains contiguous and in order.
+inline
+void
+command_queue::_removeEntry (
+	const size_t index_
+) {
+	const entry_t removed = _entries[index_];
+	::memmove((_buffer + removed.offset), (_buffer + removed.offset + removed.length), (_buffer_length - removed.offset - removed.length));
+	_buffer_length -= removed.length;
+
+	for ( size_t i = (index_ + 1) ; i < _entry_count ; ++i ) {
+		_entries[i - 1] = _entries[i];
+		_entries[i - 1].offset -= removed.length;
+	}
+	--_entry_count;
+}
+
+void
+command_queue::beginAtBaudCode (
+	const BaudCode baud_code_
+) {
+	{  // Critical section: Update shared memory
+		_mutex.lock();
+		_flush();
+		_port.beginAtBaudCode(baud_code_);
+		_mutex.unlock();
+	}
+}
+
+size_t
+command_queue::multiByteSerialRead (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_,
+	const uint_opt32_t timeout_ms_
+) {
+	{  // Critical section: Update shared memory
+		_mutex.lock();
+		_flush();
+		_mutex.unlock();
+	}
+
+	return _port.multiByteSerialRead(data_buffer_, buffer_length_, timeout_ms_);
+}
+
+size_t
+command_queue::multiByteSerialWrite (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	if ( !data_length_ ) { return 0; }
+
+	size_t bytes_queued;
+	{  // Critical section: Update shared memory
+		_mutex.lock();
+		bytes_queued = _enqueue(serial_data_, data_length_);
+		_mutex.unlock();
+	}
+
+	return bytes_queued;
+}
+
+ReturnCode
+command_queue::flush (
+	void
+) {
+	ReturnCode result;
+	{  // Critical section: Update shared memory
+		_mutex.lock();
+		result = _flush();
+		_mutex.unlock();
+	}
+
+	return result;
+}
+
+size_t
+command_queue::pending (
+	void
+) const {
+	size_t buffer_length;
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		buffer_length = _buffer_length;
+		_mutex.unlock();
+	}
+
+	return buffer_length;
+}
+
+size_t
+command_queue::superseded (
+	void
+) const {
+	size_t superseded;
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		superseded = _superseded;
+		_mutex.unlock();
+	}
+
+	return superseded;
+}
+
+} // namespace serial
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,138 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "defines.h"
+#include "serial_port.h"
+
+namespace roomba {
+namespace serial {
+
+/// \brief An outbound command queue where the last writer wins
+/// \details Commands written to the queue are held until flush(), and
+/// then sent to the underlying port in a single write. Commands setting
+/// the state of an actuator are grouped by class (drive, motors, LEDs,
+/// scheduling LEDs, display); a newer command replaces a queued command
+/// of the same class which has not been sent yet. A producer issuing
+/// setpoints faster than the UART can drain them is therefore never
+/// more than one flush behind, regardless of its rate.
+/// \n Every other command (i.e. start(), safe(), full()) is a barrier.
+/// It is sent in the order it was written, and the commands written
+/// before it are never replaced by the commands written after it.
+/// \note A write holding several commands (i.e. a robot batch) is
+/// treated as a barrier.
+/// \note The queue is flushed before each read and baud change, so
+/// sensor queries are answered as usual.
+/// \note The queue is thread-safe, so commands may be written by a
+/// planner thread while the stream reader (state::startStreamReader)
+/// reads, and flushes, the same queue.
+/// \warning Nothing paces flush() against the drain of the UART. The
+/// latency of an actuator is bounded to one frame only when the caller
+/// flushes once per frame (i.e. as each stream frame is parsed).
+/// \see robot::beginBatch
+class command_queue : public port {
+  public:
+	/// \param [in] port_ The port connected to the Roomba
+	explicit
+	command_queue (
+		port & port_
+	);
+
+	/// \brief Flush the queue, then begin the serial connection
+	/// \see port::beginAtBaudCode
+	void
+	beginAtBaudCode (
+		const BaudCode baud_code_
+	) override;
+
+	/// \brief Flush the queue, then read from the port
+	/// \see port::multiByteSerialRead
+	size_t
+	multiByteSerialRead (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_,
+		const uint_opt32_t timeout_ms_ = 1000
+	) override;
+
+	/// \brief Queue a command
+	/// \return data_length_ once queued, 0 when the queue is full
+	size_t
+	multiByteSerialWrite (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	) override;
+
+	/// \brief Send the queued commands in a single write
+	/// \return SUCCESS
+	/// \return SERIAL_TRANSFER_FAILURE The commands were discarded
+	ReturnCode
+	flush (
+		void
+	);
+
+	/// \brief The number of bytes queued
+	size_t
+	pending (
+		void
+	) const;
+
+	/// \brief The number of commands replaced before being sent
+	size_t
+	superseded (
+		void
+	) const;
+
+  private:
+	/// \brief A queued command
+	struct entry_t {
+		uint_opt16_t offset; ///< offset of the command in the buffer
+		uint_opt16_t length; ///< length of the command
+		uint_opt8_t command_class; ///< class of the command (0 is a barrier)
+	};
+
+	/// \brief Capacity of the queue (in bytes)
+	static const uint_opt16_t QUEUE_CAPACITY = 256;
+
+	/// \brief Capacity of the queue (in commands)
+	static const uint_opt8_t ENTRY_CAPACITY = 64;
+
+	command_queue (const command_queue &) = delete;
+	command_queue & operator= (const command_queue &) = delete;
+
+	size_t
+	_enqueue (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	);
+
+	ReturnCode
+	_flush (
+		void
+	);
+
+	void
+	_removeEntry (
+		const size_t index_
+	);
+
+	port & _port; ///< port connected to the Roomba
+	mutable std::mutex _mutex; ///< guards the queue
+	uint_opt8_t _buffer[QUEUE_CAPACITY]; ///< queued commands
+	uint_opt16_t _buffer_length; ///< bytes queued
+	entry_t _entries[ENTRY_CAPACITY]; ///< queued commands, in order
+	size_t _entry_count; ///< commands queued
+	size_t _first_replaceable; ///< first entry following the last barrier
+	size_t _superseded; ///< commands replaced before being sent
+};
+
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
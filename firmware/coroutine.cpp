@@ -0,0 +1,266 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "coroutine.h"
+
+#if defined(ROOMBA_COROUTINES)
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace roomba {
+namespace coro {
+
+namespace {
+	/// \brief Longest wait of the reactor while a query is awaited
+	/// \details One sensor update period of the Roomba.
+	const int QUERY_POLL_MS(15);
+} // namespace
+
+void
+task::promise_type::unhandled_exception (
+	void
+) {
+	std::terminate();
+}
+
+task::task (
+	const std::coroutine_handle<promise_type> handle_
+) :
+	_handle(handle_)
+{}
+
+task::task (
+	task && task_
+) noexcept :
+	_handle(std::exchange(task_._handle, nullptr))
+{}
+
+task &
+task::operator= (
+	task && task_
+) noexcept {
+	if ( this == &task_ ) { return *this; }
+	if ( _handle ) { _handle.destroy(); }
+	_handle = std::exchange(task_._handle, nullptr);
+	return *this;
+}
+
+task::~task (
+	void
+) {
+	if ( _handle ) { _handle.destroy(); }
+}
+
+bool
+task::done (
+	void
+) const {
+	return ( !_handle || _handle.done() );
+}
+
+query_awaiter::query_awaiter (
+	event_loop & loop_,
+	robot<OI500> & robot_,
+	const sensor::PacketId * const sensor_list_,
+	const uint_opt8_t byte_length_
+) :
+	_loop(loop_),
+	_robot(robot_),
+	_sensor_list(sensor_list_),
+	_byte_length(byte_length_),
+	_rc(SUCCESS)
+{}
+
+bool
+query_awaiter::await_ready (
+	void
+) {
+	_rc = _robot.queryListAsync(_sensor_list, _byte_length, &_completion);
+	return ( SUCCESS != _rc );
+}
+
+void
+query_awaiter::await_suspend (
+	const std::coroutine_handle<> handle_
+) {
+	_loop._waiters.push_back({ handle_, &_completion, nullptr, 0, std::chrono::steady_clock::time_point::max() });
+}
+
+ReturnCode
+query_awaiter::await_resume (
+	void
+) {
+	return ( (SUCCESS == _rc) ? _completion.get() : _rc );
+}
+
+frame_awaiter::frame_awaiter (
+	event_loop & loop_,
+	state::robot_state & robot_state_
+) :
+	_loop(loop_),
+	_robot_state(robot_state_)
+{}
+
+void
+frame_awaiter::await_suspend (
+	const std::coroutine_handle<> handle_
+) {
+	_loop._waiters.push_back({ handle_, nullptr, &_robot_state, _robot_state.framesPublished(), std::chrono::steady_clock::time_point::max() });
+}
+
+state::sensor_snapshot_t
+frame_awaiter::await_resume (
+	void
+) {
+	state::sensor_snapshot_t snapshot;
+	_robot_state.getSensorSnapshot(&snapshot);
+	return snapshot;
+}
+
+sleep_awaiter::sleep_awaiter (
+	event_loop & loop_,
+	const std::chrono::steady_clock::duration duration_
+) :
+	_loop(loop_),
+	_duration(duration_)
+{}
+
+void
+sleep_awaiter::await_suspend (
+	const std::coroutine_handle<> handle_
+) {
+	_loop._waiters.push_back({ handle_, nullptr, nullptr, 0, (std::chrono::steady_clock::now() + _duration) });
+}
+
+event_loop::event_loop (
+	serial::posix::reactor & reactor_
+) :
+	_reactor(reactor_)
+{}
+
+/// \brief Test whether the condition awaited by a coroutine is met
+inline
+bool
+event_loop::_ready (
+	const waiter_t & waiter_,
+	const std::chrono::steady_clock::time_point now_
+) const {
+	if ( waiter_.completion ) { return ( std::future_status::ready == waiter_.completion->wait_for(std::chrono::seconds(0)) ); }
+	if ( waiter_.robot_state ) { return ( waiter_.robot_state->framesPublished() != waiter_.frames_published ); }
+	return ( now_ >= waiter_.wake_time );
+}
+
+/// \brief Shorten the wait of the reactor to the earliest sleep
+inline
+int
+event_loop::_timeoutMs (
+	const int timeout_ms_
+) const {
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	int timeout_ms = timeout_ms_;
+
+	for ( const waiter_t & waiter : _waiters ) {
+		if ( _ready(waiter, now) ) { return 0; }
+		// Wake periodically while a query is pending, so the reactor can expire it
+		if ( waiter.completion ) { timeout_ms = ( (timeout_ms < 0) ? QUERY_POLL_MS : std::min(timeout_ms, QUERY_POLL_MS) ); }
+		if ( std::chrono::steady_clock::time_point::max() == waiter.wake_time ) { continue; }
+		// Round up, so the sleep has elapsed once the reactor returns
+		const int sleep_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(waiter.wake_time - now + std::chrono::milliseconds(1) - std::chrono::nanoseconds(1)).count());
+		timeout_ms = ( (timeout_ms < 0) ? sleep_ms : std::min(timeout_ms, sleep_ms) );
+	}
+
+	return timeout_ms;
+}
+
+void
+event_loop::spawn (
+	task && task_
+) {
+	if ( task_.done() ) { return; }
+	_tasks.push_back(std::move(task_));
+}
+
+size_t
+event_loop::tasks (
+	void
+) const {
+	return _tasks.size();
+}
+
+size_t
+event_loop::poll (
+	const int timeout_ms_
+) {
+	_reactor.poll(_timeoutMs(timeout_ms_));
+
+	// Collect the ready coroutines first, a resumed coroutine may suspend again
+	std::vector<std::coroutine_handle<>> ready;
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for ( size_t i = 0 ; i < _waiters.size() ; ) {
+		if ( !_ready(_waiters[i], now) ) { ++i; continue; }
+		ready.push_back(_waiters[i].handle);
+		_waiters[i] = _waiters.back();
+		_waiters.pop_back();
+	}
+
+	for ( const std::coroutine_handle<> handle : ready ) { handle.resume(); }
+	_tasks.erase(std::remove_if(_tasks.begin(), _tasks.end(), [] (const task & task_) { return task_.done(); }), _tasks.end());
+
+	return ready.size();
+}
+
+ReturnCode
+event_loop::run (
+	void
+) {
+	while ( !_tasks.empty() ) {
+		poll(-1);
+	}
+
+	return SUCCESS;
+}
+
+sleep_awaiter
+event_loop::sleepFor (
+	const std::chrono::steady_clock::duration duration_
+) {
+	return sleep_awaiter(*this, duration_);
+}
+
+async_robot::async_robot (
+	event_loop & loop_,
+	robot<OI500> & robot_
+) :
+	_loop(loop_),
+	_robot(robot_)
+{}
+
+frame_awaiter
+async_robot::nextFrame (
+	void
+) {
+	return frame_awaiter(_loop, _robot.getState());
+}
+
+query_awaiter
+async_robot::query (
+	const sensor::PacketId * const sensor_list_,
+	const uint_opt8_t byte_length_
+) {
+	return query_awaiter(_loop, _robot, sensor_list_, byte_length_);
+}
+
+sleep_awaiter
+async_robot::sleepFor (
+	const std::chrono::steady_clock::duration duration_
+) {
+	return _loop.sleepFor(duration_);
+}
+
+} // namespace coro
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
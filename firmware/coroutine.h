@@ -0,0 +1,357 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef COROUTINE_H
+#define COROUTINE_H
+
+/// \brief Coroutine support is available
+/// \details Defined when compiling for Linux with C++20 coroutines
+/// (i.e. -std=c++20), otherwise this header declares nothing and the
+/// rest of the SDK is unaffected.
+#if defined(__linux__) && defined(__cpp_impl_coroutine) && defined(__has_include)
+  #if __has_include(<coroutine>)
+    #define ROOMBA_COROUTINES
+  #endif
+#endif
+
+#if defined(ROOMBA_COROUTINES)
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "defines.h"
+#include "reactor.h"
+#include "robot.h"
+#include "state.h"
+
+namespace roomba {
+
+/// \brief Coroutine interface
+/// \details Behaviors written as coroutines suspend on sensor data
+/// rather than block a thread in multiByteSerialRead(). A single
+/// event_loop drives the epoll reactor servicing the ttys of every
+/// Roomba, and resumes each coroutine once the data it awaits has been
+/// parsed, so thousands of behaviors share one thread.
+/// \code
+/// coro::task patrol (coro::async_robot & roomba_) {
+///     for (;;) {
+///         const state::sensor_snapshot_t snapshot = co_await roomba_.nextFrame();
+///         if ( state::get<sensor::BUMPS_AND_WHEEL_DROPS>(snapshot).value ) { roomba_->driveDirect(-100, 100); }
+///         co_await roomba_.sleepFor(std::chrono::milliseconds(15));
+///     }
+/// }
+/// \endcode
+/// \note The event loop, and every coroutine it resumes, run on the
+/// thread calling event_loop::run() or event_loop::poll().
+namespace coro {
+
+/// \brief A behavior running as a coroutine
+/// \details The coroutine starts immediately, and runs until it first
+/// suspends. A task is handed to event_loop::spawn(), which destroys the
+/// coroutine once it has finished.
+class task {
+  public:
+	struct promise_type {
+		task
+		get_return_object (
+			void
+		) {
+			return task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+
+		std::suspend_never
+		initial_suspend (
+			void
+		) noexcept {
+			return {};
+		}
+
+		std::suspend_always
+		final_suspend (
+			void
+		) noexcept {
+			return {};
+		}
+
+		void
+		return_void (
+			void
+		) {}
+
+		void
+		unhandled_exception (
+			void
+		);
+	};
+
+	task (task && task_) noexcept;
+	task & operator= (task && task_) noexcept;
+	~task (void);
+
+	/// \brief The coroutine has returned
+	bool
+	done (
+		void
+	) const;
+
+  private:
+	explicit
+	task (
+		const std::coroutine_handle<promise_type> handle_
+	);
+
+	task (const task &) = delete;
+	task & operator= (const task &) = delete;
+
+	std::coroutine_handle<promise_type> _handle; ///< coroutine frame (owned)
+};
+
+class event_loop;
+
+/// \brief Awaits the completion of a sensor query
+/// \details The query is written when awaited. The result of the
+/// co_await is SUCCESS once the response has been parsed, or the error
+/// reported by the query.
+/// \see robot::queryListAsync
+class query_awaiter {
+  public:
+	query_awaiter (
+		event_loop & loop_,
+		robot<OI500> & robot_,
+		const sensor::PacketId * const sensor_list_,
+		const uint_opt8_t byte_length_
+	);
+
+	bool
+	await_ready (
+		void
+	);
+
+	void
+	await_suspend (
+		const std::coroutine_handle<> handle_
+	);
+
+	ReturnCode
+	await_resume (
+		void
+	);
+
+  private:
+	event_loop & _loop; ///< loop resuming the coroutine
+	robot<OI500> & _robot; ///< robot queried
+	const sensor::PacketId * _sensor_list; ///< packet ids requested
+	uint_opt8_t _byte_length; ///< number of packet ids requested
+	ReturnCode _rc; ///< result of the request
+	std::future<ReturnCode> _completion; ///< completion of the query
+};
+
+/// \brief Awaits the next sensor update of a Roomba
+/// \details The result of the co_await is a snapshot of the sensor data,
+/// taken once a stream frame (or query response) is published after the
+/// co_await began.
+/// \see state::robot_state::getSensorSnapshot
+class frame_awaiter {
+  public:
+	frame_awaiter (
+		event_loop & loop_,
+		state::robot_state & robot_state_
+	);
+
+	bool
+	await_ready (
+		void
+	) const {
+		return false;
+	}
+
+	void
+	await_suspend (
+		const std::coroutine_handle<> handle_
+	);
+
+	state::sensor_snapshot_t
+	await_resume (
+		void
+	);
+
+  private:
+	event_loop & _loop; ///< loop resuming the coroutine
+	state::robot_state & _robot_state; ///< state of the Roomba
+};
+
+/// \brief Awaits the passage of time
+class sleep_awaiter {
+  public:
+	sleep_awaiter (
+		event_loop & loop_,
+		const std::chrono::steady_clock::duration duration_
+	);
+
+	bool
+	await_ready (
+		void
+	) const {
+		return false;
+	}
+
+	void
+	await_suspend (
+		const std::coroutine_handle<> handle_
+	);
+
+	void
+	await_resume (
+		void
+	) const {}
+
+  private:
+	event_loop & _loop; ///< loop resuming the coroutine
+	std::chrono::steady_clock::duration _duration; ///< time to sleep
+};
+
+/// \brief Resumes coroutines as the data they await arrives
+/// \details Polls the reactor, then resumes each suspended coroutine
+/// whose query has completed, whose Roomba has published a new sensor
+/// update, or whose sleep has elapsed. The reactor must service the tty
+/// of every Roomba awaited.
+/// \see serial::posix::reactor
+class event_loop {
+  public:
+	/// \param [in] reactor_ The reactor servicing the ttys
+	explicit
+	event_loop (
+		serial::posix::reactor & reactor_
+	);
+
+	/// \brief Hand a task to the loop
+	/// \details The loop owns the task, and destroys it once the
+	/// coroutine has returned.
+	void
+	spawn (
+		task && task_
+	);
+
+	/// \brief The number of tasks which have not returned
+	size_t
+	tasks (
+		void
+	) const;
+
+	/// \brief Service the reactor once, then resume the ready coroutines
+	/// \param [in] timeout_ms_ Maximum time to wait for data (-1 waits
+	/// until data arrives or a sleep elapses)
+	/// \return The number of coroutines resumed
+	size_t
+	poll (
+		const int timeout_ms_
+	);
+
+	/// \brief Run the loop until every task has returned
+	/// \return SUCCESS
+	ReturnCode
+	run (
+		void
+	);
+
+	/// \brief Awaitable sleep
+	sleep_awaiter
+	sleepFor (
+		const std::chrono::steady_clock::duration duration_
+	);
+
+  private:
+	friend class frame_awaiter;
+	friend class query_awaiter;
+	friend class sleep_awaiter;
+
+	/// \brief A suspended coroutine and the condition resuming it
+	struct waiter_t {
+		std::coroutine_handle<> handle; ///< suspended coroutine
+		std::future<ReturnCode> * completion; ///< query awaited (or nullptr)
+		state::robot_state * robot_state; ///< Roomba awaited (or nullptr)
+		uint_opt32_t frames_published; ///< updates published when suspended
+		std::chrono::steady_clock::time_point wake_time; ///< end of a sleep
+	};
+
+	event_loop (const event_loop &) = delete;
+	event_loop & operator= (const event_loop &) = delete;
+
+	bool
+	_ready (
+		const waiter_t & waiter_,
+		const std::chrono::steady_clock::time_point now_
+	) const;
+
+	int
+	_timeoutMs (
+		const int timeout_ms_
+	) const;
+
+	serial::posix::reactor & _reactor; ///< reactor servicing the ttys
+	std::vector<task> _tasks; ///< tasks owned by the loop
+	std::vector<waiter_t> _waiters; ///< suspended coroutines
+};
+
+/// \brief A Roomba driven by coroutines
+/// \details Commands are issued directly on the robot (they do not wait
+/// for the Roomba), sensor data is awaited.
+class async_robot {
+  public:
+	/// \param [in] loop_ The loop resuming the coroutines
+	/// \param [in] robot_ The Roomba, whose tty is attached to the
+	/// reactor of the loop
+	async_robot (
+		event_loop & loop_,
+		robot<OI500> & robot_
+	);
+
+	/// \brief Access the robot to issue commands
+	robot<OI500> *
+	operator-> (
+		void
+	) const {
+		return &_robot;
+	}
+
+	/// \brief Awaitable sensor update
+	/// \see frame_awaiter
+	frame_awaiter
+	nextFrame (
+		void
+	);
+
+	/// \brief Awaitable query
+	/// \param [in] sensor_list_ An array of packet ids (which must
+	/// remain valid until the co_await begins)
+	/// \param [in] byte_length_ The length of the array
+	/// \see query_awaiter
+	query_awaiter
+	query (
+		const sensor::PacketId * const sensor_list_,
+		const uint_opt8_t byte_length_
+	);
+
+	/// \brief Awaitable sleep
+	/// \see event_loop::sleepFor
+	sleep_awaiter
+	sleepFor (
+		const std::chrono::steady_clock::duration duration_
+	);
+
+  private:
+	event_loop & _loop; ///< loop resuming the coroutines
+	robot<OI500> & _robot; ///< the Roomba
+};
+
+} // namespace coro
+} // namespace roomba
+
+#endif
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -69,6 +69,24 @@ enum BaudCode : uint_opt8_t {
 	BAUD_115200,
 };
 
+/// \brief Baud rate of each baud code
+/// \details The baud rate represented as an integer value, indexed by
+/// BaudCode
+constexpr uint_opt32_t BAUD_RATE[] = {
+	300,     // BAUD_300
+	600,     // BAUD_600
+	1200,    // BAUD_1200
+	2400,    // BAUD_2400
+	4800,    // BAUD_4800
+	9600,    // BAUD_9600
+	14400,   // BAUD_14400
+	19200,   // BAUD_19200
+	28800,   // BAUD_28800
+	38400,   // BAUD_38400
+	57600,   // BAUD_57600
+	115200,  // BAUD_115200
+};
+
 /// \brief Song (OpCode 140)
 enum Pitch : uint_opt8_t {
 	REST = 30,
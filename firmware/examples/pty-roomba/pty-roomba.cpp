@@ -0,0 +1,80 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+// Serves a simulated Roomba on a pseudo-terminal until interrupted.
+//
+//   g++ -std=c++11 -pthread -I../.. pty-roomba.cpp ../../pty_roomba.cpp ../../virtual_roomba.cpp -o pty-roomba
+//   ./pty-roomba [-b baud_code] [-t] [-c corrupt_probability] [-d drop_probability] [-s seed]
+//
+// The path of the slave device is printed, open it as /dev/ttyUSB0 would be.
+
+#include "pty_roomba.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+
+#include <unistd.h>
+
+namespace {
+	volatile std::sig_atomic_t interrupted = 0;
+
+	void
+	interrupt (
+		int
+	) {
+		interrupted = 1;
+	}
+} // namespace
+
+int
+main (
+	int argc,
+	char * argv[]
+) {
+	roomba::BaudCode baud_code = roomba::BAUD_115200;
+	bool throttle = false;
+	double corrupt_probability = 0.0;
+	double drop_probability = 0.0;
+	unsigned long seed = 0;
+
+	for ( int option ; -1 != (option = ::getopt(argc, argv, "b:c:d:s:t")) ; ) {
+		switch ( option ) {
+		  case 'b': baud_code = static_cast<roomba::BaudCode>(std::strtoul(optarg, nullptr, 10)); break;
+		  case 'c': corrupt_probability = std::strtod(optarg, nullptr); break;
+		  case 'd': drop_probability = std::strtod(optarg, nullptr); break;
+		  case 's': seed = std::strtoul(optarg, nullptr, 10); break;
+		  case 't': throttle = true; break;
+		  default:
+			std::fprintf(stderr, "usage: %s [-b baud_code] [-t] [-c corrupt_probability] [-d drop_probability] [-s seed]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if ( baud_code > roomba::BAUD_115200 ) {
+		std::fprintf(stderr, "invalid baud code (0-%d)\n", roomba::BAUD_115200);
+		return EXIT_FAILURE;
+	}
+
+	roomba::serial::posix::pty_roomba simulation(baud_code, throttle);
+	if ( roomba::SUCCESS != simulation.injectErrors(corrupt_probability, drop_probability, static_cast<uint_opt32_t>(seed)) ) {
+		std::fprintf(stderr, "invalid probability (0.0-1.0)\n");
+		return EXIT_FAILURE;
+	}
+	if ( roomba::SUCCESS != simulation.open() ) {
+		std::perror("pty");
+		return EXIT_FAILURE;
+	}
+
+	std::signal(SIGINT, interrupt);
+	std::signal(SIGTERM, interrupt);
+	std::printf("%s\n", simulation.devicePath());
+	std::fflush(stdout);
+
+	while ( !interrupted ) { ::pause(); }
+
+	std::fprintf(stderr, "bytes corrupted: %zu, bytes dropped: %zu\n", simulation.bytesCorrupted(), simulation.bytesDropped());
+	simulation.close();
+
+	return EXIT_SUCCESS;
+}
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
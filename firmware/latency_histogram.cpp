@@ -0,0 +1,135 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace roomba {
+namespace state {
+
+namespace {
+	/// \brief Linear sub-buckets per power of two
+	const uint_opt64_t SUB_BUCKET_COUNT(1ULL << latency_histogram::SUB_BUCKET_BITS);
+
+	/// \brief Largest value counted in its own bucket (in microseconds)
+	const uint_opt64_t VALUE_MAX((1ULL << latency_histogram::MAGNITUDE_MAX) - 1);
+
+	/// \brief Calculate the bucket of a value
+	/// \details Values below 2 * SUB_BUCKET_COUNT have a bucket each,
+	/// above that each power of two is split into SUB_BUCKET_COUNT
+	/// buckets of equal width.
+	/// \param [in] value_us_ The value (clamped to VALUE_MAX)
+	/// \return The index of the bucket
+	inline
+	size_t
+	_bucketIndex (
+		const uint_opt64_t value_us_
+	) {
+		const uint_opt64_t value = std::min(value_us_, VALUE_MAX);
+		uint_opt8_t shift(0);
+		while ( (value >> shift) >= (2 * SUB_BUCKET_COUNT) ) { ++shift; }
+		return static_cast<size_t>((shift * SUB_BUCKET_COUNT) + (value >> shift));
+	}
+
+	/// \brief Largest value counted in a bucket
+	/// \param [in] index_ The index of the bucket
+	/// \return The value (in microseconds)
+	inline
+	uint_opt64_t
+	_highestEquivalentValue (
+		const size_t index_
+	) {
+		const uint_opt8_t shift = static_cast<uint_opt8_t>( (index_ < (2 * SUB_BUCKET_COUNT)) ? 0 : ((index_ / SUB_BUCKET_COUNT) - 1) );
+		const uint_opt64_t sub_bucket = (index_ - (shift * SUB_BUCKET_COUNT));
+		return (((sub_bucket + 1) << shift) - 1);
+	}
+} // namespace
+
+latency_histogram::latency_histogram (
+	void
+) {
+	reset();
+}
+
+uint_opt64_t
+latency_histogram::count (
+	void
+) const {
+	return _count.load(std::memory_order_relaxed);
+}
+
+std::chrono::microseconds
+latency_histogram::max (
+	void
+) const {
+	return std::chrono::microseconds(_max_us.load(std::memory_order_relaxed));
+}
+
+std::chrono::microseconds
+latency_histogram::mean (
+	void
+) const {
+	const uint_opt64_t count = _count.load(std::memory_order_relaxed);
+	if ( !count ) { return std::chrono::microseconds(0); }
+	return std::chrono::microseconds(_sum_us.load(std::memory_order_relaxed) / count);
+}
+
+std::chrono::microseconds
+latency_histogram::min (
+	void
+) const {
+	const uint_opt64_t min_us = _min_us.load(std::memory_order_relaxed);
+	if ( std::numeric_limits<uint_opt64_t>::max() == min_us ) { return std::chrono::microseconds(0); }
+	return std::chrono::microseconds(min_us);
+}
+
+void
+latency_histogram::record (
+	const std::chrono::microseconds latency_
+) {
+	const uint_opt64_t value_us = static_cast<uint_opt64_t>(std::max<std::chrono::microseconds::rep>(latency_.count(), 0));
+
+	_buckets[_bucketIndex(value_us)].fetch_add(1, std::memory_order_relaxed);
+	_sum_us.fetch_add(value_us, std::memory_order_relaxed);
+	for ( uint_opt64_t min_us = _min_us.load(std::memory_order_relaxed) ; value_us < min_us && !_min_us.compare_exchange_weak(min_us, value_us, std::memory_order_relaxed) ; );
+	for ( uint_opt64_t max_us = _max_us.load(std::memory_order_relaxed) ; value_us > max_us && !_max_us.compare_exchange_weak(max_us, value_us, std::memory_order_relaxed) ; );
+	_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+latency_histogram::reset (
+	void
+) {
+	for ( size_t i = 0 ; i < BUCKET_COUNT ; ++i ) { _buckets[i].store(0, std::memory_order_relaxed); }
+	_count.store(0, std::memory_order_relaxed);
+	_sum_us.store(0, std::memory_order_relaxed);
+	_min_us.store(std::numeric_limits<uint_opt64_t>::max(), std::memory_order_relaxed);
+	_max_us.store(0, std::memory_order_relaxed);
+}
+
+std::chrono::microseconds
+latency_histogram::valueAtPercentile (
+	const double percentile_
+) const {
+	const uint_opt64_t count = _count.load(std::memory_order_relaxed);
+	if ( !count ) { return std::chrono::microseconds(0); }
+
+	// The rank of the value, counting from one
+	const double percentile = std::min(std::max(percentile_, 0.0), 100.0);
+	const uint_opt64_t rank = std::max<uint_opt64_t>(static_cast<uint_opt64_t>(std::ceil((percentile / 100.0) * count)), 1);
+
+	uint_opt64_t values_counted(0);
+	for ( size_t i = 0 ; i < BUCKET_COUNT ; ++i ) {
+		values_counted += _buckets[i].load(std::memory_order_relaxed);
+		if ( values_counted >= rank ) { return std::min(std::chrono::microseconds(_highestEquivalentValue(i)), max()); }
+	}
+
+	return max();
+}
+
+} // namespace state
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,121 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "defines.h"
+
+namespace roomba {
+namespace state {
+
+/// \brief The latencies measured from a drive command
+/// \details Each interval begins when driveDirect() writes the command,
+/// and ends when the first stream frame reflecting it (by its
+/// requested right and left velocities) reaches a stage of the parser.
+/// \see robot_state::getLatencyHistogram
+enum LatencyInterval : uint_opt8_t {
+	WRITE_TO_FIRST_BYTE = 0, ///< the header of the frame is seen by the parser
+	WRITE_TO_FRAME_COMPLETE, ///< the checksum of the frame is validated
+	WRITE_TO_SNAPSHOT, ///< the snapshot of the frame is published
+	LATENCY_INTERVAL_COUNT,
+};
+
+/// \brief A histogram of latencies, in the manner of HdrHistogram
+/// \details Values (in microseconds) are counted in log-linear buckets:
+/// every power of two is divided into 32 linear sub-buckets, so any
+/// recorded value is reported within 1/32 (3.2%) of its true value,
+/// from 1 us to a little over an hour. Values beyond the range are
+/// counted in the last bucket.
+/// \n Recording is wait-free (a few relaxed atomic operations), and the
+/// histogram may be read by any thread while it is being recorded.
+/// \note A read concurrent with a recording may miss that recording.
+class latency_histogram {
+  public:
+	latency_histogram (
+		void
+	);
+
+	/// \brief The number of values recorded
+	uint_opt64_t
+	count (
+		void
+	) const;
+
+	/// \brief The largest value recorded
+	/// \return The value, or zero when no value has been recorded
+	std::chrono::microseconds
+	max (
+		void
+	) const;
+
+	/// \brief The mean of the values recorded
+	/// \return The value, or zero when no value has been recorded
+	std::chrono::microseconds
+	mean (
+		void
+	) const;
+
+	/// \brief The smallest value recorded
+	/// \return The value, or zero when no value has been recorded
+	std::chrono::microseconds
+	min (
+		void
+	) const;
+
+	/// \brief Count a value
+	/// \param [in] latency_ The value to count (negative values are
+	/// counted as zero)
+	void
+	record (
+		const std::chrono::microseconds latency_
+	);
+
+	/// \brief Discard the values recorded
+	/// \note Values recorded concurrently may be partially retained.
+	void
+	reset (
+		void
+	);
+
+	/// \brief The value at or below which a percentage of the values fall
+	/// \details The largest value equivalent to the bucket of the
+	/// percentile is returned (never more than the largest value
+	/// recorded), as HdrHistogram does.
+	/// \param [in] percentile_ The percentage of values (0.0-100.0)
+	/// \return The value, or zero when no value has been recorded
+	std::chrono::microseconds
+	valueAtPercentile (
+		const double percentile_
+	) const;
+
+	/// \brief Linear sub-buckets per power of two (as a power of two)
+	static const uint_opt8_t SUB_BUCKET_BITS = 5;
+
+	/// \brief Largest power of two counted (2^32 us)
+	static const uint_opt8_t MAGNITUDE_MAX = 32;
+
+	/// \brief The number of buckets
+	static const size_t BUCKET_COUNT = (((MAGNITUDE_MAX - SUB_BUCKET_BITS) + 1) << SUB_BUCKET_BITS);
+
+  private:
+	latency_histogram (const latency_histogram &) = delete;
+	latency_histogram & operator= (const latency_histogram &) = delete;
+
+	std::atomic<uint_opt32_t> _buckets[BUCKET_COUNT]; ///< count of the values in each bucket
+	std::atomic<uint_opt64_t> _count; ///< values recorded
+	std::atomic<uint_opt64_t> _sum_us; ///< sum of the values recorded
+	std::atomic<uint_opt64_t> _min_us; ///< smallest value recorded (UINT64_MAX when empty)
+	std::atomic<uint_opt64_t> _max_us; ///< largest value recorded
+};
+
+} // namespace state
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -1,23 +1,30 @@
 /* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
 
 #include "open_interface.h"
-
-#include <chrono>
-#include <thread>
+#include "robot.h"
 
 namespace roomba {
 
+namespace {
+	/// \brief The Roomba attached to the platform serial port
+	/// \details Constructed on first use, it shares the sensor state
+	/// accessed by the free functions of the state namespace.
+	inline
+	robot<OI500> &
+	_platformRobot (
+		void
+	) {
+		static robot<OI500> platform_robot(state::getPlatformRobotState());
+		return platform_robot;
+	}
+} // namespace
+
 template<>
 ReturnCode
 open_interface<OI500>::start (
 	void
 ) {
-	const uint_opt8_t serial_data[1] = { command::START };
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	state::setOIMode(PASSIVE);
-	
-	return SUCCESS;
+	return _platformRobot().start();
 }
 
 template<>
@@ -25,18 +32,7 @@ ReturnCode
 open_interface<OI500>::baud (
 	const BaudCode baud_code_
 ) {
-	const uint_opt8_t serial_data[2] = { command::BAUD, baud_code_ };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	if ( baud_code_ > 11 ) { return INVALID_PARAMETER; }
-
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-#ifdef SENSORS_ENABLED
-	state::setBaudCode(baud_code_);
-#endif
-
-	std::this_thread::sleep_for(std::chrono::milliseconds(100));
-	return SUCCESS;
+	return _platformRobot().baud(baud_code_);
 }
 
 template<>
@@ -44,13 +40,7 @@ ReturnCode
 open_interface<OI500>::safe (
 	void
 ) {
-	const uint_opt8_t serial_data[1] = { command::SAFE };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	state::setOIMode(SAFE);
-	
-	return SUCCESS;
+	return _platformRobot().safe();
 }
 
 template<>
@@ -58,7 +48,7 @@ ReturnCode
 open_interface<OI500>::control (
 	void
 ) {
-	return safe();
+	return _platformRobot().control();
 }
 
 template<>
@@ -66,13 +56,7 @@ ReturnCode
 open_interface<OI500>::full (
 	void
 ) {
-	const uint_opt8_t serial_data[1] = { command::FULL };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	state::setOIMode(FULL);
-	
-	return SUCCESS;
+	return _platformRobot().full();
 }
 
 template<>
@@ -80,13 +64,7 @@ ReturnCode
 open_interface<OI500>::clean (
 	void
 ) {
-	const uint_opt8_t serial_data[1] = { command::CLEAN };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	state::setOIMode(PASSIVE);
-	
-	return SUCCESS;
+	return _platformRobot().clean();
 }
 
 template<>
@@ -94,13 +72,7 @@ ReturnCode
 open_interface<OI500>::max (
 	void
 ) {
-	const uint_opt8_t serial_data[1] = { command::MAX };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	state::setOIMode(PASSIVE);
-	
-	return SUCCESS;
+	return _platformRobot().max();
 }
 
 template<>
@@ -108,13 +80,7 @@ ReturnCode
 open_interface<OI500>::spot (
 	void
 ) {
-	const uint_opt8_t serial_data[1] = { command::SPOT };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	state::setOIMode(PASSIVE);
-	
-	return SUCCESS;
+	return _platformRobot().spot();
 }
 
 template<>
@@ -122,13 +88,7 @@ ReturnCode
 open_interface<OI500>::seekDock (
 	void
 ) {
-	const uint_opt8_t serial_data[1] = { command::SEEK_DOCK };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	state::setOIMode(PASSIVE);
-	
-	return SUCCESS;
+	return _platformRobot().seekDock();
 }
 
 template<>
@@ -137,22 +97,7 @@ open_interface<OI500>::schedule (
 	const bitmask::Days day_mask_,
 	const clock_time_t * const clock_times_
 ) {
-	uint_opt8_t serial_data[16] = { command::SCHEDULE };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	
-	if ( day_mask_ && clock_times_ ) {
-		serial_data[1] = static_cast<bitmask::Days>(day_mask_ & 0x7F);
-		for (uint_opt8_t day = 0, parameter_index = 0, serial_index = 2 ; day < 7 ; ++day, parameter_index += ((day_mask_ >> day) & 1), serial_index = ((2 * day) + 2)) {
-			// Test conditions without branching logic to allow for code pipelining and parallel execution with loop unroll
-			const bool valid = (((day_mask_ >> day) & 1) && (clock_times_[parameter_index].hour >= 0 && clock_times_[parameter_index].hour < 23) && (clock_times_[parameter_index].minute >= 0 && clock_times_[parameter_index].minute <= 59));
-			*reinterpret_cast<uint_opt16_t *>(&serial_data[serial_index]) = (valid * (*reinterpret_cast<const uint_opt16_t *>(&clock_times_[parameter_index])));
-			serial_data[1] &= ~(!valid << day);
-		}
-	}
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().schedule(day_mask_, clock_times_);
 }
 
 template<>
@@ -161,13 +106,7 @@ open_interface<OI500>::setDayTime (
 	const Day day_,
 	const clock_time_t clock_time_
 ) {
-	const uint_opt8_t serial_data[4] = { command::SET_DAY_TIME, day_, clock_time_.hour, clock_time_.minute };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	if ( clock_time_.hour < 0 || clock_time_.hour > 23 || clock_time_.minute < 0 || clock_time_.minute > 59 ) { return INVALID_PARAMETER; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().setDayTime(day_, clock_time_);
 }
 
 template<>
@@ -175,13 +114,7 @@ ReturnCode
 open_interface<OI500>::power (
 	void
 ) {
-	const uint_opt8_t serial_data[1] = { command::POWER };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	state::setOIMode(PASSIVE);
-	
-	return SUCCESS;
+	return _platformRobot().power();
 }
 
 template<>
@@ -190,14 +123,7 @@ open_interface<OI500>::drive (
 	const int_opt16_t velocity_,
 	const int_opt16_t radius_
 ) {
-	const uint_opt8_t serial_data[5] = { command::DRIVE, reinterpret_cast<const uint_opt8_t *>(&velocity_)[1], reinterpret_cast<const uint_opt8_t *>(&velocity_)[0], reinterpret_cast<const uint_opt8_t *>(&radius_)[1], reinterpret_cast<const uint_opt8_t *>(&radius_)[0] };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	if ( velocity_ < -500 || velocity_ > 500 || (radius_ != 32767 && (radius_ < -2000 || radius_ > 2000)) ) { return INVALID_PARAMETER; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().drive(velocity_, radius_);
 }
 
 template<>
@@ -206,14 +132,7 @@ open_interface<OI500>::driveDirect (
 	const int_opt16_t left_wheel_velocity_,
 	const int_opt16_t right_wheel_velocity_
 ) {
-	const uint_opt8_t serial_data[5] = { command::DRIVE_DIRECT, reinterpret_cast<const uint_opt8_t *>(&right_wheel_velocity_)[1], reinterpret_cast<const uint_opt8_t *>(&right_wheel_velocity_)[0], reinterpret_cast<const uint_opt8_t *>(&left_wheel_velocity_)[1], reinterpret_cast<const uint_opt8_t *>(&left_wheel_velocity_)[0] };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	if ( left_wheel_velocity_ < -500 || left_wheel_velocity_ > 500 || right_wheel_velocity_ < -500 || right_wheel_velocity_ > 500 ) { return INVALID_PARAMETER; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().driveDirect(left_wheel_velocity_, right_wheel_velocity_);
 }
 
 template<>
@@ -222,14 +141,7 @@ open_interface<OI500>::drivePWM (
 	const int_opt16_t left_wheel_pwm_,
 	const int_opt16_t right_wheel_pwm_
 ) {
-	const uint_opt8_t serial_data[5] = { command::DRIVE_PWM, reinterpret_cast<const uint_opt8_t *>(&right_wheel_pwm_)[1], reinterpret_cast<const uint_opt8_t *>(&right_wheel_pwm_)[0], reinterpret_cast<const uint_opt8_t *>(&left_wheel_pwm_)[1], reinterpret_cast<const uint_opt8_t *>(&left_wheel_pwm_)[0] };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	if ( left_wheel_pwm_ < -255 || left_wheel_pwm_ > 255 || right_wheel_pwm_ < -255 || right_wheel_pwm_ > 255 ) { return INVALID_PARAMETER; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().drivePWM(left_wheel_pwm_, right_wheel_pwm_);
 }
 
 template<>
@@ -237,13 +149,7 @@ ReturnCode
 open_interface<OI500>::motors (
 	const bitmask::MotorStates motor_state_mask_
 ) {
-	const uint_opt8_t serial_data[2] = { command::MOTORS, static_cast<const uint_opt8_t>(motor_state_mask_ & 0x1F) };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().motors(motor_state_mask_);
 }
 
 template<>
@@ -253,14 +159,7 @@ open_interface<OI500>::pwmMotors (
 	const int_opt8_t side_brush_,
 	const int_opt8_t vacuum_
 ) {
-	const uint_opt8_t serial_data[4] = { command::PWM_MOTORS, static_cast<const uint_opt8_t>(main_brush_), static_cast<const uint_opt8_t>(side_brush_), static_cast<const uint_opt8_t>(vacuum_) };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	if ( -128 == main_brush_ || -128 == side_brush_ || vacuum_ < 0 ) { return INVALID_PARAMETER; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().pwmMotors(main_brush_, side_brush_, vacuum_);
 }
 
 template<>
@@ -270,13 +169,7 @@ open_interface<OI500>::leds (
 	const uint_opt8_t color_,
 	const uint_opt8_t intensity_
 ) {
-	const uint_opt8_t serial_data[4] = { command::LEDS, static_cast<const bitmask::display::LEDs>(led_mask_ & 0x0F), color_, intensity_ };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().leds(led_mask_, color_, intensity_);
 }
 
 template<>
@@ -285,13 +178,7 @@ open_interface<OI500>::schedulingLEDs (
 	const bitmask::Days day_mask_,
 	const bitmask::display::SchedulingLEDs display_mask_
 ) {
-	const uint_opt8_t serial_data[3] = { command::SCHEDULING_LEDS, static_cast<const bitmask::Days>(day_mask_ & 0x7F), static_cast<const bitmask::display::SchedulingLEDs>(display_mask_ & 0x1F) };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().schedulingLEDs(day_mask_, display_mask_);
 }
 
 template<>
@@ -299,13 +186,7 @@ ReturnCode
 open_interface<OI500>::digitLEDsRaw (
 	const bitmask::display::DigitN raw_leds_[4]
 ) {
-	const uint_opt8_t serial_data[5] = { command::DIGIT_LEDS_RAW, static_cast<const bitmask::display::DigitN>(raw_leds_[0] & 0x7F), static_cast<const bitmask::display::DigitN>(raw_leds_[1] & 0x7F), static_cast<const bitmask::display::DigitN>(raw_leds_[2] & 0x7F), static_cast<const bitmask::display::DigitN>(raw_leds_[3] & 0x7F) };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().digitLEDsRaw(raw_leds_);
 }
 
 template<>
@@ -313,14 +194,7 @@ ReturnCode
 open_interface<OI500>::digitLEDsASCII (
 	const char ascii_leds_[4]
 ) {
-	const uint_opt8_t serial_data[5] = { command::DIGIT_LEDS_ASCII, static_cast<const uint_opt8_t>(ascii_leds_[0]), static_cast<const uint_opt8_t>(ascii_leds_[1]), static_cast<const uint_opt8_t>(ascii_leds_[2]), static_cast<const uint_opt8_t>(ascii_leds_[3]) };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	if ( ascii_leds_[0] < 32 || ascii_leds_[0] > 126 || ascii_leds_[1] < 32 || ascii_leds_[1] > 126 || ascii_leds_[2] < 32 || ascii_leds_[2] > 126 || ascii_leds_[3] < 32 || ascii_leds_[3] > 126 ) { return INVALID_PARAMETER; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().digitLEDsASCII(ascii_leds_);
 }
 
 template<>
@@ -328,12 +202,7 @@ ReturnCode
 open_interface<OI500>::buttons (
 	const bitmask::Buttons button_mask_
 ) {
-	const uint_opt8_t serial_data[2] = { command::BUTTONS, button_mask_ };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().buttons(button_mask_);
 }
 
 template<>
@@ -343,23 +212,7 @@ open_interface<OI500>::song (
 	const note_t * const song_,
 	const uint_opt8_t note_count_
 ) {
-	uint_opt8_t serial_data[(3 + (note_count_ * 2))];
-	uint_opt8_t data_index = 2;
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	if ( song_number_ > 4 || !song_ || !note_count_ || note_count_ > 16 ) { return INVALID_PARAMETER; }
-	
-	serial_data[0] = command::SONG;
-	serial_data[1] = song_number_;
-	serial_data[2] = note_count_;
-	
-	for (uint_opt8_t i = 0 ; i < note_count_ ; ++i ) {
-		serial_data[++data_index] = song_[i].pitch;
-		serial_data[++data_index] = song_[i].duration;
-	}
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().song(song_number_, song_, note_count_);
 }
 
 template<>
@@ -367,14 +220,7 @@ ReturnCode
 open_interface<OI500>::play (
 	const uint_opt8_t song_number_
 ) {
-	const uint_opt8_t serial_data[2] = { command::PLAY, song_number_ };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
-	if ( song_number_ > 4 ) { return INVALID_PARAMETER; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().play(song_number_);
 }
 
 template<>
@@ -382,16 +228,7 @@ ReturnCode
 open_interface<OI500>::sensors (
 	const sensor::PacketId packet_id_
 ) {
-	const uint_opt8_t serial_data[2] = { command::SENSORS, packet_id_ };
-	// Ensure this is called after serial::multiByteSerialWrite() and SUCCESS is returned
-	//const uint_opt8_t parse_key[2] = { sizeof(parse_key), packet_id_ };
-	//state::setParseKey(parse_key);
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	if ( (packet_id_ > 58 && packet_id_ < 100) || packet_id_ > 107 ) { return INVALID_PARAMETER; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().sensors(packet_id_);
 }
 
 template<>
@@ -401,24 +238,7 @@ open_interface<OI500>::pollSensors (
 	const sensor::PacketId * const sensor_list_,
 	const uint_opt8_t byte_length_
 ) {
-	if ( !sensor_list_ ) { return INVALID_PARAMETER; }
-	uint_opt8_t serial_data[(2 + byte_length_)];
-	uint_opt8_t data_index = 1;
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
-	if ( command::QUERY_LIST != opcode_ && command::STREAM != opcode_ ) { return INVALID_PARAMETER; }
-	
-	serial_data[0] = opcode_;
-	serial_data[1] = byte_length_;
-	
-	for (uint_opt8_t i = 0 ; i < byte_length_ ; ++i ) {
-		if ( (sensor_list_[i] > 58 && sensor_list_[i] < 100) || sensor_list_[i] > 107 ) { continue; }
-		serial_data[++data_index] = sensor_list_[i];
-	}
-	if ( 1 == data_index ) { return INVALID_PARAMETER; }
-	
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+	return _platformRobot().pollSensors(opcode_, sensor_list_, byte_length_);
 }
 
 template<>
@@ -427,7 +247,7 @@ open_interface<OI500>::queryList (
 	const sensor::PacketId * const sensor_list_,
 	const uint_opt8_t byte_length_
 ) {
-	return open_interface<OI500>::pollSensors(command::QUERY_LIST, sensor_list_, byte_length_);
+	return _platformRobot().queryList(sensor_list_, byte_length_);
 }
 
 template<>
@@ -436,7 +256,7 @@ open_interface<OI500>::stream (
 	const sensor::PacketId * const sensor_list_,
 	const uint_opt8_t byte_length_
 ) {
-	return open_interface<OI500>::pollSensors(command::STREAM, sensor_list_, byte_length_);
+	return _platformRobot().stream(sensor_list_, byte_length_);
 }
 
 template<>
@@ -444,12 +264,23 @@ ReturnCode
 open_interface<OI500>::pauseResumeStream (
 	const bool resume_
 ) {
-	const uint_opt8_t serial_data[2] = { command::PAUSE_RESUME_STREAM, resume_ };
-	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	return _platformRobot().pauseResumeStream(resume_);
+}
 
-	if ( !serial::multiByteSerialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
-	
-	return SUCCESS;
+template<>
+ReturnCode
+open_interface<OI500>::beginBatch (
+	void
+) {
+	return _platformRobot().beginBatch();
+}
+
+template<>
+ReturnCode
+open_interface<OI500>::endBatch (
+	void
+) {
+	return _platformRobot().endBatch();
 }
 
 } // namespace roomba
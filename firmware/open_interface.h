@@ -135,7 +135,7 @@ class open_interface {
 	
 	/// \brief Starts the Max cleaning mode.
 	/// \note Available in modes: Passive, Safe, or Full.
-	/// \note Changes mode to: Passive.
+	/// \note Changes mode to: Passive.
 	/// \retval SUCCESS
 	/// \retval OI_NOT_STARTED
 	/// \retval SERIAL_TRANSFER_FAILURE
@@ -147,7 +147,7 @@ class open_interface {
 	
 	/// \brief Starts the Spot cleaning mode.
 	/// \note Available in modes: Passive, Safe, or Full.
-	/// \note Changes mode to: Passive.
+	/// \note Changes mode to: Passive.
 	/// \retval SUCCESS
 	/// \retval OI_NOT_STARTED
 	/// \retval SERIAL_TRANSFER_FAILURE
@@ -242,7 +242,7 @@ class open_interface {
 	/// Turn in place clockwise = -1
 	/// \par
 	/// Turn in place counter-clockwise = 1
-	/// \note Available in modes: Safe or Full.
+	/// \note Available in modes: Safe or Full.
 	/// \warning Internal and environmental restrictions may prevent Roomba
 	/// from accurately carrying out some drive commands.
 	/// \retval SUCCESS
@@ -308,7 +308,7 @@ class open_interface {
 	/// maximum speed when enabled. The main brush and side brush can be run in
 	/// either direction. The vacuum only runs forward.
 	/// \param [in] motor_state_mask_
-	/// \note Available in modes: Safe or Full.
+	/// \note Available in modes: Safe or Full.
 	/// \retval SUCCESS
 	/// \retval OI_NOT_STARTED
 	/// \retval INVALID_MODE_FOR_REQUESTED_OPERATION
@@ -334,7 +334,7 @@ class open_interface {
 	/// \note The main brush and side brush can be run in either direction.
 	/// \note Default direction for the side brush is counter-clockwise.
 	/// \note Default direction for the main brush/flapper is inward.
-	/// \note Available in modes: Safe or Full.
+	/// \note Available in modes: Safe or Full.
 	/// \retval SUCCESS
 	/// \retval OI_NOT_STARTED
 	/// \retval INVALID_MODE_FOR_REQUESTED_OPERATION
@@ -377,7 +377,7 @@ class open_interface {
 	/// \param [in] day_mask_
 	/// \param [in] led_mask_
 	/// \note All use red LEDs
-	/// \note Available in modes: Safe or Full.
+	/// \note Available in modes: Safe or Full.
 	/// \retval SUCCESS
 	/// \retval OI_NOT_STARTED
 	/// \retval INVALID_MODE_FOR_REQUESTED_OPERATION
@@ -501,7 +501,7 @@ class open_interface {
 	/// of the sensor data. Values of 0 through 6 and 101
 	/// through 107 indicate specific subgroups of the sensor
 	/// data.
-	/// \note Available in modes: Passive, Safe, or Full.
+	/// \note Available in modes: Passive, Safe, or Full.
 	/// \retval SUCCESS
 	/// \retval OI_NOT_STARTED
 	/// \retval INVALID_PARAMETER
@@ -548,6 +548,7 @@ class open_interface {
 	/// stream will eventually become corrupted. This can be
 	/// confirmed by checking the checksum.
 	/// \see open_interface::pauseResumeStream
+	/// \see serial::uart_scheduler
 	/// \retval SUCCESS
 	/// \retval OI_NOT_STARTED
 	/// \retval INVALID_PARAMETER
@@ -577,6 +578,42 @@ class open_interface {
 		const bool resume_
 	);
 	
+	/// \brief Begin a batch of commands.
+	/// \details Until endBatch() is called, each command is
+	/// validated as usual, and returns the same ReturnCode, but
+	/// its bytes are appended to a preallocated output buffer
+	/// rather than written to the serial bus. endBatch() sends
+	/// the entire batch in a single write, which saves a system
+	/// call and a driver transaction for every command (i.e. a
+	/// control tick of driveDirect(), leds(), pwmMotors() and
+	/// digitLEDsASCII() becomes one write).
+	/// \note A batch exceeding the buffer is sent in several
+	/// writes, in order.
+	/// \note baud() is a barrier: the commands batched before it,
+	/// and its opcode, are written before the serial port changes
+	/// rate.
+	/// \warning Do not query sensors (sensors(), queryList())
+	/// during a batch, the request is not sent until endBatch().
+	/// \see open_interface::endBatch
+	/// \retval SUCCESS
+	static
+	ReturnCode
+	beginBatch (
+		void
+	);
+	
+	/// \brief Send the commands of the batch.
+	/// \details Writes the commands issued since beginBatch()
+	/// and returns to sending each command as it is issued.
+	/// \see open_interface::beginBatch
+	/// \retval SUCCESS
+	/// \retval SERIAL_TRANSFER_FAILURE
+	static
+	ReturnCode
+	endBatch (
+		void
+	);
+	
   protected:
 	/// \brief Core functionality of both queryList() and stream()
 	/// \details Both queryList() and stream() have identical
@@ -0,0 +1,248 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef PACKETS_H
+#define PACKETS_H
+
+#include <cstdint>
+#include <type_traits>
+
+#include "defines.h"
+
+namespace roomba {
+namespace sensor {
+
+/// \brief Description of a sensor packet
+/// \details Describes where the value of a packet (or packet group) is
+/// stored in the raw data blob, and how it is to be interpreted. Packet
+/// groups are a subset of packets which reside in contiguous memory
+/// locations, so the data for a group can be written or read as a
+/// single operation.
+/// \note Values located in iRobot® Roomba Open Interface (OI)
+/// Specification (page 19)
+struct packet_descriptor_t {
+	uint8_t offset; ///< byte offset of the value in the raw data blob
+	uint8_t size; ///< size of the value (in bytes)
+	bool is_signed; ///< value is two's complement
+	uint8_t index; ///< dense index of the packet id (0-62)
+	uint64_t flag_mask; ///< flags of the packet and each member of a group
+};
+
+/// \brief Number of packet ids defined by the specification
+/// \details Packet ids 0-58 map directly to their index, the extended
+/// groups (100, 101, 106, 107) are mapped onto indices 59-62.
+constexpr uint8_t PACKET_ID_COUNT = 63;
+
+/// \brief Creates bit-mask of the packet indices associated with a
+/// packet
+/// \param [in] index_ Dense index of the packet
+/// \param [in] first_ First packet id of the group (the packet id for
+/// individual packets)
+/// \param [in] last_ Last packet id of the group (the packet id for
+/// individual packets)
+/// \return A bitmask representing the packet and its members
+constexpr
+uint64_t
+packetFlagMask (
+	const uint8_t index_,
+	const uint8_t first_,
+	const uint8_t last_
+) {
+	return ((static_cast<uint64_t>(1) << index_) | (((static_cast<uint64_t>(2) << last_) - 1) & ~((static_cast<uint64_t>(1) << first_) - 1)));
+}
+
+/// \brief Descriptors of every packet
+/// \details Indexed by the dense packet index.
+/// \see sensor::packetIndex
+constexpr packet_descriptor_t PACKET_DESCRIPTOR[PACKET_ID_COUNT] = {
+	{  0, 26, false,  0, packetFlagMask( 0,  7, 26) },  // PACKETS_7_THRU_26
+	{  0, 10, false,  1, packetFlagMask( 1,  7, 16) },  // PACKETS_7_THRU_16
+	{ 10,  6, false,  2, packetFlagMask( 2, 17, 20) },  // PACKETS_17_THRU_20
+	{ 16, 10, false,  3, packetFlagMask( 3, 21, 26) },  // PACKETS_21_THRU_26
+	{ 26, 14, false,  4, packetFlagMask( 4, 27, 34) },  // PACKETS_27_THRU_34
+	{ 40, 12, false,  5, packetFlagMask( 5, 35, 42) },  // PACKETS_35_THRU_42
+	{  0, 52, false,  6, packetFlagMask( 6,  7, 42) },  // PACKETS_7_THRU_42
+	{  0,  1, false,  7, packetFlagMask( 7,  7,  7) },  // BUMPS_AND_WHEEL_DROPS
+	{  1,  1, false,  8, packetFlagMask( 8,  8,  8) },  // WALL
+	{  2,  1, false,  9, packetFlagMask( 9,  9,  9) },  // CLIFF_LEFT
+	{  3,  1, false, 10, packetFlagMask(10, 10, 10) },  // CLIFF_FRONT_LEFT
+	{  4,  1, false, 11, packetFlagMask(11, 11, 11) },  // CLIFF_FRONT_RIGHT
+	{  5,  1, false, 12, packetFlagMask(12, 12, 12) },  // CLIFF_RIGHT
+	{  6,  1, false, 13, packetFlagMask(13, 13, 13) },  // VIRTUAL_WALL
+	{  7,  1, false, 14, packetFlagMask(14, 14, 14) },  // MOTOR_OVERCURRENTS
+	{  8,  1, false, 15, packetFlagMask(15, 15, 15) },  // DIRT_DETECT
+	{  9,  1, false, 16, packetFlagMask(16, 16, 16) },  // RESERVED_1
+	{ 10,  1, false, 17, packetFlagMask(17, 17, 17) },  // INFRARED_CHARACTER_OMNI
+	{ 11,  1, false, 18, packetFlagMask(18, 18, 18) },  // BUTTONS
+	{ 12,  2, true,  19, packetFlagMask(19, 19, 19) },  // DISTANCE
+	{ 14,  2, true,  20, packetFlagMask(20, 20, 20) },  // ANGLE
+	{ 16,  1, false, 21, packetFlagMask(21, 21, 21) },  // CHARGING_STATE
+	{ 17,  2, false, 22, packetFlagMask(22, 22, 22) },  // VOLTAGE
+	{ 19,  2, true,  23, packetFlagMask(23, 23, 23) },  // CURRENT
+	{ 21,  1, true,  24, packetFlagMask(24, 24, 24) },  // TEMPERATURE
+	{ 22,  2, false, 25, packetFlagMask(25, 25, 25) },  // BATTERY_CHARGE
+	{ 24,  2, false, 26, packetFlagMask(26, 26, 26) },  // BATTERY_CAPACITY
+	{ 26,  2, false, 27, packetFlagMask(27, 27, 27) },  // WALL_SIGNAL
+	{ 28,  2, false, 28, packetFlagMask(28, 28, 28) },  // CLIFF_LEFT_SIGNAL
+	{ 30,  2, false, 29, packetFlagMask(29, 29, 29) },  // CLIFF_FRONT_LEFT_SIGNAL
+	{ 32,  2, false, 30, packetFlagMask(30, 30, 30) },  // CLIFF_FRONT_RIGHT_SIGNAL
+	{ 34,  2, false, 31, packetFlagMask(31, 31, 31) },  // CLIFF_RIGHT_SIGNAL
+	{ 36,  1, false, 32, packetFlagMask(32, 32, 32) },  // RESERVED_2
+	{ 37,  2, false, 33, packetFlagMask(33, 33, 33) },  // RESERVED_3
+	{ 39,  1, false, 34, packetFlagMask(34, 34, 34) },  // CHARGING_SOURCES_AVAILABLE
+	{ 40,  1, false, 35, packetFlagMask(35, 35, 35) },  // OI_MODE
+	{ 41,  1, false, 36, packetFlagMask(36, 36, 36) },  // SONG_NUMBER
+	{ 42,  1, false, 37, packetFlagMask(37, 37, 37) },  // SONG_PLAYING
+	{ 43,  1, false, 38, packetFlagMask(38, 38, 38) },  // NUMBER_OF_STREAM_PACKETS
+	{ 44,  2, true,  39, packetFlagMask(39, 39, 39) },  // REQUESTED_VELOCITY
+	{ 46,  2, true,  40, packetFlagMask(40, 40, 40) },  // REQUESTED_RADIUS
+	{ 48,  2, true,  41, packetFlagMask(41, 41, 41) },  // REQUESTED_RIGHT_VELOCITY
+	{ 50,  2, true,  42, packetFlagMask(42, 42, 42) },  // REQUESTED_LEFT_VELOCITY
+	{ 52,  2, false, 43, packetFlagMask(43, 43, 43) },  // RIGHT_ENCODER_COUNTS
+	{ 54,  2, false, 44, packetFlagMask(44, 44, 44) },  // LEFT_ENCODER_COUNTS
+	{ 56,  1, false, 45, packetFlagMask(45, 45, 45) },  // LIGHT_BUMPER
+	{ 57,  2, false, 46, packetFlagMask(46, 46, 46) },  // LIGHT_BUMP_LEFT_SIGNAL
+	{ 59,  2, false, 47, packetFlagMask(47, 47, 47) },  // LIGHT_BUMP_FRONT_LEFT_SIGNAL
+	{ 61,  2, false, 48, packetFlagMask(48, 48, 48) },  // LIGHT_BUMP_CENTER_LEFT_SIGNAL
+	{ 63,  2, false, 49, packetFlagMask(49, 49, 49) },  // LIGHT_BUMP_CENTER_RIGHT_SIGNAL
+	{ 65,  2, false, 50, packetFlagMask(50, 50, 50) },  // LIGHT_BUMP_FRONT_RIGHT_SIGNAL
+	{ 67,  2, false, 51, packetFlagMask(51, 51, 51) },  // LIGHT_BUMP_RIGHT_SIGNAL
+	{ 69,  1, false, 52, packetFlagMask(52, 52, 52) },  // INFRARED_CHARACTER_LEFT
+	{ 70,  1, false, 53, packetFlagMask(53, 53, 53) },  // INFRARED_CHARACTER_RIGHT
+	{ 71,  2, true,  54, packetFlagMask(54, 54, 54) },  // LEFT_MOTOR_CURRENT
+	{ 73,  2, true,  55, packetFlagMask(55, 55, 55) },  // RIGHT_MOTOR_CURRENT
+	{ 75,  2, true,  56, packetFlagMask(56, 56, 56) },  // MAIN_BRUSH_MOTOR_CURRENT
+	{ 77,  2, true,  57, packetFlagMask(57, 57, 57) },  // SIDE_BRUSH_MOTOR_CURRENT
+	{ 79,  1, false, 58, packetFlagMask(58, 58, 58) },  // STASIS
+	{  0, 80, false, 59, packetFlagMask(59,  7, 58) },  // PACKETS_7_THRU_58
+	{ 52, 28, false, 60, packetFlagMask(60, 43, 58) },  // PACKETS_43_THRU_58
+	{ 57, 12, false, 61, packetFlagMask(61, 46, 51) },  // PACKETS_46_THRU_51
+	{ 71,  9, false, 62, packetFlagMask(62, 54, 58) },  // PACKETS_54_THRU_58
+};
+
+/// \brief Tests whether a packet id is defined by the specification
+/// \param [in] packet_id_ Packet id to test
+/// \return true when the packet id can be requested from the Roomba
+constexpr
+bool
+isDefinedPacketId (
+	const uint8_t packet_id_
+) {
+	return ( packet_id_ <= STASIS || PACKETS_7_THRU_58 == packet_id_ || PACKETS_43_THRU_58 == packet_id_ || PACKETS_46_THRU_51 == packet_id_ || PACKETS_54_THRU_58 == packet_id_ );
+}
+
+/// \brief Array index for packet id
+/// \details Maps packet ids into indices between 0-62 which enables
+/// the ability to use 64-bit bitmask to represent flags associated
+/// with each packet, as well as the ability to create compact (non-
+/// sparse) arrays of informational data associated with each packet.
+/// \param [in] packet_id_ Packet id for which to provide the
+/// corresponding index
+/// \warning This function does NOT contain error checking, and should
+/// only be given packet ids defined by the specification.
+/// \return Index associated with the packet id provided
+constexpr
+uint8_t
+packetIndex (
+	const uint8_t packet_id_
+) {
+	return ( packet_id_ <= STASIS ? packet_id_
+	       : PACKETS_7_THRU_58 == packet_id_ ? 59
+	       : PACKETS_43_THRU_58 == packet_id_ ? 60
+	       : PACKETS_46_THRU_51 == packet_id_ ? 61
+	       : 62 );
+}
+
+/// \brief Descriptor of a packet id
+/// \param [in] packet_id_ Packet id for which to provide the descriptor
+/// \warning This function does NOT contain error checking, and should
+/// only be given packet ids defined by the specification.
+/// \return The descriptor of the packet id provided
+constexpr
+const packet_descriptor_t &
+packetDescriptor (
+	const uint8_t packet_id_
+) {
+	return PACKET_DESCRIPTOR[packetIndex(packet_id_)];
+}
+
+/// \brief Creates bit-mask of the packets associated with signed data
+/// \param [in] index_ First index to consider [default value: 0]
+/// \return A bitmask of the signed packets from index_ onward
+constexpr
+uint64_t
+signedFlagMask (
+	const uint8_t index_ = 0
+) {
+	return ( index_ >= PACKET_ID_COUNT ? 0 : ((PACKET_DESCRIPTOR[index_].is_signed ? (static_cast<uint64_t>(1) << index_) : 0) | signedFlagMask(index_ + 1)) );
+}
+
+/// \brief Compile-time description of a packet list
+/// \details Folds a list of packet ids into the byte count of the
+/// response and the flags of every packet the response refreshes.
+/// \note A query response is byte_count bytes, a stream frame carries
+/// byte_count + sizeof...(packet_ids_) bytes of payload.
+template <PacketId... packet_ids_>
+struct packet_list {
+	static constexpr uint16_t byte_count = 0; ///< bytes of packet values
+	static constexpr uint64_t flag_mask = 0; ///< flags of the packets refreshed
+};
+
+template <PacketId packet_id_, PacketId... packet_ids_>
+struct packet_list<packet_id_, packet_ids_...> {
+	static constexpr uint16_t byte_count = (packetDescriptor(packet_id_).size + packet_list<packet_ids_...>::byte_count); ///< bytes of packet values
+	static constexpr uint64_t flag_mask = (packetDescriptor(packet_id_).flag_mask | packet_list<packet_ids_...>::flag_mask); ///< flags of the packets refreshed
+};
+
+template <PacketId... packet_ids_> constexpr uint16_t packet_list<packet_ids_...>::byte_count;
+template <PacketId... packet_ids_> constexpr uint64_t packet_list<packet_ids_...>::flag_mask;
+template <PacketId packet_id_, PacketId... packet_ids_> constexpr uint16_t packet_list<packet_id_, packet_ids_...>::byte_count;
+template <PacketId packet_id_, PacketId... packet_ids_> constexpr uint64_t packet_list<packet_id_, packet_ids_...>::flag_mask;
+
+/// \brief Compile-time description of a single packet
+/// \details Provides the location of the packet value in the raw data
+/// blob, along with the host type able to represent it.
+/// \note Only individual packets (7-58) may be described, group
+/// packets do not have a single value.
+template <PacketId packet_id_>
+struct packet_traits {
+	static_assert((packet_id_ >= BUMPS_AND_WHEEL_DROPS && packet_id_ <= STASIS), "packet_traits is only defined for individual packets (7-58)");
+
+	static constexpr uint8_t offset = packetDescriptor(packet_id_).offset; ///< byte offset in the raw data blob
+	static constexpr uint8_t size = packetDescriptor(packet_id_).size; ///< size of the value (in bytes)
+	static constexpr bool is_signed = packetDescriptor(packet_id_).is_signed; ///< value is two's complement
+	static constexpr uint64_t flag_mask = packetDescriptor(packet_id_).flag_mask; ///< dirty flag of the packet
+
+	/// \brief Host type of the value
+	typedef typename std::conditional<(2 == size),
+		typename std::conditional<is_signed, int16_t, uint16_t>::type,
+		typename std::conditional<is_signed, int8_t, uint8_t>::type
+	>::type value_type;
+};
+
+template <PacketId packet_id_> constexpr uint8_t packet_traits<packet_id_>::offset;
+template <PacketId packet_id_> constexpr uint8_t packet_traits<packet_id_>::size;
+template <PacketId packet_id_> constexpr bool packet_traits<packet_id_>::is_signed;
+template <PacketId packet_id_> constexpr uint64_t packet_traits<packet_id_>::flag_mask;
+
+/// \brief Decode a packet value
+/// \details Converts the big endian value stored in the raw data blob
+/// to the host representation.
+/// \param [in] raw_data_ The raw data blob
+/// \return The value of the packet
+template <PacketId packet_id_>
+inline
+typename packet_traits<packet_id_>::value_type
+decode (
+	const uint8_t * const raw_data_
+) {
+	typedef packet_traits<packet_id_> traits;
+	const uint8_t * const value = (raw_data_ + traits::offset);
+	return static_cast<typename traits::value_type>((2 == traits::size) ? ((value[0] << 8) | value[1]) : value[0]);
+}
+
+} // namespace sensor
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,290 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#include "posix.h"
+
+#include <cerrno>
+#include <chrono>
+#include <thread>
+
+#include <asm/termbits.h>
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace roomba {
+namespace serial {
+namespace posix {
+
+namespace {
+	/// \brief The tty shared by the process
+	tty _tty;
+
+	/// \brief Time allowed for the driver to accept outgoing data
+	/// \details A write only blocks when the kernel buffer is full,
+	/// which indicates the device has stopped draining the line.
+	const int WRITE_TIMEOUT_MS(1000);
+
+	/// \brief Configure the tty as raw 8N1 at the requested rate
+	/// \details termios2 and BOTHER are used so the exact rate can be
+	/// requested, rather than the nearest Bxxx constant.
+	/// \return SUCCESS
+	/// \return SERIAL_TRANSFER_FAILURE
+	inline
+	ReturnCode
+	_configureLine (
+		const int fd_,
+		const BaudCode baud_code_
+	) {
+		struct termios2 tio;
+		if ( ::ioctl(fd_, TCGETS2, &tio) ) { return SERIAL_TRANSFER_FAILURE; }
+
+		tio.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON | IXOFF | IXANY);
+		tio.c_oflag &= ~OPOST;
+		tio.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+		tio.c_cflag &= ~(CSIZE | PARENB | CSTOPB | CRTSCTS | CBAUD | (CBAUD << IBSHIFT));
+		tio.c_cflag |= (CS8 | CREAD | CLOCAL | BOTHER | (BOTHER << IBSHIFT));
+		tio.c_ispeed = BAUD_RATE[baud_code_];
+		tio.c_ospeed = BAUD_RATE[baud_code_];
+		// With O_NONBLOCK, VMIN=1 reports an empty line as EAGAIN rather
+		// than a zero length read (which is reserved for hangup), so the
+		// kernel can park readers (epoll, io_uring) until data arrives.
+		tio.c_cc[VMIN] = 1;
+		tio.c_cc[VTIME] = 0;
+
+		if ( ::ioctl(fd_, TCSETS2, &tio) ) { return SERIAL_TRANSFER_FAILURE; }
+		return SUCCESS;
+	}
+
+	/// \brief Ask the driver to hand over bytes as soon as they arrive
+	/// \details USB serial adapters batch received bytes (16ms by default
+	/// on FTDI), which would otherwise dominate the stream wakeup latency.
+	/// \note Failure is ignored, not every driver supports the request.
+	inline
+	void
+	_requestLowLatency (
+		const int fd_
+	) {
+		struct serial_struct ss;
+		if ( ::ioctl(fd_, TIOCGSERIAL, &ss) ) { return; }
+		ss.flags |= ASYNC_LOW_LATENCY;
+		::ioctl(fd_, TIOCSSERIAL, &ss);
+	}
+} // namespace
+
+tty::tty (
+	void
+) :
+	_baud_code(BAUD_115200),
+	_fd(-1)
+{}
+
+tty::~tty (
+	void
+) {
+	closeSerialPort();
+}
+
+void
+tty::beginAtBaudCode (
+	const BaudCode baud_code_
+) {
+	if ( baud_code_ > BAUD_115200 ) { return; }
+	_baud_code = baud_code_;
+	if ( -1 == _fd ) { return; }
+	_configureLine(_fd, _baud_code);
+}
+
+void
+tty::closeSerialPort (
+	void
+) {
+	if ( -1 == _fd ) { return; }
+	::ioctl(_fd, TCFLSH, TCIOFLUSH);
+	::close(_fd);
+	_fd = -1;
+}
+
+int
+tty::fileDescriptor (
+	void
+) const {
+	return _fd;
+}
+
+size_t
+tty::multiByteSerialRead (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_,
+	const uint_opt32_t timeout_ms_
+) {
+	if ( -1 == _fd || !data_buffer_ ) { return 0; }
+
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms_));
+	size_t bytes_read(0);
+
+	while ( bytes_read < buffer_length_ ) {
+		const ssize_t result = ::read(_fd, (data_buffer_ + bytes_read), (buffer_length_ - bytes_read));
+		if ( result > 0 ) {
+			bytes_read += result;
+			continue;
+		}
+		if ( result < 0 && EINTR == errno ) { continue; }
+		if ( result < 0 && EAGAIN != errno ) { break; }
+
+		// Sleep in the kernel until more data arrives or the time expires
+		const std::chrono::nanoseconds remaining_ns = (deadline - std::chrono::steady_clock::now());
+		if ( remaining_ns.count() <= 0 ) { break; }
+		struct pollfd pfd = { _fd, POLLIN, 0 };
+		struct timespec timeout;
+		timeout.tv_sec = (remaining_ns.count() / 1000000000);
+		timeout.tv_nsec = (remaining_ns.count() % 1000000000);
+		const int ready = ::ppoll(&pfd, 1, &timeout, nullptr);
+		if ( ready < 0 && EINTR != errno ) { break; }
+		if ( ready > 0 && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) && !(pfd.revents & POLLIN) ) { break; }
+	}
+
+	return bytes_read;
+}
+
+size_t
+tty::multiByteSerialWrite (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	if ( -1 == _fd || !serial_data_ ) { return 0; }
+
+	size_t bytes_written(0);
+
+	while ( bytes_written < data_length_ ) {
+		const ssize_t result = ::write(_fd, (serial_data_ + bytes_written), (data_length_ - bytes_written));
+		if ( result > 0 ) {
+			bytes_written += result;
+			continue;
+		}
+		if ( result < 0 && EINTR == errno ) { continue; }
+		if ( result < 0 && EAGAIN != errno ) { break; }
+
+		// Kernel buffer is full, wait for the line to drain
+		struct pollfd pfd = { _fd, POLLOUT, 0 };
+		if ( ::poll(&pfd, 1, WRITE_TIMEOUT_MS) <= 0 ) { break; }
+	}
+
+	return bytes_written;
+}
+
+ReturnCode
+tty::openSerialPort (
+	const char * const device_path_,
+	const BaudCode baud_code_
+) {
+	if ( !device_path_ ) { return INVALID_PARAMETER; }
+	if ( baud_code_ > BAUD_115200 ) { return INVALID_PARAMETER; }
+	closeSerialPort();
+
+	const int fd = ::open(device_path_, (O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC));
+	if ( fd < 0 ) { return SERIAL_TRANSFER_FAILURE; }
+	::ioctl(fd, TIOCEXCL);
+
+	if ( SUCCESS != _configureLine(fd, baud_code_) ) {
+		::close(fd);
+		return SERIAL_TRANSFER_FAILURE;
+	}
+	_requestLowLatency(fd);
+	::ioctl(fd, TCFLSH, TCIOFLUSH);
+
+	_baud_code = baud_code_;
+	_fd = fd;
+	return SUCCESS;
+}
+
+ssize_t
+tty::readAvailable (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_
+) {
+	if ( -1 == _fd || !data_buffer_ ) { return -1; }
+
+	for (;;) {
+		const ssize_t result = ::read(_fd, data_buffer_, buffer_length_);
+		if ( result >= 0 ) { return ( (result || !buffer_length_) ? result : -1 ); }
+		if ( EINTR == errno ) { continue; }
+		return ( (EAGAIN == errno || EWOULDBLOCK == errno) ? 0 : -1 );
+	}
+}
+
+void
+beginAtBaudCode (
+	const BaudCode baud_code_
+) {
+	_tty.beginAtBaudCode(baud_code_);
+}
+
+void
+closeSerialPort (
+	void
+) {
+	_tty.closeSerialPort();
+}
+
+size_t
+delayMs (
+	const size_t desired_ms_
+) {
+	const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::milliseconds(desired_ms_));
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+size_t
+delayUs (
+	const size_t desired_us_
+) {
+	const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	std::this_thread::sleep_for(std::chrono::microseconds(desired_us_));
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+int
+fileDescriptor (
+	void
+) {
+	return _tty.fileDescriptor();
+}
+
+size_t
+multiByteSerialRead (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_,
+	const uint_opt32_t timeout_ms_
+) {
+	return _tty.multiByteSerialRead(data_buffer_, buffer_length_, timeout_ms_);
+}
+
+size_t
+multiByteSerialWrite (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	return _tty.multiByteSerialWrite(serial_data_, data_length_);
+}
+
+ReturnCode
+openSerialPort (
+	const char * const device_path_,
+	const BaudCode baud_code_
+) {
+	return _tty.openSerialPort(device_path_, baud_code_);
+}
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,175 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#ifndef POSIX_H
+#define POSIX_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/types.h>
+
+#include "defines.h"
+#include "serial_port.h"
+
+namespace roomba {
+namespace serial {
+
+/// \brief Linux serial platform
+/// \details Drives a Roomba attached to a tty device (i.e. /dev/ttyUSB0)
+/// using termios2. The line is configured as raw 8N1 at the exact rate
+/// represented by the baud code, which allows the non-standard rates
+/// (14400, 28800) supported by the Open Interface. Reads are serviced
+/// with ppoll(), so a caller blocks in the kernel until data arrives or
+/// the timeout expires; there is no busy spinning.
+namespace posix {
+
+/// \brief A tty device connected to a Roomba
+/// \details Each instance owns its own file descriptor, so one process
+/// can drive a Roomba on every tty. The free functions of this namespace
+/// operate on a single tty shared by the process.
+class tty : public port {
+  public:
+	tty (void);
+	~tty (void);
+	
+	/// \brief Begin the serial connection
+	/// \details Reconfigures the open tty to the rate represented by
+	/// the baud code. The rate is remembered and applied when the port
+	/// is opened later.
+	/// \param [in] baud_code_ The code indicating a specific rate
+	void
+	beginAtBaudCode (
+		const BaudCode baud_code_
+	) override;
+	
+	/// \brief Close the tty device
+	/// \see posix::closeSerialPort
+	void
+	closeSerialPort (
+		void
+	);
+	
+	/// \brief The file descriptor of the open tty
+	/// \return The file descriptor, or -1 when the port is closed
+	int
+	fileDescriptor (
+		void
+	) const;
+	
+	size_t
+	multiByteSerialRead (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_,
+		const uint_opt32_t timeout_ms_ = 1000
+	) override;
+	
+	size_t
+	multiByteSerialWrite (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	) override;
+	
+	/// \brief Open a tty device to communicate with the Roomba
+	/// \see posix::openSerialPort
+	ReturnCode
+	openSerialPort (
+		const char * const device_path_,
+		const BaudCode baud_code_ = BAUD_115200
+	);
+	
+	/// \brief Read the bytes already received, without waiting
+	/// \details Performs a single non-blocking read, which makes it
+	/// suitable for readiness driven (epoll) servicing of many ports.
+	/// \param [out] data_buffer_ The buffer to receive the bytes
+	/// \param [in] buffer_length_ The capacity of the buffer
+	/// \return The number of bytes read (0 when no data is waiting)
+	/// \return -1 when the port is closed or has failed (i.e. hangup)
+	ssize_t
+	readAvailable (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_
+	);
+	
+  private:
+	tty (const tty &) = delete;
+	tty & operator= (const tty &) = delete;
+	
+	BaudCode _baud_code; ///< the rate applied to the tty
+	int _fd; ///< file descriptor of the open tty
+};
+
+/// \brief Begin the serial connection
+/// \details Reconfigures the open tty to the rate represented by the
+/// baud code. The rate is remembered and applied when a port is opened
+/// later, so the order of the calls does not matter.
+/// \param [in] baud_code_ The code indicating a specific rate
+void
+beginAtBaudCode (
+	const BaudCode baud_code_
+);
+
+/// \brief Close the tty device
+/// \details Any data waiting in the kernel buffers is discarded.
+void
+closeSerialPort (
+	void
+);
+
+size_t
+delayMs (
+	const size_t desired_ms_
+);
+
+size_t
+delayUs (
+	const size_t desired_us_
+);
+
+/// \brief The file descriptor of the open tty
+/// \return The file descriptor, or -1 when no port is open
+int
+fileDescriptor (
+	void
+);
+
+size_t
+multiByteSerialRead (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_,
+	const uint_opt32_t timeout_ms_
+);
+
+size_t
+multiByteSerialWrite (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+);
+
+/// \brief Open a tty device to communicate with the Roomba
+/// \details Opens the device non-blocking, takes exclusive access,
+/// configures raw 8N1 at the rate represented by the baud code and
+/// requests low-latency mode from the driver (ignored by drivers that
+/// do not support it). A previously opened port is closed first.
+/// \param [in] device_path_ The path of the tty (i.e. /dev/ttyUSB0)
+/// \param [in] baud_code_ The code indicating a specific rate
+/// [default value: BAUD_115200]
+/// \return SUCCESS
+/// \return INVALID_PARAMETER
+/// \return SERIAL_TRANSFER_FAILURE
+ReturnCode
+openSerialPort (
+	const char * const device_path_,
+	const BaudCode baud_code_ = BAUD_115200
+);
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,258 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#include "pty_roomba.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace roomba {
+namespace serial {
+namespace posix {
+
+namespace {
+	/// \brief Line time of one byte at a baud rate (8N1)
+	inline
+	std::chrono::nanoseconds
+	_byteTime (
+		const BaudCode baud_code_
+	) {
+		return std::chrono::nanoseconds(10000000000LL / BAUD_RATE[std::min<uint_opt8_t>(baud_code_, BAUD_115200)]);
+	}
+} // namespace
+
+pty_roomba::pty_roomba (
+	const BaudCode baud_code_,
+	const bool throttle_
+) :
+	_roomba(virtual_roomba::REAL_TIME),
+	_byte_time(_byteTime(baud_code_)),
+	_throttle(throttle_),
+	_corrupt_probability(0.0),
+	_drop_probability(0.0),
+	_bytes_corrupted(0),
+	_bytes_dropped(0),
+	_master_fd(-1),
+	_slave_fd(-1),
+	_running(false)
+{
+	_device_path[0] = '\0';
+}
+
+pty_roomba::~pty_roomba (
+	void
+) {
+	close();
+}
+
+/// \brief Corrupt and drop the bytes in flight at random
+inline
+void
+pty_roomba::_corrupt (
+	direction_t & direction_
+) {
+	if ( 0.0 >= _corrupt_probability && 0.0 >= _drop_probability ) { return; }
+	std::uniform_real_distribution<double> probability(0.0, 1.0);
+	size_t length(0);
+
+	for ( size_t i = 0 ; i < direction_.length ; ++i ) {
+		if ( probability(_random) < _drop_probability ) {
+			_bytes_dropped.fetch_add(1, std::memory_order_relaxed);
+			continue;
+		}
+		direction_.data[length] = direction_.data[i];
+		if ( probability(_random) < _corrupt_probability ) {
+			direction_.data[length] ^= static_cast<uint_opt8_t>(1 << (_random() % 8));
+			_bytes_corrupted.fetch_add(1, std::memory_order_relaxed);
+		}
+		++length;
+	}
+	direction_.length = length;
+}
+
+/// \brief Put the chunk held by a direction on the line
+/// \details When throttled, the chunk is delivered once the line would
+/// have carried its last byte, after any chunk ahead of it.
+inline
+void
+pty_roomba::_launch (
+	direction_t & direction_,
+	const std::chrono::steady_clock::time_point now_
+) {
+	direction_.offset = 0;
+	if ( !_throttle ) {
+		direction_.deliver_time = now_;
+		return;
+	}
+
+	direction_.deliver_time = (std::max(now_, direction_.line_free_time) + (_byte_time * direction_.length));
+	direction_.line_free_time = direction_.deliver_time;
+}
+
+/// \brief Move bytes between the pty and the simulation
+/// \details Runs on the service thread until the pty is closed. The
+/// thread sleeps in the kernel until the host writes, the pty can
+/// accept bytes in flight, a chunk crosses the line, or the simulation
+/// takes its next step.
+void
+pty_roomba::_service (
+	void
+) {
+	direction_t to_roomba = direction_t();
+	direction_t to_host = direction_t();
+
+	while ( _running.load(std::memory_order_relaxed) ) {
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		bool progress = false;
+
+		// Host to Roomba
+		if ( !to_roomba.length ) {
+			const ssize_t bytes_read = ::read(_master_fd, to_roomba.data, CHUNK_CAPACITY);
+			if ( bytes_read > 0 ) {
+				to_roomba.length = static_cast<size_t>(bytes_read);
+				_launch(to_roomba, now);
+			}
+		}
+		if ( to_roomba.length && now >= to_roomba.deliver_time ) {
+			_roomba.multiByteSerialWrite(to_roomba.data, to_roomba.length);
+			to_roomba.length = 0;
+			progress = true;
+		}
+
+		// Roomba to host
+		if ( !to_host.length ) {
+			to_host.length = _roomba.multiByteSerialRead(to_host.data, CHUNK_CAPACITY, 0);
+			_corrupt(to_host);
+			if ( to_host.length ) { _launch(to_host, now); }
+		}
+		if ( to_host.length && now >= to_host.deliver_time ) {
+			const ssize_t bytes_written = ::write(_master_fd, (to_host.data + to_host.offset), (to_host.length - to_host.offset));
+			if ( bytes_written > 0 ) {
+				to_host.offset += static_cast<size_t>(bytes_written);
+				if ( to_host.offset == to_host.length ) { to_host.length = 0; }
+				progress = true;
+			}
+		}
+		if ( progress ) { continue; }
+
+		// Sleep until there is work to do
+		std::chrono::steady_clock::time_point wake_time = _roomba.nextStepTime();
+		if ( to_roomba.length ) { wake_time = std::min(wake_time, to_roomba.deliver_time); }
+		if ( to_host.length && to_host.deliver_time > now ) { wake_time = std::min(wake_time, to_host.deliver_time); }
+		struct pollfd pfd = { _master_fd, static_cast<short>(( to_roomba.length ? 0 : POLLIN ) | ( (to_host.length && now >= to_host.deliver_time) ? POLLOUT : 0 )), 0 };
+		now = std::chrono::steady_clock::now();
+		const std::chrono::nanoseconds timeout_ns = std::max(std::chrono::nanoseconds(0), std::chrono::duration_cast<std::chrono::nanoseconds>(wake_time - now));
+		struct timespec timeout;
+		timeout.tv_sec = (timeout_ns.count() / 1000000000);
+		timeout.tv_nsec = (timeout_ns.count() % 1000000000);
+		::ppoll(&pfd, 1, &timeout, nullptr);
+	}
+}
+
+size_t
+pty_roomba::bytesCorrupted (
+	void
+) const {
+	return _bytes_corrupted.load(std::memory_order_relaxed);
+}
+
+size_t
+pty_roomba::bytesDropped (
+	void
+) const {
+	return _bytes_dropped.load(std::memory_order_relaxed);
+}
+
+void
+pty_roomba::close (
+	void
+) {
+	_running.store(false, std::memory_order_relaxed);
+	if ( _service_thread.joinable() ) { _service_thread.join(); }
+
+	if ( -1 != _slave_fd ) { ::close(_slave_fd); }
+	if ( -1 != _master_fd ) { ::close(_master_fd); }
+	_slave_fd = -1;
+	_master_fd = -1;
+	_device_path[0] = '\0';
+}
+
+const char *
+pty_roomba::devicePath (
+	void
+) const {
+	return _device_path;
+}
+
+virtual_roomba &
+pty_roomba::getRoomba (
+	void
+) {
+	return _roomba;
+}
+
+ReturnCode
+pty_roomba::injectErrors (
+	const double corrupt_probability_,
+	const double drop_probability_,
+	const uint_opt32_t seed_
+) {
+	if ( -1 != _master_fd ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	if ( !(corrupt_probability_ >= 0.0 && corrupt_probability_ <= 1.0) || !(drop_probability_ >= 0.0 && drop_probability_ <= 1.0) ) { return INVALID_PARAMETER; }
+
+	_corrupt_probability = corrupt_probability_;
+	_drop_probability = drop_probability_;
+	_random.seed(seed_ ? seed_ : std::minstd_rand::default_seed);
+
+	return SUCCESS;
+}
+
+ReturnCode
+pty_roomba::open (
+	void
+) {
+	if ( -1 != _master_fd ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+
+	_master_fd = ::posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+	if ( -1 == _master_fd ) { return SERIAL_TRANSFER_FAILURE; }
+
+	// Raw line, so nothing is echoed or translated before the host configures the slave
+	struct termios attributes;
+	if ( ::grantpt(_master_fd) || ::unlockpt(_master_fd) || ::ptsname_r(_master_fd, _device_path, sizeof(_device_path)) || ::tcgetattr(_master_fd, &attributes) ) {
+		close();
+		return SERIAL_TRANSFER_FAILURE;
+	}
+	::cfmakeraw(&attributes);
+	if ( ::tcsetattr(_master_fd, TCSANOW, &attributes) || -1 == ::fcntl(_master_fd, F_SETFL, (::fcntl(_master_fd, F_GETFL) | O_NONBLOCK)) ) {
+		close();
+		return SERIAL_TRANSFER_FAILURE;
+	}
+
+	_slave_fd = ::open(_device_path, (O_RDWR | O_NOCTTY | O_CLOEXEC));
+	if ( -1 == _slave_fd ) {
+		close();
+		return SERIAL_TRANSFER_FAILURE;
+	}
+
+	_running.store(true, std::memory_order_relaxed);
+	_service_thread = std::thread(&pty_roomba::_service, this);
+
+	return SUCCESS;
+}
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
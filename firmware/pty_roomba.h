@@ -0,0 +1,175 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#ifndef PTY_ROOMBA_H
+#define PTY_ROOMBA_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <thread>
+
+#include "defines.h"
+#include "virtual_roomba.h"
+
+namespace roomba {
+namespace serial {
+namespace posix {
+
+/// \brief A simulated Roomba attached to a pseudo-terminal
+/// \details Serves a virtual_roomba (in real time) on the master side of
+/// a pty pair, so the slave device can be opened with tty (or any other
+/// program) exactly as /dev/ttyUSB0 would be. The whole serial path
+/// (termios, the kernel tty layer, the parser and the snapshots) is
+/// exercised without a Roomba attached.
+/// \n The line may be throttled to the byte rate of a baud code (10
+/// bits per byte, in each direction), and the bytes sent by the Roomba
+/// may be corrupted (a single bit flipped) or dropped at random, to soak
+/// the resynchronization of the parser.
+/// \code
+/// serial::posix::pty_roomba simulation(BAUD_115200, true);
+/// simulation.open();
+/// serial::posix::tty tty;
+/// tty.openSerialPort(simulation.devicePath());
+/// \endcode
+/// \note A service thread moves the bytes between the pty and the
+/// simulation. The simulation may be scripted from any thread.
+/// \see serial::virtual_roomba
+class pty_roomba {
+  public:
+	/// \param [in] baud_code_ The rate of the line [default value:
+	/// BAUD_115200]
+	/// \param [in] throttle_ Deliver the bytes no faster than the rate
+	/// of the line [default value: false]
+	explicit
+	pty_roomba (
+		const BaudCode baud_code_ = BAUD_115200,
+		const bool throttle_ = false
+	);
+
+	/// \brief Closes the pty (if open)
+	~pty_roomba (
+		void
+	);
+
+	/// \brief The number of bytes corrupted by error injection
+	size_t
+	bytesCorrupted (
+		void
+	) const;
+
+	/// \brief The number of bytes dropped by error injection
+	size_t
+	bytesDropped (
+		void
+	) const;
+
+	/// \brief Close the pty, and stop the service thread
+	void
+	close (
+		void
+	);
+
+	/// \brief The path of the slave device
+	/// \return The path (i.e. /dev/pts/3), or an empty string when the
+	/// pty is closed
+	const char *
+	devicePath (
+		void
+	) const;
+
+	/// \brief Accessor method for the simulated Roomba
+	/// \details Scripts the environment, and inspects the simulation.
+	virtual_roomba &
+	getRoomba (
+		void
+	);
+
+	/// \brief Inject errors into the bytes sent by the Roomba
+	/// \param [in] corrupt_probability_ The probability of a byte having
+	/// a single bit flipped (0.0-1.0)
+	/// \param [in] drop_probability_ The probability of a byte being
+	/// lost (0.0-1.0)
+	/// \param [in] seed_ Seed of the random errors, so a failure may be
+	/// reproduced [default value: 0]
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	/// \note May only be called while the pty is closed.
+	ReturnCode
+	injectErrors (
+		const double corrupt_probability_,
+		const double drop_probability_,
+		const uint_opt32_t seed_ = 0
+	);
+
+	/// \brief Create the pty pair, and start the service thread
+	/// \return SUCCESS
+	/// \return INVALID_MODE_FOR_REQUESTED_OPERATION The pty is open
+	/// \return SERIAL_TRANSFER_FAILURE The pty could not be created
+	ReturnCode
+	open (
+		void
+	);
+
+  private:
+	/// \brief Largest chunk moved across the line at once (in bytes)
+	/// \details Bounds the burst delivered when throttled.
+	static const size_t CHUNK_CAPACITY = 64;
+
+	/// \brief One direction of the line
+	/// \details Bytes in flight are held until the line would have
+	/// finished carrying them.
+	struct direction_t {
+		uint_opt8_t data[CHUNK_CAPACITY]; ///< bytes in flight
+		size_t length; ///< number of bytes in flight
+		size_t offset; ///< bytes of the chunk already delivered
+		std::chrono::steady_clock::time_point deliver_time; ///< time the chunk has crossed the line
+		std::chrono::steady_clock::time_point line_free_time; ///< time the line becomes idle
+	};
+
+	pty_roomba (const pty_roomba &) = delete;
+	pty_roomba & operator= (const pty_roomba &) = delete;
+
+	void
+	_corrupt (
+		direction_t & direction_
+	);
+
+	void
+	_launch (
+		direction_t & direction_,
+		const std::chrono::steady_clock::time_point now_
+	);
+
+	void
+	_service (
+		void
+	);
+
+	virtual_roomba _roomba; ///< the simulation
+	const std::chrono::nanoseconds _byte_time; ///< line time of one byte
+	const bool _throttle; ///< bytes are delivered at the rate of the line
+	double _corrupt_probability; ///< probability of a corrupted byte
+	double _drop_probability; ///< probability of a dropped byte
+	std::minstd_rand _random; ///< source of the injected errors
+	std::atomic<size_t> _bytes_corrupted; ///< bytes corrupted
+	std::atomic<size_t> _bytes_dropped; ///< bytes dropped
+	int _master_fd; ///< master side of the pty
+	int _slave_fd; ///< slave side of the pty (held open, so the master never hangs up)
+	char _device_path[64]; ///< path of the slave side
+	std::atomic<bool> _running; ///< the service thread is to continue
+	std::thread _service_thread; ///< moves bytes between pty and simulation
+};
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
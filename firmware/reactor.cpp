@@ -0,0 +1,194 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#include "reactor.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace roomba {
+namespace serial {
+namespace posix {
+
+namespace {
+	/// \brief Events returned by a single call to epoll_wait()
+	const int EVENT_BATCH(64);
+
+	/// \brief Bytes read from a ready tty per wakeup
+	/// \details Large enough to hold several stream frames, small enough
+	/// to bound the time spent on any one port before the others.
+	const size_t READ_CHUNK(512);
+} // namespace
+
+reactor::reactor (
+	void
+) :
+	_epoll_fd(::epoll_create1(EPOLL_CLOEXEC)),
+	_stop_requested(false),
+	_wake_fd(::eventfd(0, (EFD_NONBLOCK | EFD_CLOEXEC)))
+{
+	if ( -1 == _epoll_fd || -1 == _wake_fd ) { return; }
+	struct epoll_event event = { EPOLLIN, { nullptr } };
+	::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, _wake_fd, &event);
+}
+
+reactor::~reactor (
+	void
+) {
+	if ( -1 != _wake_fd ) { ::close(_wake_fd); }
+	if ( -1 != _epoll_fd ) { ::close(_epoll_fd); }
+}
+
+/// \brief Remove a channel from epoll and release it
+inline
+void
+reactor::_detachChannel (
+	const channel_t * const channel_
+) {
+	::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, channel_->port->fileDescriptor(), nullptr);
+	_channels.erase(std::find_if(_channels.begin(), _channels.end(), [channel_] (const std::unique_ptr<channel_t> & channel) { return (channel.get() == channel_); }));
+}
+
+/// \brief Read the waiting bytes of a channel into its stream parser
+/// \return The number of stream frames committed (-1 on hangup)
+inline
+size_t
+reactor::_serviceChannel (
+	const channel_t * const channel_
+) {
+	uint_opt8_t buffer[READ_CHUNK];
+	const ssize_t bytes_read = channel_->port->readAvailable(buffer, sizeof(buffer));
+	if ( bytes_read < 0 ) { return static_cast<size_t>(-1); }
+
+	return parseStreamChunk(*channel_->robot_state, buffer, bytes_read);
+}
+
+size_t
+parseStreamChunk (
+	state::robot_state & robot_state_,
+	const uint_opt8_t * const data_,
+	const size_t data_length_
+) {
+	size_t frames_committed(0);
+	size_t offset(0);
+	ReturnCode rc;
+	do {
+		size_t bytes_consumed;
+		if ( robot_state_.pendingQueries() ) {
+			rc = robot_state_.parseQueryBuffer((data_ + offset), (data_length_ - offset), &bytes_consumed);
+		} else {
+			rc = robot_state_.parseStreamBuffer((data_ + offset), (data_length_ - offset), &bytes_consumed);
+		}
+		offset += bytes_consumed;
+		if ( SUCCESS == rc ) { ++frames_committed; }
+	} while ( NO_DATA_AVAILABLE != rc );
+
+	return frames_committed;
+}
+
+ReturnCode
+reactor::attach (
+	tty & tty_,
+	state::robot_state & robot_state_
+) {
+	if ( -1 == _epoll_fd || -1 == _wake_fd ) { return SERIAL_TRANSFER_FAILURE; }
+	if ( -1 == tty_.fileDescriptor() ) { return INVALID_PARAMETER; }
+
+	std::unique_ptr<channel_t> channel(new channel_t{ &tty_, &robot_state_ });
+	struct epoll_event event = { EPOLLIN, { channel.get() } };
+	if ( ::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, tty_.fileDescriptor(), &event) ) {
+		return ( (EEXIST == errno) ? INVALID_PARAMETER : SERIAL_TRANSFER_FAILURE );
+	}
+
+	_channels.push_back(std::move(channel));
+	return SUCCESS;
+}
+
+size_t
+reactor::attached (
+	void
+) const {
+	return _channels.size();
+}
+
+ReturnCode
+reactor::detach (
+	tty & tty_
+) {
+	for ( const std::unique_ptr<channel_t> & channel : _channels ) {
+		if ( channel->port != &tty_ ) { continue; }
+		_detachChannel(channel.get());
+		return SUCCESS;
+	}
+
+	return INVALID_PARAMETER;
+}
+
+size_t
+reactor::poll (
+	const int timeout_ms_
+) {
+	if ( -1 == _epoll_fd ) { return 0; }
+
+	struct epoll_event events[EVENT_BATCH];
+	const int ready = ::epoll_wait(_epoll_fd, events, EVENT_BATCH, timeout_ms_);
+	if ( ready <= 0 ) {
+		for ( const std::unique_ptr<channel_t> & channel : _channels ) { channel->robot_state->expireQueries(); }
+		return 0;
+	}
+
+	size_t frames_committed(0);
+	for ( int i = 0 ; i < ready ; ++i ) {
+		const channel_t * const channel = static_cast<const channel_t *>(events[i].data.ptr);
+		if ( !channel ) {
+			uint64_t wakeups;
+			while ( ::read(_wake_fd, &wakeups, sizeof(wakeups)) > 0 ) {}
+			continue;
+		}
+
+		const size_t result = _serviceChannel(channel);
+		if ( static_cast<size_t>(-1) == result ) {
+			_detachChannel(channel);
+			continue;
+		}
+		frames_committed += result;
+	}
+	for ( const std::unique_ptr<channel_t> & channel : _channels ) { channel->robot_state->expireQueries(); }
+
+	return frames_committed;
+}
+
+ReturnCode
+reactor::run (
+	void
+) {
+	if ( -1 == _epoll_fd || -1 == _wake_fd ) { return SERIAL_TRANSFER_FAILURE; }
+
+	while ( !_stop_requested.exchange(false) ) {
+		poll(-1);
+	}
+
+	return SUCCESS;
+}
+
+void
+reactor::stop (
+	void
+) {
+	const uint64_t wakeup(1);
+	_stop_requested = true;
+	if ( ::write(_wake_fd, &wakeup, sizeof(wakeup)) ) {}
+}
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,145 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "defines.h"
+#include "posix.h"
+#include "state.h"
+
+namespace roomba {
+namespace serial {
+namespace posix {
+
+/// \brief Feed the bytes received from a tty into a stream parser
+/// \details Rejected bytes are discarded by the parser, which always
+/// makes progress, so every byte is consumed before returning. While
+/// queries are pending the bytes complete the queries instead.
+/// \param [in] robot_state_ The state receiving the stream
+/// \param [in] data_ The bytes received
+/// \param [in] data_length_ The number of bytes received
+/// \return The number of stream frames committed (and queries
+/// completed)
+/// \see state::robot_state::expectQuery
+size_t
+parseStreamChunk (
+	state::robot_state & robot_state_,
+	const uint_opt8_t * const data_,
+	const size_t data_length_
+);
+
+/// \brief Services the streams of many Roombas from a single thread
+/// \details Registers the tty of each Roomba with epoll, and feeds the
+/// bytes of every readable tty into the incremental stream parser of
+/// the corresponding robot state. A tty is never waited upon; a port
+/// which is slow or silent simply does not become ready, so it cannot
+/// delay the others. Each ready port is read once per wakeup (level
+/// triggered), so a busy port cannot starve the others either.
+/// \note attach(), detach() and poll() must be called from the same
+/// thread. stop() may be called from any thread.
+/// \note A robot state serviced by the reactor must not also run its
+/// own stream reader thread.
+/// \see state::robot_state::parseStreamBuffer
+class reactor {
+  public:
+	reactor (void);
+	~reactor (void);
+
+	/// \brief Register the tty of a Roomba
+	/// \details The tty must be open, and must remain open until it
+	/// is detached.
+	/// \param [in] tty_ The tty connected to the Roomba
+	/// \param [in] robot_state_ The state receiving the stream
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER The tty is closed or already attached
+	/// \return SERIAL_TRANSFER_FAILURE
+	ReturnCode
+	attach (
+		tty & tty_,
+		state::robot_state & robot_state_
+	);
+
+	/// \brief The number of ttys attached
+	size_t
+	attached (
+		void
+	) const;
+
+	/// \brief Unregister the tty of a Roomba
+	/// \param [in] tty_ The tty connected to the Roomba
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER The tty is not attached
+	ReturnCode
+	detach (
+		tty & tty_
+	);
+
+	/// \brief Wait for stream data and service every ready tty
+	/// \details A tty which reports an error or hangup is detached.
+	/// Queries whose response is overdue are failed.
+	/// \param [in] timeout_ms_ Maximum time to wait for data (-1 waits
+	/// until data arrives or stop() is called)
+	/// \return The number of stream frames committed
+	size_t
+	poll (
+		const int timeout_ms_
+	);
+
+	/// \brief Service the attached ttys until stop() is called
+	/// \return SUCCESS
+	/// \return SERIAL_TRANSFER_FAILURE The reactor failed to initialize
+	ReturnCode
+	run (
+		void
+	);
+
+	/// \brief Wake the reactor and end run()
+	/// \details Safe to call from any thread (or a signal handler).
+	void
+	stop (
+		void
+	);
+
+  private:
+	/// \brief A tty and the state receiving its stream
+	struct channel_t {
+		tty * port;
+		state::robot_state * robot_state;
+	};
+
+	reactor (const reactor &) = delete;
+	reactor & operator= (const reactor &) = delete;
+
+	void
+	_detachChannel (
+		const channel_t * const channel_
+	);
+
+	size_t
+	_serviceChannel (
+		const channel_t * const channel_
+	);
+
+	std::vector<std::unique_ptr<channel_t>> _channels; ///< channels registered with epoll
+	int _epoll_fd; ///< epoll instance
+	std::atomic<bool> _stop_requested; ///< run() should return
+	int _wake_fd; ///< eventfd used to interrupt epoll_wait()
+};
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
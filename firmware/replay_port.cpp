@@ -0,0 +1,231 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#include "replay_port.h"
+#include "telemetry_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace roomba {
+namespace serial {
+namespace posix {
+
+replay_port::replay_port (
+	void
+) :
+	_capture(nullptr),
+	_capture_length(0),
+	_records_offset(0),
+	_is_log(false),
+	_pacing(AS_FAST_AS_POSSIBLE),
+	_next_offset(0),
+	_segment(nullptr),
+	_segment_length(0),
+	_segment_time_ns(0),
+	_origin_ns(0),
+	_replay_started(false)
+{}
+
+replay_port::~replay_port (
+	void
+) {
+	closeCapture();
+}
+
+/// \brief The time the current segment becomes available
+/// \details Starts the replay clock on the first call.
+/// \note Only meaningful when the replay is paced by the wall clock.
+/// \return The time
+std::chrono::steady_clock::time_point
+replay_port::_segmentDueTime (
+	void
+) {
+	if ( !_replay_started ) {
+		_replay_start = std::chrono::steady_clock::now();
+		_replay_started = true;
+	}
+	return (_replay_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(_segment_time_ns - _origin_ns)));
+}
+
+/// \brief Make the next bytes of the capture the current segment
+/// \details Records other than stream frames are skipped. A record cut
+/// short (i.e. the recorder was killed mid-write) ends the capture.
+/// \return true when the current segment has bytes left to replay
+bool
+replay_port::_loadSegment (
+	void
+) {
+	if ( _segment_length ) { return true; }
+
+	if ( !_is_log ) {
+		if ( _next_offset >= _capture_length ) { return false; }
+		_segment = (_capture + _next_offset);
+		_segment_length = (_capture_length - _next_offset);
+		_next_offset = _capture_length;
+		return true;
+	}
+
+	while ( (_capture_length - _next_offset) >= sizeof(telemetry::record_header_t) ) {
+		telemetry::record_header_t record_header;
+		memcpy(&record_header, (_capture + _next_offset), sizeof(record_header));
+		const size_t payload_offset = (_next_offset + sizeof(record_header));
+		if ( record_header.length > (_capture_length - payload_offset) ) { break; }
+		_next_offset = (payload_offset + record_header.length);
+
+		if ( telemetry::STREAM_FRAME != record_header.type || !record_header.length ) { continue; }
+		_segment = (_capture + payload_offset);
+		_segment_length = record_header.length;
+		_segment_time_ns = record_header.timestamp_ns;
+		return true;
+	}
+
+	_next_offset = _capture_length;
+	return false;
+}
+
+void
+replay_port::beginAtBaudCode (
+	const BaudCode
+) {}
+
+void
+replay_port::closeCapture (
+	void
+) {
+	if ( !_capture ) { return; }
+	::munmap(const_cast<uint_opt8_t *>(_capture), _capture_length);
+	_capture = nullptr;
+	_capture_length = 0;
+	rewind();
+}
+
+size_t
+replay_port::multiByteSerialRead (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_,
+	const uint_opt32_t timeout_ms_
+) {
+	if ( !_capture || !data_buffer_ ) { return 0; }
+
+	const bool paced = (WALL_CLOCK == _pacing);
+	const std::chrono::steady_clock::time_point deadline = ( paced ? (std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms_)) : std::chrono::steady_clock::time_point() );
+	size_t bytes_read(0);
+
+	while ( bytes_read < buffer_length_ && _loadSegment() ) {
+		if ( paced ) {
+			// Wait for the segment to arrive, as a tty would
+			const std::chrono::steady_clock::time_point due_time = _segmentDueTime();
+			if ( due_time > deadline ) {
+				std::this_thread::sleep_until(deadline);
+				break;
+			}
+			std::this_thread::sleep_until(due_time);
+		}
+
+		const size_t length = std::min(_segment_length, (buffer_length_ - bytes_read));
+		memcpy((data_buffer_ + bytes_read), _segment, length);
+		_segment += length;
+		_segment_length -= length;
+		bytes_read += length;
+	}
+
+	return bytes_read;
+}
+
+size_t
+replay_port::multiByteSerialWrite (
+	const uint_opt8_t * const,
+	const size_t data_length_
+) {
+	return data_length_;
+}
+
+ReturnCode
+replay_port::nextSegment (
+	const uint_opt8_t ** const data_,
+	size_t * const data_length_
+) {
+	if ( !data_ || !data_length_ ) { return INVALID_PARAMETER; }
+	if ( !_capture ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	if ( !_loadSegment() ) { return NO_DATA_AVAILABLE; }
+
+	if ( WALL_CLOCK == _pacing ) { std::this_thread::sleep_until(_segmentDueTime()); }
+	*data_ = _segment;
+	*data_length_ = _segment_length;
+	_segment += _segment_length;
+	_segment_length = 0;
+
+	return SUCCESS;
+}
+
+ReturnCode
+replay_port::openCapture (
+	const char * const capture_path_,
+	const ReplayPacing pacing_
+) {
+	if ( !capture_path_ || pacing_ > WALL_CLOCK ) { return INVALID_PARAMETER; }
+	if ( _capture ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+
+	const int fd = ::open(capture_path_, (O_RDONLY | O_CLOEXEC));
+	if ( -1 == fd ) { return SERIAL_TRANSFER_FAILURE; }
+	struct stat capture_stat;
+	if ( ::fstat(fd, &capture_stat) || capture_stat.st_size <= 0 ) {
+		::close(fd);
+		return SERIAL_TRANSFER_FAILURE;
+	}
+	void * const capture = ::mmap(nullptr, static_cast<size_t>(capture_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if ( MAP_FAILED == capture ) { return SERIAL_TRANSFER_FAILURE; }
+	::madvise(capture, static_cast<size_t>(capture_stat.st_size), MADV_SEQUENTIAL);
+
+	_capture = static_cast<const uint_opt8_t *>(capture);
+	_capture_length = static_cast<size_t>(capture_stat.st_size);
+
+	// A log is identified by its magic, anything else is a raw capture
+	telemetry::log_header_t log_header;
+	_is_log = (_capture_length >= sizeof(log_header) && !memcmp(_capture, telemetry::LOG_MAGIC, sizeof(telemetry::LOG_MAGIC)));
+	if ( _is_log ) {
+		memcpy(&log_header, _capture, sizeof(log_header));
+		if ( telemetry::LOG_VERSION != log_header.version || sizeof(telemetry::record_header_t) != log_header.record_header_size ) {
+			closeCapture();
+			return SERIAL_TRANSFER_FAILURE;
+		}
+		_records_offset = sizeof(log_header);
+		_origin_ns = log_header.steady_origin_ns;
+	} else if ( WALL_CLOCK == pacing_ ) {
+		closeCapture();
+		return INVALID_PARAMETER;
+	} else {
+		_records_offset = 0;
+	}
+	_pacing = pacing_;
+	rewind();
+
+	return SUCCESS;
+}
+
+void
+replay_port::rewind (
+	void
+) {
+	_next_offset = _records_offset;
+	_segment = nullptr;
+	_segment_length = 0;
+	_replay_started = false;
+}
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,154 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#ifndef REPLAY_PORT_H
+#define REPLAY_PORT_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "defines.h"
+#include "serial_port.h"
+
+namespace roomba {
+namespace serial {
+namespace posix {
+
+/// \brief The pace of a replay
+enum ReplayPacing : uint_opt8_t {
+	AS_FAST_AS_POSSIBLE = 0, ///< bytes are available as soon as they are read
+	WALL_CLOCK, ///< each frame is available once as much time has passed since the first read as had passed since the log was opened
+};
+
+/// \brief A recorded capture, presented as the serial port of a Roomba
+/// \details Maps a capture into memory and hands its bytes to the
+/// parser, as a tty would hand over the bytes received from the Roomba.
+/// A capture is either a log written by telemetry::telemetry_recorder
+/// (whose stream frames are replayed, and whose commands are skipped),
+/// or a raw dump of the bytes received on the serial line.
+/// \n Bytes are read straight from the page cache, there is no read()
+/// into an intermediate buffer. nextSegment() goes further, and hands
+/// out the mapped bytes themselves for parseStreamBuffer().
+/// \code
+/// serial::posix::replay_port capture;
+/// capture.openCapture("roomba.tlm");
+/// state::robot_state replay(capture);
+/// while ( SUCCESS == replay.parseStreamData() ) { ... }
+/// \endcode
+/// \note Commands written to the port are discarded.
+/// \see telemetry::telemetry_recorder
+class replay_port : public port {
+  public:
+	replay_port (void);
+	~replay_port (void);
+
+	/// \brief The rate of a capture is fixed, the baud code has no effect
+	void
+	beginAtBaudCode (
+		const BaudCode baud_code_
+	) override;
+
+	/// \brief Unmap the capture
+	void
+	closeCapture (
+		void
+	);
+
+	/// \brief Copy the next bytes of the capture
+	/// \details When the replay is paced by the wall clock, the read
+	/// waits (up to the timeout) for the bytes to become available.
+	/// \return The number of bytes read (short at the end of the capture)
+	size_t
+	multiByteSerialRead (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_,
+		const uint_opt32_t timeout_ms_ = 1000
+	) override;
+
+	/// \brief Commands are discarded
+	/// \return data_length_, as though the bytes had been written
+	size_t
+	multiByteSerialWrite (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	) override;
+
+	/// \brief Take the next contiguous bytes of the capture, without a copy
+	/// \details A segment is the payload of one stream frame record of a
+	/// log, or the remainder of a raw capture. When the replay is paced by
+	/// the wall clock, the call sleeps until the segment is available.
+	/// \param [out] data_ Receives the address of the bytes (valid until
+	/// the capture is closed)
+	/// \param [out] data_length_ Receives the number of bytes
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	/// \return INVALID_MODE_FOR_REQUESTED_OPERATION No capture is open
+	/// \return NO_DATA_AVAILABLE The capture has been replayed in full
+	/// \see state::parseStreamBuffer
+	ReturnCode
+	nextSegment (
+		const uint_opt8_t ** const data_,
+		size_t * const data_length_
+	);
+
+	/// \brief Map a capture into memory
+	/// \param [in] capture_path_ The path of the capture
+	/// \param [in] pacing_ The pace of the replay [default value:
+	/// AS_FAST_AS_POSSIBLE]
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER A raw capture (which has no timestamps)
+	/// cannot be paced by the wall clock
+	/// \return INVALID_MODE_FOR_REQUESTED_OPERATION A capture is open
+	/// \return SERIAL_TRANSFER_FAILURE The capture could not be mapped,
+	/// or its log header is invalid
+	ReturnCode
+	openCapture (
+		const char * const capture_path_,
+		const ReplayPacing pacing_ = AS_FAST_AS_POSSIBLE
+	);
+
+	/// \brief Replay the capture from the beginning
+	void
+	rewind (
+		void
+	);
+
+  private:
+	replay_port (const replay_port &) = delete;
+	replay_port & operator= (const replay_port &) = delete;
+
+	std::chrono::steady_clock::time_point
+	_segmentDueTime (
+		void
+	);
+
+	bool
+	_loadSegment (
+		void
+	);
+
+	const uint_opt8_t * _capture; ///< the mapped capture (nullptr when closed)
+	size_t _capture_length; ///< bytes mapped
+	size_t _records_offset; ///< offset of the first record (zero for a raw capture)
+	bool _is_log; ///< the capture is a telemetry log
+	ReplayPacing _pacing; ///< pace of the replay
+	size_t _next_offset; ///< offset of the next record (or byte) not yet loaded
+	const uint_opt8_t * _segment; ///< bytes of the current segment not yet replayed
+	size_t _segment_length; ///< number of bytes of the current segment not yet replayed
+	int64_t _segment_time_ns; ///< recorded time of the current segment
+	int64_t _origin_ns; ///< recorded time the log was opened
+	std::chrono::steady_clock::time_point _replay_start; ///< time of the first read (wall clock pacing)
+	bool _replay_started; ///< the first read has been made
+};
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,595 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "robot.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace roomba {
+
+/// \brief Write bytes to the serial port
+/// \details The bytes written are passed to the telemetry recorder of
+/// the state (if any).
+/// \return The number of bytes written
+template<>
+size_t
+robot<OI500>::_serialWrite (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	const size_t bytes_written = _serial_port.multiByteSerialWrite(serial_data_, data_length_);
+	_state.recordCommand(serial_data_, bytes_written);
+	return bytes_written;
+}
+
+/// \brief Send the contents of the batch buffer
+/// \return SUCCESS
+/// \return SERIAL_TRANSFER_FAILURE
+template<>
+ReturnCode
+robot<OI500>::_flushBatch (
+	void
+) {
+	if ( !_batch_length ) { return SUCCESS; }
+	const size_t bytes_written = _serialWrite(_batch_buffer, _batch_length);
+	const bool complete = (bytes_written == _batch_length);
+	_batch_length = 0;
+	
+	// A drive command is only timed once it reaches the wire
+	if ( complete && _batch_drive_pending ) { _state.stampDriveCommand(_batch_drive_velocities[0], _batch_drive_velocities[1]); }
+	_batch_drive_pending = false;
+	
+	return ( complete ? SUCCESS : SERIAL_TRANSFER_FAILURE );
+}
+
+/// \brief Send a command, or append it to the batch buffer
+/// \details A command which does not fit sends the buffer first.
+/// \return The number of bytes accepted (0 on failure)
+template<>
+size_t
+robot<OI500>::_write (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	if ( !_batching ) { return _serialWrite(serial_data_, data_length_); }
+	if ( (_batch_length + data_length_) > BATCH_CAPACITY && SUCCESS != _flushBatch() ) { return 0; }
+	if ( data_length_ > BATCH_CAPACITY ) { return _serialWrite(serial_data_, data_length_); }
+	
+	memcpy((_batch_buffer + _batch_length), serial_data_, data_length_);
+	_batch_length += data_length_;
+	return data_length_;
+}
+
+template<>
+ReturnCode
+robot<OI500>::start (
+	void
+) {
+	const uint_opt8_t serial_data[1] = { command::START };
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	_state.setOIMode(PASSIVE);
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::baud (
+	const BaudCode baud_code_
+) {
+	const uint_opt8_t serial_data[2] = { command::BAUD, baud_code_ };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	if ( baud_code_ > 11 ) { return INVALID_PARAMETER; }
+
+	// The opcode must reach the Roomba before the local rate changes
+	if ( _batching && SUCCESS != _flushBatch() ) { return SERIAL_TRANSFER_FAILURE; }
+	if ( !_serialWrite(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+#ifdef SENSORS_ENABLED
+	_state.setBaudCode(baud_code_);
+#endif
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::safe (
+	void
+) {
+	const uint_opt8_t serial_data[1] = { command::SAFE };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	_state.setOIMode(SAFE);
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::control (
+	void
+) {
+	return safe();
+}
+
+template<>
+ReturnCode
+robot<OI500>::full (
+	void
+) {
+	const uint_opt8_t serial_data[1] = { command::FULL };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	_state.setOIMode(FULL);
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::clean (
+	void
+) {
+	const uint_opt8_t serial_data[1] = { command::CLEAN };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	_state.setOIMode(PASSIVE);
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::max (
+	void
+) {
+	const uint_opt8_t serial_data[1] = { command::MAX };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	_state.setOIMode(PASSIVE);
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::spot (
+	void
+) {
+	const uint_opt8_t serial_data[1] = { command::SPOT };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	_state.setOIMode(PASSIVE);
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::seekDock (
+	void
+) {
+	const uint_opt8_t serial_data[1] = { command::SEEK_DOCK };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	_state.setOIMode(PASSIVE);
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::schedule (
+	const bitmask::Days day_mask_,
+	const clock_time_t * const clock_times_
+) {
+	uint_opt8_t serial_data[16] = { command::SCHEDULE };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	if ( day_mask_ && clock_times_ ) {
+		serial_data[1] = static_cast<bitmask::Days>(day_mask_ & 0x7F);
+		for (uint_opt8_t day = 0, parameter_index = 0, serial_index = 2 ; day < 7 ; ++day, parameter_index += ((day_mask_ >> day) & 1), serial_index = ((2 * day) + 2)) {
+			// Test conditions without branching logic to allow for code pipelining and parallel execution with loop unroll
+			const bool valid = (((day_mask_ >> day) & 1) && (clock_times_[parameter_index].hour >= 0 && clock_times_[parameter_index].hour < 23) && (clock_times_[parameter_index].minute >= 0 && clock_times_[parameter_index].minute <= 59));
+			*reinterpret_cast<uint_opt16_t *>(&serial_data[serial_index]) = (valid * (*reinterpret_cast<const uint_opt16_t *>(&clock_times_[parameter_index])));
+			serial_data[1] &= ~(!valid << day);
+		}
+	}
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::setDayTime (
+	const Day day_,
+	const clock_time_t clock_time_
+) {
+	const uint_opt8_t serial_data[4] = { command::SET_DAY_TIME, day_, clock_time_.hour, clock_time_.minute };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	if ( clock_time_.hour < 0 || clock_time_.hour > 23 || clock_time_.minute < 0 || clock_time_.minute > 59 ) { return INVALID_PARAMETER; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::power (
+	void
+) {
+	const uint_opt8_t serial_data[1] = { command::POWER };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	_state.setOIMode(PASSIVE);
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::drive (
+	const int_opt16_t velocity_,
+	const int_opt16_t radius_
+) {
+	const uint_opt8_t serial_data[5] = { command::DRIVE, reinterpret_cast<const uint_opt8_t *>(&velocity_)[1], reinterpret_cast<const uint_opt8_t *>(&velocity_)[0], reinterpret_cast<const uint_opt8_t *>(&radius_)[1], reinterpret_cast<const uint_opt8_t *>(&radius_)[0] };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	if ( velocity_ < -500 || velocity_ > 500 || (radius_ != 32767 && (radius_ < -2000 || radius_ > 2000)) ) { return INVALID_PARAMETER; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::driveDirect (
+	const int_opt16_t left_wheel_velocity_,
+	const int_opt16_t right_wheel_velocity_
+) {
+	const uint_opt8_t serial_data[5] = { command::DRIVE_DIRECT, reinterpret_cast<const uint_opt8_t *>(&right_wheel_velocity_)[1], reinterpret_cast<const uint_opt8_t *>(&right_wheel_velocity_)[0], reinterpret_cast<const uint_opt8_t *>(&left_wheel_velocity_)[1], reinterpret_cast<const uint_opt8_t *>(&left_wheel_velocity_)[0] };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	if ( left_wheel_velocity_ < -500 || left_wheel_velocity_ > 500 || right_wheel_velocity_ < -500 || right_wheel_velocity_ > 500 ) { return INVALID_PARAMETER; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	if ( _batching ) {
+		_batch_drive_pending = true;
+		_batch_drive_velocities[0] = left_wheel_velocity_;
+		_batch_drive_velocities[1] = right_wheel_velocity_;
+	} else {
+		_state.stampDriveCommand(left_wheel_velocity_, right_wheel_velocity_);
+	}
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::drivePWM (
+	const int_opt16_t left_wheel_pwm_,
+	const int_opt16_t right_wheel_pwm_
+) {
+	const uint_opt8_t serial_data[5] = { command::DRIVE_PWM, reinterpret_cast<const uint_opt8_t *>(&right_wheel_pwm_)[1], reinterpret_cast<const uint_opt8_t *>(&right_wheel_pwm_)[0], reinterpret_cast<const uint_opt8_t *>(&left_wheel_pwm_)[1], reinterpret_cast<const uint_opt8_t *>(&left_wheel_pwm_)[0] };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	if ( left_wheel_pwm_ < -255 || left_wheel_pwm_ > 255 || right_wheel_pwm_ < -255 || right_wheel_pwm_ > 255 ) { return INVALID_PARAMETER; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::motors (
+	const bitmask::MotorStates motor_state_mask_
+) {
+	const uint_opt8_t serial_data[2] = { command::MOTORS, static_cast<const uint_opt8_t>(motor_state_mask_ & 0x1F) };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::pwmMotors (
+	const int_opt8_t main_brush_,
+	const int_opt8_t side_brush_,
+	const int_opt8_t vacuum_
+) {
+	const uint_opt8_t serial_data[4] = { command::PWM_MOTORS, static_cast<const uint_opt8_t>(main_brush_), static_cast<const uint_opt8_t>(side_brush_), static_cast<const uint_opt8_t>(vacuum_) };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	if ( -128 == main_brush_ || -128 == side_brush_ || vacuum_ < 0 ) { return INVALID_PARAMETER; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::leds (
+	const bitmask::display::LEDs led_mask_,
+	const uint_opt8_t color_,
+	const uint_opt8_t intensity_
+) {
+	const uint_opt8_t serial_data[4] = { command::LEDS, static_cast<const bitmask::display::LEDs>(led_mask_ & 0x0F), color_, intensity_ };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::schedulingLEDs (
+	const bitmask::Days day_mask_,
+	const bitmask::display::SchedulingLEDs display_mask_
+) {
+	const uint_opt8_t serial_data[3] = { command::SCHEDULING_LEDS, static_cast<const bitmask::Days>(day_mask_ & 0x7F), static_cast<const bitmask::display::SchedulingLEDs>(display_mask_ & 0x1F) };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::digitLEDsRaw (
+	const bitmask::display::DigitN raw_leds_[4]
+) {
+	const uint_opt8_t serial_data[5] = { command::DIGIT_LEDS_RAW, static_cast<const bitmask::display::DigitN>(raw_leds_[0] & 0x7F), static_cast<const bitmask::display::DigitN>(raw_leds_[1] & 0x7F), static_cast<const bitmask::display::DigitN>(raw_leds_[2] & 0x7F), static_cast<const bitmask::display::DigitN>(raw_leds_[3] & 0x7F) };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::digitLEDsASCII (
+	const char ascii_leds_[4]
+) {
+	const uint_opt8_t serial_data[5] = { command::DIGIT_LEDS_ASCII, static_cast<const uint_opt8_t>(ascii_leds_[0]), static_cast<const uint_opt8_t>(ascii_leds_[1]), static_cast<const uint_opt8_t>(ascii_leds_[2]), static_cast<const uint_opt8_t>(ascii_leds_[3]) };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	if ( ascii_leds_[0] < 32 || ascii_leds_[0] > 126 || ascii_leds_[1] < 32 || ascii_leds_[1] > 126 || ascii_leds_[2] < 32 || ascii_leds_[2] > 126 || ascii_leds_[3] < 32 || ascii_leds_[3] > 126 ) { return INVALID_PARAMETER; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::buttons (
+	const bitmask::Buttons button_mask_
+) {
+	const uint_opt8_t serial_data[2] = { command::BUTTONS, button_mask_ };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::song (
+	const uint_opt8_t song_number_,
+	const note_t * const song_,
+	const uint_opt8_t note_count_
+) {
+	uint_opt8_t serial_data[(3 + (note_count_ * 2))];
+	uint_opt8_t data_index = 2;
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	if ( song_number_ > 4 || !song_ || !note_count_ || note_count_ > 16 ) { return INVALID_PARAMETER; }
+	
+	serial_data[0] = command::SONG;
+	serial_data[1] = song_number_;
+	serial_data[2] = note_count_;
+	
+	for (uint_opt8_t i = 0 ; i < note_count_ ; ++i ) {
+		serial_data[++data_index] = song_[i].pitch;
+		serial_data[++data_index] = song_[i].duration;
+	}
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::play (
+	const uint_opt8_t song_number_
+) {
+	const uint_opt8_t serial_data[2] = { command::PLAY, song_number_ };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	//TODO: Incorporate state machine - if ( PASSIVE == _oi_mode ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	if ( song_number_ > 4 ) { return INVALID_PARAMETER; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::sensors (
+	const sensor::PacketId packet_id_
+) {
+	const uint_opt8_t serial_data[2] = { command::SENSORS, packet_id_ };
+	// Ensure this is called after serial::multiByteSerialWrite() and SUCCESS is returned
+	//const uint_opt8_t parse_key[2] = { sizeof(parse_key), packet_id_ };
+	//state::setParseKey(parse_key);
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	if ( (packet_id_ > 58 && packet_id_ < 100) || packet_id_ > 107 ) { return INVALID_PARAMETER; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::sensorsAsync (
+	const sensor::PacketId packet_id_,
+	std::future<ReturnCode> * const completion_
+) {
+	const uint_opt8_t serial_data[2] = { command::SENSORS, packet_id_ };
+	const sensor::PacketId parse_key[2] = { static_cast<sensor::PacketId>(sizeof(parse_key)), packet_id_ };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	const ReturnCode rc = _state.expectQuery(parse_key, completion_);
+	if ( SUCCESS != rc ) { return rc; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) {
+		_state.cancelLastQuery();
+		return SERIAL_TRANSFER_FAILURE;
+	}
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::pollSensors (
+	const command::OpCode opcode_,
+	const sensor::PacketId * const sensor_list_,
+	const uint_opt8_t byte_length_
+) {
+	if ( !sensor_list_ ) { return INVALID_PARAMETER; }
+	uint_opt8_t serial_data[(2 + byte_length_)];
+	uint_opt8_t data_index = 1;
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	if ( command::QUERY_LIST != opcode_ && command::STREAM != opcode_ ) { return INVALID_PARAMETER; }
+	
+	serial_data[0] = opcode_;
+	serial_data[1] = byte_length_;
+	
+	for (uint_opt8_t i = 0 ; i < byte_length_ ; ++i ) {
+		if ( (sensor_list_[i] > 58 && sensor_list_[i] < 100) || sensor_list_[i] > 107 ) { continue; }
+		serial_data[++data_index] = sensor_list_[i];
+	}
+	if ( 1 == data_index ) { return INVALID_PARAMETER; }
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+#ifdef SENSORS_ENABLED
+	if ( command::STREAM == opcode_ ) {
+		// The accepted packet ids form the stream key (index 0 holds the key length)
+		serial_data[1] = data_index;
+		_state.setStreamKey(reinterpret_cast<const sensor::PacketId *>(serial_data + 1));
+	}
+#endif
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::queryList (
+	const sensor::PacketId * const sensor_list_,
+	const uint_opt8_t byte_length_
+) {
+	return pollSensors(command::QUERY_LIST, sensor_list_, byte_length_);
+}
+
+template<>
+ReturnCode
+robot<OI500>::queryListAsync (
+	const sensor::PacketId * const sensor_list_,
+	const uint_opt8_t byte_length_,
+	std::future<ReturnCode> * const completion_
+) {
+	if ( !sensor_list_ || !byte_length_ || byte_length_ > 63 ) { return INVALID_PARAMETER; }
+	uint_opt8_t serial_data[(2 + byte_length_)];
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+	
+	// The parse key shares the layout of the request (index 0 holds the key length)
+	serial_data[0] = command::QUERY_LIST;
+	serial_data[1] = (byte_length_ + 1);
+	memcpy((serial_data + 2), sensor_list_, byte_length_);
+	
+	const ReturnCode rc = _state.expectQuery(reinterpret_cast<const sensor::PacketId *>(serial_data + 1), completion_);
+	if ( SUCCESS != rc ) { return rc; }
+	serial_data[1] = byte_length_;
+	
+	if ( !_write(serial_data, sizeof(serial_data)) ) {
+		_state.cancelLastQuery();
+		return SERIAL_TRANSFER_FAILURE;
+	}
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::stream (
+	const sensor::PacketId * const sensor_list_,
+	const uint_opt8_t byte_length_
+) {
+	return pollSensors(command::STREAM, sensor_list_, byte_length_);
+}
+
+template<>
+ReturnCode
+robot<OI500>::pauseResumeStream (
+	const bool resume_
+) {
+	const uint_opt8_t serial_data[2] = { command::PAUSE_RESUME_STREAM, resume_ };
+	//TODO: Incorporate state machine - if ( OFF == _oi_mode ) { return OI_NOT_STARTED; }
+
+	if ( !_write(serial_data, sizeof(serial_data)) ) { return SERIAL_TRANSFER_FAILURE; }
+	
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::beginBatch (
+	void
+) {
+	_batching = true;
+	return SUCCESS;
+}
+
+template<>
+ReturnCode
+robot<OI500>::endBatch (
+	void
+) {
+	_batching = false;
+	return _flushBatch();
+}
+
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
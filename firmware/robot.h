@@ -0,0 +1,347 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef ROBOT_H
+#define ROBOT_H
+
+#include <cstdint>
+#include <future>
+#include <memory>
+
+#include "defines.h"
+#include "open_interface.h"
+#include "serial_port.h"
+#include "state.h"
+
+namespace roomba {
+
+/// \brief A handle to a single Roomba
+/// \details Provides the Open Interface commands of open_interface,
+/// sent on the serial port of this Roomba, along with its own sensor
+/// state (sensor data, parse key and operating mode). Any number of
+/// robots can be driven concurrently from one process, each bound to
+/// its own serial port.
+/// \note The commands behave exactly as their open_interface
+/// counterparts, which drive the Roomba attached to the platform
+/// serial port.
+/// \see state::robot_state
+template <enum OISeries oi_series_>
+class robot {
+  public:
+	/// \brief Bind a new robot to a serial port
+	/// \details The robot owns its sensor state, the serial port is
+	/// borrowed and must outlive the robot.
+	/// \param [in] serial_port_ The port connected to the Roomba
+	explicit
+	robot (
+		serial::port & serial_port_
+	) :
+		_owned_state(new state::robot_state(serial_port_)),
+		_state(*_owned_state),
+		_serial_port(serial_port_),
+		_batching(false),
+		_batch_length(0),
+		_batch_drive_pending(false)
+	{}
+	
+	/// \brief Drive the Roomba of an existing sensor state
+	/// \param [in] robot_state_ The state of the Roomba (i.e. the
+	/// platform Roomba)
+	explicit
+	robot (
+		state::robot_state & robot_state_
+	) :
+		_state(robot_state_),
+		_serial_port(robot_state_.getSerialPort()),
+		_batching(false),
+		_batch_length(0),
+		_batch_drive_pending(false)
+	{}
+	
+	/// \brief Accessor method for the sensor state of the Roomba
+	/// \return The sensor state of the Roomba
+	state::robot_state &
+	getState (
+		void
+	) {
+		return _state;
+	}
+	
+	/// \see open_interface::start
+	ReturnCode
+	start (
+		void
+	);
+	
+	/// \see open_interface::baud
+	ReturnCode
+	baud (
+		const BaudCode baud_code_
+	);
+	
+	/// \see open_interface::control
+	ReturnCode
+	control (
+		void
+	);
+	
+	/// \see open_interface::safe
+	ReturnCode
+	safe (
+		void
+	);
+	
+	/// \see open_interface::full
+	ReturnCode
+	full (
+		void
+	);
+	
+	/// \see open_interface::clean
+	ReturnCode
+	clean (
+		void
+	);
+	
+	/// \see open_interface::max
+	ReturnCode
+	max (
+		void
+	);
+	
+	/// \see open_interface::spot
+	ReturnCode
+	spot (
+		void
+	);
+	
+	/// \see open_interface::seekDock
+	ReturnCode
+	seekDock (
+		void
+	);
+	
+	/// \see open_interface::schedule
+	ReturnCode
+	schedule (
+		const bitmask::Days day_mask_,
+		const clock_time_t * const clock_times_
+	);
+	
+	/// \see open_interface::setDayTime
+	ReturnCode
+	setDayTime (
+		const Day day_,
+		const clock_time_t clock_time_
+	);
+	
+	/// \see open_interface::power
+	ReturnCode
+	power (
+		void
+	);
+	
+	/// \see open_interface::drive
+	ReturnCode
+	drive (
+		const int_opt16_t velocity_,
+		const int_opt16_t radius_
+	);
+	
+	/// \see open_interface::driveDirect
+	ReturnCode
+	driveDirect (
+		const int_opt16_t left_wheel_velocity_,
+		const int_opt16_t right_wheel_velocity_
+	);
+	
+	/// \see open_interface::drivePWM
+	ReturnCode
+	drivePWM (
+		const int_opt16_t left_wheel_pwm_,
+		const int_opt16_t right_wheel_pwm_
+	);
+	
+	/// \see open_interface::motors
+	ReturnCode
+	motors (
+		const bitmask::MotorStates motor_state_mask_
+	);
+	
+	/// \see open_interface::pwmMotors
+	ReturnCode
+	pwmMotors (
+		const int_opt8_t main_brush_,
+		const int_opt8_t side_brush_,
+		const int_opt8_t vacuum_
+	);
+	
+	/// \see open_interface::leds
+	ReturnCode
+	leds (
+		const bitmask::display::LEDs led_mask_,
+		const uint_opt8_t color_,
+		const uint_opt8_t intensity_
+	);
+	
+	/// \see open_interface::schedulingLEDs
+	ReturnCode
+	schedulingLEDs (
+		const bitmask::Days day_mask_,
+		const bitmask::display::SchedulingLEDs led_mask_
+	);
+	
+	/// \see open_interface::digitLEDsRaw
+	ReturnCode
+	digitLEDsRaw (
+		const bitmask::display::DigitN raw_leds_[4]
+	);
+	
+	/// \see open_interface::digitLEDsASCII
+	ReturnCode
+	digitLEDsASCII (
+		const char ascii_leds_[4]
+	);
+	
+	/// \see open_interface::buttons
+	ReturnCode
+	buttons (
+		const bitmask::Buttons button_mask_
+	);
+	
+	/// \see open_interface::song
+	ReturnCode
+	song (
+		const uint_opt8_t song_number_,
+		const note_t * const song_,
+		const uint_opt8_t note_count_
+	);
+	
+	/// \see open_interface::play
+	ReturnCode
+	play (
+		const uint_opt8_t song_number_
+	);
+	
+	/// \see open_interface::sensors
+	ReturnCode
+	sensors (
+		const sensor::PacketId packet_id_
+	);
+	
+	/// \brief Request a sensor packet without waiting for the response
+	/// \see robot::queryListAsync
+	ReturnCode
+	sensorsAsync (
+		const sensor::PacketId packet_id_,
+		std::future<ReturnCode> * const completion_
+	);
+	
+	/// \see open_interface::queryList
+	ReturnCode
+	queryList (
+		const sensor::PacketId * const sensor_list_,
+		const uint_opt8_t byte_length_
+	);
+	
+	/// \brief Request a list of sensor packets without waiting for
+	/// the response
+	/// \details The query is registered with the robot state, then
+	/// written. Further queries may be written immediately, so the
+	/// requests and responses are pipelined back to back. The future
+	/// is fulfilled once the response has been parsed, by the I/O layer
+	/// servicing the port (reactor or io_uring engine) or by
+	/// robot_state::serviceQueries().
+	/// \param [in] sensor_list_ An array of packet ids
+	/// \param [in] byte_length_ The length of the array
+	/// \param [out] completion_ Receives the future of the query, which
+	/// yields SUCCESS or SERIAL_TRANSFER_FAILURE
+	/// \note Do not stream while queries are pending, the responses
+	/// are not framed.
+	/// \retval SUCCESS
+	/// \retval INVALID_PARAMETER
+	/// \retval NO_DATA_AVAILABLE Too many queries are pending
+	/// \retval SERIAL_TRANSFER_FAILURE
+	/// \see open_interface::queryList
+	/// \see state::robot_state::expectQuery
+	ReturnCode
+	queryListAsync (
+		const sensor::PacketId * const sensor_list_,
+		const uint_opt8_t byte_length_,
+		std::future<ReturnCode> * const completion_
+	);
+	
+	/// \see open_interface::stream
+	ReturnCode
+	stream (
+		const sensor::PacketId * const sensor_list_,
+		const uint_opt8_t byte_length_
+	);
+	
+	/// \see open_interface::pauseResumeStream
+	ReturnCode
+	pauseResumeStream (
+		const bool resume_
+	);
+	
+	/// \see open_interface::beginBatch
+	ReturnCode
+	beginBatch (
+		void
+	);
+	
+	/// \see open_interface::endBatch
+	ReturnCode
+	endBatch (
+		void
+	);
+	
+  protected:
+	/// \see open_interface::pollSensors
+	ReturnCode
+	pollSensors (
+		const command::OpCode opcode_,
+		const sensor::PacketId * const sensor_list_,
+		const uint_opt8_t byte_length_
+	);
+	
+  private:
+	friend class open_interface<oi_series_>;
+	
+	robot (const robot &) = delete;
+	robot & operator= (const robot &) = delete;
+	
+	/// \brief Capacity of the batch buffer (in bytes)
+	static const uint_opt16_t BATCH_CAPACITY = 256;
+	
+	ReturnCode
+	_flushBatch (
+		void
+	);
+	
+	size_t
+	_serialWrite (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	);
+	
+	size_t
+	_write (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	);
+	
+	std::unique_ptr<state::robot_state> _owned_state; ///< sensor state owned by the robot (if any)
+	state::robot_state & _state; ///< sensor state of the Roomba
+	serial::port & _serial_port; ///< serial port connected to the Roomba
+	bool _batching; ///< commands are appended to the batch buffer
+	uint_opt16_t _batch_length; ///< bytes held by the batch buffer
+	uint_opt8_t _batch_buffer[BATCH_CAPACITY]; ///< commands issued during a batch
+	bool _batch_drive_pending; ///< the batch buffer holds a drive command awaiting its latency stamp
+	int_opt16_t _batch_drive_velocities[2]; ///< velocities (left, right) of the last drive command of the batch
+};
+
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
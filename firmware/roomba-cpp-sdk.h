@@ -3,10 +3,14 @@
 #ifndef ROOMBA_CPP_SDK_H
 #define ROOMBA_CPP_SDK_H
 
+#include "command_queue.h"
 #include "defines.h"
 #include "state.h"
 #include "open_interface.h"
+#include "robot.h"
 #include "serial.h"
+#include "uart_scheduler.h"
+#include "virtual_roomba.h"
 
 #endif
 
@@ -6,11 +6,14 @@
 #include <cstdlib>
 
 #include "defines.h"
+#include "serial_port.h"
 
 #if defined(TESTING)
 	#include "test/MOCK_serial.h"
 #elif defined(ARDUINO) || defined(SPARK)
 	#include "wiring.h"
+#elif defined(__linux__)
+	#include "posix.h"
 #endif
 
 namespace roomba {
@@ -20,6 +23,8 @@ namespace roomba {
 /// lists the basic services to be provided by a serial platform. An
 /// explicit serial protocol will be instantiated at compilation.
 /// (i.e. Wiring, Linux, Windows_NT, Windows_UAP, etc...).
+/// \note On Linux the tty must be opened with posix::openSerialPort()
+/// before any commands are sent.
 namespace serial {
 
 /// \brief Begin the serial connection
@@ -35,6 +40,8 @@ beginAtBaudCode (
 	return mock::beginAtBaudCode(baud_code_);
 #elif defined(ARDUINO) || defined(SPARK)
 	return wiring::beginAtBaudCode(baud_code_);
+#elif defined(__linux__)
+	return posix::beginAtBaudCode(baud_code_);
 #else
 	return;
 #endif
@@ -52,6 +59,8 @@ delayMs (
 	return mock::delayMs(desired_ms_);
 #elif defined(ARDUINO) || defined(SPARK)
 	return wiring::delayMs(desired_ms_);
+#elif defined(__linux__)
+	return posix::delayMs(desired_ms_);
 #else
 	return 0;
 #endif
@@ -69,6 +78,8 @@ delayUs (
 	return mock::delayUs(desired_us_);
 #elif defined(ARDUINO) || defined(SPARK)
 	return wiring::delayUs(desired_us_);
+#elif defined(__linux__)
+	return posix::delayUs(desired_us_);
 #else
 	return 0;
 #endif
@@ -92,6 +103,8 @@ multiByteSerialRead (
 	return mock::multiByteSerialRead(data_buffer_, buffer_length_, timeout_ms_);
 #elif defined(ARDUINO) || defined(SPARK)
 	return wiring::multiByteSerialRead(data_buffer_, buffer_length_, timeout_ms_);
+#elif defined(__linux__)
+	return posix::multiByteSerialRead(data_buffer_, buffer_length_, timeout_ms_);
 #else
 	return 0;
 #endif
@@ -113,11 +126,43 @@ multiByteSerialWrite (
 	return mock::multiByteSerialWrite(serial_data_, data_length_);
 #elif defined(ARDUINO) || defined(SPARK)
 	return wiring::multiByteSerialWrite(serial_data_, data_length_);
+#elif defined(__linux__)
+	return posix::multiByteSerialWrite(serial_data_, data_length_);
 #else
 	return 0;
 #endif
 }
 
+/// \brief The serial port of the platform
+/// \details Forwards to the platform functions above, and is used by
+/// the Roomba driven through the static open_interface methods.
+class platform_port : public port {
+  public:
+	void
+	beginAtBaudCode (
+		const BaudCode baud_code_
+	) override {
+		serial::beginAtBaudCode(baud_code_);
+	}
+	
+	size_t
+	multiByteSerialRead (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_,
+		const uint_opt32_t timeout_ms_ = 1000
+	) override {
+		return serial::multiByteSerialRead(data_buffer_, buffer_length_, timeout_ms_);
+	}
+	
+	size_t
+	multiByteSerialWrite (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	) override {
+		return serial::multiByteSerialWrite(serial_data_, data_length_);
+	}
+};
+
 } // namespace serial
 } // namespace roomba
 
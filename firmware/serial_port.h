@@ -0,0 +1,57 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef SERIAL_PORT_H
+#define SERIAL_PORT_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "defines.h"
+
+namespace roomba {
+namespace serial {
+
+/// \brief A serial port connected to a Roomba
+/// \details Interface implemented by each serial transport. A port
+/// object is bound to a single Roomba, which allows several Roombas
+/// to be driven from one process (each with its own port).
+/// \see state::robot_state
+class port {
+  public:
+	virtual ~port (void) {}
+	
+	/// \brief Begin the serial connection
+	/// \param [in] baud_code_ The code indicating a specific rate
+	/// \see serial::beginAtBaudCode
+	virtual
+	void
+	beginAtBaudCode (
+		const BaudCode baud_code_
+	) = 0;
+	
+	/// \brief Multi-byte read access to the port
+	/// \see serial::multiByteSerialRead
+	virtual
+	size_t
+	multiByteSerialRead (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_,
+		const uint_opt32_t timeout_ms_ = 1000
+	) = 0;
+	
+	/// \brief Multi-byte write access to the port
+	/// \see serial::multiByteSerialWrite
+	virtual
+	size_t
+	multiByteSerialWrite (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	) = 0;
+};
+
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
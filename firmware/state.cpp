@@ -1,94 +1,29 @@
 /* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
 
 #include "state.h"
+#include "packets.h"
 #include "serial.h"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <memory>
 #include <mutex>
+#include <thread>
 
 namespace roomba {
 namespace state {
 
-/// \brief Format of the data stored in shared memory
-/// \details The variable data utilized by both the OICommand and
-/// oi:sensors methods. OICommand and the oi::sensors methods execute
-/// concurrently, therefore this data will be accessed concurrently.
-/// All methods accessing this data will need to take possession
-/// of the internal mutex to ensure the integrity of this data.
-namespace {
-	/// \brief The baud rate associated with the serial bus
-	/// \details This variable is used to calculate buffer overrun
-	/// protection.
-	BaudCode _baud_code(BAUD_115200);
-	
-	/// \brief Indicates the validity of the sensor packet ids
-	/// \details The index of each bit is tied to the corresponding
-	/// packet id. If a sensor value returned from the Roomba has
-	/// stale or invalid data (as indicated by the checksum) then
-	/// the dirty bit will be flagged.
-	uint_opt64_t _flag_mask_dirty;
-	
-	/// \brief The mode associated with the state of the open interface
-	/// \details This variable is used to gate function calls.
-	OIMode _oi_mode(OFF);
-	
-	/// \brief Key to decode the Roomba's serial stream
-	/// \details The Roomba returns a blob of data representing the
-	/// preceding sensor request. The key is a 1-base indexed array
-	/// of packet ids ordered the exact same sequence as the request.
-	/// \note The zero index is used to store the size.
-	/// \note The maximum size allowed is 64, which provides room for
-	/// the count and one of each sensor.
-	/// \see OICommand::sensors
-	/// \see OICommand::queryList
-	sensor::PacketId _parse_key[64] = { static_cast<sensor::PacketId>(0) };
-	
-	/// \brief Status messages resulting from parsing
-	/// \details The parsing function is asynchronous, and therefore
-	/// cannot return a status code directly.
-	ReturnCode _parse_status(SUCCESS);
-	
-	/// \brief Raw sensor data
-	/// \details The data blob used to store sensor data returned from
-	/// the iRobot Roomba in big endian format.
-	uint_opt8_t _raw_data[80];
-	
-	/// \brief Time point when all sensor data should be returned
-	/// \details Time required for the Roomba to process the query,
-	/// then return the requested data at the current baud rate.
-	std::chrono::time_point<std::chrono::steady_clock, std::chrono::milliseconds> _serial_read_next_available_ms;
-	
-	/// \brief Mutex for the shared sensor data
-	std::mutex _shared_data;
-} // namespace
-
 /// \brief Constant data used to manage data returned from the iRobot® Roomba
 /// \details This constant data facilitates inserting and retreiving
-/// sensor data from the blob. Some "data" is represented "functionally"
-/// to reduce wasted space for sparse data sets. The data functions do
-/// not contain error checking, and should only be used internally.
+/// sensor data from the blob. The location, size and flags of each
+/// packet are described by the constexpr tables of packets.h.
 namespace {
-	/// \brief Baud rate
-	/// \details The baud rate represented as an integer value
-	const uint_opt32_t _BAUD_RATE[] = {
-		300,     // BAUD_300
-		600,     // BAUD_600
-		1200,    // BAUD_1200
-		2400,    // BAUD_2400
-		4800,    // BAUD_4800
-		9600,    // BAUD_9600
-		14400,   // BAUD_14400
-		19200,   // BAUD_19200
-		28800,   // BAUD_28800
-		38400,   // BAUD_38400
-		57600,   // BAUD_57600
-		115200,  // BAUD_115200
-	};
-	
 	/// \brief Packet ids associated with signed data
 	/// \details A bit mask indicating which packet ids are associated with
 	/// signed data.
-	const uint_opt64_t _FLAG_MASK_SIGNED = 0x03C0078001980000;
+	const uint_opt64_t _FLAG_MASK_SIGNED = sensor::signedFlagMask();
 
 	/// \brief Hardware serial delay
 	/// \details The time (in milliseconds) required for the Roomba to receive
@@ -97,200 +32,24 @@ namespace {
 	/// \note This value is half-adjusted up to enforce rounding.
 	const uint_opt8_t HARDWARE_SERIAL_DELAY_MS(4);
 	
-	/// \brief Packet offset and size information
-	/// \details A table providing information regarding the pointer offset
-	/// where the associated data can be found (high bits 7-1), and a flag
-	/// (low bit) indicating whether the size of the data is 1 byte or larger.
-	/// \n Format:
-	/// \n |7|6|5|4|3|2|1|0|
-	/// \n |o|o|o|o|o|o|o|>|
-	/// \n Access:
-	/// * Offset value: _PACKET_INFO[x] >> 1
-	/// * Size boolean: _PACKET_INFO[x] & 0x01
-	const sensor::PacketId _PACKET_INFO[] = {
-		static_cast<sensor::PacketId>(0x01),  // PACKETS_7_THRU_26
-		static_cast<sensor::PacketId>(0x01),  // PACKETS_7_THRU_16
-		static_cast<sensor::PacketId>(0x15),  // PACKETS_17_THRU_20
-		static_cast<sensor::PacketId>(0x21),  // PACKETS_21_THRU_26
-		static_cast<sensor::PacketId>(0x35),  // PACKETS_27_THRU_34
-		static_cast<sensor::PacketId>(0x51),  // PACKETS_35_THRU_42
-		static_cast<sensor::PacketId>(0x01),  // PACKETS_7_THRU_42
-		static_cast<sensor::PacketId>(0x00),  // BUMPS_AND_WHEEL_DROPS
-		static_cast<sensor::PacketId>(0x02),  // WALL
-		static_cast<sensor::PacketId>(0x04),  // CLIFF_LEFT
-		static_cast<sensor::PacketId>(0x06),  // CLIFF_FRONT_LEFT
-		static_cast<sensor::PacketId>(0x08),  // CLIFF_FRONT_RIGHT
-		static_cast<sensor::PacketId>(0x0A),  // CLIFF_RIGHT
-		static_cast<sensor::PacketId>(0x0C),  // VIRTUAL_WALL
-		static_cast<sensor::PacketId>(0x0E),  // MOTOR_OVERCURRENTS
-		static_cast<sensor::PacketId>(0x10),  // DIRT_DETECT
-		static_cast<sensor::PacketId>(0x12),  // RESERVED_1
-		static_cast<sensor::PacketId>(0x14),  // INFRARED_CHARACTER_OMNI
-		static_cast<sensor::PacketId>(0x16),  // BUTTONS
-		static_cast<sensor::PacketId>(0x19),  // DISTANCE
-		static_cast<sensor::PacketId>(0x1D),  // ANGLE
-		static_cast<sensor::PacketId>(0x20),  // CHARGING_STATE
-		static_cast<sensor::PacketId>(0x23),  // VOLTAGE
-		static_cast<sensor::PacketId>(0x27),  // CURRENT
-		static_cast<sensor::PacketId>(0x2A),  // TEMPERATURE
-		static_cast<sensor::PacketId>(0x2D),  // BATTERY_CHARGE
-		static_cast<sensor::PacketId>(0x31),  // BATTERY_CAPACITY
-		static_cast<sensor::PacketId>(0x35),  // WALL_SIGNAL
-		static_cast<sensor::PacketId>(0x39),  // CLIFF_LEFT_SIGNAL
-		static_cast<sensor::PacketId>(0x3D),  // CLIFF_FRONT_LEFT_SIGNAL
-		static_cast<sensor::PacketId>(0x41),  // CLIFF_FRONT_RIGHT_SIGNAL
-		static_cast<sensor::PacketId>(0x45),  // CLIFF_RIGHT_SIGNAL
-		static_cast<sensor::PacketId>(0x48),  // RESERVED_2
-		static_cast<sensor::PacketId>(0x4B),  // RESERVED_3
-		static_cast<sensor::PacketId>(0x4E),  // CHARGING_SOURCES_AVAILABLE
-		static_cast<sensor::PacketId>(0x50),  // OI_MODE
-		static_cast<sensor::PacketId>(0x52),  // SONG_NUMBER
-		static_cast<sensor::PacketId>(0x54),  // SONG_PLAYING
-		static_cast<sensor::PacketId>(0x56),  // NUMBER_OF_STREAM_PACKETS
-		static_cast<sensor::PacketId>(0x59),  // REQUESTED_VELOCITY
-		static_cast<sensor::PacketId>(0x5D),  // REQUESTED_RADIUS
-		static_cast<sensor::PacketId>(0x61),  // REQUESTED_RIGHT_VELOCITY
-		static_cast<sensor::PacketId>(0x65),  // REQUESTED_LEFT_VELOCITY
-		static_cast<sensor::PacketId>(0x69),  // RIGHT_ENCODER_COUNTS
-		static_cast<sensor::PacketId>(0x6D),  // LEFT_ENCODER_COUNTS
-		static_cast<sensor::PacketId>(0x70),  // LIGHT_BUMPER
-		static_cast<sensor::PacketId>(0x73),  // LIGHT_BUMP_LEFT_SIGNAL
-		static_cast<sensor::PacketId>(0x77),  // LIGHT_BUMP_FRONT_LEFT_SIGNAL
-		static_cast<sensor::PacketId>(0x7B),  // LIGHT_BUMP_CENTER_LEFT_SIGNAL
-		static_cast<sensor::PacketId>(0x7F),  // LIGHT_BUMP_CENTER_RIGHT_SIGNAL
-		static_cast<sensor::PacketId>(0x83),  // LIGHT_BUMP_FRONT_RIGHT_SIGNAL
-		static_cast<sensor::PacketId>(0x87),  // LIGHT_BUMP_RIGHT_SIGNAL
-		static_cast<sensor::PacketId>(0x8A),  // INFRARED_CHARACTER_LEFT
-		static_cast<sensor::PacketId>(0x8C),  // INFRARED_CHARACTER_RIGHT
-		static_cast<sensor::PacketId>(0x8F),  // LEFT_MOTOR_CURRENT
-		static_cast<sensor::PacketId>(0x93),  // RIGHT_MOTOR_CURRENT
-		static_cast<sensor::PacketId>(0x97),  // MAIN_BRUSH_MOTOR_CURRENT
-		static_cast<sensor::PacketId>(0x9B),  // SIDE_BRUSH_MOTOR_CURRENT
-		static_cast<sensor::PacketId>(0x9E),  // STASIS
-		static_cast<sensor::PacketId>(0x01),  // PACKETS_7_THRU_58
-		static_cast<sensor::PacketId>(0x69),  // PACKETS_43_THRU_58
-		static_cast<sensor::PacketId>(0x73),  // PACKETS_46_THRU_51
-		static_cast<sensor::PacketId>(0x8F)   // PACKETS_54_THRU_58
-	};
-	
-	/// \brief Creates bit-mask of individual packet ids associated with
-	/// given packet id
-	/// \param [in] packet_id_ Packet id for which to generate a
-	/// corresponding bitmask
-	/// \warning This function does NOT contain error checking, does
-	/// NOT return error codes and should only be used internally.
-	/// \return A bitmask representing all associated packet ids
-	inline
-	uint_opt64_t
-	_flagMaskForPacket (
-		const sensor::PacketId packet_id_
-	) {
-		switch (packet_id_) {
-		  case sensor::PACKETS_7_THRU_26:
-			return 0x0000000007FFFF81;
-		  case sensor::PACKETS_7_THRU_16:
-			return 0x000000000001FF82;
-		  case sensor::PACKETS_17_THRU_20:
-			return 0x00000000001E0004;
-		  case sensor::PACKETS_21_THRU_26:
-			return 0x0000000007E00008;
-		  case sensor::PACKETS_27_THRU_34:
-			return 0x00000007F8000010;
-		  case sensor::PACKETS_35_THRU_42:
-			return 0x000007F800000020;
-		  case sensor::PACKETS_7_THRU_42:
-			return 0x000007FFFFFFFFC0;
-		  case sensor::PACKETS_7_THRU_58:
-			return 0x0FFFFFFFFFFFFF80;
-		  case sensor::PACKETS_43_THRU_58:
-			return 0x17FFF80000000000;
-		  case sensor::PACKETS_46_THRU_51:
-			return 0x200FC00000000000;
-		  case sensor::PACKETS_54_THRU_58:
-			return 0x47C0000000000000;
-		  default:
-		    return (static_cast<uint_opt64_t>(1) << packet_id_);
-		}
-	}
+	/// \brief Lateness tolerated of a query response
+	/// \details The deadline of a query is an estimate, the margin
+	/// absorbs the scheduling jitter of the host and the USB adapter.
+	const std::chrono::milliseconds QUERY_DEADLINE_MARGIN(100);
 	
-	/// \brief Array index for packet id
-	/// \details Maps packet ids into indices between 0-62 which enables
-	/// the ability to use 64-bit bitmask to represent flags associated
-	/// with each packet, as well as the ability to create compact (non-
-	/// spare) arrays of informational data associated with each packet.
-	/// \param [in] packet_id_ Packet id for which to provide the
-	/// corresponding index
-	/// \warning This function does NOT contain error checking, does
-	/// NOT return error codes and should only be used internally.
-	/// \return Index associated with the packet id provided
-	inline
-	uint_opt8_t
-	_packetIndex (
-		const sensor::PacketId packet_id_
-	) {
-		switch (packet_id_) {
-		  case sensor::PACKETS_7_THRU_58:
-			return 59;
-		  case sensor::PACKETS_43_THRU_58:
-			return 60;
-		  case sensor::PACKETS_46_THRU_51:
-			return 61;
-		  case sensor::PACKETS_54_THRU_58:
-			return 62;
-		  default:
-		    return packet_id_;
-		}
-	}
+	/// \brief Pause of the stream reader when no frame could be read
+	/// \details A non-blocking port returns at once while the stream is
+	/// idle. The pause is a fraction of the 15 ms frame period, so it
+	/// delays a frame by no more than a millisecond.
+	const std::chrono::milliseconds STREAM_READER_BACKOFF(1);
 	
-	/// \brief Provides the size of the packet (in bytes)
-	/// \details Provides the size of the packet (in bytes) when the
-	/// value is greater than one. Packet data is stored in a single
-	/// memory location as a data blob. Packet groups are a subset of
-	/// packets which reside in contiguous memory locations. Therefore,
-	/// the data for a packet group can be written or read as a single
-	/// operation when the size is provided.
-	/// \param [in] packet_id_ Packet id for which to provide the
-	/// corresponding size
-	/// \note The use of this function is only necessary when the
-	/// low-bit of the _PACKET_INFO table is set ON (true).
-	/// \note Values located in iRobot® Roomba Open Interface (OI)
-	/// Specification (page 19)
-	/// \warning This function does NOT contain error checking, does
-	/// NOT return error codes and should only be used internally.
-	/// \return The size (in bytes) of the packet id provided
-	/// \see _PACKET_INFO[]
-	inline
-	uint_opt8_t
-	_packetSize (
-		const sensor::PacketId packet_id_
-	) {
-		switch (packet_id_) {
-		  case sensor::PACKETS_7_THRU_26:
-			return 26;
-		  case sensor::PACKETS_7_THRU_16:
-			return 10;
-		  case sensor::PACKETS_17_THRU_20:
-			return 6;
-		  case sensor::PACKETS_21_THRU_26:
-			return 10;
-		  case sensor::PACKETS_27_THRU_34:
-			return 14;
-		  case sensor::PACKETS_35_THRU_42:
-			return 12;
-		  case sensor::PACKETS_7_THRU_42:
-			return 52;
-		  case sensor::PACKETS_7_THRU_58:
-			return 80;
-		  case sensor::PACKETS_43_THRU_58:
-			return 28;
-		  case sensor::PACKETS_46_THRU_51:
-			return 12;
-		  case sensor::PACKETS_54_THRU_58:
-			return 9;
-		  default:
-		    return 2;
-		}
-	}
+	/// \brief First byte of every stream frame
+	const uint_opt8_t STREAM_HEADER(19);
+	
+	/// \brief Bytes read by parseStreamData() before giving up
+	/// \details Enough to skip a corrupt frame and read the next
+	/// frame in its entirety.
+	const uint_opt16_t STREAM_SYNC_WINDOW(2 * robot_state::STREAM_FRAME_MAX);
 } // namespace
 
 /// \brief Internal helper functions
@@ -312,127 +71,831 @@ namespace {
 		uint_opt16_t byte_count(0);
 		
 		for ( uint_opt8_t i = 1 ; i < *query_list_ ; ++i ) {
-			const uint_opt8_t pi = _packetIndex(query_list_[i]);
-			if ( _PACKET_INFO[pi] & 0x01 ) {
-				byte_count += _packetSize(query_list_[i]);
-			} else {
-				++byte_count;
-			}
+			byte_count += sensor::packetDescriptor(query_list_[i]).size;
 		}
 		
 		return byte_count;
 	}
 
-	/// \brief Store a packet in shared memory
-	/// \details The data value of the packet id will be read from the
-	/// serial bus and stored into shared memory.
-	/// \param [in] packet_id_ Packet Id associated with the data
-	/// \param [out] packet_size_ Returns the size of the packet stored
-	/// \param [out] check_sum_ Tracks the check sum of the data being transferred
-	/// \return SUCCESS
-	/// \return SERIAL_TRANSFER_FAILURE
-	/// \see state::parseQueryData
-	/// \see state::parseStreamData
+	/// \brief Advance a counter written by a single thread
+	/// \details The parsing thread is the only writer, so a relaxed load
+	/// and store suffice, and readers never see a torn value.
+	/// \param [in,out] counter_ The counter to advance
+	/// \param [in] amount_ The amount to add [default value: 1]
 	inline
-	ReturnCode
-	_readPacketValueIntoRawDataBlob (
-		const sensor::PacketId packet_id_,
-		uint_opt8_t * const packet_size_,
-		uint_opt8_t * const check_sum_
+	void
+	_increment (
+		std::atomic<uint_opt32_t> & counter_,
+		const uint_opt32_t amount_ = 1
 	) {
-		const uint_opt8_t pi = _packetIndex(packet_id_);
-		uint_opt8_t bytes_read = 0;
-		bool size_greater_than_one = ( _PACKET_INFO[pi] & 0x01 );
-		*packet_size_ = (size_greater_than_one * _packetSize(packet_id_)) + !size_greater_than_one;
-		bytes_read = serial::multiByteSerialRead((_raw_data + (_PACKET_INFO[pi] >> 1)), *packet_size_);
-		if ( bytes_read != *packet_size_ ) {
-			return SERIAL_TRANSFER_FAILURE;
-		}
-		for ( uint_opt8_t i = 0 ; i < *packet_size_ ; ++i ) {
-			*check_sum_ += (_raw_data + (_PACKET_INFO[pi] >> 1))[i];
+		counter_.store((counter_.load(std::memory_order_relaxed) + amount_), std::memory_order_relaxed);
+	}
+
+	/// \brief Provides the size of the packet value (in bytes)
+	/// \param [in] packet_id_ Packet id for which to provide the size
+	/// \return The size (in bytes) of the packet value
+	inline
+	uint_opt8_t
+	_packetValueSize (
+		const sensor::PacketId packet_id_
+	) {
+		return sensor::packetDescriptor(packet_id_).size;
+	}
+} // namespace
+
+namespace {
+	/// \brief The state of the Roomba attached to the platform serial port
+	/// \details Constructed on first use, so the free functions may be
+	/// called during static initialization.
+	inline
+	robot_state &
+	_platformRobotState (
+		void
+	) {
+		static serial::platform_port platform_port;
+		static robot_state platform_robot_state(platform_port);
+		return platform_robot_state;
+	}
+} // namespace
+
+robot_state::robot_state (
+	serial::port & serial_port_
+) :
+	_baud_code(BAUD_115200),
+	_flag_mask_dirty(static_cast<uint_opt64_t>(-1)),
+	_oi_mode(OFF),
+	_stream_format(std::make_shared<stream_format_t>()),
+	_parse_status(SUCCESS),
+	_snapshots_published(0),
+	_stream_reader_running(false),
+	_latency_tracking(false),
+	_telemetry_recorder(nullptr),
+	_serial_port(serial_port_)
+{
+	*_parse_key = static_cast<sensor::PacketId>(0);
+	_resetParseCounters();
+	_stream_parser.buffered = 0;
+	_stream_parser.scanned = 0;
+	_stream_parser.byte_sum = 0;
+	_snapshot_slots[0].sequence.store(0);
+	_snapshot_slots[1].sequence.store(0);
+	_query_pipeline.head = 0;
+	_query_pipeline.count.store(0);
+	_query_pipeline.key_index = 1;
+	_query_pipeline.value_bytes = 0;
+	_query_pipeline.flag_mask_received = 0;
+	_drive_probe.write_time.store(0);
+	_drive_probe.velocities.store(0);
+}
+
+robot_state::~robot_state (
+	void
+) {
+	stopStreamReader();
+}
+
+serial::port &
+robot_state::getSerialPort (
+	void
+) const {
+	return _serial_port;
+}
+
+OIMode
+robot_state::getOIMode (
+	void
+) const {
+	return _oi_mode;
+}
+
+/// \brief Publish the raw data blob
+/// \details Copies the blob into the slot readers are not using, then
+/// makes it the latest slot.
+inline
+void
+robot_state::_publishSnapshot (
+	void
+) {
+	const uint_opt32_t frame_count = (_snapshots_published.load(std::memory_order_relaxed) + 1);
+	snapshot_slot_t & slot = _snapshot_slots[frame_count & 0x01];
+	const uint_opt32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+
+	slot.sequence.store((sequence + 1), std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.snapshot.frame_count = frame_count;
+	slot.snapshot.flag_mask_dirty = _flag_mask_dirty;
+	memcpy(&slot.snapshot.sensor_data, _raw_data, sizeof(slot.snapshot.sensor_data));
+	slot.sequence.store((sequence + 2), std::memory_order_release);
+
+	_snapshots_published.store(frame_count, std::memory_order_release);
+}
+
+/// \brief Fail every pending query
+/// \details The shared data lock must be held.
+inline
+void
+robot_state::_failQueries (
+	void
+) {
+	for ( ; _query_pipeline.count.load(std::memory_order_relaxed) ; _query_pipeline.head = ((_query_pipeline.head + 1) % QUERY_PIPELINE_DEPTH) ) {
+		_query_pipeline.queries[_query_pipeline.head].completion.set_value(SERIAL_TRANSFER_FAILURE);
+		_query_pipeline.count.fetch_sub(1, std::memory_order_release);
+	}
+	_query_pipeline.key_index = 1;
+	_query_pipeline.value_bytes = 0;
+	_query_pipeline.flag_mask_received = 0;
+}
+
+/// \brief Store a packet in shared memory
+/// \details The data value of the packet id is copied from a staging
+/// buffer into its location in the raw data blob.
+/// \param [in] packet_id_ Packet Id associated with the data
+/// \param [in] packet_value_ The big endian value of the packet
+/// \return The size of the packet value stored
+/// \see state::parseQueryData
+/// \see state::parseStreamData
+inline
+uint_opt8_t
+robot_state::_copyPacketValueIntoRawDataBlob (
+	const sensor::PacketId packet_id_,
+	const uint_opt8_t * const packet_value_
+) {
+	const sensor::packet_descriptor_t & packet_descriptor = sensor::packetDescriptor(packet_id_);
+	memcpy((_raw_data + packet_descriptor.offset), packet_value_, packet_descriptor.size);
+	return packet_descriptor.size;
+}
+
+/// \brief Discard the buffered bytes preceding the next frame header
+/// \param [in] first_candidate_ Index of the first byte that may be
+/// a frame header
+/// \return The number of bytes discarded
+inline
+uint_opt16_t
+robot_state::_discardStreamBytesBeforeHeader (
+	const uint_opt16_t first_candidate_
+) {
+	uint_opt16_t header_index = first_candidate_;
+	while ( header_index < _stream_parser.buffered && STREAM_HEADER != _stream_parser.frame[header_index] ) { ++header_index; }
+
+	_stream_parser.buffered -= header_index;
+	memmove(_stream_parser.frame, (_stream_parser.frame + header_index), _stream_parser.buffered);
+	_stream_parser.scanned = 0;
+	_stream_parser.byte_sum = 0;
+
+	return header_index;
+}
+
+/// \brief Match a stream frame to the drive command being timed
+/// \details Records the latencies of the command, when the frame
+/// reflects its velocities and began after it was written. Runs on the
+/// parsing thread, after the snapshot of the frame has been published.
+/// \param [in] flag_mask_received_ The flags of the packets in the frame
+/// \param [in] frame_complete_time_ The time the frame was validated
+/// \see robot_state::setLatencyTracking
+inline
+void
+robot_state::_observeDriveCommand (
+	const uint_opt64_t flag_mask_received_,
+	const std::chrono::steady_clock::time_point frame_complete_time_
+) {
+	const uint_opt64_t flag_mask_velocities = (sensor::packet_traits<sensor::REQUESTED_RIGHT_VELOCITY>::flag_mask | sensor::packet_traits<sensor::REQUESTED_LEFT_VELOCITY>::flag_mask);
+	if ( flag_mask_velocities != (flag_mask_received_ & flag_mask_velocities) ) { return; }
+
+	// Read the command twice, to detect a replacement in between
+	std::chrono::steady_clock::rep write_ticks = _drive_probe.write_time.load(std::memory_order_acquire);
+	const uint_opt32_t velocities = _drive_probe.velocities.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if ( !write_ticks || write_ticks != _drive_probe.write_time.load(std::memory_order_relaxed) ) { return; }
+
+	const std::chrono::steady_clock::time_point write_time = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(write_ticks));
+	if ( _stream_parser.header_time < write_time ) { return; }
+	const uint_opt32_t frame_velocities = ((static_cast<uint_opt32_t>(sensor::decode<sensor::REQUESTED_RIGHT_VELOCITY>(_raw_data) & 0xFFFF) << 16) | (sensor::decode<sensor::REQUESTED_LEFT_VELOCITY>(_raw_data) & 0xFFFF));
+	if ( velocities != frame_velocities ) { return; }
+
+	// Claim the command, unless it has just been replaced
+	if ( !_drive_probe.write_time.compare_exchange_strong(write_ticks, 0, std::memory_order_relaxed) ) { return; }
+	const std::chrono::steady_clock::time_point snapshot_time = std::chrono::steady_clock::now();
+	_latency_histograms[WRITE_TO_FIRST_BYTE].record(std::chrono::duration_cast<std::chrono::microseconds>(_stream_parser.header_time - write_time));
+	_latency_histograms[WRITE_TO_FRAME_COMPLETE].record(std::chrono::duration_cast<std::chrono::microseconds>(frame_complete_time_ - write_time));
+	_latency_histograms[WRITE_TO_SNAPSHOT].record(std::chrono::duration_cast<std::chrono::microseconds>(snapshot_time - write_time));
+}
+
+/// \brief Copy a validated stream frame into the raw data blob
+/// \details Packet values are written to the blob and their dirty
+/// flags are cleared. The frame must have passed validation.
+/// \param [in] frame_ The frame (header first)
+inline
+void
+robot_state::_commitStreamFrame (
+	const uint_opt8_t * const frame_
+) {
+	uint_opt64_t flag_mask_received(0);
+	const uint_opt16_t payload_end = (frame_[1] + 2);
+	const bool timing = static_cast<bool>(_drive_probe.write_time.load(std::memory_order_relaxed));
+	const std::chrono::steady_clock::time_point frame_complete_time = ( timing ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point() );
+
+	for ( uint_opt16_t i = 2 ; i < payload_end ; ) {
+		const sensor::PacketId packet_id = static_cast<sensor::PacketId>(frame_[i]);
+		i += (_copyPacketValueIntoRawDataBlob(packet_id, (frame_ + i + 1)) + 1);
+		flag_mask_received |= sensor::packetDescriptor(packet_id).flag_mask;
+	}
+
+	_flag_mask_dirty &= ~flag_mask_received;
+	_publishSnapshot();
+	_increment(_parse_counters.frames_parsed);
+	_recordPacketUpdates(flag_mask_received);
+	if ( timing ) { _observeDriveCommand(flag_mask_received, frame_complete_time); }
+	
+	telemetry::telemetry_recorder * const telemetry_recorder = _telemetry_recorder.load(std::memory_order_acquire);
+	if ( telemetry_recorder ) { telemetry_recorder->record(telemetry::STREAM_FRAME, frame_, (payload_end + 1)); }
+}
+
+/// \brief Advance the stream state machine by one byte
+/// \details Validates the next unscanned byte of the frame according
+/// to its position: header, length (against the stream key), packet
+/// id (against the stream key and the remaining length), packet value
+/// or checksum.
+/// \return SUCCESS The frame is complete and valid
+/// \return NO_DATA_AVAILABLE The byte was accepted
+/// \return FAILURE_TO_SYNC The frame header was false
+/// \return INVALID_CHECKSUM The frame was corrupted
+inline
+ReturnCode
+robot_state::_scanStreamByte (
+	void
+) {
+	stream_parser_t & parser = _stream_parser;
+	const uint_opt8_t byte = parser.frame[parser.scanned];
+
+	if ( 0 == parser.scanned ) {
+		// Header was located by _scanStreamParser(), the frame is judged by the key current now
+		parser.format = std::atomic_load(&_stream_format);
+		if ( _drive_probe.write_time.load(std::memory_order_relaxed) ) { parser.header_time = std::chrono::steady_clock::now(); }
+	} else if ( 1 == parser.scanned ) {
+		if ( !byte ) { return FAILURE_TO_SYNC; }
+		if ( parser.format->payload_length && parser.format->payload_length != byte ) { return FAILURE_TO_SYNC; }
+		parser.key_index = 1;
+		parser.value_bytes_remaining = 0;
+	} else if ( parser.scanned < static_cast<uint_opt16_t>(parser.frame[1] + 2) ) {
+		if ( parser.value_bytes_remaining ) {
+			--parser.value_bytes_remaining;
+		} else {
+			if ( !sensor::isDefinedPacketId(byte) ) { return FAILURE_TO_SYNC; }
+			const sensor::PacketId * const stream_key = parser.format->key;
+			if ( *stream_key ) {
+				if ( parser.key_index >= *stream_key || stream_key[parser.key_index] != byte ) { return FAILURE_TO_SYNC; }
+				++parser.key_index;
+			}
+			parser.value_bytes_remaining = _packetValueSize(static_cast<sensor::PacketId>(byte));
+			if ( (parser.scanned - 1 + parser.value_bytes_remaining) > parser.frame[1] ) { return FAILURE_TO_SYNC; }
 		}
+	} else {
+		if ( static_cast<uint_opt8_t>(parser.byte_sum + byte) ) { return INVALID_CHECKSUM; }
+		++parser.scanned;
 		return SUCCESS;
 	}
-} // namespace
 
+	parser.byte_sum += byte;
+	++parser.scanned;
+	return NO_DATA_AVAILABLE;
+}
+
+/// \brief Run the stream state machine over the buffered bytes
+/// \details Rejected frames are discarded up to the next candidate
+/// header and the remaining bytes are rescanned. Scanning stops once
+/// a frame has been committed, any bytes following it are retained.
+/// \return SUCCESS A frame was committed
+/// \return NO_DATA_AVAILABLE More bytes are required
+/// \return INVALID_CHECKSUM A frame was rejected
+inline
 ReturnCode
-getParseError (
+robot_state::_scanStreamParser (
 	void
 ) {
-	return _parse_status;
+	while ( _stream_parser.scanned < _stream_parser.buffered ) {
+		if ( 0 == _stream_parser.scanned && STREAM_HEADER != *_stream_parser.frame ) {
+			_increment(_parse_counters.bytes_discarded, _discardStreamBytesBeforeHeader(0));
+			continue;
+		}
+		const ReturnCode rc = _scanStreamByte();
+		if ( NO_DATA_AVAILABLE == rc ) { continue; }
+		if ( SUCCESS == rc ) {
+			const uint_opt16_t frame_length = _stream_parser.scanned;
+			_commitStreamFrame(_stream_parser.frame);
+			_increment(_parse_counters.bytes_discarded, (_discardStreamBytesBeforeHeader(frame_length) - frame_length));
+			return SUCCESS;
+		}
+		
+		// Drop the false header and rescan the bytes that followed it
+		_increment( INVALID_CHECKSUM == rc ? _parse_counters.checksum_failures : _parse_counters.sync_losses );
+		_increment(_parse_counters.bytes_discarded, _discardStreamBytesBeforeHeader(1));
+		if ( INVALID_CHECKSUM == rc ) { return INVALID_CHECKSUM; }
+	}
+
+	return NO_DATA_AVAILABLE;
 }
 
+/// \brief Number of bytes required to complete the current frame
+/// \details When the stream key is known an entire frame is requested
+/// at once, otherwise the header and length are requested first.
+/// \return The number of bytes to read from the serial bus
+inline
+uint_opt16_t
+robot_state::_streamBytesRequired (
+	void
+) {
+	if ( _stream_parser.buffered >= 2 ) { return (_stream_parser.frame[1] + 3 - _stream_parser.buffered); }
+	const uint_opt8_t payload_length = std::atomic_load(&_stream_format)->payload_length;
+	if ( payload_length ) { return (payload_length + 3 - _stream_parser.buffered); }
+	return (2 - _stream_parser.buffered);
+}
+
+/// \brief Feed a single byte to the stream parser
+/// \return SUCCESS A frame was committed
+/// \return NO_DATA_AVAILABLE More bytes are required
+/// \return INVALID_CHECKSUM A frame was rejected
+inline
 ReturnCode
-parseQueryData (
+robot_state::_parseStreamByte (
+	const uint_opt8_t byte_
+) {
+	if ( !_stream_parser.buffered && STREAM_HEADER != byte_ ) {
+		_increment(_parse_counters.bytes_discarded);
+		return NO_DATA_AVAILABLE;
+	}
+	if ( STREAM_FRAME_MAX == _stream_parser.buffered ) {
+		_increment(_parse_counters.sync_losses);
+		_increment(_parse_counters.bytes_discarded, _discardStreamBytesBeforeHeader(1));
+	}
+
+	_stream_parser.frame[_stream_parser.buffered++] = byte_;
+	return _scanStreamParser();
+}
+
+/// \brief Count the packets refreshed by a frame or response
+/// \details Advances the update count and the refresh time of each
+/// packet whose dirty bit was cleared. The clock is read once.
+/// \param [in] flag_mask_received_ The flags of the packets refreshed
+inline
+void
+robot_state::_recordPacketUpdates (
+	const uint_opt64_t flag_mask_received_
+) {
+	const std::chrono::steady_clock::rep refresh_time = std::chrono::steady_clock::now().time_since_epoch().count();
+	
+	uint_opt8_t index(0);
+	for ( uint_opt64_t flags = flag_mask_received_ ; flags ; flags >>= 1, ++index ) {
+		if ( !(flags & 0x01) ) { continue; }
+		_increment(_parse_counters.packet_updates[index]);
+		_parse_counters.packet_refresh_time[index].store(refresh_time, std::memory_order_relaxed);
+	}
+}
+
+/// \brief Store the result of a parsing method
+/// \details NO_DATA_AVAILABLE only indicates more bytes are required,
+/// so it does not replace the result of the last frame or response.
+/// \param [in] rc_ The return code of the parsing method
+/// \return rc_
+inline
+ReturnCode
+robot_state::_recordParseStatus (
+	const ReturnCode rc_
+) {
+	if ( NO_DATA_AVAILABLE != rc_ ) { _parse_status.store(rc_, std::memory_order_relaxed); }
+	return rc_;
+}
+
+/// \brief Zero the parser counters
+/// \note Counts recorded concurrently may be partially retained.
+void
+robot_state::_resetParseCounters (
+	void
+) {
+	_parse_counters.frames_parsed.store(0, std::memory_order_relaxed);
+	_parse_counters.queries_parsed.store(0, std::memory_order_relaxed);
+	_parse_counters.checksum_failures.store(0, std::memory_order_relaxed);
+	_parse_counters.sync_losses.store(0, std::memory_order_relaxed);
+	_parse_counters.short_reads.store(0, std::memory_order_relaxed);
+	_parse_counters.bytes_discarded.store(0, std::memory_order_relaxed);
+	for ( uint_opt8_t i = 0 ; i < sensor::PACKET_ID_COUNT ; ++i ) {
+		_parse_counters.packet_updates[i].store(0, std::memory_order_relaxed);
+		_parse_counters.packet_refresh_time[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+ReturnCode
+robot_state::cancelLastQuery (
+	void
+) {
+	ReturnCode rc = NO_DATA_AVAILABLE;
+	
+	{  // Critical section: Update shared memory
+		_shared_data.lock();
+		
+		const uint_opt8_t count = _query_pipeline.count.load(std::memory_order_relaxed);
+		const bool response_begun = (1 == count && (1 != _query_pipeline.key_index || _query_pipeline.value_bytes));
+		if ( count && !response_begun ) {
+			_query_pipeline.queries[((_query_pipeline.head + count - 1) % QUERY_PIPELINE_DEPTH)].completion.set_value(SERIAL_TRANSFER_FAILURE);
+			_query_pipeline.count.fetch_sub(1, std::memory_order_release);
+			rc = SUCCESS;
+		}
+		
+		_shared_data.unlock();
+	}
+	
+	return rc;
+}
+
+ReturnCode
+robot_state::expectQuery (
+	sensor::PacketId const * const parse_key_,
+	std::future<ReturnCode> * const completion_
+) {
+	if ( !parse_key_ || !completion_ ) { return INVALID_PARAMETER; }
+	if ( *parse_key_ < 2 || *parse_key_ > sizeof(_query_pipeline.queries[0].parse_key) ) { return INVALID_PARAMETER; }
+	for ( uint_opt8_t i = 1 ; i < *parse_key_ ; ++i ) {
+		if ( !sensor::isDefinedPacketId(parse_key_[i]) ) { return INVALID_PARAMETER; }
+	}
+	
+	// Calculate completion time (including Roomba signal processing time)
+	const std::chrono::milliseconds transfer_time_ms(HARDWARE_SERIAL_DELAY_MS + ((_bytesInQueryList(parse_key_) * 10000) / BAUD_RATE[_baud_code]));
+	ReturnCode rc = NO_DATA_AVAILABLE;
+	
+	{  // Critical section: Update shared memory
+		_shared_data.lock();
+		
+		const uint_opt8_t count = _query_pipeline.count.load(std::memory_order_relaxed);
+		if ( QUERY_PIPELINE_DEPTH != count ) {
+			// The response follows the responses of the queries ahead of it
+			std::chrono::steady_clock::time_point transfer_start = std::chrono::steady_clock::now();
+			if ( count ) { transfer_start = std::max(transfer_start, _query_pipeline.queries[((_query_pipeline.head + count - 1) % QUERY_PIPELINE_DEPTH)].deadline); }
+			
+			query_pipeline_t::pending_query_t & query = _query_pipeline.queries[((_query_pipeline.head + count) % QUERY_PIPELINE_DEPTH)];
+			memcpy(query.parse_key, parse_key_, *reinterpret_cast<const uint_opt8_t *>(parse_key_));
+			query.completion = std::promise<ReturnCode>();
+			query.deadline = (transfer_start + transfer_time_ms);
+			*completion_ = query.completion.get_future();
+			_query_pipeline.count.fetch_add(1, std::memory_order_release);
+			rc = SUCCESS;
+		}
+		
+		_shared_data.unlock();
+	}
+	
+	return rc;
+}
+
+size_t
+robot_state::expireQueries (
+	void
+) {
+	if ( !_query_pipeline.count.load(std::memory_order_acquire) ) { return 0; }
+	size_t queries_failed(0);
+	
+	{  // Critical section: Update shared memory
+		_shared_data.lock();
+		
+		if ( _query_pipeline.count.load(std::memory_order_relaxed) && std::chrono::steady_clock::now() > (_query_pipeline.queries[_query_pipeline.head].deadline + QUERY_DEADLINE_MARGIN) ) {
+			queries_failed = _query_pipeline.count.load(std::memory_order_relaxed);
+			_failQueries();
+		}
+		
+		_shared_data.unlock();
+	}
+	
+	return queries_failed;
+}
+
+uint_opt32_t
+robot_state::framesPublished (
+	void
+) const {
+	return _snapshots_published.load(std::memory_order_acquire);
+}
+
+uint_opt64_t
+robot_state::getFlagMaskDirty (
+	void
+) const {
+	return _flag_mask_dirty;
+}
+
+const latency_histogram &
+robot_state::getLatencyHistogram (
+	const LatencyInterval interval_
+) const {
+	return _latency_histograms[std::min<uint_opt8_t>(interval_, (LATENCY_INTERVAL_COUNT - 1))];
+}
+
+ReturnCode
+robot_state::getParseError (
+	void
+) const {
+	return _parse_status.load(std::memory_order_relaxed);
+}
+
+ReturnCode
+robot_state::getParseMetrics (
+	parse_metrics_t * const metrics_
+) const {
+	if ( !metrics_ ) { return INVALID_PARAMETER; }
+	const std::chrono::steady_clock::rep now = std::chrono::steady_clock::now().time_since_epoch().count();
+	
+	metrics_->frames_parsed = _parse_counters.frames_parsed.load(std::memory_order_relaxed);
+	metrics_->queries_parsed = _parse_counters.queries_parsed.load(std::memory_order_relaxed);
+	metrics_->checksum_failures = _parse_counters.checksum_failures.load(std::memory_order_relaxed);
+	metrics_->sync_losses = _parse_counters.sync_losses.load(std::memory_order_relaxed);
+	metrics_->short_reads = _parse_counters.short_reads.load(std::memory_order_relaxed);
+	metrics_->bytes_discarded = _parse_counters.bytes_discarded.load(std::memory_order_relaxed);
+	for ( uint_opt8_t i = 0 ; i < sensor::PACKET_ID_COUNT ; ++i ) {
+		const std::chrono::steady_clock::rep refresh_time = _parse_counters.packet_refresh_time[i].load(std::memory_order_relaxed);
+		metrics_->packet_updates[i] = _parse_counters.packet_updates[i].load(std::memory_order_relaxed);
+		metrics_->packet_age[i] = ( refresh_time ? std::chrono::steady_clock::duration(std::max<std::chrono::steady_clock::rep>((now - refresh_time), 0)) : std::chrono::steady_clock::duration::max() );
+	}
+	
+	return SUCCESS;
+}
+
+const sensor_data_t &
+robot_state::getSensorData (
+	void
+) const {
+	return *reinterpret_cast<const sensor_data_t *>(_raw_data);
+}
+
+ReturnCode
+robot_state::getSensorSnapshot (
+	sensor_snapshot_t * const snapshot_
+) const {
+	if ( !snapshot_ ) { return INVALID_PARAMETER; }
+	
+	for (;;) {
+		const uint_opt32_t frame_count = _snapshots_published.load(std::memory_order_acquire);
+		if ( !frame_count ) { return NO_DATA_AVAILABLE; }
+		const snapshot_slot_t & slot = _snapshot_slots[frame_count & 0x01];
+		
+		const uint_opt32_t sequence = slot.sequence.load(std::memory_order_acquire);
+		if ( sequence & 0x01 ) { continue; }
+		memcpy(snapshot_, &slot.snapshot, sizeof(sensor_snapshot_t));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if ( slot.sequence.load(std::memory_order_relaxed) == sequence ) { return SUCCESS; }
+	}
+}
+
+stream_statistics_t
+robot_state::getStreamStatistics (
+	void
+) const {
+	stream_statistics_t stream_statistics;
+	stream_statistics.bytes_dropped = _parse_counters.bytes_discarded.load(std::memory_order_relaxed);
+	stream_statistics.frames_dropped = (_parse_counters.checksum_failures.load(std::memory_order_relaxed) + _parse_counters.sync_losses.load(std::memory_order_relaxed));
+	return stream_statistics;
+}
+
+ReturnCode
+robot_state::parseQueryBuffer (
+	const uint_opt8_t * const data_,
+	const size_t data_length_,
+	size_t * const bytes_consumed_
+) {
+	if ( !data_ || !bytes_consumed_ ) { return INVALID_PARAMETER; }
+	*bytes_consumed_ = 0;
+	if ( !_query_pipeline.count.load(std::memory_order_acquire) ) { return NO_DATA_AVAILABLE; }
+	ReturnCode rc = NO_DATA_AVAILABLE;
+	
+	{  // Critical section: Update shared memory
+		_shared_data.lock();
+		
+		query_pipeline_t::pending_query_t & query = _query_pipeline.queries[_query_pipeline.head];
+		while ( *bytes_consumed_ < data_length_ ) {
+			// Copy as much of the current packet value as has arrived
+			const sensor::packet_descriptor_t & packet_descriptor = sensor::packetDescriptor(query.parse_key[_query_pipeline.key_index]);
+			const size_t value_length = std::min<size_t>((packet_descriptor.size - _query_pipeline.value_bytes), (data_length_ - *bytes_consumed_));
+			memcpy((_raw_data + packet_descriptor.offset + _query_pipeline.value_bytes), (data_ + *bytes_consumed_), value_length);
+			_query_pipeline.value_bytes += value_length;
+			*bytes_consumed_ += value_length;
+			if ( _query_pipeline.value_bytes != packet_descriptor.size ) { break; }
+			
+			_query_pipeline.flag_mask_received |= packet_descriptor.flag_mask;
+			_query_pipeline.value_bytes = 0;
+			if ( ++_query_pipeline.key_index < *reinterpret_cast<const uint_opt8_t *>(query.parse_key) ) { continue; }
+			
+			// The response is complete
+			_flag_mask_dirty &= ~_query_pipeline.flag_mask_received;
+			_publishSnapshot();
+			_increment(_parse_counters.queries_parsed);
+			_recordPacketUpdates(_query_pipeline.flag_mask_received);
+			_recordParseStatus(SUCCESS);
+			query.completion.set_value(SUCCESS);
+			_query_pipeline.head = ((_query_pipeline.head + 1) % QUERY_PIPELINE_DEPTH);
+			_query_pipeline.key_index = 1;
+			_query_pipeline.flag_mask_received = 0;
+			_query_pipeline.count.fetch_sub(1, std::memory_order_release);
+			rc = SUCCESS;
+			break;
+		}
+		
+		_shared_data.unlock();
+	}
+	
+	return rc;
+}
+
+ReturnCode
+robot_state::parseQueryData (
 	void
 ) {
 	uint_opt64_t flag_mask_received(0);
 	const uint_opt8_t packet_count = *_parse_key;
-	uint_opt8_t unused;
 	*_parse_key = static_cast<sensor::PacketId>(0);
-	for ( uint_opt8_t i = 1 ; i < packet_count ; ++i ) {
-		const ReturnCode rc = _readPacketValueIntoRawDataBlob(_parse_key[i], &unused, &unused);
-		if ( SUCCESS != rc ) { return rc; }
-		flag_mask_received |= (static_cast<uint_opt64_t>(1) << _packetIndex(_parse_key[i]));
+	
+	for ( uint_opt8_t i = 1 ; i < packet_count ; ) {
+		// Read as many packet values as the staging buffer will hold at once
+		uint_opt16_t batch_size(0);
+		uint_opt8_t batch_end(i);
+		for ( ; batch_end < packet_count ; ++batch_end ) {
+			const uint_opt8_t packet_size = _packetValueSize(_parse_key[batch_end]);
+			if ( (batch_size + packet_size) > sizeof(_query_staging) ) { break; }
+			batch_size += packet_size;
+		}
+		if ( batch_size != _serial_port.multiByteSerialRead(_query_staging, batch_size) ) {
+			_increment(_parse_counters.short_reads);
+			return _recordParseStatus(SERIAL_TRANSFER_FAILURE);
+		}
+		
+		for ( const uint_opt8_t * packet_value = _query_staging ; i < batch_end ; ++i ) {
+			packet_value += _copyPacketValueIntoRawDataBlob(_parse_key[i], packet_value);
+			flag_mask_received |= sensor::packetDescriptor(_parse_key[i]).flag_mask;
+		}
 	}
+	
 	_flag_mask_dirty &= ~flag_mask_received;
-	return SUCCESS;
+	_publishSnapshot();
+	_increment(_parse_counters.queries_parsed);
+	_recordPacketUpdates(flag_mask_received);
+	return _recordParseStatus(SUCCESS);
 }
 
 ReturnCode
-parseStreamData (
+robot_state::parseStreamBuffer (
+	const uint_opt8_t * const data_,
+	const size_t data_length_,
+	size_t * const bytes_consumed_
+) {
+	if ( !data_ || !bytes_consumed_ ) { return INVALID_PARAMETER; }
+	*bytes_consumed_ = 0;
+	
+	// Bytes retained from a previous call are scanned first
+	ReturnCode rc = _scanStreamParser();
+	if ( NO_DATA_AVAILABLE != rc ) { return _recordParseStatus(rc); }
+	
+	while ( *bytes_consumed_ < data_length_ ) {
+		rc = _parseStreamByte(data_[(*bytes_consumed_)++]);
+		if ( NO_DATA_AVAILABLE != rc ) { return _recordParseStatus(rc); }
+	}
+	
+	return NO_DATA_AVAILABLE;
+}
+
+ReturnCode
+robot_state::parseStreamData (
 	void
 ) {
-	uint_opt64_t flag_mask_received(0);
-	uint_opt8_t bytes_read, byte_sum, check_sum, header[2];
-	
-	// Get header information
-	bytes_read = serial::multiByteSerialRead(header, sizeof(header));
-	if ( bytes_read != sizeof(header) ) { return SERIAL_TRANSFER_FAILURE; }
-	//TODO: Attempt to recover from unsynchronized stream
-	if ( 19 != header[0] ) { return FAILURE_TO_SYNC; }
-	byte_sum = header[1];
-	
-	// Parse stream
-	for ( uint_opt8_t i = 1 ; i < header[1] ; ++i ) {
-		uint_opt8_t packet_id, packet_size;
+	// Bytes retained from a previous call are scanned first
+	ReturnCode rc = _scanStreamParser();
+	if ( NO_DATA_AVAILABLE != rc ) { return _recordParseStatus(rc); }
+	
+	// Read the remainder of the frame straight into the parser's buffer
+	for ( uint_opt16_t bytes_read_total = 0 ; bytes_read_total < STREAM_SYNC_WINDOW ; ) {
+		const uint_opt16_t bytes_required = _streamBytesRequired();
+		const size_t bytes_read = _serial_port.multiByteSerialRead((_stream_parser.frame + _stream_parser.buffered), bytes_required);
+		_stream_parser.buffered += bytes_read;
+		bytes_read_total += bytes_read;
 		
-		// Get packet id
-		bytes_read = serial::multiByteSerialRead(&packet_id, sizeof(packet_id));
-		if ( bytes_read != sizeof(packet_id) ) { return SERIAL_TRANSFER_FAILURE; }
-		byte_sum += packet_id;
+		rc = _scanStreamParser();
+		if ( NO_DATA_AVAILABLE != rc ) { return _recordParseStatus(rc); }
+		if ( bytes_read != bytes_required ) {
+			_increment(_parse_counters.short_reads);
+			return _recordParseStatus(SERIAL_TRANSFER_FAILURE);
+		}
+	}
+	
+	return _recordParseStatus(FAILURE_TO_SYNC);
+}
+
+ReturnCode
+robot_state::parseStreamFrames (
+	const uint_opt8_t * const data_,
+	const size_t data_length_,
+	size_t * const bytes_consumed_
+) {
+	if ( !data_ || !bytes_consumed_ ) { return INVALID_PARAMETER; }
+	*bytes_consumed_ = 0;
+	if ( _stream_parser.buffered ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+	
+	// Reject the corrupt frames before any of them is decoded
+	stream_validation_t validation;
+	std::atomic_load(&_stream_format)->validator.validate(data_, data_length_, &_validated_frames, &validation);
+	_increment(_parse_counters.checksum_failures, validation.checksum_failures);
+	_increment(_parse_counters.sync_losses, validation.sync_losses);
+	_increment(_parse_counters.bytes_discarded, validation.bytes_discarded);
+	*bytes_consumed_ = validation.bytes_resolved;
+	
+	// Every byte of the buffer arrived before the call
+	if ( !_validated_frames.empty() && _drive_probe.write_time.load(std::memory_order_relaxed) ) { _stream_parser.header_time = std::chrono::steady_clock::now(); }
+	for ( const stream_frame_t & frame : _validated_frames ) {
+		_commitStreamFrame(data_ + frame.offset);
+	}
+	
+	if ( !_validated_frames.empty() ) { return _recordParseStatus(SUCCESS); }
+	if ( validation.checksum_failures ) { return _recordParseStatus(INVALID_CHECKSUM); }
+	return NO_DATA_AVAILABLE;
+}
+
+size_t
+robot_state::pendingQueries (
+	void
+) const {
+	return _query_pipeline.count.load(std::memory_order_acquire);
+}
+
+void
+robot_state::recordCommand (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	telemetry::telemetry_recorder * const telemetry_recorder = _telemetry_recorder.load(std::memory_order_acquire);
+	if ( !telemetry_recorder || !data_length_ ) { return; }
+	telemetry_recorder->record(telemetry::COMMAND, serial_data_, data_length_);
+}
+
+ReturnCode
+robot_state::serviceQueries (
+	void
+) {
+	uint_opt8_t buffer[64];
+	
+	while ( _query_pipeline.count.load(std::memory_order_acquire) ) {
+		std::chrono::steady_clock::time_point deadline;
+		size_t bytes_remaining(0);
+		
+		{  // Critical section: Read shared memory
+			_shared_data.lock();
+			
+			const query_pipeline_t::pending_query_t & query = _query_pipeline.queries[_query_pipeline.head];
+			for ( uint_opt8_t i = _query_pipeline.key_index ; i < *reinterpret_cast<const uint_opt8_t *>(query.parse_key) ; ++i ) {
+				bytes_remaining += _packetValueSize(query.parse_key[i]);
+			}
+			bytes_remaining -= _query_pipeline.value_bytes;
+			deadline = (query.deadline + QUERY_DEADLINE_MARGIN);
+			
+			_shared_data.unlock();
+		}
 		
-		// Insert packet data into blob
-		const ReturnCode rc = _readPacketValueIntoRawDataBlob(static_cast<sensor::PacketId>(packet_id), &packet_size, &byte_sum);
-		if ( SUCCESS != rc ) { return rc; }
+		// Read no more than the oldest response, or the read would wait for bytes not yet requested
+		const std::chrono::steady_clock::duration time_remaining = (deadline - std::chrono::steady_clock::now());
+		const uint_opt32_t timeout_ms = static_cast<uint_opt32_t>(std::max<int_fast64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(time_remaining).count(), 0));
+		const size_t bytes_read = _serial_port.multiByteSerialRead(buffer, std::min(bytes_remaining, sizeof(buffer)), timeout_ms);
+		if ( !bytes_read ) {
+			_increment(_parse_counters.short_reads);
+			_shared_data.lock();
+			_failQueries();
+			_shared_data.unlock();
+			return _recordParseStatus(SERIAL_TRANSFER_FAILURE);
+		}
 		
-		// Flag packet as received
-		flag_mask_received |= (static_cast<uint_opt64_t>(1) << _packetIndex(static_cast<sensor::PacketId>(packet_id)));
-		i += packet_size;
+		for ( size_t offset = 0 ; offset < bytes_read ; ) {
+			size_t bytes_consumed;
+			parseQueryBuffer((buffer + offset), (bytes_read - offset), &bytes_consumed);
+			if ( !bytes_consumed ) { break; }
+			offset += bytes_consumed;
+		}
 	}
 	
-	// Test the check sum
-	bytes_read = serial::multiByteSerialRead(&check_sum, sizeof(check_sum));
-	if ( bytes_read != sizeof(check_sum) ) { return SERIAL_TRANSFER_FAILURE; }
-	if ( static_cast<uint_opt8_t>(check_sum + byte_sum) ) { return INVALID_CHECKSUM; }
-	
-	// Clear the dirty flag for received packets
-	_flag_mask_dirty &= ~flag_mask_received;
 	return SUCCESS;
 }
 
 ReturnCode
-setBaudCode (
+robot_state::setBaudCode (
 	const BaudCode baud_code_
 ) {
 	if ( baud_code_ > 11 ) { return INVALID_PARAMETER; }
-	serial::beginAtBaudCode(baud_code_);
+	_serial_port.beginAtBaudCode(baud_code_);
 	_baud_code = baud_code_;
 	return SUCCESS;
 }
 
 ReturnCode
-setOIMode (
+robot_state::setLatencyTracking (
+	const bool enabled_
+) {
+	_latency_tracking.store(enabled_, std::memory_order_relaxed);
+	if ( !enabled_ ) { _drive_probe.write_time.store(0, std::memory_order_relaxed); }
+	return SUCCESS;
+}
+
+ReturnCode
+robot_state::setOIMode (
 	const OIMode oi_mode_
 ) {
 	if ( oi_mode_ > 3 ) { return INVALID_PARAMETER; }
@@ -441,14 +904,14 @@ setOIMode (
 }
 
 ReturnCode
-setParseKey (
+robot_state::setParseKey (
 	sensor::PacketId const * const parse_key_
 ) {
 	if ( !parse_key_ ) { return INVALID_PARAMETER; }
 	if ( !(*parse_key_) ) { return INVALID_PARAMETER; }
 	
 	// Calculate completion time (including Roomba signal processing time)
-	std::chrono::milliseconds transfer_time_ms(HARDWARE_SERIAL_DELAY_MS + ((_bytesInQueryList(parse_key_) * 10000) / _BAUD_RATE[_baud_code]));
+	std::chrono::milliseconds transfer_time_ms(HARDWARE_SERIAL_DELAY_MS + ((_bytesInQueryList(parse_key_) * 10000) / BAUD_RATE[_baud_code]));
 	std::chrono::time_point<std::chrono::steady_clock, std::chrono::milliseconds> serial_read_next_available_ms = std::chrono::time_point_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()) + transfer_time_ms;
 	
 	{  // Critical section: Update shared memory
@@ -464,20 +927,214 @@ setParseKey (
 	return SUCCESS;
 }
 
+void
+robot_state::stampDriveCommand (
+	const int_opt16_t left_wheel_velocity_,
+	const int_opt16_t right_wheel_velocity_
+) {
+	if ( !_latency_tracking.load(std::memory_order_relaxed) ) { return; }
+	const uint_opt32_t velocities = ((static_cast<uint_opt32_t>(right_wheel_velocity_ & 0xFFFF) << 16) | (left_wheel_velocity_ & 0xFFFF));
+	
+	// Withdraw the previous command before its velocities are replaced
+	_drive_probe.write_time.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	_drive_probe.velocities.store(velocities, std::memory_order_relaxed);
+	_drive_probe.write_time.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_release);
+}
+
+ReturnCode
+robot_state::startStreamReader (
+	void
+) {
+	if ( _stream_reader_running.exchange(true) ) { return SUCCESS; }
+	
+	_stream_reader = std::thread([this] () {
+		while ( _stream_reader_running.load(std::memory_order_relaxed) ) {
+			const ReturnCode rc = parseStreamData();
+			if ( NO_DATA_AVAILABLE == rc || SERIAL_TRANSFER_FAILURE == rc ) { std::this_thread::sleep_for(STREAM_READER_BACKOFF); }
+		}
+	});
+	
+	return SUCCESS;
+}
+
+ReturnCode
+robot_state::stopStreamReader (
+	void
+) {
+	_stream_reader_running.store(false);
+	if ( _stream_reader.joinable() ) { _stream_reader.join(); }
+	return SUCCESS;
+}
+
+ReturnCode
+robot_state::setStreamKey (
+	sensor::PacketId const * const stream_key_
+) {
+	if ( !stream_key_ ) { return INVALID_PARAMETER; }
+	if ( !(*stream_key_) ) { return INVALID_PARAMETER; }
+	if ( *stream_key_ > sizeof(stream_format_t::key) ) { return INVALID_PARAMETER; }
+	for ( uint_opt8_t i = 1 ; i < *stream_key_ ; ++i ) {
+		if ( !sensor::isDefinedPacketId(stream_key_[i]) ) { return INVALID_PARAMETER; }
+	}
+	
+	const uint_opt16_t payload_length = ((*stream_key_ - 1) + _bytesInQueryList(stream_key_));
+	if ( payload_length > 255 ) { return INVALID_PARAMETER; }
+	
+	// Build the new format aside, then publish it whole
+	const std::shared_ptr<stream_format_t> stream_format = std::make_shared<stream_format_t>();
+	memcpy(stream_format->key, stream_key_, *reinterpret_cast<const uint_opt8_t *>(stream_key_));
+	stream_format->payload_length = payload_length;
+	stream_format->validator.setStreamKey(stream_key_);
+	std::atomic_store(&_stream_format, std::shared_ptr<const stream_format_t>(stream_format));
+	
+	return SUCCESS;
+}
+
+ReturnCode
+robot_state::setTelemetryRecorder (
+	telemetry::telemetry_recorder * const telemetry_recorder_
+) {
+	_telemetry_recorder.store(telemetry_recorder_, std::memory_order_release);
+	return SUCCESS;
+}
+
+robot_state &
+getPlatformRobotState (
+	void
+) {
+	return _platformRobotState();
+}
+
+uint_opt64_t
+getFlagMaskDirty (
+	void
+) {
+	return _platformRobotState().getFlagMaskDirty();
+}
+
+ReturnCode
+getParseError (
+	void
+) {
+	return _platformRobotState().getParseError();
+}
+
+ReturnCode
+getParseMetrics (
+	parse_metrics_t * const metrics_
+) {
+	return _platformRobotState().getParseMetrics(metrics_);
+}
+
+const sensor_data_t &
+getSensorData (
+	void
+) {
+	return _platformRobotState().getSensorData();
+}
+
+ReturnCode
+getSensorSnapshot (
+	sensor_snapshot_t * const snapshot_
+) {
+	return _platformRobotState().getSensorSnapshot(snapshot_);
+}
+
+stream_statistics_t
+getStreamStatistics (
+	void
+) {
+	return _platformRobotState().getStreamStatistics();
+}
+
+ReturnCode
+parseQueryData (
+	void
+) {
+	return _platformRobotState().parseQueryData();
+}
+
+ReturnCode
+parseStreamBuffer (
+	const uint_opt8_t * const data_,
+	const size_t data_length_,
+	size_t * const bytes_consumed_
+) {
+	return _platformRobotState().parseStreamBuffer(data_, data_length_, bytes_consumed_);
+}
+
+ReturnCode
+parseStreamData (
+	void
+) {
+	return _platformRobotState().parseStreamData();
+}
+
+ReturnCode
+parseStreamFrames (
+	const uint_opt8_t * const data_,
+	const size_t data_length_,
+	size_t * const bytes_consumed_
+) {
+	return _platformRobotState().parseStreamFrames(data_, data_length_, bytes_consumed_);
+}
+
+ReturnCode
+setBaudCode (
+	const BaudCode baud_code_
+) {
+	return _platformRobotState().setBaudCode(baud_code_);
+}
+
+ReturnCode
+setOIMode (
+	const OIMode oi_mode_
+) {
+	return _platformRobotState().setOIMode(oi_mode_);
+}
+
+ReturnCode
+setParseKey (
+	sensor::PacketId const * const parse_key_
+) {
+	return _platformRobotState().setParseKey(parse_key_);
+}
+
+ReturnCode
+setStreamKey (
+	sensor::PacketId const * const stream_key_
+) {
+	return _platformRobotState().setStreamKey(stream_key_);
+}
+
+ReturnCode
+startStreamReader (
+	void
+) {
+	return _platformRobotState().startStreamReader();
+}
+
+ReturnCode
+stopStreamReader (
+	void
+) {
+	return _platformRobotState().stopStreamReader();
+}
 #ifdef TESTING
 namespace testing {
 	BaudCode
 	getBaudCode (
 		void
 	) {
-		return _baud_code;
+		return _platformRobotState()._baud_code;
 	}
 	
 	uint_opt64_t
 	getFlagMaskDirty (
 		void
 	) {
-		return _flag_mask_dirty;
+		return _platformRobotState()._flag_mask_dirty;
 	}
 	
 	uint_opt64_t
@@ -491,40 +1148,52 @@ namespace testing {
 	getOIMode (
 		void
 	) {
-		return _oi_mode;
+		return _platformRobotState()._oi_mode;
 	}
 	
 	sensor::PacketId *
 	getParseKey (
 		void
 	) {
-		return _parse_key;
+		return _platformRobotState()._parse_key;
 	}
 	
 	uint_opt8_t *
 	getRawData (
 		void
 	) {
-		return _raw_data;
+		return _platformRobotState()._raw_data;
 	}
 	
 	std::chrono::time_point<std::chrono::steady_clock, std::chrono::milliseconds>
 	getSerialReadNextAvailableMs (
 		void
 	) {
-		return _serial_read_next_available_ms;
+		return _platformRobotState()._serial_read_next_available_ms;
 	}
 	
 	void
 	setInternalsToInitialState (
 		void
 	) {
-		_baud_code = BAUD_115200;
-		_oi_mode = OFF;
-		serial::beginAtBaudCode(_baud_code);
-		_flag_mask_dirty = static_cast<uint_opt64_t>(-1);
-		*_parse_key = static_cast<sensor::PacketId>(0);
-		_parse_status = SUCCESS;
+		robot_state & platform_robot_state = _platformRobotState();
+		platform_robot_state.stopStreamReader();
+		platform_robot_state._baud_code = BAUD_115200;
+		platform_robot_state._oi_mode = OFF;
+		serial::beginAtBaudCode(platform_robot_state._baud_code);
+		platform_robot_state._flag_mask_dirty = static_cast<uint_opt64_t>(-1);
+		*platform_robot_state._parse_key = static_cast<sensor::PacketId>(0);
+		std::atomic_store(&platform_robot_state._stream_format, std::shared_ptr<const robot_state::stream_format_t>(std::make_shared<robot_state::stream_format_t>()));
+		platform_robot_state._stream_parser.buffered = 0;
+		platform_robot_state._stream_parser.scanned = 0;
+		platform_robot_state._stream_parser.byte_sum = 0;
+		platform_robot_state._resetParseCounters();
+		platform_robot_state._snapshots_published.store(0);
+		platform_robot_state._parse_status = SUCCESS;
+		platform_robot_state._failQueries();
+		platform_robot_state.setLatencyTracking(false);
+		platform_robot_state.setTelemetryRecorder(nullptr);
+		for ( uint_opt8_t i = 0 ; i < LATENCY_INTERVAL_COUNT ; ++i ) { platform_robot_state._latency_histograms[i].reset(); }
 	}
 } // namespace testing
 #endif
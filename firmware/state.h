@@ -3,9 +3,22 @@
 #ifndef STATE_H
 #define STATE_H
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "defines.h"
+#include "latency_histogram.h"
+#include "packets.h"
+#include "serial_port.h"
+#include "stream_validator.h"
+#include "telemetry_recorder.h"
 
 namespace roomba {
 
@@ -89,12 +102,80 @@ struct sensor_data_t {
 	uint8_t stasis;
 } __attribute__((__packed__));
 
+/// \brief A consistent copy of the sensor data
+/// \details Published each time a stream frame or query response has
+/// been committed. The copy is always taken from a single, complete
+/// frame.
+/// \note The values in sensor_data are big endian, as returned by
+/// the Roomba.
+/// \see state::getSensorSnapshot
+struct sensor_snapshot_t {
+	uint_opt32_t frame_count; ///< number of frames published since start up
+	uint_opt64_t flag_mask_dirty; ///< dirty flags at the time of publication
+	sensor_data_t sensor_data; ///< the sensor data blob
+};
+
+/// \brief The value of a single sensor packet
+/// \details Returned by the typed accessors, the value has already been
+/// converted to the host byte order and signedness.
+/// \see state::get
+template <typename T>
+struct packet_value_t {
+	T value; ///< the value of the packet
+	bool dirty; ///< the packet has not been refreshed by the last request
+};
+
+/// \brief Stream synchronization statistics
+/// \details Counters maintained by the stream parser while it
+/// searches for, and validates, stream frames.
+/// \see state::parseStreamData
+struct stream_statistics_t {
+	uint_opt32_t bytes_dropped; ///< bytes discarded while searching for a frame header
+	uint_opt32_t frames_dropped; ///< candidate frames rejected by length, packet id or checksum
+};
+
+/// \brief Counters maintained by the parsers
+/// \details A copy of the hot-path counters of a Roomba. The counters
+/// accumulate from start up, and are indexed (where per packet) by the
+/// dense packet index, which is the packet id for packets 0-58.
+/// \note The copy is taken without a lock, so a copy taken while a
+/// frame is being parsed may reflect part of that frame.
+/// \see state::getParseMetrics
+/// \see sensor::packetDescriptor
+struct parse_metrics_t {
+	uint_opt32_t frames_parsed; ///< stream frames validated and committed
+	uint_opt32_t queries_parsed; ///< query responses committed
+	uint_opt32_t checksum_failures; ///< stream frames rejected by checksum
+	uint_opt32_t sync_losses; ///< false stream headers rejected by length or packet id
+	uint_opt32_t short_reads; ///< serial reads returning fewer bytes than requested
+	uint_opt32_t bytes_discarded; ///< stream bytes discarded while searching for a frame header
+	uint_opt32_t packet_updates[sensor::PACKET_ID_COUNT]; ///< times each packet was refreshed
+	std::chrono::steady_clock::duration packet_age[sensor::PACKET_ID_COUNT]; ///< time since the dirty bit of each packet was cleared (duration::max() when never)
+};
+
+/// \brief Accessor method for the dirty flags
+/// \details The index of each bit is tied to the corresponding packet
+/// id. A set bit indicates the packet was not refreshed by the last
+/// query or stream frame.
+/// \note Only the parsing thread may rely on this value, other threads
+/// must use the published snapshots.
+/// \return The dirty flags of the raw data blob
+/// \see state::get
+uint_opt64_t
+getFlagMaskDirty (
+	void
+);
+
 /// \brief Accessor method to check for parsing errors
 /// \details The parsing methods typically execute in a separate thread
 /// and is therefore unable to provide return codes directly. This method
 /// provides access to the shared memory where the return code is stored.
+/// \return The result of the last frame or response parsed
 /// \return SUCCESS
+/// \return FAILURE_TO_SYNC
+/// \return INVALID_CHECKSUM
 /// \return SERIAL_TRANSFER_FAILURE
+/// \see state::getParseMetrics
 /// \see state::parseQueryData
 /// \see state::parseStreamData
 ReturnCode
@@ -102,6 +183,19 @@ getParseError (
 	void
 );
 
+/// \brief Accessor method for the parser counters
+/// \details Copies the counters maintained by the parsers. The counters
+/// are atomic and advanced by the parsing thread alone, so the copy never
+/// takes a lock and never delays the parsing thread.
+/// \param [out] metrics_ Receives the counters
+/// \return SUCCESS
+/// \return INVALID_PARAMETER
+/// \see state::getStreamStatistics
+ReturnCode
+getParseMetrics (
+	parse_metrics_t * const metrics_
+);
+
 /// \brief Function to receive serial data generated by a query command
 /// \details Parses data received from Roomba and stores it in memory
 /// accessible by the OICommand object.
@@ -114,16 +208,112 @@ parseQueryData (
 	void
 );
 
+/// \brief Accessor method for the raw data blob
+/// \details Provides field name access to the sensor data without
+/// copying it.
+/// \note The values are big endian, as returned by the Roomba.
+/// \note Only the parsing thread may rely on this value, other threads
+/// must use the published snapshots.
+/// \return The sensor data most recently parsed
+/// \see state::get
+const sensor_data_t &
+getSensorData (
+	void
+);
+
+/// \brief Accessor method for the most recent sensor data
+/// \details Copies the most recently published frame. The sensor data
+/// is double-buffered behind a sequence lock, so the call never takes
+/// a lock and never delays the parsing thread. The copy is lock-free
+/// rather than wait-free: a reader has to repeat it if two frames are
+/// published while it is copying.
+/// \param [out] snapshot_ Receives the sensor data
+/// \return SUCCESS
+/// \return NO_DATA_AVAILABLE No frame has been published yet
+/// \return INVALID_PARAMETER
+/// \see state::startStreamReader
+ReturnCode
+getSensorSnapshot (
+	sensor_snapshot_t * const snapshot_
+);
+
+/// \brief Accessor method for the stream synchronization statistics
+/// \return The counters accumulated since start up
+/// \see state::parseStreamData
+stream_statistics_t
+getStreamStatistics (
+	void
+);
+
+/// \brief Function to feed raw serial bytes to the stream parser
+/// \details Bytes are consumed one at a time by an incremental
+/// state machine, which allows data to be supplied in arbitrary
+/// slices (i.e. whatever was available on the serial bus). The
+/// parser stops after the first frame is committed, so the
+/// caller can act on each frame as it becomes available.
+/// \param [in] data_ The bytes received from the Roomba
+/// \param [in] data_length_ The number of bytes available
+/// \param [out] bytes_consumed_ The number of bytes taken from data_
+/// \return SUCCESS A frame was validated and committed
+/// \return INVALID_CHECKSUM A frame was rejected, the parser has
+/// already resynchronized and will continue with the next byte
+/// \return NO_DATA_AVAILABLE All bytes were consumed without
+/// completing a frame
+/// \return INVALID_PARAMETER
+/// \see state::parseStreamData
+ReturnCode
+parseStreamBuffer (
+	const uint_opt8_t * const data_,
+	const size_t data_length_,
+	size_t * const bytes_consumed_
+);
+
 /// \brief Function to receive serial data generated by the stream command
 /// \details Parses data received from Roomba and stores it in memory
-/// accessible by the OICommand object.
+/// accessible by the OICommand object. The parser scans for the
+/// frame header (19), validates the length byte against the active
+/// stream list and validates the checksum before any sensor data
+/// is committed. When a frame is rejected the parser discards the
+/// false header and rescans the bytes that followed it, so a single
+/// dropped byte costs at most one frame.
 /// \return SUCCESS
+/// \return FAILURE_TO_SYNC No frame was found in the bytes read
+/// \return INVALID_CHECKSUM
+/// \return SERIAL_TRANSFER_FAILURE
 /// \see OpenInterface::stream
+/// \see state::getStreamStatistics
 ReturnCode
 parseStreamData (
 	void
 );
 
+/// \brief Function to feed many buffered stream frames to the parser
+/// \details Intended for bulk ingestion (i.e. a replayed capture or the
+/// frames of many Roombas gathered by a gateway). Every frame of the
+/// buffer is validated by structure and checksum first, then only the
+/// frames that passed are decoded and committed, in order. A snapshot
+/// is published for each frame committed. Frames are judged exactly as
+/// parseStreamBuffer() would judge them.
+/// \param [in] data_ The bytes received from the Roomba
+/// \param [in] data_length_ The number of bytes available
+/// \param [out] bytes_consumed_ The number of bytes taken from data_.
+/// An incomplete frame at the end of the buffer is not consumed, and
+/// must be given again along with the rest of the frame.
+/// \return SUCCESS At least one frame was committed
+/// \return INVALID_CHECKSUM No frame was committed, and at least one
+/// frame was rejected by checksum
+/// \return NO_DATA_AVAILABLE No frame was completed
+/// \return INVALID_PARAMETER
+/// \return INVALID_MODE_FOR_REQUESTED_OPERATION parseStreamBuffer()
+/// or parseStreamData() holds the bytes of a partial frame
+/// \see state::stream_validator
+ReturnCode
+parseStreamFrames (
+	const uint_opt8_t * const data_,
+	const size_t data_length_,
+	size_t * const bytes_consumed_
+);
+
 /// \brief Stores the baud code
 /// \details The baud code is used when calculating the
 /// time required to execute a sensor query transaction.
@@ -154,6 +344,51 @@ setParseKey (
 	sensor::PacketId const * const parse_key_
 );
 
+/// \brief Function to store the active stream list
+/// \details A stream key is generated during the call to stream()
+/// to describe the format of each frame returned by the iRobot®
+/// Roomba. It allows the stream parser to reject false headers
+/// without waiting for the checksum.
+/// \param [in] stream_key_ An array of bytes describing the data
+/// requested from the iRobot® Roomba (same format as the parse key).
+/// \n Index 0 contains the length of the array.
+/// \n The remaining values are the packet ids of the
+/// data requested from the iRobot® Roomba.
+/// \return SUCCESS
+/// \return INVALID_PARAMETER
+/// \see OpenInterface::stream
+/// \see state::setParseKey
+ReturnCode
+setStreamKey (
+	sensor::PacketId const * const stream_key_
+);
+
+/// \brief Starts the stream reader thread
+/// \details The thread owns the serial stream: it calls parseStreamData()
+/// continuously and publishes each committed frame, which can then be
+/// collected with getSensorSnapshot(). When no frame could be read,
+/// the thread pauses for a millisecond rather than spin on the port. While the thread is running no
+/// other thread should call parseStreamData() or parseQueryData().
+/// \note Calling the method while the thread is running has no effect.
+/// \return SUCCESS
+/// \see OpenInterface::stream
+/// \see state::getSensorSnapshot
+/// \see state::stopStreamReader
+ReturnCode
+startStreamReader (
+	void
+);
+
+/// \brief Stops the stream reader thread
+/// \details Blocks until the thread has exited, which happens once the
+/// read in progress has returned (at most the serial read timeout).
+/// \return SUCCESS
+/// \see state::startStreamReader
+ReturnCode
+stopStreamReader (
+	void
+);
+
 /// \brief Stores the operating mode of the Open Interface
 /// \details The variable is used to track the current operating
 /// mode of the Roomba's internal state machine (i.e. Off,
@@ -171,6 +406,639 @@ setOIMode (
 	const OIMode oi_mode_
 );
 
+/// \brief Typed accessor for a single sensor packet
+/// \details Reads the value directly from the sensor data, with no
+/// intermediate copy, and converts it to the host byte order. The
+/// type of the value is chosen by the packet (i.e. DISTANCE returns
+/// an int16_t, LEFT_ENCODER_COUNTS returns a uint16_t).
+/// \param [in] sensor_data_ The sensor data to read
+/// \param [in] flag_mask_dirty_ The dirty flags of the sensor data
+/// \return The value of the packet and its dirty flag
+/// \see sensor::packet_traits
+template <sensor::PacketId packet_id_>
+inline
+packet_value_t<typename sensor::packet_traits<packet_id_>::value_type>
+get (
+	const sensor_data_t & sensor_data_,
+	const uint_opt64_t flag_mask_dirty_
+) {
+	packet_value_t<typename sensor::packet_traits<packet_id_>::value_type> packet_value;
+	packet_value.value = sensor::decode<packet_id_>(reinterpret_cast<const uint8_t *>(&sensor_data_));
+	packet_value.dirty = static_cast<bool>(flag_mask_dirty_ & sensor::packet_traits<packet_id_>::flag_mask);
+	return packet_value;
+}
+
+/// \brief Typed accessor for a single sensor packet of a snapshot
+/// \param [in] snapshot_ A snapshot collected with getSensorSnapshot()
+/// \return The value of the packet and its dirty flag
+/// \see state::getSensorSnapshot
+template <sensor::PacketId packet_id_>
+inline
+packet_value_t<typename sensor::packet_traits<packet_id_>::value_type>
+get (
+	const sensor_snapshot_t & snapshot_
+) {
+	return get<packet_id_>(snapshot_.sensor_data, snapshot_.flag_mask_dirty);
+}
+
+/// \brief Typed accessor for a single sensor packet of the raw data blob
+/// \note Only the parsing thread may rely on this value, other threads
+/// must use the published snapshots.
+/// \return The value of the packet and its dirty flag
+/// \see state::getSensorData
+template <sensor::PacketId packet_id_>
+inline
+packet_value_t<typename sensor::packet_traits<packet_id_>::value_type>
+get (
+	void
+) {
+	return get<packet_id_>(getSensorData(), getFlagMaskDirty());
+}
+
+/// \brief The state of a single iRobot Roomba
+/// \details Houses the sensor data, parse key, stream parser and
+/// operating mode of one Roomba, along with the serial port used to
+/// reach it. Each instance is independent, so any number of Roombas
+/// can be serviced concurrently from one process. The free functions
+/// of this namespace operate on the state of the Roomba attached to
+/// the platform serial port.
+/// \note The methods behave exactly as the free functions of the same
+/// name, but apply to this Roomba only.
+/// \see state::getPlatformRobotState
+class robot_state {
+  public:
+	/// \brief Bind the state to a serial port
+	/// \param [in] serial_port_ The port connected to the Roomba
+	/// \note The port must outlive the state.
+	explicit
+	robot_state (
+		serial::port & serial_port_
+	);
+	
+	/// \brief Stops the stream reader thread (if running)
+	~robot_state (
+		void
+	);
+	
+	/// \brief Withdraw the query registered last
+	/// \details Used when the request could not be written, so no
+	/// response will arrive. The query completes with
+	/// SERIAL_TRANSFER_FAILURE.
+	/// \return SUCCESS
+	/// \return NO_DATA_AVAILABLE No query is pending, or the response
+	/// of the last query has begun to arrive
+	/// \see robot_state::expectQuery
+	ReturnCode
+	cancelLastQuery (
+		void
+	);
+	
+	/// \brief Register a query whose response is expected
+	/// \details The query is appended to the pipeline of pending
+	/// queries. Responses are matched to the queries in the order the
+	/// queries were registered, so several queries may be written back
+	/// to back without waiting for the responses in between. The
+	/// completion is fulfilled by parseQueryBuffer() once the response
+	/// has arrived in its entirety (usually by the I/O layer), or by
+	/// expireQueries() if it does not arrive in time.
+	/// \param [in] parse_key_ An array of bytes describing the data
+	/// requested from the iRobot® Roomba (same format as the parse key).
+	/// \param [out] completion_ Receives the future of the query
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	/// \return NO_DATA_AVAILABLE The pipeline is full
+	/// \see state::setParseKey
+	/// \see serial::posix::parseStreamChunk
+	ReturnCode
+	expectQuery (
+		sensor::PacketId const * const parse_key_,
+		std::future<ReturnCode> * const completion_
+	);
+	
+	/// \brief Fail the pending queries if a response is overdue
+	/// \details A response is overdue once the deadline of its query
+	/// has passed by more than a margin of 100 ms. The
+	/// bytes of a late response can not be told apart from those that
+	/// follow it, so every pending query fails with
+	/// SERIAL_TRANSFER_FAILURE.
+	/// \return The number of queries failed
+	size_t
+	expireQueries (
+		void
+	);
+	
+	/// \brief The number of sensor updates published
+	/// \details Advances with each stream frame committed and each query
+	/// completed, so a reader can detect new data without copying it.
+	/// \see state::getSensorSnapshot
+	uint_opt32_t
+	framesPublished (
+		void
+	) const;
+	
+	/// \see state::get
+	template <sensor::PacketId packet_id_>
+	packet_value_t<typename sensor::packet_traits<packet_id_>::value_type>
+	get (
+		void
+	) const {
+		return state::get<packet_id_>(getSensorData(), getFlagMaskDirty());
+	}
+	
+	/// \see state::getFlagMaskDirty
+	uint_opt64_t
+	getFlagMaskDirty (
+		void
+	) const;
+	
+	/// \brief Accessor method for the latencies of the drive commands
+	/// \details Safe to read from any thread while the stream is parsed.
+	/// \param [in] interval_ The interval measured
+	/// \return The histogram of the interval
+	/// \see robot_state::setLatencyTracking
+	const latency_histogram &
+	getLatencyHistogram (
+		const LatencyInterval interval_
+	) const;
+	
+	/// \brief Accessor method for the operating mode of the Open Interface
+	/// \return The mode most recently set
+	/// \see state::setOIMode
+	OIMode
+	getOIMode (
+		void
+	) const;
+	
+	/// \see state::getParseError
+	ReturnCode
+	getParseError (
+		void
+	) const;
+	
+	/// \see state::getParseMetrics
+	ReturnCode
+	getParseMetrics (
+		parse_metrics_t * const metrics_
+	) const;
+	
+	/// \see state::getSensorData
+	const sensor_data_t &
+	getSensorData (
+		void
+	) const;
+	
+	/// \see state::getSensorSnapshot
+	ReturnCode
+	getSensorSnapshot (
+		sensor_snapshot_t * const snapshot_
+	) const;
+	
+	/// \brief Accessor method for the serial port of the Roomba
+	/// \return The port the state is bound to
+	serial::port &
+	getSerialPort (
+		void
+	) const;
+	
+	/// \see state::getStreamStatistics
+	stream_statistics_t
+	getStreamStatistics (
+		void
+	) const;
+	
+	/// \brief Feed raw serial bytes to the pending queries
+	/// \details The bytes are matched to the oldest pending query.
+	/// Each packet value is committed as it arrives, and the query is
+	/// completed with SUCCESS (and a snapshot published) once its last
+	/// value has arrived. The parser stops after each completed query.
+	/// \param [in] data_ The bytes received from the Roomba
+	/// \param [in] data_length_ The number of bytes available
+	/// \param [out] bytes_consumed_ The number of bytes taken from data_
+	/// \return SUCCESS A query was completed
+	/// \return NO_DATA_AVAILABLE All bytes were consumed without
+	/// completing a query (or no query is pending)
+	/// \return INVALID_PARAMETER
+	/// \see robot_state::expectQuery
+	ReturnCode
+	parseQueryBuffer (
+		const uint_opt8_t * const data_,
+		const size_t data_length_,
+		size_t * const bytes_consumed_
+	);
+	
+	/// \see state::parseQueryData
+	ReturnCode
+	parseQueryData (
+		void
+	);
+	
+	/// \see state::parseStreamBuffer
+	ReturnCode
+	parseStreamBuffer (
+		const uint_opt8_t * const data_,
+		const size_t data_length_,
+		size_t * const bytes_consumed_
+	);
+	
+	/// \see state::parseStreamData
+	ReturnCode
+	parseStreamData (
+		void
+	);
+	
+	/// \see state::parseStreamFrames
+	ReturnCode
+	parseStreamFrames (
+		const uint_opt8_t * const data_,
+		const size_t data_length_,
+		size_t * const bytes_consumed_
+	);
+	
+	/// \brief The number of queries awaiting a response
+	/// \see robot_state::expectQuery
+	size_t
+	pendingQueries (
+		void
+	) const;
+	
+	/// \brief Read the responses of the pending queries from the port
+	/// \details Blocks until every pending query has completed, for
+	/// applications without an I/O layer (reactor or io_uring engine)
+	/// servicing the port. Each read waits no longer than the deadline
+	/// of the query it belongs to.
+	/// \return SUCCESS
+	/// \return SERIAL_TRANSFER_FAILURE A response was overdue, and the
+	/// pending queries were failed
+	/// \see robot_state::expireQueries
+	ReturnCode
+	serviceQueries (
+		void
+	);
+	
+	/// \see state::setBaudCode
+	ReturnCode
+	setBaudCode (
+		const BaudCode baud_code_
+	);
+	
+	/// \brief Measure the latency of the drive commands
+	/// \details Once enabled, each driveDirect() is timed until the
+	/// first stream frame whose requested right and left velocities
+	/// match the command, and whose header arrived after the command
+	/// was written. The intervals to the header, the checksum and the
+	/// snapshot of that frame are recorded in the latency histograms.
+	/// \n While disabled, the parser makes no calls to the clock.
+	/// \param [in] enabled_ Time the drive commands
+	/// \return SUCCESS
+	/// \note The stream must include REQUESTED_RIGHT_VELOCITY and
+	/// REQUESTED_LEFT_VELOCITY. A command is superseded by the next,
+	/// so only the latest command is timed. A batched command is timed
+	/// from the flush of its batch.
+	/// \see robot_state::getLatencyHistogram
+	ReturnCode
+	setLatencyTracking (
+		const bool enabled_
+	);
+	
+	/// \see state::setOIMode
+	ReturnCode
+	setOIMode (
+		const OIMode oi_mode_
+	);
+	
+	/// \see state::setParseKey
+	ReturnCode
+	setParseKey (
+		sensor::PacketId const * const parse_key_
+	);
+	
+	/// \see state::setStreamKey
+	ReturnCode
+	setStreamKey (
+		sensor::PacketId const * const stream_key_
+	);
+	
+	/// \brief Record the traffic of the Roomba
+	/// \details Once attached, each stream frame committed by the
+	/// parser, and each command written by the robot, is appended to
+	/// the log of the recorder. Recording never blocks the parser.
+	/// \param [in] telemetry_recorder_ The recorder, or nullptr to
+	/// detach the recorder
+	/// \return SUCCESS
+	/// \note The recorder is borrowed, and must remain attached to this
+	/// state only while it is open.
+	/// \see robot_state::recordCommand
+	ReturnCode
+	setTelemetryRecorder (
+		telemetry::telemetry_recorder * const telemetry_recorder_
+	);
+	
+	/// \brief Record a command written to the Roomba
+	/// \details Called by the robot once bytes have been written to the
+	/// serial port. Has no effect unless a recorder is attached.
+	/// \param [in] serial_data_ The bytes written
+	/// \param [in] data_length_ The number of bytes written
+	/// \see robot_state::setTelemetryRecorder
+	void
+	recordCommand (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	);
+	
+	/// \brief Start the latency measurement of a drive command
+	/// \details Called by the robot once the command has been written
+	/// (when its batch is flushed, if batched). Has no effect unless
+	/// latency tracking is enabled.
+	/// \param [in] left_wheel_velocity_ The velocity requested of the
+	/// left wheel
+	/// \param [in] right_wheel_velocity_ The velocity requested of the
+	/// right wheel
+	/// \see robot_state::setLatencyTracking
+	void
+	stampDriveCommand (
+		const int_opt16_t left_wheel_velocity_,
+		const int_opt16_t right_wheel_velocity_
+	);
+	
+	/// \see state::startStreamReader
+	ReturnCode
+	startStreamReader (
+		void
+	);
+	
+	/// \see state::stopStreamReader
+	ReturnCode
+	stopStreamReader (
+		void
+	);
+	
+	/// \brief Largest possible stream frame
+	/// \details Header, length, up to 255 bytes of payload and the checksum.
+	static const uint_opt16_t STREAM_FRAME_MAX = 258;
+	
+	/// \brief Queries which may be pending at once
+	static const uint_opt8_t QUERY_PIPELINE_DEPTH = 8;
+	
+#if !defined(TESTING)
+  private:
+#endif
+	robot_state (const robot_state &) = delete;
+	robot_state & operator= (const robot_state &) = delete;
+	
+	uint_opt8_t
+	_copyPacketValueIntoRawDataBlob (
+		const sensor::PacketId packet_id_,
+		const uint_opt8_t * const packet_value_
+	);
+	
+	void
+	_commitStreamFrame (
+		const uint_opt8_t * const frame_
+	);
+	
+	uint_opt16_t
+	_discardStreamBytesBeforeHeader (
+		const uint_opt16_t first_candidate_
+	);
+	
+	void
+	_observeDriveCommand (
+		const uint_opt64_t flag_mask_received_,
+		const std::chrono::steady_clock::time_point frame_complete_time_
+	);
+	
+	ReturnCode
+	_parseStreamByte (
+		const uint_opt8_t byte_
+	);
+	
+	void
+	_recordPacketUpdates (
+		const uint_opt64_t flag_mask_received_
+	);
+	
+	ReturnCode
+	_recordParseStatus (
+		const ReturnCode rc_
+	);
+	
+	void
+	_resetParseCounters (
+		void
+	);
+	
+	void
+	_failQueries (
+		void
+	);
+	
+	void
+	_publishSnapshot (
+		void
+	);
+	
+	ReturnCode
+	_scanStreamByte (
+		void
+	);
+	
+	ReturnCode
+	_scanStreamParser (
+		void
+	);
+	
+	uint_opt16_t
+	_streamBytesRequired (
+		void
+	);
+	
+	/// \brief The baud rate associated with the serial bus
+	/// \details This variable is used to calculate buffer overrun
+	/// protection.
+	BaudCode _baud_code;
+	
+	/// \brief Indicates the validity of the sensor packet ids
+	/// \details The index of each bit is tied to the corresponding
+	/// packet id. If a sensor value returned from the Roomba has
+	/// stale or invalid data (as indicated by the checksum) then
+	/// the dirty bit will be flagged.
+	uint_opt64_t _flag_mask_dirty;
+	
+	/// \brief The mode associated with the state of the open interface
+	/// \details This variable is used to gate function calls.
+	OIMode _oi_mode;
+	
+	/// \brief Key to decode the Roomba's serial stream
+	/// \details The Roomba returns a blob of data representing the
+	/// preceding sensor request. The key is a 1-base indexed array
+	/// of packet ids ordered the exact same sequence as the request.
+	/// \note The zero index is used to store the size.
+	/// \note The maximum size allowed is 64, which provides room for
+	/// the count and one of each sensor.
+	/// \see OICommand::sensors
+	/// \see OICommand::queryList
+	sensor::PacketId _parse_key[64];
+	
+	/// \brief Description of the Roomba's stream frames
+	/// \details Never modified once published. setStreamKey() builds a
+	/// new format and swaps it in atomically, while the parser takes a
+	/// reference to the current format at each frame header, so a frame
+	/// is always judged against one complete stream key.
+	/// \see OICommand::stream
+	struct stream_format_t {
+		/// \brief Key to validate the Roomba's stream frames
+		/// \details The list of packet ids requested by the last call to
+		/// stream(), in the same format as the parse key.
+		/// \note A zero size indicates the stream list is unknown, in which
+		/// case frames are validated by structure and checksum alone.
+		sensor::PacketId key[64];
+		
+		/// \brief Expected length byte of a stream frame
+		/// \details The byte count of the packet ids and values described by
+		/// the stream key (zero when the stream key is unknown).
+		uint_opt8_t payload_length;
+		
+		/// \brief Validator of buffered stream frames
+		/// \details Holds a template of the frames described by the key.
+		/// \see robot_state::parseStreamFrames
+		stream_validator validator;
+	};
+	
+	/// \brief The current stream format
+	/// \details Only accessed with std::atomic_load() and
+	/// std::atomic_store().
+	std::shared_ptr<const stream_format_t> _stream_format;
+	
+	/// \brief Frames of the last buffer that passed validation
+	/// \details Retained between calls, to reuse the allocation.
+	std::vector<stream_frame_t> _validated_frames;
+	
+	/// \brief Staging buffer for query responses
+	/// \details Query responses are read from the serial bus in bulk,
+	/// then copied into the raw data blob.
+	uint_opt8_t _query_staging[256];
+	
+	/// \brief Counters maintained by the parsers
+	/// \details Advanced by the parsing thread alone (with a relaxed load
+	/// and store, rather than a locked read-modify-write), and read by any
+	/// thread without a lock.
+	/// \see robot_state::getParseMetrics
+	struct parse_counters_t {
+		std::atomic<uint_opt32_t> frames_parsed;
+		std::atomic<uint_opt32_t> queries_parsed;
+		std::atomic<uint_opt32_t> checksum_failures;
+		std::atomic<uint_opt32_t> sync_losses;
+		std::atomic<uint_opt32_t> short_reads;
+		std::atomic<uint_opt32_t> bytes_discarded;
+		std::atomic<uint_opt32_t> packet_updates[sensor::PACKET_ID_COUNT];
+		std::atomic<std::chrono::steady_clock::rep> packet_refresh_time[sensor::PACKET_ID_COUNT]; ///< time the dirty bit was cleared (zero when never)
+	} _parse_counters;
+	
+	/// \brief Status messages resulting from parsing
+	/// \details The parsing function is asynchronous, and therefore
+	/// cannot return a status code directly.
+	std::atomic<ReturnCode> _parse_status;
+	
+	/// \brief Raw sensor data
+	/// \details The data blob used to store sensor data returned from
+	/// the iRobot Roomba in big endian format.
+	/// \note Only the parsing thread may touch this memory, other threads
+	/// must use the published snapshots.
+	uint_opt8_t _raw_data[80];
+	
+	/// \brief Published sensor data
+	/// \details Complete frames are published into alternating slots. The
+	/// sequence of a slot is odd while the slot is being written, so a
+	/// reader can detect (and retry) a copy that overlapped a write.
+	struct snapshot_slot_t {
+		std::atomic<uint_opt32_t> sequence;
+		sensor_snapshot_t snapshot;
+	} _snapshot_slots[2];
+	
+	/// \brief Number of frames published
+	/// \details The least significant bit selects the latest slot.
+	std::atomic<uint_opt32_t> _snapshots_published;
+	
+	/// \brief Stream reader thread
+	std::thread _stream_reader;
+	
+	/// \brief Signals the stream reader thread to run
+	std::atomic<bool> _stream_reader_running;
+	
+	/// \brief Time point when all sensor data should be returned
+	/// \details Time required for the Roomba to process the query,
+	/// then return the requested data at the current baud rate.
+	std::chrono::time_point<std::chrono::steady_clock, std::chrono::milliseconds> _serial_read_next_available_ms;
+	
+	/// \brief Mutex for the shared sensor data
+	std::mutex _shared_data;
+	
+	/// \brief Pipeline of pending queries
+	/// \details A ring of the queries awaiting a response, in the order
+	/// they were written. Only the oldest query receives bytes, which
+	/// are copied straight into the raw data blob.
+	struct query_pipeline_t {
+		struct pending_query_t {
+			sensor::PacketId parse_key[64]; ///< packet ids requested (index 0 holds the length)
+			std::promise<ReturnCode> completion; ///< fulfilled once the response is parsed
+			std::chrono::steady_clock::time_point deadline; ///< time the response should have arrived
+		} queries[QUERY_PIPELINE_DEPTH];
+		uint_opt8_t head; ///< index of the oldest query
+		std::atomic<uint_opt8_t> count; ///< queries pending
+		uint_opt8_t key_index; ///< parse key index of the packet being received
+		uint_opt8_t value_bytes; ///< bytes of the packet value received
+		uint_opt64_t flag_mask_received; ///< flags of the packets received
+	} _query_pipeline;
+	
+	/// \brief Incremental stream parser
+	/// \details Holds the bytes of the frame currently being assembled, so
+	/// a frame can be validated in its entirety before it is committed,
+	/// and so the bytes following a false header can be rescanned when a
+	/// frame is rejected.
+	struct stream_parser_t {
+		uint_opt8_t frame[STREAM_FRAME_MAX]; ///< header, length, payload and checksum
+		uint_opt16_t buffered; ///< bytes held in frame
+		uint_opt16_t scanned; ///< bytes of frame accepted by the state machine
+		uint_opt8_t byte_sum; ///< sum of the scanned bytes
+		uint_opt8_t key_index; ///< stream key index of the next packet id
+		uint_opt8_t value_bytes_remaining; ///< bytes of the current packet value yet to be scanned
+		std::shared_ptr<const stream_format_t> format; ///< stream format of the frame, taken when its header was scanned
+		std::chrono::steady_clock::time_point header_time; ///< time the header was scanned (while a drive command is timed)
+	} _stream_parser;
+	
+	/// \brief The drive command being timed
+	/// \details Written by the thread sending commands, and read by the
+	/// parsing thread without a lock. The write time is zero while the
+	/// command is being replaced (or when no command is timed), so a
+	/// torn read is detected by reading it twice.
+	struct drive_probe_t {
+		std::atomic<std::chrono::steady_clock::rep> write_time; ///< time the command was written (zero when none)
+		std::atomic<uint_opt32_t> velocities; ///< right (high half) and left (low half) velocities requested
+	} _drive_probe;
+	
+	/// \brief Histograms of the drive command latencies
+	latency_histogram _latency_histograms[LATENCY_INTERVAL_COUNT];
+	
+	/// \brief Drive commands are timed
+	std::atomic<bool> _latency_tracking;
+	
+	/// \brief Recorder of the traffic (nullptr when not recording)
+	std::atomic<telemetry::telemetry_recorder *> _telemetry_recorder;
+	
+	/// \brief The serial port connected to the Roomba
+	serial::port & _serial_port;
+};
+
+/// \brief Accessor method for the state of the platform Roomba
+/// \details The Roomba attached to the platform serial port, which is
+/// driven by the static open_interface methods and the free functions
+/// of this namespace.
+/// \return The state of the platform Roomba
+robot_state &
+getPlatformRobotState (
+	void
+);
+
 } // namespace state
 } // namespace roomba
 
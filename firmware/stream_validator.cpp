@@ -0,0 +1,205 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "stream_validator.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+  #define STREAM_VALIDATOR_SSE2
+  #include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  #define STREAM_VALIDATOR_NEON
+  #include <arm_neon.h>
+#endif
+
+namespace roomba {
+namespace state {
+
+namespace {
+	/// \brief Walk the packet ids of a frame
+	/// \details Used when the stream key is unknown, so the position of
+	/// each packet id depends on the packets before it.
+	/// \param [in] frame_ The frame (header first)
+	/// \param [in] bytes_available_ Bytes of the frame available
+	/// \return false when a packet id is undefined, or its value would
+	/// overrun the payload
+	inline
+	bool
+	_hasValidPacketIds (
+		const uint_opt8_t * const frame_,
+		const uint_opt16_t bytes_available_
+	) {
+		const uint_opt16_t payload_end = std::min<uint_opt16_t>((frame_[1] + 2), bytes_available_);
+		for ( uint_opt16_t i = 2 ; i < payload_end ; ) {
+			if ( !sensor::isDefinedPacketId(frame_[i]) ) { return false; }
+			const uint_opt8_t value_size = sensor::packetDescriptor(frame_[i]).size;
+			if ( (i - 1 + value_size) > frame_[1] ) { return false; }
+			i += (value_size + 1);
+		}
+		return true;
+	}
+} // namespace
+
+stream_validator::stream_validator (
+	void
+) {
+	clearStreamKey();
+}
+
+uint_opt8_t
+stream_validator::byteSum (
+	const uint_opt8_t * const data_,
+	const size_t data_length_
+) {
+	size_t i(0);
+	uint_opt8_t sum(0);
+
+	// Sixteen lanes accumulate (modulo 256), then are summed horizontally
+#if defined(STREAM_VALIDATOR_SSE2)
+	__m128i lane_sums = _mm_setzero_si128();
+	for ( ; (i + 16) <= data_length_ ; i += 16 ) {
+		lane_sums = _mm_add_epi8(lane_sums, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data_ + i)));
+	}
+	lane_sums = _mm_sad_epu8(lane_sums, _mm_setzero_si128());
+	sum = static_cast<uint_opt8_t>(_mm_cvtsi128_si32(lane_sums) + _mm_extract_epi16(lane_sums, 4));
+#elif defined(STREAM_VALIDATOR_NEON)
+	uint8x16_t lane_sums = vdupq_n_u8(0);
+	for ( ; (i + 16) <= data_length_ ; i += 16 ) {
+		lane_sums = vaddq_u8(lane_sums, vld1q_u8(data_ + i));
+	}
+	sum = vaddvq_u8(lane_sums);
+#endif
+
+	for ( ; i < data_length_ ; ++i ) { sum += data_[i]; }
+	return sum;
+}
+
+void
+stream_validator::clearStreamKey (
+	void
+) {
+	_payload_length = 0;
+	memset(_template_mask, 0, sizeof(_template_mask));
+	memset(_template, 0, sizeof(_template));
+}
+
+ReturnCode
+stream_validator::setStreamKey (
+	sensor::PacketId const * const stream_key_
+) {
+	if ( !stream_key_ ) { return INVALID_PARAMETER; }
+	const uint_opt8_t key_length = *reinterpret_cast<const uint_opt8_t *>(stream_key_);
+	if ( !key_length || key_length > 64 ) { return INVALID_PARAMETER; }
+
+	uint_opt16_t payload_length(0);
+	for ( uint_opt8_t i = 1 ; i < key_length ; ++i ) {
+		if ( !sensor::isDefinedPacketId(stream_key_[i]) ) { return INVALID_PARAMETER; }
+		payload_length += (sensor::packetDescriptor(stream_key_[i]).size + 1);
+	}
+	if ( payload_length > 255 ) { return INVALID_PARAMETER; }
+
+	// The header, length byte and packet ids have fixed positions
+	clearStreamKey();
+	if ( !payload_length ) { return SUCCESS; }
+	_payload_length = static_cast<uint_opt8_t>(payload_length);
+	_template[0] = FRAME_HEADER;
+	_template[1] = _payload_length;
+	_template_mask[0] = _template_mask[1] = 0xFF;
+	for ( uint_opt16_t i = 1, position = 2 ; i < key_length ; ++i ) {
+		_template[position] = stream_key_[i];
+		_template_mask[position] = 0xFF;
+		position += (sensor::packetDescriptor(stream_key_[i]).size + 1);
+	}
+
+	return SUCCESS;
+}
+
+/// \brief Check the header, length and packet ids of a frame
+/// \param [in] frame_ The frame (header first, length available)
+/// \param [in] bytes_available_ Bytes of the frame available, which
+/// may fall short of the frame
+/// \return true when the bytes available are valid
+inline
+bool
+stream_validator::_hasValidStructure (
+	const uint_opt8_t * const frame_,
+	const uint_opt16_t bytes_available_
+) const {
+	if ( !frame_[1] ) { return false; }
+	if ( !_payload_length ) { return _hasValidPacketIds(frame_, bytes_available_); }
+	if ( _payload_length != frame_[1] ) { return false; }
+
+	uint_opt16_t i(0);
+#if defined(STREAM_VALIDATOR_SSE2)
+	for ( ; (i + 16) <= bytes_available_ ; i += 16 ) {
+		const __m128i masked = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(frame_ + i)), _mm_loadu_si128(reinterpret_cast<const __m128i *>(_template_mask + i)));
+		if ( 0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi8(masked, _mm_loadu_si128(reinterpret_cast<const __m128i *>(_template + i)))) ) { return false; }
+	}
+#elif defined(STREAM_VALIDATOR_NEON)
+	for ( ; (i + 16) <= bytes_available_ ; i += 16 ) {
+		const uint8x16_t masked = vandq_u8(vld1q_u8(frame_ + i), vld1q_u8(_template_mask + i));
+		if ( 0xFF != vminvq_u8(vceqq_u8(masked, vld1q_u8(_template + i))) ) { return false; }
+	}
+#endif
+	for ( ; i < bytes_available_ ; ++i ) {
+		if ( (frame_[i] & _template_mask[i]) != _template[i] ) { return false; }
+	}
+	return true;
+}
+
+ReturnCode
+stream_validator::validate (
+	const uint_opt8_t * const data_,
+	const size_t data_length_,
+	std::vector<stream_frame_t> * const frames_,
+	stream_validation_t * const validation_
+) const {
+	if ( (!data_ && data_length_) || !frames_ || !validation_ ) { return INVALID_PARAMETER; }
+	frames_->clear();
+	memset(validation_, 0, sizeof(*validation_));
+
+	size_t offset(0);
+	while ( offset < data_length_ ) {
+		if ( FRAME_HEADER != data_[offset] ) {
+			const uint_opt8_t * const header = static_cast<const uint_opt8_t *>(memchr((data_ + offset), FRAME_HEADER, (data_length_ - offset)));
+			const size_t header_offset = ( header ? static_cast<size_t>(header - data_) : data_length_ );
+			validation_->bytes_discarded += (header_offset - offset);
+			offset = header_offset;
+			continue;
+		}
+		if ( (data_length_ - offset) < 2 ) { break; }
+
+		const uint_opt8_t * const frame = (data_ + offset);
+		const uint_opt16_t frame_length = (frame[1] + 3);
+		const uint_opt16_t bytes_available = static_cast<uint_opt16_t>(std::min<size_t>(frame_length, (data_length_ - offset)));
+		const bool valid_structure = _hasValidStructure(frame, bytes_available);
+		if ( valid_structure && bytes_available < frame_length ) { break; }
+
+		// Drop the false header and rescan the bytes that followed it
+		if ( !valid_structure ) {
+			++validation_->sync_losses;
+		} else if ( byteSum(frame, frame_length) ) {
+			++validation_->checksum_failures;
+		} else {
+			stream_frame_t passed = { offset, frame_length };
+			frames_->push_back(passed);
+			offset += frame_length;
+			continue;
+		}
+		++validation_->bytes_discarded;
+		++offset;
+	}
+	validation_->bytes_resolved = offset;
+
+	return SUCCESS;
+}
+
+const uint_opt8_t stream_validator::FRAME_HEADER;
+const uint_opt16_t stream_validator::FRAME_MAX;
+const uint_opt16_t stream_validator::TEMPLATE_SIZE;
+
+} // namespace state
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
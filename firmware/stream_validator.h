@@ -0,0 +1,139 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef STREAM_VALIDATOR_H
+#define STREAM_VALIDATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "defines.h"
+#include "packets.h"
+
+namespace roomba {
+namespace state {
+
+/// \brief A stream frame located within a buffer
+/// \see stream_validator::validate
+struct stream_frame_t {
+	size_t offset; ///< offset of the frame header within the buffer
+	uint_opt16_t length; ///< bytes of the frame (header, length, payload and checksum)
+};
+
+/// \brief The outcome of a validation
+/// \see stream_validator::validate
+struct stream_validation_t {
+	size_t bytes_resolved; ///< bytes preceding an incomplete frame at the end of the buffer (every byte when there is none)
+	uint_opt32_t bytes_discarded; ///< bytes outside of any valid frame
+	uint_opt32_t checksum_failures; ///< candidate frames rejected by checksum
+	uint_opt32_t sync_losses; ///< false headers rejected by length or packet id
+};
+
+/// \brief Validates many buffered stream frames at once
+/// \details Locates the stream frames of a buffer, and checks the
+/// structure (header, length and packet ids) and the checksum of each
+/// frame, before any of them is decoded. A buffer is judged exactly as
+/// the byte-at-a-time parser of state::robot_state would judge it, so
+/// the same frames pass, and the same bytes are discarded.
+/// \n When the stream key is known, every frame has the same layout,
+/// so the structure of a frame is compared against a template sixteen
+/// bytes at a time. The checksum is a byte sum of the frame, which is
+/// accumulated sixteen bytes at a time and reduced with a horizontal
+/// sum (SSE2 on x86, NEON on AArch64, scalar elsewhere).
+/// \code
+/// state::stream_validator validator;
+/// validator.setStreamKey(stream_key);
+/// validator.validate(data, data_length, &frames, &validation);
+/// \endcode
+/// \see state::robot_state::parseStreamFrames
+class stream_validator {
+  public:
+	stream_validator (
+		void
+	);
+
+	/// \brief Sum of bytes (modulo 256)
+	/// \details A valid stream frame sums to zero, from its header
+	/// through its checksum.
+	/// \param [in] data_ The bytes
+	/// \param [in] data_length_ The number of bytes
+	/// \return The least significant byte of the sum
+	static
+	uint_opt8_t
+	byteSum (
+		const uint_opt8_t * const data_,
+		const size_t data_length_
+	);
+
+	/// \brief Clear the stream key
+	/// \details Frames are validated by structure and checksum alone.
+	void
+	clearStreamKey (
+		void
+	);
+
+	/// \brief Describe the frames of the stream
+	/// \param [in] stream_key_ The packet ids requested by the last call
+	/// to stream() (same format as the parse key)
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER The key is empty or too long, holds an
+	/// undefined packet id, or describes a frame of more than 255 bytes
+	/// \see state::setStreamKey
+	ReturnCode
+	setStreamKey (
+		sensor::PacketId const * const stream_key_
+	);
+
+	/// \brief Validate the stream frames of a buffer
+	/// \details Scanning resumes after the header of a rejected frame,
+	/// so a corrupt frame costs only itself. Scanning stops at a frame
+	/// that is incomplete but valid so far, whose bytes must be given
+	/// again (followed by the rest of the frame).
+	/// \param [in] data_ The bytes received from the Roomba
+	/// \param [in] data_length_ The number of bytes
+	/// \param [out] frames_ Receives the frames that passed, in order
+	/// \param [out] validation_ Receives the outcome
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	ReturnCode
+	validate (
+		const uint_opt8_t * const data_,
+		const size_t data_length_,
+		std::vector<stream_frame_t> * const frames_,
+		stream_validation_t * const validation_
+	) const;
+
+	/// \brief First byte of every stream frame
+	static const uint_opt8_t FRAME_HEADER = 19;
+
+	/// \brief Largest possible stream frame
+	/// \details Header, length, up to 255 bytes of payload and the checksum.
+	static const uint_opt16_t FRAME_MAX = 258;
+
+  private:
+	/// \brief Size of the template, rounded up to a whole vector
+	static const uint_opt16_t TEMPLATE_SIZE = 272;
+
+	bool
+	_hasValidStructure (
+		const uint_opt8_t * const frame_,
+		const uint_opt16_t bytes_available_
+	) const;
+
+	/// \brief Expected length byte (zero when the stream key is unknown)
+	uint_opt8_t _payload_length;
+
+	/// \brief Bytes of a frame checked against the template (header,
+	/// length and packet ids)
+	uint_opt8_t _template_mask[TEMPLATE_SIZE];
+
+	/// \brief The expected value of each byte under the mask
+	uint_opt8_t _template[TEMPLATE_SIZE];
+};
+
+} // namespace state
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
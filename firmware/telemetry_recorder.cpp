@@ -0,0 +1,225 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "telemetry_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace roomba {
+namespace telemetry {
+
+namespace {
+	/// \brief Size of the stdio buffer of the log (in bytes)
+	const size_t LOG_BUFFER_SIZE(64 * 1024);
+
+	/// \brief Round a capacity up to a power of two
+	/// \param [in] capacity_ The capacity requested
+	/// \return The capacity of the ring (at least two)
+	inline
+	size_t
+	_ringCapacity (
+		const size_t capacity_
+	) {
+		size_t capacity(2);
+		while ( capacity < capacity_ ) { capacity <<= 1; }
+		return capacity;
+	}
+
+	/// \brief Read a clock in nanoseconds
+	/// \return The time since the epoch of the clock
+	template <typename clock_t>
+	inline
+	int64_t
+	_nowNs (
+		void
+	) {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_t::now().time_since_epoch()).count();
+	}
+} // namespace
+
+const uint_opt16_t telemetry_recorder::RECORD_PAYLOAD_MAX;
+
+telemetry_recorder::telemetry_recorder (
+	const size_t capacity_,
+	const std::chrono::milliseconds flush_interval_
+) :
+	_slot_mask(_ringCapacity(capacity_) - 1),
+	_slots(new slot_t[_slot_mask + 1]),
+	_flush_interval(flush_interval_),
+	_enqueue_position(0),
+	_dequeue_position(0),
+	_sequence(0),
+	_records_dropped(0),
+	_records_written(0),
+	_log(nullptr),
+	_recording(false),
+	_flushing(false)
+{
+	for ( size_t i = 0 ; i <= _slot_mask ; ++i ) { _slots[i].turn.store(i, std::memory_order_relaxed); }
+}
+
+telemetry_recorder::~telemetry_recorder (
+	void
+) {
+	close();
+}
+
+/// \brief Write the records queued on the ring to the log
+/// \details Runs on the flusher thread (or on the thread closing the
+/// log, once the flusher has stopped).
+/// \return The number of records taken from the ring
+size_t
+telemetry_recorder::_drain (
+	void
+) {
+	size_t records_drained(0);
+
+	for (;;) {
+		slot_t & slot = _slots[_dequeue_position & _slot_mask];
+		if ( slot.turn.load(std::memory_order_acquire) != (_dequeue_position + 1) ) { break; }
+
+		const bool written = (1 == std::fwrite(&slot.header, sizeof(record_header_t), 1, _log) && slot.header.length == std::fwrite(slot.payload, 1, slot.header.length, _log));
+		(written ? _records_written : _records_dropped).fetch_add(1, std::memory_order_relaxed);
+
+		// Return the slot to the producers, one lap ahead
+		slot.turn.store((_dequeue_position + _slot_mask + 1), std::memory_order_release);
+		++_dequeue_position;
+		++records_drained;
+	}
+	if ( records_drained ) { std::fflush(_log); }
+
+	return records_drained;
+}
+
+/// \brief Body of the flusher thread
+/// \details Drains the ring once per flush interval, until the log is
+/// closed.
+void
+telemetry_recorder::_flush (
+	void
+) {
+	std::unique_lock<std::mutex> lock(_flusher_mutex);
+	while ( _flushing ) {
+		_flusher_wake.wait_for(lock, _flush_interval);
+		lock.unlock();
+		_drain();
+		lock.lock();
+	}
+}
+
+void
+telemetry_recorder::close (
+	void
+) {
+	if ( !_log ) { return; }
+	_recording.store(false, std::memory_order_relaxed);
+
+	_flusher_mutex.lock();
+	_flushing = false;
+	_flusher_mutex.unlock();
+	_flusher_wake.notify_one();
+	if ( _flusher.joinable() ) { _flusher.join(); }
+
+	_drain();
+	std::fclose(_log);
+	_log = nullptr;
+}
+
+ReturnCode
+telemetry_recorder::open (
+	const char * const path_
+) {
+	if ( !path_ ) { return INVALID_PARAMETER; }
+	if ( _log ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+
+	_log = std::fopen(path_, "wb");
+	if ( !_log ) { return SERIAL_TRANSFER_FAILURE; }
+	std::setvbuf(_log, nullptr, _IOFBF, LOG_BUFFER_SIZE);
+
+	log_header_t log_header = log_header_t();
+	memcpy(log_header.magic, LOG_MAGIC, sizeof(log_header.magic));
+	log_header.version = LOG_VERSION;
+	log_header.record_header_size = sizeof(record_header_t);
+	log_header.steady_origin_ns = _nowNs<std::chrono::steady_clock>();
+	log_header.system_origin_ns = _nowNs<std::chrono::system_clock>();
+	if ( 1 != std::fwrite(&log_header, sizeof(log_header), 1, _log) || std::fflush(_log) ) {
+		std::fclose(_log);
+		_log = nullptr;
+		return SERIAL_TRANSFER_FAILURE;
+	}
+
+	_flushing = true;
+	_flusher = std::thread(&telemetry_recorder::_flush, this);
+	_recording.store(true, std::memory_order_relaxed);
+
+	return SUCCESS;
+}
+
+ReturnCode
+telemetry_recorder::record (
+	const RecordType type_,
+	const uint_opt8_t * const data_,
+	const size_t data_length_
+) {
+	if ( !data_ || !data_length_ ) { return INVALID_PARAMETER; }
+	if ( STREAM_FRAME != type_ && COMMAND != type_ ) { return INVALID_PARAMETER; }
+	if ( !_recording.load(std::memory_order_relaxed) ) { return INVALID_MODE_FOR_REQUESTED_OPERATION; }
+
+	const int64_t timestamp_ns = _nowNs<std::chrono::steady_clock>();
+	ReturnCode rc = SUCCESS;
+
+	for ( size_t offset = 0 ; offset < data_length_ ; ) {
+		const uint_opt16_t length = static_cast<uint_opt16_t>(std::min<size_t>(RECORD_PAYLOAD_MAX, (data_length_ - offset)));
+		const uint_opt32_t sequence = _sequence.fetch_add(1, std::memory_order_relaxed);
+
+		// Claim the slot at the head of the ring, unless the flusher has yet to write it
+		slot_t * slot = nullptr;
+		size_t position = _enqueue_position.load(std::memory_order_relaxed);
+		for (;;) {
+			slot_t & candidate = _slots[position & _slot_mask];
+			const size_t turn = candidate.turn.load(std::memory_order_acquire);
+			if ( turn == position ) {
+				if ( _enqueue_position.compare_exchange_weak(position, (position + 1), std::memory_order_relaxed) ) { slot = &candidate; break; }
+			} else if ( static_cast<std::ptrdiff_t>(turn - position) < 0 ) {
+				break;
+			} else {
+				position = _enqueue_position.load(std::memory_order_relaxed);
+			}
+		}
+
+		if ( slot ) {
+			slot->header.length = length;
+			slot->header.type = type_;
+			slot->header.reserved = 0;
+			slot->header.sequence = sequence;
+			slot->header.timestamp_ns = timestamp_ns;
+			memcpy(slot->payload, (data_ + offset), length);
+			slot->turn.store((position + 1), std::memory_order_release);
+		} else {
+			_records_dropped.fetch_add(1, std::memory_order_relaxed);
+			rc = NO_DATA_AVAILABLE;
+		}
+		offset += length;
+	}
+
+	return rc;
+}
+
+uint_opt64_t
+telemetry_recorder::recordsDropped (
+	void
+) const {
+	return _records_dropped.load(std::memory_order_relaxed);
+}
+
+uint_opt64_t
+telemetry_recorder::recordsWritten (
+	void
+) const {
+	return _records_written.load(std::memory_order_relaxed);
+}
+
+} // namespace telemetry
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
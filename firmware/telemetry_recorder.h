@@ -0,0 +1,190 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef TELEMETRY_RECORDER_H
+#define TELEMETRY_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "defines.h"
+
+namespace roomba {
+
+/// \brief Flight recording of the traffic of a Roomba
+/// \details Captures the stream frames validated by the parser and the
+/// commands written to the Roomba, for analysis after the fact.
+/// \see telemetry::telemetry_recorder
+namespace telemetry {
+
+/// \brief The content of a record
+enum RecordType : uint8_t {
+	STREAM_FRAME = 1, ///< a validated stream frame (header, length, payload and checksum)
+	COMMAND = 2, ///< bytes written to the Roomba (one or more commands)
+};
+
+/// \brief The header of a log file
+/// \details Written once, at the start of the file. The origins relate
+/// the monotonic timestamps of the records to the wall clock.
+/// \note Fields are written in the byte order of the host, a version
+/// other than LOG_VERSION (i.e. byte swapped) must be rejected.
+struct log_header_t {
+	char magic[8]; ///< LOG_MAGIC
+	uint32_t version; ///< LOG_VERSION
+	uint32_t record_header_size; ///< sizeof(record_header_t)
+	int64_t steady_origin_ns; ///< steady clock when the log was opened
+	int64_t system_origin_ns; ///< system clock (since the Unix epoch) when the log was opened
+};
+
+/// \brief The header of a record
+/// \details Each record is its header, followed by length bytes of
+/// payload. Records are appended in the order they were recorded.
+struct record_header_t {
+	uint16_t length; ///< bytes of payload following the header
+	uint8_t type; ///< RecordType
+	uint8_t reserved; ///< zero
+	uint32_t sequence; ///< sequence of the record (a gap counts the records dropped)
+	int64_t timestamp_ns; ///< steady clock when the record was made
+};
+static_assert((16 == sizeof(record_header_t)), "record_header_t must not be padded");
+
+/// \brief Identifies a log file
+const char LOG_MAGIC[8] = { 'R', 'O', 'O', 'M', 'B', 'A', 'T', 'L' };
+
+/// \brief Version of the log format
+const uint32_t LOG_VERSION = 1;
+
+/// \brief An append-only, binary log of stream frames and commands
+/// \details Records are copied into a preallocated ring of fixed size
+/// slots, and written to the log by a background flusher. Recording is
+/// lock-free (a few atomic operations and a copy), so it may be called
+/// from the parsing thread and the command threads at once, and never
+/// waits for the disk. When the ring is full the record is dropped and
+/// counted, rather than stalling the caller.
+/// \code
+/// telemetry::telemetry_recorder recorder;
+/// recorder.open("roomba.tlm");
+/// roomba.getState().setTelemetryRecorder(&recorder);
+/// \endcode
+/// \see state::robot_state::setTelemetryRecorder
+class telemetry_recorder {
+  public:
+	/// \param [in] capacity_ Records held by the ring (rounded up to a
+	/// power of two) [default value: 4096]
+	/// \param [in] flush_interval_ Time the flusher waits between
+	/// writes [default value: 20ms]
+	explicit
+	telemetry_recorder (
+		const size_t capacity_ = 4096,
+		const std::chrono::milliseconds flush_interval_ = std::chrono::milliseconds(20)
+	);
+
+	/// \brief Closes the log (if open)
+	~telemetry_recorder (
+		void
+	);
+
+	/// \brief Write the records held by the ring, and close the log
+	/// \note Recording must have ceased (i.e. the recorder detached from
+	/// the robot state) before the log is closed.
+	void
+	close (
+		void
+	);
+
+	/// \brief Create a log, and start the flusher
+	/// \details An existing file is replaced.
+	/// \param [in] path_ The path of the log file
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	/// \return INVALID_MODE_FOR_REQUESTED_OPERATION The log is open
+	/// \return SERIAL_TRANSFER_FAILURE The file could not be created
+	ReturnCode
+	open (
+		const char * const path_
+	);
+
+	/// \brief Append a record to the log
+	/// \details The record is timestamped and queued on the ring, the
+	/// flusher writes it to the log. A payload longer than
+	/// RECORD_PAYLOAD_MAX is split across consecutive records.
+	/// \param [in] type_ The content of the record
+	/// \param [in] data_ The payload of the record
+	/// \param [in] data_length_ The number of bytes of payload
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	/// \return INVALID_MODE_FOR_REQUESTED_OPERATION The log is closed
+	/// \return NO_DATA_AVAILABLE The ring is full, the record was dropped
+	ReturnCode
+	record (
+		const RecordType type_,
+		const uint_opt8_t * const data_,
+		const size_t data_length_
+	);
+
+	/// \brief The number of records dropped (ring full, or write failure)
+	uint_opt64_t
+	recordsDropped (
+		void
+	) const;
+
+	/// \brief The number of records written to the log
+	uint_opt64_t
+	recordsWritten (
+		void
+	) const;
+
+	/// \brief Largest payload of a single record (the largest stream frame)
+	static const uint_opt16_t RECORD_PAYLOAD_MAX = 258;
+
+  private:
+	/// \brief A record queued on the ring
+	/// \details The turn of a slot tells the producers and the flusher
+	/// whose turn it is, as in a Vyukov bounded queue.
+	struct slot_t {
+		std::atomic<size_t> turn; ///< position of the ring the slot is ready for
+		record_header_t header; ///< header of the record
+		uint_opt8_t payload[RECORD_PAYLOAD_MAX]; ///< payload of the record
+	};
+
+	telemetry_recorder (const telemetry_recorder &) = delete;
+	telemetry_recorder & operator= (const telemetry_recorder &) = delete;
+
+	size_t
+	_drain (
+		void
+	);
+
+	void
+	_flush (
+		void
+	);
+
+	const size_t _slot_mask; ///< slots in the ring, less one
+	const std::unique_ptr<slot_t[]> _slots; ///< the ring
+	const std::chrono::milliseconds _flush_interval; ///< time between writes
+	std::atomic<size_t> _enqueue_position; ///< next position claimed by a producer
+	size_t _dequeue_position; ///< next position written by the flusher
+	std::atomic<uint_opt32_t> _sequence; ///< sequence of the next record
+	std::atomic<uint_opt64_t> _records_dropped; ///< records dropped
+	std::atomic<uint_opt64_t> _records_written; ///< records written
+	std::FILE * _log; ///< the log file (nullptr when closed)
+	std::atomic<bool> _recording; ///< the log is open
+	bool _flushing; ///< the flusher is to continue (guarded by _flusher_mutex)
+	std::mutex _flusher_mutex; ///< wakes the flusher when the log is closed
+	std::condition_variable _flusher_wake; ///< signalled when the log is closed
+	std::thread _flusher; ///< writes the ring to the log
+};
+
+} // namespace telemetry
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
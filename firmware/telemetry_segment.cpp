@@ -0,0 +1,375 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "telemetry_segment.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace roomba {
+namespace telemetry {
+
+namespace {
+	/// \brief Bytes of a serialized segment header (magic, version,
+	/// column count, rows and block count)
+	const size_t SEGMENT_HEADER_SIZE(sizeof(SEGMENT_MAGIC) + sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t) + sizeof(uint64_t));
+
+	/// \brief Bytes of a serialized index entry
+	const size_t SEGMENT_BLOCK_SIZE(sizeof(int64_t) + sizeof(uint64_t) + (telemetry_segment::COLUMN_COUNT * sizeof(uint32_t)));
+
+	/// \brief Append a field to a serialized segment
+	/// \param [in,out] data_ The serialized segment
+	/// \param [in] field_ The field to append
+	template <typename T>
+	inline
+	void
+	_put (
+		std::vector<uint_opt8_t> * const data_,
+		const T field_
+	) {
+		const uint_opt8_t * const bytes = reinterpret_cast<const uint_opt8_t *>(&field_);
+		data_->insert(data_->end(), bytes, (bytes + sizeof(field_)));
+	}
+
+	/// \brief Take a field from a serialized segment
+	/// \param [in] data_ The serialized segment
+	/// \param [in,out] offset_ Offset of the field, advanced past it
+	/// \return The field
+	template <typename T>
+	inline
+	T
+	_take (
+		const uint_opt8_t * const data_,
+		size_t * const offset_
+	) {
+		T field;
+		memcpy(&field, (data_ + *offset_), sizeof(field));
+		*offset_ += sizeof(field);
+		return field;
+	}
+
+	/// \brief Append a zig-zag varint
+	/// \details Small magnitudes (positive or negative) take few bytes.
+	/// \param [in,out] bytes_ The encoded column
+	/// \param [in] value_ The value to encode
+	inline
+	void
+	_putVarint (
+		std::vector<uint_opt8_t> & bytes_,
+		const int64_t value_
+	) {
+		uint64_t zig_zag = ((static_cast<uint64_t>(value_) << 1) ^ static_cast<uint64_t>(value_ >> 63));
+		while ( zig_zag >= 0x80 ) {
+			bytes_.push_back(static_cast<uint_opt8_t>(zig_zag | 0x80));
+			zig_zag >>= 7;
+		}
+		bytes_.push_back(static_cast<uint_opt8_t>(zig_zag));
+	}
+
+	/// \brief Take a zig-zag varint
+	/// \param [in] bytes_ The encoded column
+	/// \param [in] end_ Offset past the last byte that may be read
+	/// \param [in,out] offset_ Offset of the varint, advanced past it
+	/// \param [out] value_ Receives the value
+	/// \return false when the varint runs past end_
+	inline
+	bool
+	_takeVarint (
+		const uint_opt8_t * const bytes_,
+		const size_t end_,
+		size_t * const offset_,
+		int64_t * const value_
+	) {
+		uint64_t zig_zag(0);
+		for ( uint_opt8_t shift = 0 ; *offset_ < end_ && shift < 64 ; shift += 7 ) {
+			const uint_opt8_t byte = bytes_[(*offset_)++];
+			zig_zag |= (static_cast<uint64_t>(byte & 0x7F) << shift);
+			if ( !(byte & 0x80) ) {
+				*value_ = static_cast<int64_t>((zig_zag >> 1) ^ (~(zig_zag & 1) + 1));
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// \brief Append a run of equal deltas
+	/// \param [in,out] bytes_ The encoded column
+	/// \param [in] delta_ The delta of each row of the run
+	/// \param [in] length_ The number of rows of the run
+	inline
+	void
+	_putRun (
+		std::vector<uint_opt8_t> & bytes_,
+		const int64_t delta_,
+		const uint_opt32_t length_
+	) {
+		_putVarint(bytes_, delta_);
+		_putVarint(bytes_, length_);
+	}
+
+	/// \brief The value of a packet in the sensor data blob
+	/// \param [in] sensor_data_ The raw data blob
+	/// \param [in] column_ The column of the packet (1-52)
+	/// \return The value, in host byte order and signedness
+	inline
+	int64_t
+	_packetValue (
+		const uint8_t * const sensor_data_,
+		const uint_opt8_t column_
+	) {
+		const sensor::packet_descriptor_t & descriptor = sensor::PACKET_DESCRIPTOR[(sensor::BUMPS_AND_WHEEL_DROPS + column_ - 1)];
+		const uint8_t * const value = (sensor_data_ + descriptor.offset);
+		if ( 2 == descriptor.size ) {
+			const uint16_t raw = static_cast<uint16_t>((value[0] << 8) | value[1]);
+			return ( descriptor.is_signed ? static_cast<int16_t>(raw) : raw );
+		}
+		return ( descriptor.is_signed ? static_cast<int8_t>(value[0]) : value[0] );
+	}
+} // namespace
+
+const uint_opt8_t telemetry_segment::COLUMN_COUNT;
+
+telemetry_segment::telemetry_segment (
+	const size_t block_rows_
+) :
+	_block_rows(std::max<size_t>(block_rows_, 1)),
+	_columns(),
+	_rows(0),
+	_block_open(false)
+{}
+
+/// \brief Decode a block of a column
+/// \details Decoding is bounded by the block (and the column), so the
+/// bytes of a corrupt segment cannot be overrun.
+/// \param [in] column_ The column to decode
+/// \param [in] block_ The block to decode
+/// \param [out] values_ Receives the value of each row of the block
+/// \return The number of values decoded (short when the column is corrupt)
+size_t
+telemetry_segment::_decodeBlock (
+	const uint_opt8_t column_,
+	const size_t block_,
+	std::vector<int64_t> * const values_
+) const {
+	const column_t & column = _columns[column_];
+	const bool last_block = ((block_ + 1) == _blocks.size());
+	const size_t block_rows = static_cast<size_t>(( last_block ? _rows : _blocks[(block_ + 1)].first_row ) - _blocks[block_].first_row);
+	const size_t end = ( last_block ? column.bytes.size() : _blocks[(block_ + 1)].offsets[column_] );
+	size_t offset = _blocks[block_].offsets[column_];
+	int64_t value;
+
+	values_->clear();
+	if ( !_takeVarint(column.bytes.data(), end, &offset, &value) ) { return 0; }
+	values_->push_back(value);
+
+	int64_t delta, length;
+	while ( values_->size() < block_rows && _takeVarint(column.bytes.data(), end, &offset, &delta) && _takeVarint(column.bytes.data(), end, &offset, &length) ) {
+		for ( int64_t i = 0 ; i < length && values_->size() < block_rows ; ++i ) {
+			value = static_cast<int64_t>(static_cast<uint64_t>(value) + static_cast<uint64_t>(delta));
+			values_->push_back(value);
+		}
+	}
+
+	// The run being extended belongs to the last block
+	if ( last_block && _block_open ) {
+		for ( uint_opt32_t i = 0 ; i < column.run_length && values_->size() < block_rows ; ++i ) {
+			value = static_cast<int64_t>(static_cast<uint64_t>(value) + static_cast<uint64_t>(column.run_delta));
+			values_->push_back(value);
+		}
+	}
+
+	return values_->size();
+}
+
+ReturnCode
+telemetry_segment::append (
+	const int64_t timestamp_ns_,
+	const state::sensor_data_t & sensor_data_
+) {
+	if ( _rows && timestamp_ns_ < _columns[0].previous ) { return INVALID_PARAMETER; }
+	const uint8_t * const sensor_data = reinterpret_cast<const uint8_t *>(&sensor_data_);
+
+	if ( !_block_open || (_rows - _blocks.back().first_row) >= _block_rows ) {
+		// End the runs of the previous block, and index the new one
+		block_t block;
+		block.first_timestamp_ns = timestamp_ns_;
+		block.first_row = _rows;
+		for ( uint_opt8_t column = 0 ; column < COLUMN_COUNT ; ++column ) {
+			column_t & encoded = _columns[column];
+			if ( encoded.run_length ) { _putRun(encoded.bytes, encoded.run_delta, encoded.run_length); }
+			block.offsets[column] = static_cast<uint32_t>(encoded.bytes.size());
+			encoded.previous = ( column ? _packetValue(sensor_data, column) : timestamp_ns_ );
+			encoded.run_length = 0;
+			_putVarint(encoded.bytes, encoded.previous);
+		}
+		_blocks.push_back(block);
+		_block_open = true;
+	} else {
+		for ( uint_opt8_t column = 0 ; column < COLUMN_COUNT ; ++column ) {
+			column_t & encoded = _columns[column];
+			const int64_t value = ( column ? _packetValue(sensor_data, column) : timestamp_ns_ );
+			const int64_t delta = static_cast<int64_t>(static_cast<uint64_t>(value) - static_cast<uint64_t>(encoded.previous));
+			if ( encoded.run_length && delta == encoded.run_delta ) {
+				++encoded.run_length;
+			} else {
+				if ( encoded.run_length ) { _putRun(encoded.bytes, encoded.run_delta, encoded.run_length); }
+				encoded.run_delta = delta;
+				encoded.run_length = 1;
+			}
+			encoded.previous = value;
+		}
+	}
+	++_rows;
+
+	return SUCCESS;
+}
+
+ReturnCode
+telemetry_segment::deserialize (
+	const uint_opt8_t * const data_,
+	const size_t data_length_
+) {
+	_blocks.clear();
+	for ( uint_opt8_t column = 0 ; column < COLUMN_COUNT ; ++column ) {
+		_columns[column] = column_t();
+	}
+	_rows = 0;
+	_block_open = false;
+	if ( !data_ || data_length_ < SEGMENT_HEADER_SIZE ) { return INVALID_PARAMETER; }
+
+	size_t offset(sizeof(SEGMENT_MAGIC));
+	if ( memcmp(data_, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) ) { return INVALID_PARAMETER; }
+	if ( SEGMENT_VERSION != _take<uint32_t>(data_, &offset) ) { return INVALID_PARAMETER; }
+	if ( COLUMN_COUNT != _take<uint32_t>(data_, &offset) ) { return INVALID_PARAMETER; }
+	const uint64_t rows = _take<uint64_t>(data_, &offset);
+	const uint64_t block_count = _take<uint64_t>(data_, &offset);
+	if ( (!rows != !block_count) || block_count > rows || block_count > ((data_length_ - offset) / SEGMENT_BLOCK_SIZE) ) { return INVALID_PARAMETER; }
+
+	// The index must describe ascending rows and times
+	std::vector<block_t> blocks(static_cast<size_t>(block_count));
+	for ( size_t i = 0 ; i < blocks.size() ; ++i ) {
+		blocks[i].first_timestamp_ns = _take<int64_t>(data_, &offset);
+		blocks[i].first_row = _take<uint64_t>(data_, &offset);
+		for ( uint_opt8_t column = 0 ; column < COLUMN_COUNT ; ++column ) {
+			blocks[i].offsets[column] = _take<uint32_t>(data_, &offset);
+		}
+		if ( i ? (blocks[i].first_row <= blocks[(i - 1)].first_row || blocks[i].first_timestamp_ns < blocks[(i - 1)].first_timestamp_ns) : (0 != blocks[i].first_row) ) { return INVALID_PARAMETER; }
+	}
+	if ( block_count && blocks.back().first_row >= rows ) { return INVALID_PARAMETER; }
+
+	column_t columns[COLUMN_COUNT];
+	for ( uint_opt8_t column = 0 ; column < COLUMN_COUNT ; ++column ) {
+		if ( (data_length_ - offset) < sizeof(uint64_t) ) { return INVALID_PARAMETER; }
+		const uint64_t column_length = _take<uint64_t>(data_, &offset);
+		if ( column_length > (data_length_ - offset) ) { return INVALID_PARAMETER; }
+		for ( size_t i = 0 ; i < blocks.size() ; ++i ) {
+			if ( blocks[i].offsets[column] > column_length || (i && blocks[i].offsets[column] < blocks[(i - 1)].offsets[column]) ) { return INVALID_PARAMETER; }
+		}
+		columns[column].bytes.assign((data_ + offset), (data_ + offset + column_length));
+		offset += static_cast<size_t>(column_length);
+	}
+
+	_blocks.swap(blocks);
+	for ( uint_opt8_t column = 0 ; column < COLUMN_COUNT ; ++column ) {
+		_columns[column].bytes.swap(columns[column].bytes);
+	}
+	_rows = static_cast<size_t>(rows);
+
+	// Later rows must not precede the last timestamp
+	if ( _rows ) {
+		std::vector<int64_t> timestamps;
+		if ( _decodeBlock(0, (_blocks.size() - 1), &timestamps) ) { _columns[0].previous = timestamps.back(); }
+	}
+
+	return SUCCESS;
+}
+
+size_t
+telemetry_segment::encodedSize (
+	void
+) const {
+	size_t encoded_size(0);
+	for ( uint_opt8_t column = 0 ; column < COLUMN_COUNT ; ++column ) {
+		encoded_size += _columns[column].bytes.size();
+	}
+	return encoded_size;
+}
+
+ReturnCode
+telemetry_segment::query (
+	const sensor::PacketId packet_id_,
+	const int64_t begin_ns_,
+	const int64_t end_ns_,
+	std::vector<sample_t> * const samples_
+) const {
+	if ( !samples_ || packet_id_ < sensor::BUMPS_AND_WHEEL_DROPS || packet_id_ > sensor::STASIS || begin_ns_ > end_ns_ ) { return INVALID_PARAMETER; }
+	const uint_opt8_t column = static_cast<uint_opt8_t>(packet_id_ - sensor::BUMPS_AND_WHEEL_DROPS + 1);
+	samples_->clear();
+
+	// Seek to the last block beginning before the range
+	std::vector<block_t>::const_iterator block = std::lower_bound(_blocks.begin(), _blocks.end(), begin_ns_, [](const block_t & block_, const int64_t timestamp_ns_) {
+		return (block_.first_timestamp_ns < timestamp_ns_);
+	});
+	if ( block != _blocks.begin() ) { --block; }
+
+	std::vector<int64_t> timestamps, values;
+	for ( ; block != _blocks.end() && block->first_timestamp_ns <= end_ns_ ; ++block ) {
+		const size_t block_index = static_cast<size_t>(block - _blocks.begin());
+		const size_t decoded = std::min(_decodeBlock(0, block_index, &timestamps), _decodeBlock(column, block_index, &values));
+		for ( size_t row = 0 ; row < decoded ; ++row ) {
+			if ( timestamps[row] < begin_ns_ ) { continue; }
+			if ( timestamps[row] > end_ns_ ) { break; }
+			sample_t sample;
+			sample.timestamp_ns = timestamps[row];
+			sample.value = static_cast<int32_t>(values[row]);
+			samples_->push_back(sample);
+		}
+	}
+
+	return SUCCESS;
+}
+
+size_t
+telemetry_segment::rows (
+	void
+) const {
+	return _rows;
+}
+
+ReturnCode
+telemetry_segment::serialize (
+	std::vector<uint_opt8_t> * const data_
+) const {
+	if ( !data_ ) { return INVALID_PARAMETER; }
+	data_->clear();
+
+	data_->insert(data_->end(), SEGMENT_MAGIC, (SEGMENT_MAGIC + sizeof(SEGMENT_MAGIC)));
+	_put<uint32_t>(data_, SEGMENT_VERSION);
+	_put<uint32_t>(data_, COLUMN_COUNT);
+	_put<uint64_t>(data_, _rows);
+	_put<uint64_t>(data_, _blocks.size());
+	for ( const block_t & block : _blocks ) {
+		_put<int64_t>(data_, block.first_timestamp_ns);
+		_put<uint64_t>(data_, block.first_row);
+		for ( uint_opt8_t column = 0 ; column < COLUMN_COUNT ; ++column ) {
+			_put<uint32_t>(data_, block.offsets[column]);
+		}
+	}
+
+	// The run being extended ends the last block
+	std::vector<uint_opt8_t> run;
+	for ( uint_opt8_t column = 0 ; column < COLUMN_COUNT ; ++column ) {
+		const column_t & encoded = _columns[column];
+		run.clear();
+		if ( _block_open && encoded.run_length ) { _putRun(run, encoded.run_delta, encoded.run_length); }
+		_put<uint64_t>(data_, (encoded.bytes.size() + run.size()));
+		data_->insert(data_->end(), encoded.bytes.begin(), encoded.bytes.end());
+		data_->insert(data_->end(), run.begin(), run.end());
+	}
+
+	return SUCCESS;
+}
+
+} // namespace telemetry
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
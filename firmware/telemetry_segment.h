@@ -0,0 +1,170 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef TELEMETRY_SEGMENT_H
+#define TELEMETRY_SEGMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "defines.h"
+#include "packets.h"
+#include "state.h"
+
+namespace roomba {
+namespace telemetry {
+
+/// \brief A value of a packet, at the time it was collected
+/// \see telemetry_segment::query
+struct sample_t {
+	int64_t timestamp_ns; ///< steady clock when the sensor data was collected
+	int32_t value; ///< the value of the packet (in host byte order and signedness)
+};
+
+/// \brief Identifies a serialized segment
+const char SEGMENT_MAGIC[8] = { 'R', 'O', 'O', 'M', 'B', 'A', 'C', 'S' };
+
+/// \brief Version of the segment format
+const uint32_t SEGMENT_VERSION = 1;
+
+/// \brief A columnar store of the sensor data of one Roomba
+/// \details Rather than storing each row of sensor data as an 80 byte
+/// blob, every individual packet (7-58) is stored in a column of its
+/// own, beside a column of timestamps. A column is encoded as runs of
+/// equal deltas (zig-zag varints), so a packet that never changes (i.e.
+/// SONG_NUMBER, RESERVED_1) or changes at a steady rate (i.e. the
+/// timestamps, or LEFT_ENCODER_COUNTS while cruising) costs a few bytes
+/// per block, regardless of the number of rows.
+/// \n Rows are grouped into blocks, and each block begins each column
+/// with an absolute value. A sparse index holds the first timestamp of
+/// each block, and the offset of the block in every column, so a query
+/// seeks to the blocks covering its range by binary search, and decodes
+/// only the timestamps and the one column it asks for.
+/// \code
+/// telemetry::telemetry_segment segment;
+/// segment.append(snapshot_ns, snapshot.sensor_data);
+/// ...
+/// std::vector<telemetry::sample_t> samples;
+/// segment.query(sensor::LEFT_MOTOR_CURRENT, t0_ns, t1_ns, &samples);
+/// \endcode
+/// \note Group packets are not stored, their members are. Rows hold the
+/// value of every packet at the time of the row, whether or not the
+/// packet was refreshed (an unrefreshed value repeats, and costs
+/// nothing).
+/// \warning A segment is not thread-safe.
+class telemetry_segment {
+  public:
+	/// \param [in] block_rows_ Rows in each block of the index (one block
+	/// is decoded for a query of a single row) [default value: 256]
+	explicit
+	telemetry_segment (
+		const size_t block_rows_ = 256
+	);
+
+	/// \brief Append a row of sensor data
+	/// \param [in] timestamp_ns_ Time the sensor data was collected
+	/// (i.e. the steady clock, in nanoseconds)
+	/// \param [in] sensor_data_ The sensor data blob
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER The timestamp precedes the last row
+	ReturnCode
+	append (
+		const int64_t timestamp_ns_,
+		const state::sensor_data_t & sensor_data_
+	);
+
+	/// \brief Load a segment serialized by serialize()
+	/// \details Replaces the contents of the segment. Rows appended
+	/// afterward begin a new block.
+	/// \param [in] data_ The serialized segment
+	/// \param [in] data_length_ The number of bytes of the segment
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER The bytes are not a valid segment (the
+	/// segment is left empty)
+	ReturnCode
+	deserialize (
+		const uint_opt8_t * const data_,
+		const size_t data_length_
+	);
+
+	/// \brief The number of bytes held by the columns
+	size_t
+	encodedSize (
+		void
+	) const;
+
+	/// \brief The values of a packet collected within a range of time
+	/// \param [in] packet_id_ An individual packet (7-58)
+	/// \param [in] begin_ns_ Beginning of the range (inclusive)
+	/// \param [in] end_ns_ End of the range (inclusive)
+	/// \param [out] samples_ Receives the values, in the order they were
+	/// appended (existing contents are discarded)
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	ReturnCode
+	query (
+		const sensor::PacketId packet_id_,
+		const int64_t begin_ns_,
+		const int64_t end_ns_,
+		std::vector<sample_t> * const samples_
+	) const;
+
+	/// \brief The number of rows appended
+	size_t
+	rows (
+		void
+	) const;
+
+	/// \brief Serialize the segment
+	/// \details The segment is a header, the index of blocks, then each
+	/// column. Fields are written in the byte order of the host.
+	/// \param [out] data_ Receives the serialized segment (existing
+	/// contents are discarded)
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	ReturnCode
+	serialize (
+		std::vector<uint_opt8_t> * const data_
+	) const;
+
+	/// \brief The timestamps, then one column for each individual packet
+	static const uint_opt8_t COLUMN_COUNT = (1 + sensor::STASIS - sensor::BUMPS_AND_WHEEL_DROPS + 1);
+
+  private:
+	/// \brief An encoded column
+	/// \details The run being extended is held aside until it ends (or
+	/// its block does), so each run is encoded once.
+	struct column_t {
+		std::vector<uint_opt8_t> bytes; ///< the encoded blocks
+		int64_t previous; ///< value of the last row
+		int64_t run_delta; ///< delta of the run being extended
+		uint_opt32_t run_length; ///< rows in the run being extended (zero when none)
+	};
+
+	/// \brief An entry of the sparse index
+	struct block_t {
+		int64_t first_timestamp_ns; ///< timestamp of the first row of the block
+		uint64_t first_row; ///< the first row of the block
+		uint32_t offsets[COLUMN_COUNT]; ///< offset of the block in each column
+	};
+
+	size_t
+	_decodeBlock (
+		const uint_opt8_t column_,
+		const size_t block_,
+		std::vector<int64_t> * const values_
+	) const;
+
+	const size_t _block_rows; ///< rows in each block appended
+	std::vector<block_t> _blocks; ///< the sparse index
+	column_t _columns[COLUMN_COUNT]; ///< the columns
+	size_t _rows; ///< rows appended
+	bool _block_open; ///< rows may be appended to the last block
+};
+
+} // namespace telemetry
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
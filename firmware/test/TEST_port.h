@@ -0,0 +1,77 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(TESTING)
+
+#ifndef TEST_PORT_H
+#define TEST_PORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "../serial_port.h"
+
+namespace roomba {
+namespace serial {
+namespace testing {
+
+/// \brief A serial port backed by byte vectors
+/// \details Reads are served from `rx` (nothing once it is exhausted),
+/// and writes are appended to `tx`.
+class TestPort : public port {
+  public:
+	TestPort (
+		void
+	) :
+		baud_code(static_cast<BaudCode>(-1)),
+		read_index(0),
+		tx_at_baud_change(0),
+		write_count(0)
+	{}
+
+	void
+	beginAtBaudCode (
+		const BaudCode baud_code_
+	) override {
+		baud_code = baud_code_;
+		tx_at_baud_change = tx.size();
+	}
+
+	size_t
+	multiByteSerialRead (
+		uint_opt8_t * const buffer_,
+		const size_t buffer_length_,
+		const uint_opt32_t
+	) override {
+		const size_t length = std::min(buffer_length_, (rx.size() - read_index));
+		for ( size_t i = 0 ; i < length ; ++i ) { buffer_[i] = rx[read_index++]; }
+		return length;
+	}
+
+	size_t
+	multiByteSerialWrite (
+		const uint_opt8_t * const data_,
+		const size_t data_length_
+	) override {
+		tx.insert(tx.end(), data_, (data_ + data_length_));
+		++write_count;
+		return data_length_;
+	}
+
+	BaudCode baud_code; ///< the baud code of the last call to beginAtBaudCode()
+	size_t read_index; ///< the next byte of `rx` to be read
+	std::vector<uint_opt8_t> rx; ///< the bytes to be read
+	std::vector<uint_opt8_t> tx; ///< the bytes written
+	size_t tx_at_baud_change; ///< the size of `tx` at the last call to beginAtBaudCode()
+	size_t write_count; ///< the number of calls to multiByteSerialWrite()
+};
+
+} // namespace testing
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
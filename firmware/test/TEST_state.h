@@ -54,6 +54,27 @@ setInternalsToInitialState (
 	void
 );
 
+/// \brief Store the value of a packet in a sensor data blob
+/// \param [in,out] sensor_data_ The sensor data blob
+/// \param [in] packet_id_ An individual packet
+/// \param [in] value_ The value of the packet
+inline
+void
+setPacket (
+	sensor_data_t & sensor_data_,
+	const sensor::PacketId packet_id_,
+	const int value_
+) {
+	const sensor::packet_descriptor_t & descriptor = sensor::packetDescriptor(packet_id_);
+	uint8_t * const value = (reinterpret_cast<uint8_t *>(&sensor_data_) + descriptor.offset);
+	if ( 2 == descriptor.size ) {
+		value[0] = static_cast<uint8_t>(value_ >> 8);
+		value[1] = static_cast<uint8_t>(value_);
+	} else {
+		value[0] = static_cast<uint8_t>(value_);
+	}
+}
+
 } // testing
 } // namespace state
 } // namespace roomba
@@ -0,0 +1,371 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+// Measures the code run on every frame (67 Hz per robot): the stream and
+// query parsers (byte at a time, and in bulk), the parse/stream key
+// bookkeeping and the encoders of open_interface<OI500>, as well as each
+// kernel of the batch decoder. The serial port is the mock, so the
+// results are the cost of the library alone.
+//
+//   make BENCHMARK_SUITE=benchmark_hot_paths benchmark_hot_paths CXXFLAGS=-O2
+//   ./benchmark_hot_paths [--benchmark_filter=parse]
+//
+// Results are reported in frames/sec and time/byte (ns per byte on the
+// wire).
+
+#include "benchmark/benchmark.h"
+#include "../batch_decoder.h"
+#include "../open_interface.h"
+#include "../state.h"
+#include "MOCK_serial.h"
+#include "TEST_state.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace roomba;
+
+namespace {
+
+typedef open_interface<OI500> OpenInterface;
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+/// \brief Report the throughput of a benchmark
+/// \param [in,out] state_ The benchmark state
+/// \param [in] bytes_per_frame_ The bytes on the wire for each iteration
+/// \note time/byte is an inverted rate (seconds per byte), so it is
+/// printed with its SI prefix (i.e. 5.4ns).
+void
+reportThroughput (
+	benchmark::State & state_,
+	const size_t bytes_per_frame_
+) {
+	state_.counters["frames/sec"] = benchmark::Counter(1, benchmark::Counter::kIsIterationInvariantRate);
+	state_.counters["time/byte"] = benchmark::Counter(bytes_per_frame_, (benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert));
+}
+
+/// \brief Serve the same bytes forever from the mock serial port
+/// \param [in] data_ The bytes to repeat
+void
+serveRepeatedly (
+	const std::vector<uint_opt8_t> & data_
+) {
+	size_t offset(0);
+	serial::mock::setSerialReadFunc([data_, offset] (uint_opt8_t * const data_buffer_, const size_t buffer_length_) mutable -> size_t {
+		for ( size_t i = 0 ; i < buffer_length_ ; ++i ) {
+			data_buffer_[i] = data_[offset];
+			if ( ++offset == data_.size() ) { offset = 0; }
+		}
+		return buffer_length_;
+	});
+}
+
+/// \brief Build a stream frame for a sensor list
+/// \param [in] sensor_list_ The packet ids of the frame
+/// \param [in] sensor_count_ The number of packet ids
+/// \return The frame (header, length, packets and checksum), with
+/// every packet value set to zero
+std::vector<uint_opt8_t>
+streamFrame (
+	const sensor::PacketId * const sensor_list_,
+	const size_t sensor_count_
+) {
+	std::vector<uint_opt8_t> frame = { 19, 0 };
+	for ( size_t i = 0 ; i < sensor_count_ ; ++i ) {
+		frame.push_back(sensor_list_[i]);
+		frame.resize((frame.size() + sensor::packetDescriptor(sensor_list_[i]).size), 0);
+	}
+	frame[1] = static_cast<uint_opt8_t>(frame.size() - 2);
+
+	uint_opt8_t checksum(0);
+	for ( size_t i = 0 ; i < frame.size() ; ++i ) { checksum += frame[i]; }
+	frame.push_back(static_cast<uint_opt8_t>(0x100 - checksum));
+	return frame;
+}
+
+  /****************/
+ /* PACKET LISTS */
+/****************/
+/// \brief The packet groups measured on their own
+const sensor::PacketId SENSOR_GROUPS[3] = { sensor::PACKETS_7_THRU_58, sensor::PACKETS_43_THRU_58, sensor::VOLTAGE };
+
+/// \brief Every named sensor packet, the longest query and stream
+const sensor::PacketId ALL_PACKETS[49] = {
+	sensor::BUMPS_AND_WHEEL_DROPS, sensor::WALL, sensor::CLIFF_LEFT, sensor::CLIFF_FRONT_LEFT, sensor::CLIFF_FRONT_RIGHT, sensor::CLIFF_RIGHT, sensor::VIRTUAL_WALL, sensor::MOTOR_OVERCURRENTS, sensor::DIRT_DETECT, sensor::INFRARED_CHARACTER_OMNI,
+	sensor::BUTTONS, sensor::DISTANCE, sensor::ANGLE, sensor::CHARGING_STATE, sensor::VOLTAGE, sensor::CURRENT, sensor::TEMPERATURE, sensor::BATTERY_CHARGE, sensor::BATTERY_CAPACITY, sensor::WALL_SIGNAL,
+	sensor::CLIFF_LEFT_SIGNAL, sensor::CLIFF_FRONT_LEFT_SIGNAL, sensor::CLIFF_FRONT_RIGHT_SIGNAL, sensor::CLIFF_RIGHT_SIGNAL, sensor::CHARGING_SOURCES_AVAILABLE, sensor::OI_MODE, sensor::SONG_NUMBER, sensor::SONG_PLAYING, sensor::NUMBER_OF_STREAM_PACKETS, sensor::REQUESTED_VELOCITY,
+	sensor::REQUESTED_RADIUS, sensor::REQUESTED_RIGHT_VELOCITY, sensor::REQUESTED_LEFT_VELOCITY, sensor::RIGHT_ENCODER_COUNTS, sensor::LEFT_ENCODER_COUNTS, sensor::LIGHT_BUMPER, sensor::LIGHT_BUMP_LEFT_SIGNAL, sensor::LIGHT_BUMP_FRONT_LEFT_SIGNAL, sensor::LIGHT_BUMP_CENTER_LEFT_SIGNAL, sensor::LIGHT_BUMP_CENTER_RIGHT_SIGNAL,
+	sensor::LIGHT_BUMP_FRONT_RIGHT_SIGNAL, sensor::LIGHT_BUMP_RIGHT_SIGNAL, sensor::INFRARED_CHARACTER_LEFT, sensor::INFRARED_CHARACTER_RIGHT, sensor::LEFT_MOTOR_CURRENT, sensor::RIGHT_MOTOR_CURRENT, sensor::MAIN_BRUSH_MOTOR_CURRENT, sensor::SIDE_BRUSH_MOTOR_CURRENT, sensor::STASIS,
+};
+
+/// \brief The odometry packets
+const sensor::PacketId ODOMETRY_PACKETS[3] = { sensor::BUMPS_AND_WHEEL_DROPS, sensor::DISTANCE, sensor::ANGLE };
+
+/// \brief A packet list
+struct sensor_list_t {
+	const sensor::PacketId * packet_ids; ///< the packet ids
+	size_t packet_count; ///< the number of packet ids
+	const char * label; ///< the description reported with the result
+};
+
+/// \brief The packet lists measured by the parse benchmarks
+/// \details Selected by the argument of the benchmark.
+const sensor_list_t SENSOR_LISTS[] = {
+	{ &SENSOR_GROUPS[0], 1, "100 (7-58)" },
+	{ &SENSOR_GROUPS[1], 1, "101 (43-58)" },
+	{ &SENSOR_GROUPS[2], 1, "22 (voltage)" },
+	{ ODOMETRY_PACKETS, 3, "7,19,20 (odometry)" },
+	{ ALL_PACKETS, 49, "7-58 (single packets)" },
+};
+
+/// \brief Build the key of a packet list (length at index 0)
+std::vector<sensor::PacketId>
+sensorKey (
+	const size_t list_
+) {
+	std::vector<sensor::PacketId> key(1, static_cast<sensor::PacketId>(SENSOR_LISTS[list_].packet_count + 1));
+	for ( size_t i = 0 ; i < SENSOR_LISTS[list_].packet_count ; ++i ) { key.push_back(SENSOR_LISTS[list_].packet_ids[i]); }
+	return key;
+}
+
+  /**************/
+ /* BENCHMARKS */
+/**************/
+void
+BM_parseStreamData (
+	benchmark::State & state_
+) {
+	const size_t list = static_cast<size_t>(state_.range(0));
+	const std::vector<sensor::PacketId> stream_key = sensorKey(list);
+	const std::vector<uint_opt8_t> frame = streamFrame(SENSOR_LISTS[list].packet_ids, SENSOR_LISTS[list].packet_count);
+	state::testing::setInternalsToInitialState();
+	state::setStreamKey(stream_key.data());
+	serveRepeatedly(frame);
+
+	for ( auto _ : state_ ) {
+		if ( SUCCESS != state::parseStreamData() ) {
+			state_.SkipWithError("parseStreamData() failed");
+			break;
+		}
+	}
+
+	reportThroughput(state_, frame.size());
+	state_.SetLabel(SENSOR_LISTS[list].label);
+}
+BENCHMARK(BM_parseStreamData)->DenseRange(0, 4);
+
+void
+BM_parseStreamBuffer (
+	benchmark::State & state_
+) {
+	const size_t list = static_cast<size_t>(state_.range(0));
+	const std::vector<sensor::PacketId> stream_key = sensorKey(list);
+	const std::vector<uint_opt8_t> frame = streamFrame(SENSOR_LISTS[list].packet_ids, SENSOR_LISTS[list].packet_count);
+	state::testing::setInternalsToInitialState();
+	state::setStreamKey(stream_key.data());
+
+	for ( auto _ : state_ ) {
+		size_t bytes_consumed;
+		if ( SUCCESS != state::parseStreamBuffer(frame.data(), frame.size(), &bytes_consumed) ) {
+			state_.SkipWithError("parseStreamBuffer() failed");
+			break;
+		}
+	}
+
+	reportThroughput(state_, frame.size());
+	state_.SetLabel(SENSOR_LISTS[list].label);
+}
+BENCHMARK(BM_parseStreamBuffer)->DenseRange(0, 4);
+
+/// \brief Frames buffered for each iteration of the bulk benchmark
+const size_t BUFFERED_FRAME_COUNT(64);
+
+void
+BM_parseStreamFrames (
+	benchmark::State & state_
+) {
+	const size_t list = static_cast<size_t>(state_.range(0));
+	const std::vector<sensor::PacketId> stream_key = sensorKey(list);
+	const std::vector<uint_opt8_t> frame = streamFrame(SENSOR_LISTS[list].packet_ids, SENSOR_LISTS[list].packet_count);
+	std::vector<uint_opt8_t> frames;
+	for ( size_t i = 0 ; i < BUFFERED_FRAME_COUNT ; ++i ) { frames.insert(frames.end(), frame.begin(), frame.end()); }
+	state::testing::setInternalsToInitialState();
+	state::setStreamKey(stream_key.data());
+
+	for ( auto _ : state_ ) {
+		size_t bytes_consumed;
+		if ( SUCCESS != state::parseStreamFrames(frames.data(), frames.size(), &bytes_consumed) ) {
+			state_.SkipWithError("parseStreamFrames() failed");
+			break;
+		}
+	}
+
+	state_.counters["frames/sec"] = benchmark::Counter(BUFFERED_FRAME_COUNT, benchmark::Counter::kIsIterationInvariantRate);
+	state_.counters["time/byte"] = benchmark::Counter(frames.size(), (benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert));
+	state_.SetLabel(SENSOR_LISTS[list].label);
+}
+BENCHMARK(BM_parseStreamFrames)->DenseRange(0, 4);
+
+void
+BM_parseQueryData (
+	benchmark::State & state_
+) {
+	const size_t list = static_cast<size_t>(state_.range(0));
+	const std::vector<sensor::PacketId> parse_key = sensorKey(list);
+	size_t response_length(0);
+	for ( size_t i = 0 ; i < SENSOR_LISTS[list].packet_count ; ++i ) { response_length += sensor::packetDescriptor(SENSOR_LISTS[list].packet_ids[i]).size; }
+	state::testing::setInternalsToInitialState();
+	state::setParseKey(parse_key.data());
+	serveRepeatedly(std::vector<uint_opt8_t>(response_length, 0));
+
+	// parseQueryData() consumes the key by clearing its length, which is
+	// restored rather than calling setParseKey() (measured on its own)
+	sensor::PacketId * const key_length = state::testing::getParseKey();
+	for ( auto _ : state_ ) {
+		*key_length = parse_key[0];
+		if ( SUCCESS != state::parseQueryData() ) {
+			state_.SkipWithError("parseQueryData() failed");
+			break;
+		}
+	}
+
+	reportThroughput(state_, response_length);
+	state_.SetLabel(SENSOR_LISTS[list].label);
+}
+BENCHMARK(BM_parseQueryData)->DenseRange(0, 4);
+
+/// \details Dominated by the byte count of the key (_bytesInQueryList),
+/// which is internal to state.cpp and therefore measured through its
+/// callers, setParseKey() and setStreamKey().
+void
+BM_setParseKey (
+	benchmark::State & state_
+) {
+	const size_t list = static_cast<size_t>(state_.range(0));
+	const std::vector<sensor::PacketId> parse_key = sensorKey(list);
+	state::testing::setInternalsToInitialState();
+
+	for ( auto _ : state_ ) {
+		benchmark::DoNotOptimize(state::setParseKey(parse_key.data()));
+	}
+
+	state_.SetLabel(SENSOR_LISTS[list].label);
+}
+BENCHMARK(BM_setParseKey)->DenseRange(0, 4);
+
+void
+BM_setStreamKey (
+	benchmark::State & state_
+) {
+	const size_t list = static_cast<size_t>(state_.range(0));
+	const std::vector<sensor::PacketId> stream_key = sensorKey(list);
+	state::testing::setInternalsToInitialState();
+
+	for ( auto _ : state_ ) {
+		benchmark::DoNotOptimize(state::setStreamKey(stream_key.data()));
+	}
+
+	state_.SetLabel(SENSOR_LISTS[list].label);
+}
+BENCHMARK(BM_setStreamKey)->DenseRange(0, 4);
+
+/// \brief Blobs decoded by each iteration of the batch benchmark
+const size_t BATCH_BLOB_COUNT(4096);
+
+void
+BM_batchDecode (
+	benchmark::State & state_
+) {
+	const sensor::BatchKernel kernel = static_cast<sensor::BatchKernel>(state_.range(0));
+	const char * const KERNEL_LABELS[] = { "auto", "scalar", "ssse3", "avx2", "neon" };
+	state_.SetLabel(KERNEL_LABELS[kernel]);
+	if ( !sensor::batch_decoder::kernelSupported(kernel) ) {
+		state_.SkipWithError("kernel not supported");
+		return;
+	}
+	std::vector<uint8_t> blobs(BATCH_BLOB_COUNT * sensor::batch_decoder::SENSOR_DATA_SIZE);
+	for ( size_t i = 0 ; i < blobs.size() ; ++i ) { blobs[i] = static_cast<uint8_t>(i * 131); }
+	sensor::batch_decoder batch;
+
+	for ( auto _ : state_ ) {
+		batch.decode(blobs.data(), BATCH_BLOB_COUNT, sensor::batch_decoder::SENSOR_DATA_SIZE, kernel);
+		benchmark::DoNotOptimize(batch.column(sensor::STASIS));
+	}
+
+	state_.counters["frames/sec"] = benchmark::Counter(BATCH_BLOB_COUNT, benchmark::Counter::kIsIterationInvariantRate);
+	state_.counters["time/byte"] = benchmark::Counter((BATCH_BLOB_COUNT * sensor::batch_decoder::SENSOR_DATA_SIZE), (benchmark::Counter::kIsIterationInvariantRate | benchmark::Counter::kInvert));
+}
+BENCHMARK(BM_batchDecode)->DenseRange(sensor::BATCH_KERNEL_SCALAR, sensor::BATCH_KERNEL_NEON);
+
+/// \brief Measure an encoder of open_interface<OI500>
+/// \param [in,out] state_ The benchmark state
+/// \param [in] encode_ Issues a single command
+void
+BM_encode (
+	benchmark::State & state_,
+	ReturnCode (*encode_)(void)
+) {
+	size_t bytes_written(0);
+	state::testing::setInternalsToInitialState();
+	serial::mock::setSerialWriteFunc([&bytes_written] (const uint_opt8_t * const serial_data_, const size_t data_length_) -> size_t {
+		benchmark::DoNotOptimize(serial_data_);
+		bytes_written += data_length_;
+		return data_length_;
+	});
+
+	for ( auto _ : state_ ) {
+		state::setOIMode(FULL);
+		if ( SUCCESS != encode_() ) {
+			state_.SkipWithError("encoder failed");
+			break;
+		}
+	}
+
+	if ( state_.iterations() ) { reportThroughput(state_, (bytes_written / state_.iterations())); }
+}
+
+/// \brief A song of sixteen notes (the longest command)
+const note_t SONG[16] = {
+	{ C_4, 16 }, { D_4, 16 }, { E_4, 16 }, { F_4, 16 }, { G_4, 16 }, { A_4, 16 }, { B_4, 16 }, { C_5, 16 },
+	{ C_5, 16 }, { B_4, 16 }, { A_4, 16 }, { G_4, 16 }, { F_4, 16 }, { E_4, 16 }, { D_4, 16 }, { C_4, 16 },
+};
+
+/// \brief A schedule for every day of the week
+const clock_time_t SCHEDULE[7] = { clock_time_t(9, 0), clock_time_t(9, 0), clock_time_t(9, 0), clock_time_t(9, 0), clock_time_t(9, 0), clock_time_t(9, 0), clock_time_t(9, 0) };
+
+BENCHMARK_CAPTURE(BM_encode, start, [] () { return OpenInterface::start(); });
+BENCHMARK_CAPTURE(BM_encode, baud, [] () { return OpenInterface::baud(BAUD_115200); })->UseRealTime();  // waits out the change of baud rate
+BENCHMARK_CAPTURE(BM_encode, control, [] () { return OpenInterface::control(); });
+BENCHMARK_CAPTURE(BM_encode, safe, [] () { return OpenInterface::safe(); });
+BENCHMARK_CAPTURE(BM_encode, full, [] () { return OpenInterface::full(); });
+BENCHMARK_CAPTURE(BM_encode, clean, [] () { return OpenInterface::clean(); });
+BENCHMARK_CAPTURE(BM_encode, max, [] () { return OpenInterface::max(); });
+BENCHMARK_CAPTURE(BM_encode, spot, [] () { return OpenInterface::spot(); });
+BENCHMARK_CAPTURE(BM_encode, seekDock, [] () { return OpenInterface::seekDock(); });
+BENCHMARK_CAPTURE(BM_encode, schedule, [] () { return OpenInterface::schedule(static_cast<bitmask::Days>(0x7F), SCHEDULE); });
+BENCHMARK_CAPTURE(BM_encode, setDayTime, [] () { return OpenInterface::setDayTime(WEDNESDAY, clock_time_t(13, 37)); });
+BENCHMARK_CAPTURE(BM_encode, power, [] () { return OpenInterface::power(); });
+BENCHMARK_CAPTURE(BM_encode, drive, [] () { return OpenInterface::drive(-200, 500); });
+BENCHMARK_CAPTURE(BM_encode, driveDirect, [] () { return OpenInterface::driveDirect(-200, 200); });
+BENCHMARK_CAPTURE(BM_encode, drivePWM, [] () { return OpenInterface::drivePWM(-255, 255); });
+BENCHMARK_CAPTURE(BM_encode, motors, [] () { return OpenInterface::motors(static_cast<bitmask::MotorStates>(bitmask::MAIN_BRUSH_ENGAGED | bitmask::VACUUM_ENGAGED)); });
+BENCHMARK_CAPTURE(BM_encode, pwmMotors, [] () { return OpenInterface::pwmMotors(127, -127, 127); });
+BENCHMARK_CAPTURE(BM_encode, leds, [] () { return OpenInterface::leds(bitmask::display::CHECK_ROBOT, 128, 255); });
+BENCHMARK_CAPTURE(BM_encode, schedulingLEDs, [] () { return OpenInterface::schedulingLEDs(bitmask::MONDAY, bitmask::display::COLON); });
+BENCHMARK_CAPTURE(BM_encode, digitLEDsRaw, [] () { static const bitmask::display::DigitN digits[4] = { bitmask::display::A, bitmask::display::B, bitmask::display::C, bitmask::display::A }; return OpenInterface::digitLEDsRaw(digits); });
+BENCHMARK_CAPTURE(BM_encode, digitLEDsASCII, [] () { return OpenInterface::digitLEDsASCII("ABCD"); });
+BENCHMARK_CAPTURE(BM_encode, buttons, [] () { return OpenInterface::buttons(bitmask::CLEAN); });
+BENCHMARK_CAPTURE(BM_encode, song, [] () { return OpenInterface::song(0, SONG, 16); });
+BENCHMARK_CAPTURE(BM_encode, play, [] () { return OpenInterface::play(0); });
+BENCHMARK_CAPTURE(BM_encode, sensors, [] () { return OpenInterface::sensors(sensor::PACKETS_7_THRU_58); });
+BENCHMARK_CAPTURE(BM_encode, queryList, [] () { return OpenInterface::queryList(ALL_PACKETS, 49); });
+BENCHMARK_CAPTURE(BM_encode, stream, [] () { return OpenInterface::stream(ALL_PACKETS, 49); });
+BENCHMARK_CAPTURE(BM_encode, pauseResumeStream, [] () { return OpenInterface::pauseResumeStream(true); });
+BENCHMARK_CAPTURE(BM_encode, batch, [] () { OpenInterface::beginBatch(); OpenInterface::safe(); OpenInterface::driveDirect(-200, 200); OpenInterface::leds(bitmask::display::DOCK, 0, 255); return OpenInterface::endBatch(); });
+
+} // namespace
+
+BENCHMARK_MAIN();
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,128 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../batch_decoder.h"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+/// \brief The vector kernels
+const sensor::BatchKernel VECTOR_KERNELS[3] = { sensor::BATCH_KERNEL_SSSE3, sensor::BATCH_KERNEL_AVX2, sensor::BATCH_KERNEL_NEON };
+
+/// \brief Fill sensor data blobs with noise
+/// \param [in] blob_count_ The number of blobs
+/// \param [in] blob_stride_ Bytes from one blob to the next
+/// \return The blobs
+std::vector<uint8_t>
+randomBlobs (
+	const size_t blob_count_,
+	const size_t blob_stride_ = sensor::batch_decoder::SENSOR_DATA_SIZE
+) {
+	std::mt19937 generator(0x526F6F6D);
+	std::vector<uint8_t> blobs(blob_count_ * blob_stride_);
+	for ( uint8_t & byte : blobs ) { byte = static_cast<uint8_t>(generator()); }
+	return blobs;
+}
+
+/// \brief Compare the columns of two batches
+/// \param [in] expected_ The reference batch
+/// \param [in] actual_ The batch under test
+/// \return true when every column of every packet is identical
+bool
+columnsAreEqual (
+	const sensor::batch_decoder & expected_,
+	const sensor::batch_decoder & actual_
+) {
+	if ( expected_.size() != actual_.size() ) { return false; }
+	for ( uint8_t packet_id = sensor::BUMPS_AND_WHEEL_DROPS ; packet_id <= sensor::STASIS ; ++packet_id ) {
+		const sensor::PacketId id = static_cast<sensor::PacketId>(packet_id);
+		if ( memcmp(expected_.column(id), actual_.column(id), (expected_.size() * sizeof(uint16_t))) ) { return false; }
+	}
+	return true;
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+TEST(BatchDecoder, decode$WHENStrideIsShorterThanABlobTHENErrorIsReturned) {
+	const std::vector<uint8_t> blobs = randomBlobs(2);
+	sensor::batch_decoder batch;
+	EXPECT_EQ(INVALID_PARAMETER, batch.decode(blobs.data(), 2, (sensor::batch_decoder::SENSOR_DATA_SIZE - 1)));
+}
+
+TEST(BatchDecoder, decode$WHENKernelIsNotSupportedTHENErrorIsReturned) {
+	const std::vector<uint8_t> blobs = randomBlobs(2);
+	sensor::batch_decoder batch;
+	size_t kernels_unsupported(0);
+	for ( const sensor::BatchKernel kernel : VECTOR_KERNELS ) {
+		if ( sensor::batch_decoder::kernelSupported(kernel) ) { continue; }
+		++kernels_unsupported;
+		EXPECT_EQ(INVALID_MODE_FOR_REQUESTED_OPERATION, batch.decode(blobs.data(), 2, sensor::batch_decoder::SENSOR_DATA_SIZE, kernel));
+	}
+	EXPECT_LT(0u, kernels_unsupported);
+}
+
+TEST(BatchDecoder, column$WHENPacketIsAGroupTHENNullIsReturned) {
+	const std::vector<uint8_t> blobs = randomBlobs(2);
+	sensor::batch_decoder batch;
+	ASSERT_EQ(SUCCESS, batch.decode(blobs.data(), 2));
+	EXPECT_EQ(nullptr, batch.column(sensor::PACKETS_7_THRU_58));
+	EXPECT_NE(nullptr, batch.column(sensor::STASIS));
+}
+
+TEST(BatchDecoder, decode$WHENBlobsAreDecodedTHENColumnsMatchThePacketDecoder) {
+	const size_t blob_count(37);
+	const std::vector<uint8_t> blobs = randomBlobs(blob_count);
+	sensor::batch_decoder batch;
+	ASSERT_EQ(SUCCESS, batch.decode(blobs.data(), blob_count));
+	ASSERT_EQ(blob_count, batch.size());
+	for ( size_t i = 0 ; i < blob_count ; ++i ) {
+		const uint8_t * const blob = (blobs.data() + (i * sensor::batch_decoder::SENSOR_DATA_SIZE));
+		EXPECT_EQ(sensor::decode<sensor::BUMPS_AND_WHEEL_DROPS>(blob), batch.column<sensor::BUMPS_AND_WHEEL_DROPS>()[i]);
+		EXPECT_EQ(sensor::decode<sensor::DISTANCE>(blob), batch.column<sensor::DISTANCE>()[i]);
+		EXPECT_EQ(sensor::decode<sensor::VOLTAGE>(blob), batch.column<sensor::VOLTAGE>()[i]);
+		EXPECT_EQ(sensor::decode<sensor::TEMPERATURE>(blob), batch.column<sensor::TEMPERATURE>()[i]);
+		EXPECT_EQ(sensor::decode<sensor::LIGHT_BUMP_LEFT_SIGNAL>(blob), batch.column<sensor::LIGHT_BUMP_LEFT_SIGNAL>()[i]);
+		EXPECT_EQ(sensor::decode<sensor::LEFT_MOTOR_CURRENT>(blob), batch.column<sensor::LEFT_MOTOR_CURRENT>()[i]);
+		EXPECT_EQ(sensor::decode<sensor::STASIS>(blob), batch.column<sensor::STASIS>()[i]);
+	}
+}
+
+TEST(BatchDecoder, decode$WHENKernelIsVectorizedTHENColumnsAreBitExact) {
+	const size_t blob_count(1013);
+	const std::vector<uint8_t> blobs = randomBlobs(blob_count);
+	sensor::batch_decoder expected, actual;
+	ASSERT_EQ(SUCCESS, expected.decode(blobs.data(), blob_count, sensor::batch_decoder::SENSOR_DATA_SIZE, sensor::BATCH_KERNEL_SCALAR));
+	for ( const sensor::BatchKernel kernel : VECTOR_KERNELS ) {
+		if ( !sensor::batch_decoder::kernelSupported(kernel) ) { continue; }
+		ASSERT_EQ(SUCCESS, actual.decode(blobs.data(), blob_count, sensor::batch_decoder::SENSOR_DATA_SIZE, kernel));
+		EXPECT_TRUE(columnsAreEqual(expected, actual)) << "kernel " << static_cast<int>(kernel);
+	}
+}
+
+TEST(BatchDecoder, decode$WHENBlobsAreWithinLargerRecordsTHENStrideIsHonored) {
+	const size_t blob_count(40), record_size(96), blob_offset(12);
+	const std::vector<uint8_t> records = randomBlobs(blob_count, record_size);
+	std::vector<uint8_t> blobs;
+	for ( size_t i = 0 ; i < blob_count ; ++i ) {
+		const uint8_t * const blob = (records.data() + (i * record_size) + blob_offset);
+		blobs.insert(blobs.end(), blob, (blob + sensor::batch_decoder::SENSOR_DATA_SIZE));
+	}
+	sensor::batch_decoder expected, actual;
+	ASSERT_EQ(SUCCESS, expected.decode(blobs.data(), blob_count, sensor::batch_decoder::SENSOR_DATA_SIZE, sensor::BATCH_KERNEL_SCALAR));
+	ASSERT_EQ(SUCCESS, actual.decode((records.data() + blob_offset), blob_count, record_size));
+	EXPECT_TRUE(columnsAreEqual(expected, actual));
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
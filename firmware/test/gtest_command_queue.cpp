@@ -0,0 +1,151 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../command_queue.h"
+#include "../robot.h"
+#include "TEST_port.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+using serial::testing::TestPort;
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class QueuedRobot : public ::testing::Test {
+  protected:
+	QueuedRobot (
+		void
+	) :
+		queue(port),
+		roomba(queue)
+	{}
+
+	TestPort port;
+	serial::command_queue queue;
+	robot<OI500> roomba;
+};
+
+TEST_F(QueuedRobot, multiByteSerialWrite$WHENCalledTHENNothingIsSentUntilFlush) {
+	EXPECT_EQ(SUCCESS, roomba.start());
+	EXPECT_EQ(SUCCESS, roomba.drive(-200, 500));
+	EXPECT_TRUE(port.tx.empty());
+	EXPECT_EQ(6u, queue.pending());
+
+	EXPECT_EQ(SUCCESS, queue.flush());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128, 137, 0xFF, 0x38, 0x01, 0xF4 }), port.tx);
+	EXPECT_EQ(1u, port.write_count);
+	EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(QueuedRobot, multiByteSerialWrite$WHENDriveCommandsPileUpTHENOnlyTheLatestIsSent) {
+	EXPECT_EQ(SUCCESS, roomba.drive(-200, 500));
+	EXPECT_EQ(SUCCESS, roomba.drivePWM(10, 10));
+	EXPECT_EQ(SUCCESS, roomba.driveDirect(100, -100));
+	EXPECT_EQ(2u, queue.superseded());
+
+	EXPECT_EQ(SUCCESS, queue.flush());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 145, 0xFF, 0x9C, 0x00, 0x64 }), port.tx);
+}
+
+TEST_F(QueuedRobot, multiByteSerialWrite$WHENClassesDifferTHENNeitherIsReplaced) {
+	const char display[4] = { 'A', 'B', 'C', 'D' };
+	EXPECT_EQ(SUCCESS, roomba.driveDirect(100, -100));
+	EXPECT_EQ(SUCCESS, roomba.motors(static_cast<bitmask::MotorStates>(0x01)));
+	EXPECT_EQ(SUCCESS, roomba.digitLEDsASCII(display));
+
+	EXPECT_EQ(SUCCESS, queue.flush());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 145, 0xFF, 0x9C, 0x00, 0x64, 138, 0x01, 164, 'A', 'B', 'C', 'D' }), port.tx);
+	EXPECT_EQ(0u, queue.superseded());
+}
+
+TEST_F(QueuedRobot, multiByteSerialWrite$WHENAModeCommandIntervenesTHENTheEarlierDriveIsKept) {
+	EXPECT_EQ(SUCCESS, roomba.start());
+	EXPECT_EQ(SUCCESS, roomba.driveDirect(100, -100));
+	EXPECT_EQ(SUCCESS, roomba.full());
+	EXPECT_EQ(SUCCESS, roomba.driveDirect(0, 0));
+	EXPECT_EQ(SUCCESS, roomba.safe());
+
+	EXPECT_EQ(SUCCESS, queue.flush());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128, 145, 0xFF, 0x9C, 0x00, 0x64, 132, 145, 0x00, 0x00, 0x00, 0x00, 131 }), port.tx);
+	EXPECT_EQ(0u, queue.superseded());
+}
+
+TEST_F(QueuedRobot, multiByteSerialWrite$WHENADriveIsReplacedTHENItMovesBehindTheOtherClasses) {
+	EXPECT_EQ(SUCCESS, roomba.driveDirect(100, -100));
+	EXPECT_EQ(SUCCESS, roomba.motors(static_cast<bitmask::MotorStates>(0x01)));
+	EXPECT_EQ(SUCCESS, roomba.driveDirect(0, 0));
+
+	EXPECT_EQ(SUCCESS, queue.flush());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 138, 0x01, 145, 0x00, 0x00, 0x00, 0x00 }), port.tx);
+}
+
+TEST_F(QueuedRobot, multiByteSerialWrite$WHENTheQueueIsFullTHENTheCommandFails) {
+	for ( size_t i = 0 ; i < 64 ; ++i ) { ASSERT_EQ(SUCCESS, roomba.safe()); }
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, roomba.safe());
+	EXPECT_EQ(64u, queue.pending());
+}
+
+TEST_F(QueuedRobot, multiByteSerialWrite$WHENTheQueueIsFullTHENADriveMayStillBeReplaced) {
+	for ( size_t i = 0 ; i < 63 ; ++i ) { ASSERT_EQ(SUCCESS, roomba.safe()); }
+	EXPECT_EQ(SUCCESS, roomba.driveDirect(100, -100));
+	EXPECT_EQ(SUCCESS, roomba.driveDirect(0, 0));
+	EXPECT_EQ(1u, queue.superseded());
+}
+
+TEST_F(QueuedRobot, multiByteSerialRead$WHENCalledTHENTheQueueIsSentFirst) {
+	uint_opt8_t buffer[1];
+	port.rx.push_back(0x55);
+	EXPECT_EQ(SUCCESS, roomba.start());
+	EXPECT_EQ(1u, queue.multiByteSerialRead(buffer, sizeof(buffer)));
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128 }), port.tx);
+	EXPECT_EQ(0x55, buffer[0]);
+}
+
+TEST_F(QueuedRobot, beginAtBaudCode$WHENCalledTHENTheQueueIsSentFirst) {
+	EXPECT_EQ(SUCCESS, roomba.start());
+	queue.beginAtBaudCode(BAUD_57600);
+	EXPECT_EQ(BAUD_57600, port.baud_code);
+	EXPECT_EQ(1u, port.tx_at_baud_change);
+}
+
+TEST_F(QueuedRobot, multiByteSerialRead$WHENAReaderFlushesWhileAPlannerWritesTHENOnlyWholeCommandsAreSent) {
+	std::atomic<bool> planning(true);
+	std::thread reader([&] () {
+		uint_opt8_t buffer[1];
+		while ( planning.load() ) { queue.multiByteSerialRead(buffer, sizeof(buffer), 0); }
+	});
+	for ( int_opt16_t velocity = 0 ; velocity < 500 ; ++velocity ) {
+		ASSERT_EQ(SUCCESS, roomba.driveDirect(velocity, 0));
+		ASSERT_EQ(SUCCESS, roomba.leds(static_cast<bitmask::display::LEDs>(0), 0, 255));
+	}
+	planning.store(false);
+	reader.join();
+	EXPECT_EQ(SUCCESS, queue.flush());
+
+	ASSERT_FALSE(port.tx.empty());
+	for ( size_t i = 0 ; i < port.tx.size() ; ) {
+		ASSERT_TRUE(145 == port.tx[i] || 139 == port.tx[i]) << "offset " << i;
+		i += ( 145 == port.tx[i] ? 5 : 4 );
+	}
+	EXPECT_EQ(0u, queue.pending());
+}
+
+TEST_F(QueuedRobot, flush$WHENTheQueueIsEmptyTHENNothingIsWritten) {
+	EXPECT_EQ(SUCCESS, queue.flush());
+	EXPECT_EQ(0u, port.write_count);
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,175 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../coroutine.h"
+
+#if defined(ROOMBA_COROUTINES)
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+const sensor::PacketId STREAM_KEY[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+const uint_opt8_t FRAME_DISTANCE_MINUS_200[6] = { 19, 3, 19, 0xFF, 0x38, 0xA0 };
+const uint_opt8_t FRAME_DISTANCE_100[6] = { 19, 3, 19, 0x00, 0x64, 0x73 };
+
+/// \brief Await a frame, and record the distance it carries
+coro::task
+awaitFrame (
+	coro::async_robot & roomba_,
+	int_opt16_t * const distance_
+) {
+	const state::sensor_snapshot_t snapshot = co_await roomba_.nextFrame();
+	*distance_ = state::get<sensor::DISTANCE>(snapshot).value;
+}
+
+/// \brief Await a query, and record its result
+coro::task
+awaitQuery (
+	coro::async_robot & roomba_,
+	ReturnCode * const rc_
+) {
+	const sensor::PacketId sensor_list[1] = { sensor::DISTANCE };
+	*rc_ = co_await roomba_.query(sensor_list, 1);
+}
+
+/// \brief Sleep, then drive
+coro::task
+sleepThenDrive (
+	coro::async_robot & roomba_,
+	const std::chrono::milliseconds duration_
+) {
+	co_await roomba_.sleepFor(duration_);
+	roomba_->driveDirect(100, 100);
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class PseudoTerminals : public ::testing::Test {
+  protected:
+	static const size_t PORT_COUNT = 3;
+
+	PseudoTerminals (
+		void
+	) :
+		master_fd{ -1, -1, -1 },
+		loop(reactor)
+	{
+		for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) {
+			roomba[i].reset(new robot<OI500>(tty[i]));
+			async_roomba[i].reset(new coro::async_robot(loop, *roomba[i]));
+		}
+	}
+
+	virtual void SetUp() {
+		for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) {
+			master_fd[i] = ::posix_openpt(O_RDWR | O_NOCTTY);
+			ASSERT_LE(0, master_fd[i]);
+			ASSERT_EQ(0, ::grantpt(master_fd[i]));
+			ASSERT_EQ(0, ::unlockpt(master_fd[i]));
+			ASSERT_EQ(SUCCESS, tty[i].openSerialPort(::ptsname(master_fd[i])));
+			ASSERT_EQ(SUCCESS, roomba[i]->getState().setStreamKey(STREAM_KEY));
+			ASSERT_EQ(SUCCESS, reactor.attach(tty[i], roomba[i]->getState()));
+		}
+	}
+	virtual void TearDown() {
+		for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) {
+			tty[i].closeSerialPort();
+			if ( -1 != master_fd[i] ) { ::close(master_fd[i]); }
+		}
+	}
+
+	int master_fd[PORT_COUNT];
+	serial::posix::tty tty[PORT_COUNT];
+	std::unique_ptr<robot<OI500>> roomba[PORT_COUNT];
+	serial::posix::reactor reactor;
+	coro::event_loop loop;
+	std::unique_ptr<coro::async_robot> async_roomba[PORT_COUNT];
+};
+
+TEST_F(PseudoTerminals, nextFrame$WHENAFrameArrivesTHENTheCoroutineResumesWithIt) {
+	int_opt16_t distance(0);
+	loop.spawn(awaitFrame(*async_roomba[0], &distance));
+	EXPECT_EQ(1u, loop.tasks());
+	ASSERT_EQ(6, ::write(master_fd[0], FRAME_DISTANCE_MINUS_200, 6));
+
+	EXPECT_EQ(SUCCESS, loop.run());
+	EXPECT_EQ(-200, distance);
+	EXPECT_EQ(0u, loop.tasks());
+}
+
+TEST_F(PseudoTerminals, nextFrame$WHENManyCoroutinesAwaitManyRobotsTHENEachResumesWithItsRobotsFrame) {
+	const size_t COROUTINES_PER_ROBOT = 1000;
+	std::unique_ptr<int_opt16_t[]> distance(new int_opt16_t[PORT_COUNT * COROUTINES_PER_ROBOT]());
+	for ( size_t i = 0 ; i < (PORT_COUNT * COROUTINES_PER_ROBOT) ; ++i ) { loop.spawn(awaitFrame(*async_roomba[i % PORT_COUNT], &distance[i])); }
+	ASSERT_EQ(6, ::write(master_fd[0], FRAME_DISTANCE_MINUS_200, 6));
+	ASSERT_EQ(6, ::write(master_fd[1], FRAME_DISTANCE_100, 6));
+	ASSERT_EQ(6, ::write(master_fd[2], FRAME_DISTANCE_MINUS_200, 6));
+
+	EXPECT_EQ(SUCCESS, loop.run());
+	for ( size_t i = 0 ; i < (PORT_COUNT * COROUTINES_PER_ROBOT) ; ++i ) { ASSERT_EQ(((1 == (i % PORT_COUNT)) ? 100 : -200), distance[i]); }
+}
+
+TEST_F(PseudoTerminals, query$WHENTheResponseArrivesTHENTheCoroutineResumesWithSuccess) {
+	const uint_opt8_t response[2] = { 0x00, 0x64 };
+	ReturnCode rc(NO_DATA_AVAILABLE);
+	loop.spawn(awaitQuery(*async_roomba[1], &rc));
+	ASSERT_EQ(2, ::write(master_fd[1], response, 2));
+
+	EXPECT_EQ(SUCCESS, loop.run());
+	EXPECT_EQ(SUCCESS, rc);
+	EXPECT_EQ(100, roomba[1]->getState().get<sensor::DISTANCE>().value);
+}
+
+TEST_F(PseudoTerminals, query$WHENTheResponseIsMissingTHENTheCoroutineResumesWithAFailure) {
+	ReturnCode rc(NO_DATA_AVAILABLE);
+	loop.spawn(awaitQuery(*async_roomba[1], &rc));
+
+	EXPECT_EQ(SUCCESS, loop.run());
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, rc);
+}
+
+TEST_F(PseudoTerminals, query$WHENTheRequestIsInvalidTHENTheCoroutineDoesNotSuspend) {
+	ReturnCode rc(SUCCESS);
+	coro::task task = [] (coro::async_robot & roomba_, ReturnCode * const rc_) -> coro::task {
+		*rc_ = co_await roomba_.query(nullptr, 1);
+	}(*async_roomba[0], &rc);
+
+	EXPECT_TRUE(task.done());
+	EXPECT_EQ(INVALID_PARAMETER, rc);
+}
+
+TEST_F(PseudoTerminals, sleepFor$WHENTheDurationElapsesTHENTheCoroutineResumes) {
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	loop.spawn(sleepThenDrive(*async_roomba[2], std::chrono::milliseconds(30)));
+
+	EXPECT_EQ(SUCCESS, loop.run());
+	EXPECT_LE(30, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+	uint_opt8_t command[5];
+	EXPECT_EQ(5, ::read(master_fd[2], command, sizeof(command)));
+	EXPECT_EQ(145, command[0]);
+}
+
+} // namespace
+
+#else
+
+TEST(Coroutine, build$WHENCoroutinesAreUnavailableTHENTheSuiteFails) {
+	FAIL() << "coroutine.h requires c++20 (build with STD=c++20)";
+}
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,169 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../latency_histogram.h"
+#include "../robot.h"
+#include "../virtual_roomba.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+/// \brief Parse a number of stream frames
+/// \param [in] robot_ The robot bound to the virtual Roomba
+/// \param [in] frames_ The number of frames to parse
+void
+parseFrames (
+	robot<OI500> & robot_,
+	const size_t frames_
+) {
+	for ( size_t i = 0 ; i < frames_ ; ++i ) { ASSERT_EQ(SUCCESS, robot_.getState().parseStreamData()); }
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class LatencyHistogram : public ::testing::Test {
+  protected:
+	state::latency_histogram histogram;
+};
+
+class DriveLatency : public ::testing::Test {
+  protected:
+	DriveLatency (
+		void
+	) :
+		roomba(roomba_port)
+	{}
+
+	virtual void SetUp() {
+		const sensor::PacketId stream_key[3] = { static_cast<sensor::PacketId>(3), sensor::REQUESTED_RIGHT_VELOCITY, sensor::REQUESTED_LEFT_VELOCITY };
+		ASSERT_EQ(SUCCESS, roomba.getState().setStreamKey(stream_key));
+		roomba.start();
+		roomba.safe();
+		roomba.stream((stream_key + 1), 2);
+	}
+
+	serial::virtual_roomba roomba_port;
+	robot<OI500> roomba;
+};
+
+TEST_F(LatencyHistogram, valueAtPercentile$WHENEmptyTHENEveryStatisticIsZero) {
+	EXPECT_EQ(0u, histogram.count());
+	EXPECT_EQ(0, histogram.min().count());
+	EXPECT_EQ(0, histogram.max().count());
+	EXPECT_EQ(0, histogram.mean().count());
+	EXPECT_EQ(0, histogram.valueAtPercentile(99.0).count());
+}
+
+TEST_F(LatencyHistogram, valueAtPercentile$WHENValuesAreSmallTHENTheyAreExact) {
+	for ( int i = 1 ; i <= 50 ; ++i ) { histogram.record(std::chrono::microseconds(i)); }
+	EXPECT_EQ(50u, histogram.count());
+	EXPECT_EQ(1, histogram.min().count());
+	EXPECT_EQ(50, histogram.max().count());
+	EXPECT_EQ(25, histogram.mean().count());
+	EXPECT_EQ(25, histogram.valueAtPercentile(50.0).count());
+	EXPECT_EQ(45, histogram.valueAtPercentile(90.0).count());
+	EXPECT_EQ(1, histogram.valueAtPercentile(0.0).count());
+	EXPECT_EQ(50, histogram.valueAtPercentile(100.0).count());
+}
+
+TEST_F(LatencyHistogram, valueAtPercentile$WHENValuesAreLargeTHENTheyAreWithinTheBucketPrecision) {
+	for ( int i = 0 ; i < 99 ; ++i ) { histogram.record(std::chrono::microseconds(15000)); }
+	histogram.record(std::chrono::milliseconds(250));
+	const std::chrono::microseconds median = histogram.valueAtPercentile(50.0);
+	EXPECT_LE(15000, median.count());
+	EXPECT_GE((15000 + (15000 / 32)), median.count());
+	EXPECT_EQ(250000, histogram.valueAtPercentile(99.9).count());
+	EXPECT_EQ(250000, histogram.max().count());
+}
+
+TEST_F(LatencyHistogram, record$WHENValuesAreOutOfRangeTHENTheyAreClamped) {
+	histogram.record(std::chrono::microseconds(-5));
+	histogram.record(std::chrono::hours(2));
+	EXPECT_EQ(2u, histogram.count());
+	EXPECT_EQ(0, histogram.min().count());
+	EXPECT_EQ(0, histogram.valueAtPercentile(50.0).count());
+	EXPECT_EQ(std::chrono::microseconds(std::chrono::hours(2)).count(), histogram.max().count());
+	EXPECT_EQ(((1LL << state::latency_histogram::MAGNITUDE_MAX) - 1), histogram.valueAtPercentile(100.0).count());
+}
+
+TEST_F(LatencyHistogram, reset$WHENResetTHENTheValuesAreDiscarded) {
+	histogram.record(std::chrono::microseconds(700));
+	histogram.reset();
+	EXPECT_EQ(0u, histogram.count());
+	EXPECT_EQ(0, histogram.valueAtPercentile(100.0).count());
+	histogram.record(std::chrono::microseconds(3));
+	EXPECT_EQ(3, histogram.min().count());
+}
+
+TEST_F(DriveLatency, driveDirect$WHENTrackingIsDisabledTHENNothingIsRecorded) {
+	parseFrames(roomba, 1);
+	roomba.driveDirect(-100, 100);
+	parseFrames(roomba, 3);
+	EXPECT_EQ(0u, roomba.getState().getLatencyHistogram(state::WRITE_TO_SNAPSHOT).count());
+}
+
+TEST_F(DriveLatency, driveDirect$WHENAFrameReflectsTheCommandTHENEachIntervalIsRecordedOnce) {
+	ASSERT_EQ(SUCCESS, roomba.getState().setLatencyTracking(true));
+	parseFrames(roomba, 1);
+	roomba.driveDirect(-100, 100);
+	parseFrames(roomba, 3);
+
+	const state::latency_histogram & first_byte = roomba.getState().getLatencyHistogram(state::WRITE_TO_FIRST_BYTE);
+	const state::latency_histogram & frame_complete = roomba.getState().getLatencyHistogram(state::WRITE_TO_FRAME_COMPLETE);
+	const state::latency_histogram & snapshot = roomba.getState().getLatencyHistogram(state::WRITE_TO_SNAPSHOT);
+	EXPECT_EQ(1u, first_byte.count());
+	EXPECT_EQ(1u, frame_complete.count());
+	EXPECT_EQ(1u, snapshot.count());
+	EXPECT_LE(first_byte.max(), frame_complete.max());
+	EXPECT_LE(frame_complete.max(), snapshot.max());
+}
+
+TEST_F(DriveLatency, driveDirect$WHENACommandIsSupersededTHENOnlyTheLatestIsTimed) {
+	ASSERT_EQ(SUCCESS, roomba.getState().setLatencyTracking(true));
+	roomba.driveDirect(-100, 100);
+	roomba.driveDirect(200, 200);
+	parseFrames(roomba, 3);
+	EXPECT_EQ(1u, roomba.getState().getLatencyHistogram(state::WRITE_TO_SNAPSHOT).count());
+}
+
+TEST_F(DriveLatency, driveDirect$WHENTheCommandIsBatchedTHENItIsTimedFromTheFlush) {
+	const std::chrono::milliseconds hold(100);
+	ASSERT_EQ(SUCCESS, roomba.getState().setLatencyTracking(true));
+	parseFrames(roomba, 1);
+	ASSERT_EQ(SUCCESS, roomba.beginBatch());
+	roomba.driveDirect(-100, 100);
+	std::this_thread::sleep_for(hold);
+	ASSERT_EQ(SUCCESS, roomba.endBatch());
+	parseFrames(roomba, 3);
+
+	const state::latency_histogram & snapshot = roomba.getState().getLatencyHistogram(state::WRITE_TO_SNAPSHOT);
+	EXPECT_EQ(1u, snapshot.count());
+	EXPECT_LT(snapshot.max(), hold);
+}
+
+TEST(DriveLatencyUnmatched, driveDirect$WHENTheStreamLacksTheVelocitiesTHENNothingIsRecorded) {
+	const sensor::PacketId stream_key[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+	serial::virtual_roomba roomba_port;
+	robot<OI500> roomba(roomba_port);
+	ASSERT_EQ(SUCCESS, roomba.getState().setStreamKey(stream_key));
+	ASSERT_EQ(SUCCESS, roomba.getState().setLatencyTracking(true));
+	roomba.start();
+	roomba.safe();
+	roomba.stream((stream_key + 1), 1);
+	roomba.driveDirect(-100, 100);
+	parseFrames(roomba, 3);
+	EXPECT_EQ(0u, roomba.getState().getLatencyHistogram(state::WRITE_TO_SNAPSHOT).count());
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
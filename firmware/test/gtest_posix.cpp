@@ -0,0 +1,133 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../posix.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace roomba;
+
+namespace {
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class PseudoTerminal : public ::testing::Test {
+  protected:
+	PseudoTerminal (
+		void
+	) :
+		master_fd(-1)
+	{}
+
+	//virtual ~PseudoTerminal() {}
+	virtual void SetUp() {
+		master_fd = ::posix_openpt(O_RDWR | O_NOCTTY);
+		ASSERT_LE(0, master_fd);
+		ASSERT_EQ(0, ::grantpt(master_fd));
+		ASSERT_EQ(0, ::unlockpt(master_fd));
+		ASSERT_EQ(SUCCESS, serial::posix::openSerialPort(::ptsname(master_fd)));
+	}
+	virtual void TearDown() {
+		serial::posix::closeSerialPort();
+		::close(master_fd);
+	}
+
+	int master_fd;
+};
+
+TEST(PosixSerial, openSerialPort$WHENDevicePathIsNULLTHENParameterIsInvalid) {
+	EXPECT_EQ(INVALID_PARAMETER, serial::posix::openSerialPort(NULL));
+}
+
+TEST(PosixSerial, openSerialPort$WHENBaudCodeIsGreaterThan11THENParameterIsInvalid) {
+	EXPECT_EQ(INVALID_PARAMETER, serial::posix::openSerialPort("/dev/null", static_cast<BaudCode>(12)));
+}
+
+TEST(PosixSerial, openSerialPort$WHENDeviceDoesNotExistTHENErrorIsReturned) {
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, serial::posix::openSerialPort("/dev/roomba-does-not-exist"));
+	EXPECT_EQ(-1, serial::posix::fileDescriptor());
+}
+
+TEST(PosixSerial, multiByteSerialRead$WHENPortIsNotOpenTHENZeroIsReturned) {
+	uint_opt8_t buffer[4];
+	EXPECT_EQ(0, serial::posix::multiByteSerialRead(buffer, sizeof(buffer), 10));
+}
+
+TEST(PosixSerial, multiByteSerialWrite$WHENPortIsNotOpenTHENZeroIsReturned) {
+	const uint_opt8_t serial_data[1] = { command::START };
+	EXPECT_EQ(0, serial::posix::multiByteSerialWrite(serial_data, sizeof(serial_data)));
+}
+
+TEST_F(PseudoTerminal, openSerialPort$WHENCalledTHENFileDescriptorIsAvailable) {
+	EXPECT_LE(0, serial::posix::fileDescriptor());
+}
+
+TEST_F(PseudoTerminal, multiByteSerialWrite$WHENCalledTHENDataArrivesAtTheDevice) {
+	const uint_opt8_t serial_data[5] = { command::DRIVE_DIRECT, 0x01, 0xF4, 0xFE, 0x0C };
+	uint8_t received[5] = { 0 };
+	ASSERT_EQ(sizeof(serial_data), serial::posix::multiByteSerialWrite(serial_data, sizeof(serial_data)));
+	ASSERT_EQ(static_cast<ssize_t>(sizeof(received)), ::read(master_fd, received, sizeof(received)));
+	for ( size_t i = 0 ; i < sizeof(received) ; ++i ) {
+		EXPECT_EQ(serial_data[i], received[i]);
+	}
+}
+
+TEST_F(PseudoTerminal, multiByteSerialRead$WHENDataIsAvailableTHENItIsPlacedInTheBuffer) {
+	const uint8_t stream[8] = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 };
+	uint_opt8_t buffer[8] = { 0 };
+	ASSERT_EQ(static_cast<ssize_t>(sizeof(stream)), ::write(master_fd, stream, sizeof(stream)));
+	ASSERT_EQ(sizeof(buffer), serial::posix::multiByteSerialRead(buffer, sizeof(buffer), 1000));
+	for ( size_t i = 0 ; i < sizeof(buffer) ; ++i ) {
+		EXPECT_EQ(stream[i], buffer[i]);
+	}
+}
+
+TEST_F(PseudoTerminal, multiByteSerialRead$WHENDataArrivesInPiecesTHENReadWaitsForTheRemainder) {
+	const uint8_t stream[8] = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 };
+	uint_opt8_t buffer[8] = { 0 };
+	std::thread writer([&] () {
+		::write(master_fd, stream, 3);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		::write(master_fd, (stream + 3), 5);
+	});
+	EXPECT_EQ(sizeof(buffer), serial::posix::multiByteSerialRead(buffer, sizeof(buffer), 1000));
+	writer.join();
+	EXPECT_EQ(0xA3, buffer[7]);
+}
+
+TEST_F(PseudoTerminal, multiByteSerialRead$WHENNoDataArrivesTHENReturnsAfterTimeout) {
+	uint_opt8_t buffer[4];
+	const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	EXPECT_EQ(0, serial::posix::multiByteSerialRead(buffer, sizeof(buffer), 25));
+	const long elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+	EXPECT_LE(25, elapsed_ms);
+	EXPECT_GT(500, elapsed_ms);
+}
+
+TEST_F(PseudoTerminal, multiByteSerialRead$WHENFewerBytesArriveTHENPartialCountIsReturned) {
+	const uint8_t stream[2] = { 0x13, 0x05 };
+	uint_opt8_t buffer[8];
+	ASSERT_EQ(static_cast<ssize_t>(sizeof(stream)), ::write(master_fd, stream, sizeof(stream)));
+	EXPECT_EQ(sizeof(stream), serial::posix::multiByteSerialRead(buffer, sizeof(buffer), 10));
+}
+
+TEST_F(PseudoTerminal, beginAtBaudCode$WHENCalledWithNonStandardRateTHENPortRemainsUsable) {
+	const uint_opt8_t serial_data[1] = { command::START };
+	uint8_t received = 0;
+	serial::posix::beginAtBaudCode(BAUD_28800);
+	ASSERT_EQ(sizeof(serial_data), serial::posix::multiByteSerialWrite(serial_data, sizeof(serial_data)));
+	ASSERT_EQ(1, ::read(master_fd, &received, 1));
+	EXPECT_EQ(command::START, received);
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,174 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../posix.h"
+#include "../pty_roomba.h"
+#include "../robot.h"
+
+#include <chrono>
+#include <future>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+/// \brief Parse the stream arriving on a tty for a period of time
+/// \param [in] tty_ The tty receiving the stream
+/// \param [in] robot_state_ The state parsing the stream
+/// \param [in] duration_ The time to listen
+/// \return The number of frames committed
+size_t
+listen (
+	serial::posix::tty & tty_,
+	state::robot_state & robot_state_,
+	const std::chrono::milliseconds duration_
+) {
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + duration_);
+	size_t frames(0);
+
+	while ( std::chrono::steady_clock::now() < deadline ) {
+		uint_opt8_t data[256];
+		const size_t length = tty_.multiByteSerialRead(data, sizeof(data), 10);
+		for ( size_t offset = 0 ; offset < length ; ) {
+			size_t consumed(0);
+			if ( SUCCESS == robot_state_.parseStreamBuffer((data + offset), (length - offset), &consumed) ) { ++frames; }
+			offset += consumed;
+		}
+	}
+
+	return frames;
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class PtyRoomba : public ::testing::Test {
+  protected:
+	PtyRoomba (
+		void
+	) :
+		roomba(tty)
+	{}
+
+	virtual void TearDown() {
+		tty.closeSerialPort();
+		simulation.close();
+	}
+
+	/// \brief Open the pty, and connect the robot to it
+	void
+	connect (
+		void
+	) {
+		ASSERT_EQ(SUCCESS, simulation.open());
+		ASSERT_EQ(SUCCESS, tty.openSerialPort(simulation.devicePath()));
+	}
+
+	serial::posix::pty_roomba simulation;
+	serial::posix::tty tty;
+	robot<OI500> roomba;
+};
+
+TEST_F(PtyRoomba, open$WHENOpenedTHENTheSlaveIsATty) {
+	EXPECT_STREQ("", simulation.devicePath());
+	connect();
+	EXPECT_STRNE("", simulation.devicePath());
+	EXPECT_LE(0, tty.fileDescriptor());
+	EXPECT_EQ(INVALID_MODE_FOR_REQUESTED_OPERATION, simulation.open());
+}
+
+TEST_F(PtyRoomba, close$WHENClosedTHENItCanBeOpenedAgain) {
+	connect();
+	tty.closeSerialPort();
+	simulation.close();
+	EXPECT_STREQ("", simulation.devicePath());
+	EXPECT_EQ(SUCCESS, simulation.open());
+}
+
+TEST_F(PtyRoomba, write$WHENCommandsAreWrittenToTheTtyTHENTheSimulationExecutesThem) {
+	connect();
+	roomba.start();
+	roomba.safe();
+	roomba.driveDirect(-100, 100);
+
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + std::chrono::seconds(1));
+	int_opt16_t right(0), left(0);
+	while ( std::chrono::steady_clock::now() < deadline && !right ) { simulation.getRoomba().getWheelVelocities(&right, &left); }
+	EXPECT_EQ(SAFE, simulation.getRoomba().getOIMode());
+	EXPECT_EQ(100, right);
+	EXPECT_EQ(-100, left);
+}
+
+TEST_F(PtyRoomba, queryListAsync$WHENServicedOverTheTtyTHENTheResponseIsParsed) {
+	const sensor::PacketId sensor_list[2] = { sensor::OI_MODE, sensor::VOLTAGE };
+	std::future<ReturnCode> completion;
+	connect();
+	roomba.start();
+	roomba.full();
+
+	ASSERT_EQ(SUCCESS, roomba.queryListAsync(sensor_list, 2, &completion));
+	EXPECT_EQ(SUCCESS, roomba.getState().serviceQueries());
+	EXPECT_EQ(SUCCESS, completion.get());
+	EXPECT_EQ(FULL, roomba.getState().get<sensor::OI_MODE>().value);
+	EXPECT_EQ(16000, roomba.getState().get<sensor::VOLTAGE>().value);
+}
+
+TEST_F(PtyRoomba, stream$WHENStreamingOverTheTtyTHENAFrameArrivesEveryStep) {
+	const sensor::PacketId stream_key[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+	connect();
+	ASSERT_EQ(SUCCESS, roomba.getState().setStreamKey(stream_key));
+	roomba.start();
+	roomba.stream((stream_key + 1), 1);
+
+	const size_t frames = listen(tty, roomba.getState(), std::chrono::milliseconds(300));
+	EXPECT_LE(15u, frames);
+	EXPECT_GE(21u, frames);
+	EXPECT_EQ(0u, roomba.getState().getStreamStatistics().frames_dropped);
+}
+
+TEST(PtyRoombaThrottled, stream$WHENThrottledTHENBytesArriveAtTheRateOfTheLine) {
+	const sensor::PacketId sensor_list[1] = { sensor::PACKETS_7_THRU_58 };
+	serial::posix::pty_roomba simulation(BAUD_19200, true);
+	serial::posix::tty tty;
+	robot<OI500> roomba(tty);
+	ASSERT_EQ(SUCCESS, simulation.open());
+	ASSERT_EQ(SUCCESS, tty.openSerialPort(simulation.devicePath(), BAUD_19200));
+	roomba.start();
+	roomba.stream(sensor_list, 1);
+
+	// 200 bytes take 104 ms at 19200 baud, rather than 3 frames (45 ms)
+	uint_opt8_t data[200];
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EXPECT_EQ(sizeof(data), tty.multiByteSerialRead(data, sizeof(data), 1000));
+	EXPECT_LE(100, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+TEST_F(PtyRoomba, injectErrors$WHENInvalidTHENTheErrorsAreRejected) {
+	EXPECT_EQ(INVALID_PARAMETER, simulation.injectErrors(-0.1, 0.0));
+	EXPECT_EQ(INVALID_PARAMETER, simulation.injectErrors(0.0, 1.5));
+	connect();
+	EXPECT_EQ(INVALID_MODE_FOR_REQUESTED_OPERATION, simulation.injectErrors(0.0, 0.0));
+}
+
+TEST_F(PtyRoomba, injectErrors$WHENBytesAreCorruptedAndDroppedTHENTheParserResynchronizes) {
+	const sensor::PacketId stream_key[2] = { static_cast<sensor::PacketId>(2), sensor::PACKETS_7_THRU_26 };
+	ASSERT_EQ(SUCCESS, simulation.injectErrors(0.01, 0.01, 42));
+	connect();
+	ASSERT_EQ(SUCCESS, roomba.getState().setStreamKey(stream_key));
+	roomba.start();
+	roomba.stream((stream_key + 1), 1);
+
+	const size_t frames = listen(tty, roomba.getState(), std::chrono::milliseconds(450));
+	const state::stream_statistics_t statistics = roomba.getState().getStreamStatistics();
+	EXPECT_LT(0u, (simulation.bytesCorrupted() + simulation.bytesDropped()));
+	EXPECT_LT(0u, (statistics.bytes_dropped + statistics.frames_dropped));
+	EXPECT_LT(10u, frames);
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,197 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../reactor.h"
+#include "../robot.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+const sensor::PacketId STREAM_KEY[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+const uint_opt8_t FRAME_DISTANCE_MINUS_200[6] = { 19, 3, 19, 0xFF, 0x38, 0xA0 };
+const uint_opt8_t FRAME_DISTANCE_100[6] = { 19, 3, 19, 0x00, 0x64, 0x73 };
+
+/// \brief Poll until the expected number of frames are committed
+inline
+size_t
+pollForFrames (
+	serial::posix::reactor & reactor_,
+	const size_t frames_expected_
+) {
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + std::chrono::seconds(2));
+	size_t frames_committed(0);
+	while ( frames_committed < frames_expected_ && std::chrono::steady_clock::now() < deadline ) {
+		frames_committed += reactor_.poll(100);
+	}
+	return frames_committed;
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class PseudoTerminals : public ::testing::Test {
+  protected:
+	static const size_t PORT_COUNT = 3;
+
+	PseudoTerminals (
+		void
+	) :
+		master_fd{ -1, -1, -1 }
+	{
+		for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) { robot_state[i].reset(new state::robot_state(tty[i])); }
+	}
+
+	virtual void SetUp() {
+		for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) {
+			master_fd[i] = ::posix_openpt(O_RDWR | O_NOCTTY);
+			ASSERT_LE(0, master_fd[i]);
+			ASSERT_EQ(0, ::grantpt(master_fd[i]));
+			ASSERT_EQ(0, ::unlockpt(master_fd[i]));
+			ASSERT_EQ(SUCCESS, tty[i].openSerialPort(::ptsname(master_fd[i])));
+			ASSERT_EQ(SUCCESS, robot_state[i]->setStreamKey(STREAM_KEY));
+		}
+	}
+	virtual void TearDown() {
+		for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) {
+			tty[i].closeSerialPort();
+			if ( -1 != master_fd[i] ) { ::close(master_fd[i]); }
+		}
+	}
+
+	int master_fd[PORT_COUNT];
+	serial::posix::tty tty[PORT_COUNT];
+	std::unique_ptr<state::robot_state> robot_state[PORT_COUNT];
+	serial::posix::reactor reactor;
+};
+
+TEST(Reactor, attach$WHENTtyIsClosedTHENParameterIsInvalid) {
+	serial::posix::reactor reactor;
+	serial::posix::tty tty;
+	state::robot_state robot_state(tty);
+	EXPECT_EQ(INVALID_PARAMETER, reactor.attach(tty, robot_state));
+	EXPECT_EQ(0u, reactor.attached());
+}
+
+TEST(Reactor, poll$WHENNothingIsAttachedTHENReturnsAfterTimeout) {
+	serial::posix::reactor reactor;
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EXPECT_EQ(0u, reactor.poll(20));
+	EXPECT_LE(15, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+TEST_F(PseudoTerminals, attach$WHENTtyIsAlreadyAttachedTHENParameterIsInvalid) {
+	EXPECT_EQ(SUCCESS, reactor.attach(tty[0], *robot_state[0]));
+	EXPECT_EQ(INVALID_PARAMETER, reactor.attach(tty[0], *robot_state[1]));
+	EXPECT_EQ(1u, reactor.attached());
+}
+
+TEST_F(PseudoTerminals, detach$WHENTtyIsAttachedTHENItIsRemoved) {
+	EXPECT_EQ(SUCCESS, reactor.attach(tty[0], *robot_state[0]));
+	EXPECT_EQ(SUCCESS, reactor.attach(tty[1], *robot_state[1]));
+	EXPECT_EQ(SUCCESS, reactor.detach(tty[0]));
+	EXPECT_EQ(1u, reactor.attached());
+	EXPECT_EQ(INVALID_PARAMETER, reactor.detach(tty[0]));
+}
+
+TEST_F(PseudoTerminals, poll$WHENFramesArriveOnManyTtysTHENEachStateReceivesItsOwnFrame) {
+	for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) { ASSERT_EQ(SUCCESS, reactor.attach(tty[i], *robot_state[i])); }
+	ASSERT_EQ(6, ::write(master_fd[0], FRAME_DISTANCE_MINUS_200, 6));
+	ASSERT_EQ(6, ::write(master_fd[1], FRAME_DISTANCE_100, 6));
+	ASSERT_EQ(6, ::write(master_fd[2], FRAME_DISTANCE_MINUS_200, 6));
+
+	EXPECT_EQ(3u, pollForFrames(reactor, 3));
+	EXPECT_EQ(-200, robot_state[0]->get<sensor::DISTANCE>().value);
+	EXPECT_EQ(100, robot_state[1]->get<sensor::DISTANCE>().value);
+	EXPECT_EQ(-200, robot_state[2]->get<sensor::DISTANCE>().value);
+}
+
+TEST_F(PseudoTerminals, poll$WHENQueryResponsesArriveTHENThePendingQueriesComplete) {
+	const sensor::PacketId parse_key[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+	const uint_opt8_t responses[4] = { 0xFF, 0x38, 0x00, 0x64 };
+	std::future<ReturnCode> first, second;
+	ASSERT_EQ(SUCCESS, reactor.attach(tty[0], *robot_state[0]));
+	ASSERT_EQ(SUCCESS, robot_state[0]->expectQuery(parse_key, &first));
+	ASSERT_EQ(SUCCESS, robot_state[0]->expectQuery(parse_key, &second));
+	ASSERT_EQ(4, ::write(master_fd[0], responses, 4));
+
+	EXPECT_EQ(2u, pollForFrames(reactor, 2));
+	EXPECT_EQ(SUCCESS, first.get());
+	EXPECT_EQ(SUCCESS, second.get());
+	EXPECT_EQ(100, robot_state[0]->get<sensor::DISTANCE>().value);
+}
+
+TEST_F(PseudoTerminals, poll$WHENAQueryResponseIsOverdueTHENTheQueryFails) {
+	const sensor::PacketId parse_key[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+	std::future<ReturnCode> completion;
+	ASSERT_EQ(SUCCESS, reactor.attach(tty[0], *robot_state[0]));
+	ASSERT_EQ(SUCCESS, robot_state[0]->expectQuery(parse_key, &completion));
+
+	reactor.poll(250);
+	ASSERT_EQ(std::future_status::ready, completion.wait_for(std::chrono::seconds(0)));
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, completion.get());
+}
+
+TEST_F(PseudoTerminals, poll$WHENFramesArriveInPiecesTHENTheyAreReassembled) {
+	ASSERT_EQ(SUCCESS, reactor.attach(tty[0], *robot_state[0]));
+	ASSERT_EQ(4, ::write(master_fd[0], FRAME_DISTANCE_100, 4));
+	EXPECT_EQ(0u, reactor.poll(100));
+	EXPECT_TRUE(robot_state[0]->get<sensor::DISTANCE>().dirty);
+
+	ASSERT_EQ(8, ::write(master_fd[0], (FRAME_DISTANCE_100 + 4), 2) + ::write(master_fd[0], FRAME_DISTANCE_MINUS_200, 6));
+	EXPECT_EQ(2u, pollForFrames(reactor, 2));
+	EXPECT_EQ(-200, robot_state[0]->get<sensor::DISTANCE>().value);
+}
+
+TEST_F(PseudoTerminals, poll$WHENATtyIsSilentTHENTheOthersAreServicedWithoutDelay) {
+	for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) { ASSERT_EQ(SUCCESS, reactor.attach(tty[i], *robot_state[i])); }
+	ASSERT_EQ(6, ::write(master_fd[1], FRAME_DISTANCE_100, 6));
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EXPECT_EQ(1u, reactor.poll(1000));
+	EXPECT_GT(500, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+	EXPECT_EQ(100, robot_state[1]->get<sensor::DISTANCE>().value);
+	EXPECT_TRUE(robot_state[0]->get<sensor::DISTANCE>().dirty);
+}
+
+TEST_F(PseudoTerminals, poll$WHENTheDeviceHangsUpTHENTheTtyIsDetached) {
+	ASSERT_EQ(SUCCESS, reactor.attach(tty[0], *robot_state[0]));
+	ASSERT_EQ(SUCCESS, reactor.attach(tty[1], *robot_state[1]));
+	::close(master_fd[0]);
+	master_fd[0] = -1;
+
+	reactor.poll(100);
+	EXPECT_EQ(1u, reactor.attached());
+}
+
+TEST_F(PseudoTerminals, run$WHENStopIsCalledFromAnotherThreadTHENRunReturns) {
+	ASSERT_EQ(SUCCESS, reactor.attach(tty[0], *robot_state[0]));
+	std::thread stopper([this] () {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		::write(master_fd[0], FRAME_DISTANCE_100, 6);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		reactor.stop();
+	});
+
+	EXPECT_EQ(SUCCESS, reactor.run());
+	stopper.join();
+	EXPECT_EQ(100, robot_state[0]->get<sensor::DISTANCE>().value);
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
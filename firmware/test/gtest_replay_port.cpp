@@ -0,0 +1,219 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../replay_port.h"
+#include "../robot.h"
+#include "../telemetry_recorder.h"
+#include "../virtual_roomba.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+/// \brief Append a record to a log under construction
+/// \param [in,out] log_ The bytes of the log
+/// \param [in] type_ The content of the record
+/// \param [in] timestamp_ns_ The time of the record
+/// \param [in] payload_ The payload of the record
+void
+appendRecord (
+	std::vector<uint_opt8_t> & log_,
+	const telemetry::RecordType type_,
+	const int64_t timestamp_ns_,
+	const std::vector<uint_opt8_t> & payload_
+) {
+	telemetry::record_header_t record_header = telemetry::record_header_t();
+	record_header.length = static_cast<uint16_t>(payload_.size());
+	record_header.type = type_;
+	record_header.timestamp_ns = timestamp_ns_;
+	const uint_opt8_t * const header_bytes = reinterpret_cast<const uint_opt8_t *>(&record_header);
+	log_.insert(log_.end(), header_bytes, (header_bytes + sizeof(record_header)));
+	log_.insert(log_.end(), payload_.begin(), payload_.end());
+}
+
+/// \brief Begin a log
+/// \param [in] steady_origin_ns_ The time the log was opened
+/// \return The bytes of the log header
+std::vector<uint_opt8_t>
+beginLog (
+	const int64_t steady_origin_ns_
+) {
+	telemetry::log_header_t log_header = telemetry::log_header_t();
+	memcpy(log_header.magic, telemetry::LOG_MAGIC, sizeof(log_header.magic));
+	log_header.version = telemetry::LOG_VERSION;
+	log_header.record_header_size = sizeof(telemetry::record_header_t);
+	log_header.steady_origin_ns = steady_origin_ns_;
+	const uint_opt8_t * const header_bytes = reinterpret_cast<const uint_opt8_t *>(&log_header);
+	return std::vector<uint_opt8_t>(header_bytes, (header_bytes + sizeof(log_header)));
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class ReplayPort : public ::testing::Test {
+  protected:
+	ReplayPort (
+		void
+	) :
+		capture_path(::testing::TempDir() + "gtest_replay_port.capture"),
+		first_frame{ 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 },
+		second_frame{ 0x13, 0x05, 0x1D, 0x01, 0x19, 0x0D, 0x01, 0xA3 },
+		replay(capture)
+	{}
+
+	virtual void TearDown() {
+		capture.closeCapture();
+		std::remove(capture_path.c_str());
+	}
+
+	/// \brief Write the capture file
+	void
+	writeCapture (
+		const std::vector<uint_opt8_t> & bytes_
+	) {
+		std::FILE * const file = std::fopen(capture_path.c_str(), "wb");
+		ASSERT_NE(nullptr, file);
+		ASSERT_EQ(bytes_.size(), std::fwrite(bytes_.data(), 1, bytes_.size(), file));
+		std::fclose(file);
+	}
+
+	const std::string capture_path;
+	const std::vector<uint_opt8_t> first_frame;
+	const std::vector<uint_opt8_t> second_frame;
+	serial::posix::replay_port capture;
+	state::robot_state replay;
+};
+
+TEST_F(ReplayPort, openCapture$WHENFileIsMissingTHENErrorIsReturned) {
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, capture.openCapture(capture_path.c_str()));
+}
+
+TEST_F(ReplayPort, openCapture$WHENRawCaptureIsPacedByTheWallClockTHENErrorIsReturned) {
+	writeCapture(first_frame);
+	EXPECT_EQ(INVALID_PARAMETER, capture.openCapture(capture_path.c_str(), serial::posix::WALL_CLOCK));
+}
+
+TEST_F(ReplayPort, parseStreamData$WHENRawCaptureIsReplayedTHENEachFrameIsParsed) {
+	std::vector<uint_opt8_t> raw(first_frame);
+	raw.insert(raw.end(), second_frame.begin(), second_frame.end());
+	writeCapture(raw);
+	ASSERT_EQ(SUCCESS, capture.openCapture(capture_path.c_str()));
+
+	ASSERT_EQ(SUCCESS, replay.parseStreamData());
+	EXPECT_EQ(0x0219, replay.get<sensor::CLIFF_FRONT_LEFT_SIGNAL>().value);
+	ASSERT_EQ(SUCCESS, replay.parseStreamData());
+	EXPECT_EQ(0x0119, replay.get<sensor::CLIFF_FRONT_LEFT_SIGNAL>().value);
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, replay.parseStreamData());
+}
+
+TEST_F(ReplayPort, parseStreamData$WHENLogIsReplayedTHENCommandsAreSkipped) {
+	std::vector<uint_opt8_t> log = beginLog(0);
+	appendRecord(log, telemetry::COMMAND, 10, { 128 });
+	appendRecord(log, telemetry::STREAM_FRAME, 20, first_frame);
+	appendRecord(log, telemetry::COMMAND, 30, { 145, 0x00, 0x64, 0x00, 0x64 });
+	appendRecord(log, telemetry::STREAM_FRAME, 40, second_frame);
+	writeCapture(log);
+	ASSERT_EQ(SUCCESS, capture.openCapture(capture_path.c_str()));
+
+	ASSERT_EQ(SUCCESS, replay.parseStreamData());
+	EXPECT_EQ(0x0219, replay.get<sensor::CLIFF_FRONT_LEFT_SIGNAL>().value);
+	ASSERT_EQ(SUCCESS, replay.parseStreamData());
+	EXPECT_EQ(0x0119, replay.get<sensor::CLIFF_FRONT_LEFT_SIGNAL>().value);
+	EXPECT_EQ(0u, replay.getStreamStatistics().bytes_dropped);
+}
+
+TEST_F(ReplayPort, nextSegment$WHENLogIsReplayedTHENEachFrameIsHandedOutInPlace) {
+	const uint_opt8_t * data;
+	size_t data_length, bytes_consumed;
+	std::vector<uint_opt8_t> log = beginLog(0);
+	appendRecord(log, telemetry::STREAM_FRAME, 20, first_frame);
+	appendRecord(log, telemetry::STREAM_FRAME, 40, second_frame);
+	writeCapture(log);
+	ASSERT_EQ(SUCCESS, capture.openCapture(capture_path.c_str()));
+
+	ASSERT_EQ(SUCCESS, capture.nextSegment(&data, &data_length));
+	ASSERT_EQ(first_frame.size(), data_length);
+	ASSERT_EQ(SUCCESS, replay.parseStreamBuffer(data, data_length, &bytes_consumed));
+	ASSERT_EQ(SUCCESS, capture.nextSegment(&data, &data_length));
+	ASSERT_EQ(SUCCESS, replay.parseStreamBuffer(data, data_length, &bytes_consumed));
+	EXPECT_EQ(0x0119, replay.get<sensor::CLIFF_FRONT_LEFT_SIGNAL>().value);
+	EXPECT_EQ(NO_DATA_AVAILABLE, capture.nextSegment(&data, &data_length));
+
+	capture.rewind();
+	ASSERT_EQ(SUCCESS, capture.nextSegment(&data, &data_length));
+	EXPECT_EQ(0, memcmp(first_frame.data(), data, data_length));
+}
+
+TEST_F(ReplayPort, nextSegment$WHENLastRecordIsCutShortTHENReplayEndsBeforeIt) {
+	const uint_opt8_t * data;
+	size_t data_length;
+	std::vector<uint_opt8_t> log = beginLog(0);
+	appendRecord(log, telemetry::STREAM_FRAME, 20, first_frame);
+	appendRecord(log, telemetry::STREAM_FRAME, 40, second_frame);
+	log.resize(log.size() - 3);
+	writeCapture(log);
+	ASSERT_EQ(SUCCESS, capture.openCapture(capture_path.c_str()));
+
+	ASSERT_EQ(SUCCESS, capture.nextSegment(&data, &data_length));
+	EXPECT_EQ(NO_DATA_AVAILABLE, capture.nextSegment(&data, &data_length));
+}
+
+TEST_F(ReplayPort, nextSegment$WHENPacedByTheWallClockTHENFramesArriveAtTheirRecordedTimes) {
+	const uint_opt8_t * data;
+	size_t data_length;
+	const int64_t origin_ns = 5000000000;
+	std::vector<uint_opt8_t> log = beginLog(origin_ns);
+	appendRecord(log, telemetry::STREAM_FRAME, origin_ns, first_frame);
+	appendRecord(log, telemetry::STREAM_FRAME, (origin_ns + 60000000), second_frame);
+	writeCapture(log);
+	ASSERT_EQ(SUCCESS, capture.openCapture(capture_path.c_str(), serial::posix::WALL_CLOCK));
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	ASSERT_EQ(SUCCESS, capture.nextSegment(&data, &data_length));
+	EXPECT_GT(std::chrono::milliseconds(60), (std::chrono::steady_clock::now() - start));
+	ASSERT_EQ(SUCCESS, capture.nextSegment(&data, &data_length));
+	EXPECT_LE(std::chrono::milliseconds(60), (std::chrono::steady_clock::now() - start));
+}
+
+TEST_F(ReplayPort, parseStreamData$WHENRecordingIsReplayedTHENTheSameFramesAreParsed) {
+	const sensor::PacketId stream_key[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+	serial::virtual_roomba roomba_port;
+	robot<OI500> roomba(roomba_port);
+	telemetry::telemetry_recorder recorder;
+	ASSERT_EQ(SUCCESS, recorder.open(capture_path.c_str()));
+	ASSERT_EQ(SUCCESS, roomba.getState().setStreamKey(stream_key));
+	ASSERT_EQ(SUCCESS, roomba.getState().setTelemetryRecorder(&recorder));
+	roomba.start();
+	roomba.safe();
+	roomba.driveDirect(200, 200);
+	roomba.stream((stream_key + 1), 1);
+	std::vector<int16_t> distances;
+	for ( size_t i = 0 ; i < 4 ; ++i ) {
+		ASSERT_EQ(SUCCESS, roomba.getState().parseStreamData());
+		distances.push_back(roomba.getState().get<sensor::DISTANCE>().value);
+	}
+	ASSERT_EQ(SUCCESS, roomba.getState().setTelemetryRecorder(nullptr));
+	recorder.close();
+
+	ASSERT_EQ(SUCCESS, capture.openCapture(capture_path.c_str()));
+	ASSERT_EQ(SUCCESS, replay.setStreamKey(stream_key));
+	for ( size_t i = 0 ; i < distances.size() ; ++i ) {
+		ASSERT_EQ(SUCCESS, replay.parseStreamData());
+		EXPECT_EQ(distances[i], replay.get<sensor::DISTANCE>().value);
+	}
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, replay.parseStreamData());
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
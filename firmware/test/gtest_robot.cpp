@@ -0,0 +1,250 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../robot.h"
+#include "TEST_port.h"
+
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+using serial::testing::TestPort;
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class TwoRobots : public ::testing::Test {
+  protected:
+	TwoRobots (
+		void
+	) :
+		left(left_port),
+		right(right_port)
+	{}
+
+	TestPort left_port;
+	TestPort right_port;
+	robot<OI500> left;
+	robot<OI500> right;
+};
+
+TEST_F(TwoRobots, constructor$WHENBoundToAPortTHENStateIsBoundToThePort) {
+	EXPECT_EQ(&left_port, &left.getState().getSerialPort());
+	EXPECT_EQ(&right_port, &right.getState().getSerialPort());
+}
+
+TEST_F(TwoRobots, constructor$WHENBoundToAnExistingStateTHENStateIsShared) {
+	robot<OI500> shared(left.getState());
+	EXPECT_EQ(&left.getState(), &shared.getState());
+	EXPECT_EQ(SUCCESS, shared.start());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128 }), left_port.tx);
+}
+
+TEST_F(TwoRobots, start$WHENCalledTHENOnlyItsPortIsWritten) {
+	EXPECT_EQ(SUCCESS, left.start());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128 }), left_port.tx);
+	EXPECT_TRUE(right_port.tx.empty());
+}
+
+TEST_F(TwoRobots, safe$WHENCalledTHENOnlyItsModeIsUpdated) {
+	EXPECT_EQ(SUCCESS, left.start());
+	EXPECT_EQ(SUCCESS, right.start());
+	EXPECT_EQ(SUCCESS, right.safe());
+	EXPECT_EQ(PASSIVE, left.getState().getOIMode());
+	EXPECT_EQ(SAFE, right.getState().getOIMode());
+}
+
+TEST_F(TwoRobots, drive$WHENCalledOnEachRobotTHENEachPortReceivesItsOwnCommand) {
+	EXPECT_EQ(SUCCESS, left.drive(-200, 500));
+	EXPECT_EQ(SUCCESS, right.driveDirect(100, -100));
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 137, 0xFF, 0x38, 0x01, 0xF4 }), left_port.tx);
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 145, 0xFF, 0x9C, 0x00, 0x64 }), right_port.tx);
+}
+
+TEST_F(TwoRobots, baud$WHENCalledTHENOnlyItsPortIsReconfigured) {
+	EXPECT_EQ(SUCCESS, left.baud(BAUD_57600));
+	EXPECT_EQ(BAUD_57600, left_port.baud_code);
+	EXPECT_EQ(static_cast<BaudCode>(-1), right_port.baud_code);
+}
+
+TEST_F(TwoRobots, baud$WHENBatchedTHENTheOpcodeIsWrittenBeforeTheRateChanges) {
+	EXPECT_EQ(SUCCESS, left.beginBatch());
+	EXPECT_EQ(SUCCESS, left.start());
+	EXPECT_EQ(SUCCESS, left.baud(BAUD_57600));
+	EXPECT_EQ(BAUD_57600, left_port.baud_code);
+	EXPECT_EQ(3u, left_port.tx_at_baud_change);
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128, 129, BAUD_57600 }), left_port.tx);
+
+	EXPECT_EQ(SUCCESS, left.safe());
+	EXPECT_EQ(SUCCESS, left.endBatch());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128, 129, BAUD_57600, 131 }), left_port.tx);
+}
+
+TEST_F(TwoRobots, endBatch$WHENCommandsAreBatchedTHENTheyAreWrittenOnce) {
+	EXPECT_EQ(SUCCESS, left.beginBatch());
+	EXPECT_EQ(SUCCESS, left.start());
+	EXPECT_EQ(SUCCESS, left.safe());
+	EXPECT_EQ(SUCCESS, left.drive(-200, 500));
+	EXPECT_TRUE(left_port.tx.empty());
+	EXPECT_EQ(SAFE, left.getState().getOIMode());
+
+	EXPECT_EQ(SUCCESS, left.endBatch());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128, 131, 137, 0xFF, 0x38, 0x01, 0xF4 }), left_port.tx);
+	EXPECT_EQ(1u, left_port.write_count);
+}
+
+TEST_F(TwoRobots, endBatch$WHENBatchEndsTHENCommandsAreWrittenImmediately) {
+	EXPECT_EQ(SUCCESS, left.beginBatch());
+	EXPECT_EQ(SUCCESS, left.endBatch());
+	EXPECT_EQ(SUCCESS, left.start());
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128 }), left_port.tx);
+}
+
+TEST_F(TwoRobots, drive$WHENBatchedWithAnInvalidParameterTHENNothingIsAppended) {
+	EXPECT_EQ(SUCCESS, left.beginBatch());
+	EXPECT_EQ(INVALID_PARAMETER, left.drive(-501, 500));
+	EXPECT_EQ(SUCCESS, left.endBatch());
+	EXPECT_TRUE(left_port.tx.empty());
+	EXPECT_EQ(0u, left_port.write_count);
+}
+
+TEST_F(TwoRobots, beginBatch$WHENTheBatchOverflowsTHENCommandsAreWrittenInOrder) {
+	EXPECT_EQ(SUCCESS, left.beginBatch());
+	for ( int_opt16_t velocity = 0 ; velocity < 60 ; ++velocity ) { ASSERT_EQ(SUCCESS, left.driveDirect(velocity, 0)); }
+	EXPECT_EQ(SUCCESS, left.endBatch());
+
+	ASSERT_EQ(300u, left_port.tx.size());
+	EXPECT_EQ(2u, left_port.write_count);
+	for ( size_t i = 0 ; i < 60 ; ++i ) { EXPECT_EQ(i, left_port.tx[((i * 5) + 4)]); }
+}
+
+TEST_F(TwoRobots, queryListAsync$WHENQueriesArePipelinedTHENRequestsAreWrittenBackToBack) {
+	const sensor::PacketId sensor_list[2] = { sensor::ANGLE, sensor::VOLTAGE };
+	std::future<ReturnCode> first, second;
+	EXPECT_EQ(SUCCESS, left.sensorsAsync(sensor::DISTANCE, &first));
+	EXPECT_EQ(SUCCESS, left.queryListAsync(sensor_list, 2, &second));
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 142, 19, 149, 2, 20, 22 }), left_port.tx);
+	EXPECT_EQ(2u, left.getState().pendingQueries());
+}
+
+TEST_F(TwoRobots, serviceQueries$WHENResponsesArriveTHENEachFutureCompletesInOrder) {
+	const sensor::PacketId sensor_list[2] = { sensor::ANGLE, sensor::VOLTAGE };
+	std::future<ReturnCode> first, second;
+	ASSERT_EQ(SUCCESS, left.sensorsAsync(sensor::DISTANCE, &first));
+	ASSERT_EQ(SUCCESS, left.queryListAsync(sensor_list, 2, &second));
+	left_port.rx = { 0xFF, 0x38, 0x00, 0x5A, 0x3A, 0x98 };
+
+	EXPECT_EQ(SUCCESS, left.getState().serviceQueries());
+	EXPECT_EQ(SUCCESS, first.get());
+	EXPECT_EQ(SUCCESS, second.get());
+	EXPECT_EQ(-200, left.getState().get<sensor::DISTANCE>().value);
+	EXPECT_EQ(90, left.getState().get<sensor::ANGLE>().value);
+	EXPECT_EQ(15000, left.getState().get<sensor::VOLTAGE>().value);
+	EXPECT_FALSE(left.getState().get<sensor::VOLTAGE>().dirty);
+	EXPECT_EQ(0u, left.getState().pendingQueries());
+}
+
+TEST_F(TwoRobots, parseQueryBuffer$WHENTheResponseArrivesInSlicesTHENTheQueryCompletesWithTheLastByte) {
+	const uint_opt8_t response[2] = { 0xFF, 0x38 };
+	std::future<ReturnCode> completion;
+	size_t bytes_consumed;
+	ASSERT_EQ(SUCCESS, left.sensorsAsync(sensor::DISTANCE, &completion));
+
+	EXPECT_EQ(NO_DATA_AVAILABLE, left.getState().parseQueryBuffer(response, 1, &bytes_consumed));
+	EXPECT_EQ(1u, bytes_consumed);
+	EXPECT_EQ(std::future_status::timeout, completion.wait_for(std::chrono::seconds(0)));
+	EXPECT_EQ(SUCCESS, left.getState().parseQueryBuffer((response + 1), 1, &bytes_consumed));
+	EXPECT_EQ(SUCCESS, completion.get());
+	EXPECT_EQ(-200, left.getState().get<sensor::DISTANCE>().value);
+}
+
+TEST_F(TwoRobots, serviceQueries$WHENAResponseIsMissingTHENThePendingQueriesFail) {
+	std::future<ReturnCode> first, second;
+	ASSERT_EQ(SUCCESS, left.sensorsAsync(sensor::DISTANCE, &first));
+	ASSERT_EQ(SUCCESS, left.sensorsAsync(sensor::ANGLE, &second));
+
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, left.getState().serviceQueries());
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, first.get());
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, second.get());
+	EXPECT_EQ(0u, left.getState().pendingQueries());
+}
+
+TEST_F(TwoRobots, queryListAsync$WHENThePipelineIsFullTHENNoDataIsAvailable) {
+	std::future<ReturnCode> completion[state::robot_state::QUERY_PIPELINE_DEPTH + 1];
+	for ( size_t i = 0 ; i < state::robot_state::QUERY_PIPELINE_DEPTH ; ++i ) { ASSERT_EQ(SUCCESS, left.sensorsAsync(sensor::DISTANCE, &completion[i])); }
+	EXPECT_EQ(NO_DATA_AVAILABLE, left.sensorsAsync(sensor::DISTANCE, &completion[state::robot_state::QUERY_PIPELINE_DEPTH]));
+	EXPECT_EQ((2u * state::robot_state::QUERY_PIPELINE_DEPTH), left_port.tx.size());
+}
+
+TEST_F(TwoRobots, queryListAsync$WHENAPacketIdIsUndefinedTHENParameterIsInvalid) {
+	const sensor::PacketId sensor_list[2] = { sensor::DISTANCE, static_cast<sensor::PacketId>(75) };
+	std::future<ReturnCode> completion;
+	EXPECT_EQ(INVALID_PARAMETER, left.queryListAsync(sensor_list, 2, &completion));
+	EXPECT_EQ(INVALID_PARAMETER, left.queryListAsync(sensor_list, 1, nullptr));
+	EXPECT_TRUE(left_port.tx.empty());
+	EXPECT_EQ(0u, left.getState().pendingQueries());
+}
+
+TEST_F(TwoRobots, parseStreamData$WHENEachRobotStreamsTHENEachStateHoldsItsOwnData) {
+	const sensor::PacketId sensor_list[1] = { sensor::DISTANCE };
+	EXPECT_EQ(SUCCESS, left.stream(sensor_list, 1));
+	EXPECT_EQ(SUCCESS, right.stream(sensor_list, 1));
+	left_port.rx = { 19, 3, 19, 0xFF, 0x38, 0xA0 };
+	right_port.rx = { 19, 3, 19, 0x00, 0x64, 0x73 };
+
+	EXPECT_EQ(SUCCESS, left.getState().parseStreamData());
+	EXPECT_EQ(SUCCESS, right.getState().parseStreamData());
+	EXPECT_EQ(-200, left.getState().get<sensor::DISTANCE>().value);
+	EXPECT_EQ(100, right.getState().get<sensor::DISTANCE>().value);
+	EXPECT_FALSE(left.getState().get<sensor::DISTANCE>().dirty);
+}
+
+TEST_F(TwoRobots, parseStreamData$WHENARobotStreamsTHENPlatformStateIsUnaffected) {
+	const sensor::PacketId sensor_list[1] = { sensor::DISTANCE };
+	const uint_opt64_t platform_flag_mask_dirty = state::getFlagMaskDirty();
+	EXPECT_EQ(SUCCESS, left.stream(sensor_list, 1));
+	left_port.rx = { 19, 3, 19, 0xFF, 0x38, 0xA0 };
+
+	EXPECT_EQ(SUCCESS, left.getState().parseStreamData());
+	EXPECT_EQ(platform_flag_mask_dirty, state::getFlagMaskDirty());
+}
+
+TEST_F(TwoRobots, parseStreamBuffer$WHENRobotsAreServicedConcurrentlyTHENEachStateIsConsistent) {
+	const sensor::PacketId sensor_list[1] = { sensor::DISTANCE };
+	const uint_opt8_t left_frame[6] = { 19, 3, 19, 0xFF, 0x38, 0xA0 };
+	const uint_opt8_t right_frame[6] = { 19, 3, 19, 0x00, 0x64, 0x73 };
+	const size_t frame_count = 1000;
+	EXPECT_EQ(SUCCESS, left.stream(sensor_list, 1));
+	EXPECT_EQ(SUCCESS, right.stream(sensor_list, 1));
+
+	auto service = [frame_count] (robot<OI500> & robot_, const uint_opt8_t * frame_, size_t * frames_parsed_) {
+		for ( size_t i = 0 ; i < frame_count ; ++i ) {
+			size_t bytes_consumed;
+			if ( SUCCESS == robot_.getState().parseStreamBuffer(frame_, 6, &bytes_consumed) ) { ++(*frames_parsed_); }
+		}
+	};
+	size_t left_frames_parsed(0), right_frames_parsed(0);
+	std::thread left_thread(service, std::ref(left), left_frame, &left_frames_parsed);
+	std::thread right_thread(service, std::ref(right), right_frame, &right_frames_parsed);
+	left_thread.join();
+	right_thread.join();
+
+	EXPECT_EQ(frame_count, left_frames_parsed);
+	EXPECT_EQ(frame_count, right_frames_parsed);
+	EXPECT_EQ(0u, left.getState().getStreamStatistics().frames_dropped);
+	EXPECT_EQ(-200, left.getState().get<sensor::DISTANCE>().value);
+	EXPECT_EQ(100, right.getState().get<sensor::DISTANCE>().value);
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
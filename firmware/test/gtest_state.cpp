@@ -5,6 +5,14 @@
 #include "TEST_state.h"
 #include "MOCK_serial.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <type_traits>
+#include <thread>
+#include <vector>
+
 //TODO: Guarantee queryList() calculates the time required to retrieve the amount of data it is requesting (via setParseKey())
 //TODO: Guarantee the stream is paused when queryList() is called
 //TODO: See what happens when a request goes out while streaming data is being returned - expecting nothing, as serial is asynchronous
@@ -12,8 +20,6 @@
 //TODO: Ensure _parse_key is not updated on fail cases
 //TODO: Serial read next available time, needs to be incorporated into the framework
 
-//TODO: Design new thread function used to wait for available data
-//TODO: Determine appropriate mutexing of shared data
 //TODO: Design a state machine to test and track _oi_mode
 
 //TODO: Consider the dirty mask - should it only be corrupt data or should it include stale data - if only corrupt, then refactor name
@@ -128,7 +134,7 @@ class StreamData : public ::testing::Test {
 	StreamData (
 		void
 	) :
-		serial_stream{ 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xB6 }
+		serial_stream{ 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 }
 	{
 		state::testing::setInternalsToInitialState();
 	}
@@ -182,7 +188,7 @@ class StreamData$ByteCountError : public ::testing::Test {
 	StreamData$ByteCountError (
 		void
 	) :
-		serial_stream{ 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xB6 },
+		serial_stream{ 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 },
 		call_count(0),
 		fail_on_call(1)
 	{
@@ -241,7 +247,7 @@ class StreamData$OutOfSync : public ::testing::Test {
 	StreamData$OutOfSync (
 		void
 	) :
-		serial_stream{ 0x19, 0x0D, 0x00, 0xB6, 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xB6, 0x13, 0x05, 0x1D }
+		serial_stream{ 0x19, 0x0D, 0x00, 0xA3, 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3, 0x13, 0x05, 0x1D }
 	{
 		state::testing::setInternalsToInitialState();
 	}
@@ -263,6 +269,65 @@ class StreamData$OutOfSync : public ::testing::Test {
 	uint_opt8_t serial_stream[15];
 };
 
+class StreamData$Resynchronization : public ::testing::Test {
+  protected:
+	StreamData$Resynchronization (
+		void
+	) :
+		stream_key{ sizeof(stream_key), sensor::CLIFF_FRONT_LEFT_SIGNAL, sensor::VIRTUAL_WALL },
+		read_index(0)
+	{
+		state::testing::setInternalsToInitialState();
+	}
+	
+	//virtual ~StreamData$Resynchronization() {}
+	virtual void SetUp() {
+		serial::mock::setSerialReadFunc(
+			[&] (uint_opt8_t * const buffer_, const size_t buffer_length_) {
+				const size_t bytes_available = std::min(buffer_length_, (serial_stream.size() - read_index));
+				memcpy(buffer_, (serial_stream.data() + read_index), bytes_available);
+				read_index += bytes_available;
+				return bytes_available;
+			}
+		);
+	}
+	//virtual void TearDown() {}
+	
+	const uint_opt8_t stream_key[3];
+	std::vector<uint_opt8_t> serial_stream;
+	size_t read_index;
+};
+
+class StreamData$Reader : public ::testing::Test {
+  protected:
+	StreamData$Reader (
+		void
+	) :
+		serial_stream{ 0x13, 0x05, 0x1D, 0x01, 0x01, 0x0D, 0x01, 0xBB, 0x13, 0x05, 0x1D, 0x02, 0x02, 0x0D, 0x02, 0xB8 },
+		read_index(0)
+	{
+		state::testing::setInternalsToInitialState();
+	}
+	
+	//virtual ~StreamData$Reader() {}
+	virtual void SetUp() {
+		serial::mock::setSerialReadFunc(
+			[&] (uint_opt8_t * const buffer_, const size_t buffer_length_) {
+				for ( size_t i = 0 ; i < buffer_length_ ; ++i, read_index = ((read_index + 1) % sizeof(serial_stream)) ) {
+					buffer_[i] = serial_stream[read_index];
+				}
+				return buffer_length_;
+			}
+		);
+	}
+	virtual void TearDown() {
+		state::stopStreamReader();
+	}
+	
+	const uint_opt8_t serial_stream[16];
+	size_t read_index;
+};
+
 /*
 The first argument is the name of the test case (or fixture), and the
 second argument is the test's name within the test case. Both names must
@@ -413,6 +478,12 @@ TEST_F(QueryData, parseQueryData$WHENCalledTHENTheDirtyFlagIsUnset) {
 	EXPECT_FALSE((flag_mask_dirty >> 13 ) & 0x01 );
 }
 
+TEST_F(QueryData$ByteCountError, parseQueryData$WHENCalledTHENResponseIsReadInASingleTransfer) {
+	fail_on_call = 0;
+	ASSERT_EQ(SUCCESS, state::parseQueryData());
+	EXPECT_EQ(1, call_count);
+}
+
 TEST_F(QueryData$ByteCountError, parseQueryData$WHENBytesReadDoNotMatchBytesRequestedTHENErrorIsReturned) {
 	ASSERT_EQ(SERIAL_TRANSFER_FAILURE, state::parseQueryData());
 }
@@ -429,10 +500,306 @@ TEST_F(QueryData$ByteCountError, parseQueryData$WHENBytesReadDoNotMatchBytesRequ
 	EXPECT_TRUE((flag_mask_dirty >> 29 ) & 0x01 );
 }
 
-TEST_F(StreamData$OutOfSync, parseStreamData$WHENFirstValueIsNot19THENFailureToSyncErrorIsReturned) {
+TEST_F(StreamData$OutOfSync, parseStreamData$WHENFirstValueIsNot19THENStreamIsResynchronized) {
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	const uint_opt16_t expected_cliff_front_left_signal = 0x0219;
+	const uint_opt16_t actual_cliff_front_left_signal = convertTwoByteIntegerFromBigToLittleEndian(*reinterpret_cast<uint_opt16_t *>(state::testing::getRawData() + 30));
+	EXPECT_EQ(expected_cliff_front_left_signal, actual_cliff_front_left_signal);
+}
+
+TEST_F(StreamData$OutOfSync, parseStreamData$WHENFirstValueIsNot19THENSkippedBytesAreCounted) {
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(4, state::getStreamStatistics().bytes_dropped);
+	EXPECT_EQ(0, state::getStreamStatistics().frames_dropped);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamData$WHENNoHeaderIsFoundTHENFailureToSyncErrorIsReturned) {
+	serial_stream.assign(600, 0x00);
 	ASSERT_EQ(FAILURE_TO_SYNC, state::parseStreamData());
 }
 
+TEST_F(StreamData$Resynchronization, parseStreamData$WHENChecksumFailsTHENNextFrameIsParsed) {
+	serial_stream = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xBE, 0x13, 0x05, 0x1D, 0x01, 0x19, 0x0D, 0x01, 0xA3 };
+	ASSERT_EQ(INVALID_CHECKSUM, state::parseStreamData());
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(0x01, state::testing::getRawData()[30]);
+	EXPECT_EQ(0x01, state::testing::getRawData()[6]);
+	EXPECT_EQ(1, state::getStreamStatistics().frames_dropped);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamData$WHENChecksumFailsTHENNothingIsCommitted) {
+	serial_stream = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x07, 0xBE };
+	state::testing::getRawData()[6] = 0x00;
+	ASSERT_EQ(INVALID_CHECKSUM, state::parseStreamData());
+	EXPECT_EQ(0x00, state::testing::getRawData()[6]);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamData$WHENByteIsDroppedTHENStreamRecoversWithinOneFrame) {
+	// The first frame lost its value byte 0x19, so its checksum lands on the next header
+	serial_stream = { 0x13, 0x05, 0x1D, 0x02, 0x0D, 0x00, 0xA3, 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 };
+	ASSERT_EQ(SUCCESS, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+	ReturnCode rc = state::parseStreamData();
+	if ( SUCCESS != rc ) { rc = state::parseStreamData(); }
+	ASSERT_EQ(SUCCESS, rc);
+	EXPECT_EQ(0x02, state::testing::getRawData()[30]);
+	EXPECT_EQ(0x19, state::testing::getRawData()[31]);
+	EXPECT_EQ(1, state::getStreamStatistics().frames_dropped);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamData$WHENLengthDoesNotMatchStreamKeyTHENFalseHeaderIsSkipped) {
+	serial_stream = { 0x13, 0x07, 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 };
+	ASSERT_EQ(SUCCESS, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(1, state::getStreamStatistics().frames_dropped);
+	EXPECT_EQ(2, state::getStreamStatistics().bytes_dropped);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamData$WHENPacketIdDoesNotMatchStreamKeyTHENFalseHeaderIsSkipped) {
+	serial_stream = { 0x13, 0x05, 0x07, 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 };
+	ASSERT_EQ(SUCCESS, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(1, state::getStreamStatistics().frames_dropped);
+	EXPECT_EQ(3, state::getStreamStatistics().bytes_dropped);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamData$WHENFramesAreConsecutiveTHENEachCallCommitsOneFrame) {
+	serial_stream = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3, 0x13, 0x05, 0x1D, 0x01, 0x19, 0x0D, 0x01, 0xA3 };
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(0x02, state::testing::getRawData()[30]);
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(0x01, state::testing::getRawData()[30]);
+	EXPECT_EQ(0, state::getStreamStatistics().bytes_dropped);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamBuffer$WHENFrameArrivesInSlicesTHENFrameIsCommittedOnLastSlice) {
+	const uint_opt8_t frame[8] = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 };
+	size_t bytes_consumed;
+	ASSERT_EQ(NO_DATA_AVAILABLE, state::parseStreamBuffer(frame, 3, &bytes_consumed));
+	EXPECT_EQ(3, bytes_consumed);
+	ASSERT_EQ(SUCCESS, state::parseStreamBuffer((frame + 3), 5, &bytes_consumed));
+	EXPECT_EQ(5, bytes_consumed);
+	EXPECT_EQ(0x19, state::testing::getRawData()[31]);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamBuffer$WHENFrameIsCommittedTHENRemainingBytesAreNotConsumed) {
+	const uint_opt8_t frames[10] = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3, 0x13, 0x05 };
+	size_t bytes_consumed;
+	ASSERT_EQ(SUCCESS, state::parseStreamBuffer(frames, sizeof(frames), &bytes_consumed));
+	EXPECT_EQ(8, bytes_consumed);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamBuffer$WHENCalledWithNULLTHENErrorIsReturned) {
+	size_t bytes_consumed;
+	const uint_opt8_t frame[1] = { 0x13 };
+	EXPECT_EQ(INVALID_PARAMETER, state::parseStreamBuffer(NULL, 0, &bytes_consumed));
+	EXPECT_EQ(INVALID_PARAMETER, state::parseStreamBuffer(frame, sizeof(frame), NULL));
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamFrames$WHENFramesAreBufferedTHENOnlyValidFramesAreCommitted) {
+	const uint_opt8_t frames[27] = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3, 0x13, 0x05, 0x1D, 0x02, 0x18, 0x0D, 0x00, 0xA3, 0x13, 0x05, 0x1D, 0x01, 0x19, 0x0D, 0x01, 0xA3, 0x13, 0x05, 0x1D };
+	state::parse_metrics_t metrics;
+	size_t bytes_consumed;
+	ASSERT_EQ(SUCCESS, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+	ASSERT_EQ(SUCCESS, state::parseStreamFrames(frames, sizeof(frames), &bytes_consumed));
+	EXPECT_EQ(24, bytes_consumed);
+	EXPECT_EQ(0x01, state::testing::getRawData()[30]);
+	ASSERT_EQ(SUCCESS, state::getParseMetrics(&metrics));
+	EXPECT_EQ(2, metrics.frames_parsed);
+	EXPECT_EQ(1, metrics.checksum_failures);
+	EXPECT_EQ(8, metrics.bytes_discarded);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamFrames$WHENEveryFrameIsCorruptTHENChecksumErrorIsReturned) {
+	const uint_opt8_t frame[8] = { 0x13, 0x05, 0x1D, 0x02, 0x18, 0x0D, 0x00, 0xA3 };
+	size_t bytes_consumed;
+	state::testing::getRawData()[31] = 0x00;
+	ASSERT_EQ(INVALID_CHECKSUM, state::parseStreamFrames(frame, sizeof(frame), &bytes_consumed));
+	EXPECT_EQ(8, bytes_consumed);
+	EXPECT_EQ(0x00, state::testing::getRawData()[31]);
+}
+
+TEST_F(StreamData$Resynchronization, parseStreamFrames$WHENParserHoldsAPartialFrameTHENErrorIsReturned) {
+	const uint_opt8_t frame[8] = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 };
+	size_t bytes_consumed;
+	ASSERT_EQ(NO_DATA_AVAILABLE, state::parseStreamBuffer(frame, 3, &bytes_consumed));
+	EXPECT_EQ(INVALID_MODE_FOR_REQUESTED_OPERATION, state::parseStreamFrames(frame, sizeof(frame), &bytes_consumed));
+	EXPECT_EQ(0, bytes_consumed);
+}
+
+TEST_F(InitialState, getSensorSnapshot$WHENNoFrameHasBeenParsedTHENNoDataIsAvailable) {
+	state::sensor_snapshot_t snapshot;
+	ASSERT_EQ(NO_DATA_AVAILABLE, state::getSensorSnapshot(&snapshot));
+}
+
+TEST_F(InitialState, getSensorSnapshot$WHENCalledWithNULLTHENErrorIsReturned) {
+	ASSERT_EQ(INVALID_PARAMETER, state::getSensorSnapshot(NULL));
+}
+
+TEST_F(StreamData, getSensorSnapshot$WHENFrameIsParsedTHENFrameIsPublished) {
+	state::sensor_snapshot_t snapshot;
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	ASSERT_EQ(SUCCESS, state::getSensorSnapshot(&snapshot));
+	EXPECT_EQ(1, snapshot.frame_count);
+	EXPECT_EQ(0x0219, convertTwoByteIntegerFromBigToLittleEndian(snapshot.sensor_data.cliff_front_left_signal));
+	EXPECT_FALSE((snapshot.flag_mask_dirty >> 29) & 0x01);
+}
+
+TEST_F(QueryData, getSensorSnapshot$WHENQueryIsParsedTHENResponseIsPublished) {
+	state::sensor_snapshot_t snapshot;
+	ASSERT_EQ(SUCCESS, state::parseQueryData());
+	ASSERT_EQ(SUCCESS, state::getSensorSnapshot(&snapshot));
+	EXPECT_EQ(0x0219, convertTwoByteIntegerFromBigToLittleEndian(snapshot.sensor_data.cliff_front_left_signal));
+}
+
+TEST_F(InitialState, getParseMetrics$WHENCalledWithNULLTHENErrorIsReturned) {
+	ASSERT_EQ(INVALID_PARAMETER, state::getParseMetrics(NULL));
+}
+
+TEST_F(StreamData, getParseMetrics$WHENFrameIsParsedTHENFrameAndPacketsAreCounted) {
+	state::parse_metrics_t metrics;
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	ASSERT_EQ(SUCCESS, state::getParseMetrics(&metrics));
+	EXPECT_EQ(1, metrics.frames_parsed);
+	EXPECT_EQ(0, metrics.queries_parsed);
+	EXPECT_EQ(1, metrics.packet_updates[sensor::CLIFF_FRONT_LEFT_SIGNAL]);
+	EXPECT_EQ(1, metrics.packet_updates[sensor::VIRTUAL_WALL]);
+	EXPECT_EQ(0, metrics.packet_updates[sensor::DISTANCE]);
+	EXPECT_GT(std::chrono::steady_clock::duration::max(), metrics.packet_age[sensor::CLIFF_FRONT_LEFT_SIGNAL]);
+	EXPECT_EQ(std::chrono::steady_clock::duration::max(), metrics.packet_age[sensor::DISTANCE]);
+	EXPECT_EQ(SUCCESS, state::getParseError());
+}
+
+TEST_F(QueryData, getParseMetrics$WHENQueryIsParsedTHENResponseAndPacketsAreCounted) {
+	state::parse_metrics_t metrics;
+	ASSERT_EQ(SUCCESS, state::parseQueryData());
+	ASSERT_EQ(SUCCESS, state::getParseMetrics(&metrics));
+	EXPECT_EQ(0, metrics.frames_parsed);
+	EXPECT_EQ(1, metrics.queries_parsed);
+	EXPECT_EQ(1, metrics.packet_updates[sensor::CLIFF_FRONT_LEFT_SIGNAL]);
+	EXPECT_EQ(1, metrics.packet_updates[sensor::VIRTUAL_WALL]);
+}
+
+TEST_F(StreamData$Resynchronization, getParseMetrics$WHENChecksumFailsTHENChecksumFailureIsCounted) {
+	state::parse_metrics_t metrics;
+	serial_stream = { 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xBE, 0x13, 0x05, 0x1D, 0x01, 0x19, 0x0D, 0x01, 0xA3 };
+	ASSERT_EQ(INVALID_CHECKSUM, state::parseStreamData());
+	EXPECT_EQ(INVALID_CHECKSUM, state::getParseError());
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(SUCCESS, state::getParseError());
+	ASSERT_EQ(SUCCESS, state::getParseMetrics(&metrics));
+	EXPECT_EQ(1, metrics.checksum_failures);
+	EXPECT_EQ(0, metrics.sync_losses);
+	EXPECT_EQ(1, metrics.frames_parsed);
+}
+
+TEST_F(StreamData$Resynchronization, getParseMetrics$WHENFalseHeaderIsSkippedTHENSyncLossAndDiscardedBytesAreCounted) {
+	state::parse_metrics_t metrics;
+	serial_stream = { 0x13, 0x07, 0x13, 0x05, 0x1D, 0x02, 0x19, 0x0D, 0x00, 0xA3 };
+	ASSERT_EQ(SUCCESS, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	ASSERT_EQ(SUCCESS, state::getParseMetrics(&metrics));
+	EXPECT_EQ(0, metrics.checksum_failures);
+	EXPECT_EQ(1, metrics.sync_losses);
+	EXPECT_EQ(2, metrics.bytes_discarded);
+}
+
+TEST_F(StreamData$ByteCountError, getParseMetrics$WHENBytesReadDoNotMatchBytesRequestedTHENShortReadIsCounted) {
+	state::parse_metrics_t metrics;
+	ASSERT_EQ(SERIAL_TRANSFER_FAILURE, state::parseStreamData());
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, state::getParseError());
+	ASSERT_EQ(SUCCESS, state::getParseMetrics(&metrics));
+	EXPECT_EQ(1, metrics.short_reads);
+	EXPECT_EQ(0, metrics.frames_parsed);
+}
+
+TEST_F(StreamData$Reader, startStreamReader$WHENStartedTHENFramesArePublished) {
+	state::sensor_snapshot_t snapshot = state::sensor_snapshot_t();
+	ASSERT_EQ(SUCCESS, state::startStreamReader());
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + std::chrono::seconds(5));
+	while ( snapshot.frame_count < 100 && std::chrono::steady_clock::now() < deadline ) {
+		state::getSensorSnapshot(&snapshot);
+	}
+	ASSERT_EQ(SUCCESS, state::stopStreamReader());
+	EXPECT_LE(100, snapshot.frame_count);
+}
+
+TEST_F(StreamData$Reader, getSensorSnapshot$WHENReaderIsPublishingTHENSnapshotsAreNeverTorn) {
+	state::sensor_snapshot_t snapshot = state::sensor_snapshot_t();
+	ASSERT_EQ(SUCCESS, state::startStreamReader());
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + std::chrono::seconds(5));
+	while ( snapshot.frame_count < 10000 && std::chrono::steady_clock::now() < deadline ) {
+		if ( SUCCESS != state::getSensorSnapshot(&snapshot) ) { continue; }
+		const uint_opt8_t * const raw_data = reinterpret_cast<const uint_opt8_t *>(&snapshot.sensor_data);
+		ASSERT_EQ(raw_data[6], raw_data[30]);
+		ASSERT_EQ(raw_data[6], raw_data[31]);
+	}
+	ASSERT_EQ(SUCCESS, state::stopStreamReader());
+}
+
+TEST_F(StreamData$Reader, stopStreamReader$WHENReaderIsStoppedTHENNoMoreFramesArePublished) {
+	state::sensor_snapshot_t before, after;
+	ASSERT_EQ(SUCCESS, state::startStreamReader());
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + std::chrono::seconds(5));
+	while ( SUCCESS != state::getSensorSnapshot(&before) && std::chrono::steady_clock::now() < deadline ) {}
+	ASSERT_EQ(SUCCESS, state::stopStreamReader());
+	ASSERT_EQ(SUCCESS, state::getSensorSnapshot(&before));
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	ASSERT_EQ(SUCCESS, state::getSensorSnapshot(&after));
+	EXPECT_EQ(before.frame_count, after.frame_count);
+}
+
+TEST_F(StreamData$Reader, startStreamReader$WHENNoDataIsAvailableTHENReaderBacksOff) {
+	std::atomic<size_t> reads(0);
+	serial::mock::setSerialReadFunc(
+		[&] (uint_opt8_t * const, const size_t) {
+			++reads;
+			return static_cast<size_t>(0);
+		}
+	);
+	ASSERT_EQ(SUCCESS, state::startStreamReader());
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	ASSERT_EQ(SUCCESS, state::stopStreamReader());
+	EXPECT_LT(0u, reads.load());
+	EXPECT_GT(200u, reads.load());
+}
+
+TEST_F(StreamData$Reader, setStreamKey$WHENKeyChangesWhileReaderRunsTHENReaderResumesOnTheMatchingKey) {
+	const uint_opt8_t matching_key[3] = { sizeof(matching_key), sensor::CLIFF_FRONT_LEFT_SIGNAL, sensor::VIRTUAL_WALL };
+	const uint_opt8_t reversed_key[3] = { sizeof(reversed_key), sensor::VIRTUAL_WALL, sensor::CLIFF_FRONT_LEFT_SIGNAL };
+	state::sensor_snapshot_t snapshot = state::sensor_snapshot_t();
+	ASSERT_EQ(SUCCESS, state::startStreamReader());
+	for ( size_t i = 0 ; i < 1000 ; ++i ) {
+		ASSERT_EQ(SUCCESS, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(( (i & 0x01) ? matching_key : reversed_key ))));
+		if ( SUCCESS != state::getSensorSnapshot(&snapshot) ) { continue; }
+		const uint_opt8_t * const raw_data = reinterpret_cast<const uint_opt8_t *>(&snapshot.sensor_data);
+		ASSERT_EQ(raw_data[6], raw_data[31]);
+	}
+	const uint_opt32_t frames_published = state::getPlatformRobotState().framesPublished();
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + std::chrono::seconds(5));
+	while ( (state::getPlatformRobotState().framesPublished() - frames_published) < 100 && std::chrono::steady_clock::now() < deadline ) {}
+	ASSERT_EQ(SUCCESS, state::stopStreamReader());
+	EXPECT_LE(100u, (state::getPlatformRobotState().framesPublished() - frames_published));
+}
+
+TEST_F(InitialState, setStreamKey$WHENCalledWithNULLTHENErrorIsReturned) {
+	ASSERT_EQ(INVALID_PARAMETER, state::setStreamKey(NULL));
+}
+
+TEST_F(InitialState, setStreamKey$WHENCalledWithZeroSizeTHENErrorIsReturned) {
+	const uint_opt8_t stream_key[2] = { 0, sensor::BUTTONS };
+	ASSERT_EQ(INVALID_PARAMETER, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+}
+
+TEST_F(InitialState, setStreamKey$WHENPacketIdIsUndefinedTHENErrorIsReturned) {
+	const uint_opt8_t stream_key[3] = { sizeof(stream_key), sensor::BUTTONS, 59 };
+	ASSERT_EQ(INVALID_PARAMETER, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+}
+
+TEST_F(InitialState, setStreamKey$WHENFrameWouldExceed255BytesTHENErrorIsReturned) {
+	const uint_opt8_t stream_key[5] = { sizeof(stream_key), sensor::ALL_SENSOR_DATA, sensor::ALL_SENSOR_DATA, sensor::ALL_SENSOR_DATA, sensor::ALL_SENSOR_DATA };
+	ASSERT_EQ(INVALID_PARAMETER, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+}
+
 TEST_F(StreamData, parseStreamData$WHENCalledTHENValuesAreStoredInTheirRespectiveLocations) {
 	ASSERT_EQ(SUCCESS, state::parseStreamData());
 	const uint_opt16_t expected_cliff_front_left_signal = 0x0219;
@@ -454,19 +821,23 @@ TEST_F(StreamData$ByteCountError, parseStreamData$WHENHeaderBytesReadDoNotMatchB
 	ASSERT_EQ(SERIAL_TRANSFER_FAILURE, state::parseStreamData());
 }
 
-TEST_F(StreamData$ByteCountError, parseStreamData$WHENPacketIdBytesReadDoNotMatchBytesRequestedTHENSerialTransferFailureErrorIsReturned) {
+TEST_F(StreamData$ByteCountError, parseStreamData$WHENFrameBytesReadDoNotMatchBytesRequestedTHENSerialTransferFailureErrorIsReturned) {
 	fail_on_call = 2;
 	ASSERT_EQ(SERIAL_TRANSFER_FAILURE, state::parseStreamData());
 }
 
-TEST_F(StreamData$ByteCountError, parseStreamData$WHENDataBytesReadDoNotMatchBytesRequestedTHENSerialTransferFailureErrorIsReturned) {
-	fail_on_call = 3;
-	ASSERT_EQ(SERIAL_TRANSFER_FAILURE, state::parseStreamData());
+TEST_F(StreamData$ByteCountError, parseStreamData$WHENStreamKeyIsUnknownTHENHeaderAndFrameAreEachReadInASingleTransfer) {
+	fail_on_call = 0;
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(2, call_count);
 }
 
-TEST_F(StreamData$ByteCountError, parseStreamData$WHENCheckSumBytesReadDoNotMatchBytesRequestedTHENSerialTransferFailureErrorIsReturned) {
-	fail_on_call = 6;
-	ASSERT_EQ(SERIAL_TRANSFER_FAILURE, state::parseStreamData());
+TEST_F(StreamData$ByteCountError, parseStreamData$WHENStreamKeyIsKnownTHENFrameIsReadInASingleTransfer) {
+	const uint_opt8_t stream_key[3] = { sizeof(stream_key), sensor::CLIFF_FRONT_LEFT_SIGNAL, sensor::VIRTUAL_WALL };
+	fail_on_call = 0;
+	ASSERT_EQ(SUCCESS, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(1, call_count);
 }
 
 TEST_F(StreamData$BadCheckSum, parseStreamData$WHENCheckSumDoesNotMatchTHENInvalidChecksumErrorIsReturned) {
@@ -480,28 +851,116 @@ TEST_F(StreamData$BadCheckSum, parseStreamData$WHENCheckSumDoesNotMatchTHENTheDi
 	EXPECT_TRUE((flag_mask_dirty >> 29 ) & 0x01 );
 }
 
-TEST_F(StreamData$ByteCountError, parseStreamData$WHENPacketIdBytesReadDoNotMatchBytesRequestedTHENTheDirtyFlagIsSetForAllBytesRead) {
-	fail_on_call = 4;
+TEST_F(StreamData$ByteCountError, parseStreamData$WHENFrameBytesReadDoNotMatchBytesRequestedTHENTheDirtyFlagIsSetForAllBytesRead) {
+	fail_on_call = 2;
 	ASSERT_EQ(SERIAL_TRANSFER_FAILURE, state::parseStreamData());
 	const uint_opt64_t flag_mask_dirty = state::testing::getFlagMaskDirty();
 	EXPECT_TRUE((flag_mask_dirty >> 13 ) & 0x01 );
 	EXPECT_TRUE((flag_mask_dirty >> 29 ) & 0x01 );
 }
 
-TEST_F(StreamData$ByteCountError, parseStreamData$WHENDataBytesReadDoNotMatchBytesRequestedTHENTheDirtyFlagIsSetForAllBytesRead) {
-	fail_on_call = 5;
-	ASSERT_EQ(SERIAL_TRANSFER_FAILURE, state::parseStreamData());
-	const uint_opt64_t flag_mask_dirty = state::testing::getFlagMaskDirty();
-	EXPECT_TRUE((flag_mask_dirty >> 13 ) & 0x01 );
-	EXPECT_TRUE((flag_mask_dirty >> 29 ) & 0x01 );
+TEST(PacketTraits, offset$WHENComparedToSensorDataTHENEveryPacketMatchesItsField) {
+	EXPECT_EQ(offsetof(state::sensor_data_t, bumps_and_wheel_drops), sensor::packet_traits<sensor::BUMPS_AND_WHEEL_DROPS>::offset);
+	EXPECT_EQ(offsetof(state::sensor_data_t, distance), sensor::packet_traits<sensor::DISTANCE>::offset);
+	EXPECT_EQ(offsetof(state::sensor_data_t, temperature), sensor::packet_traits<sensor::TEMPERATURE>::offset);
+	EXPECT_EQ(offsetof(state::sensor_data_t, cliff_front_left_signal), sensor::packet_traits<sensor::CLIFF_FRONT_LEFT_SIGNAL>::offset);
+	EXPECT_EQ(offsetof(state::sensor_data_t, charging_sources_available), sensor::packet_traits<sensor::CHARGING_SOURCES_AVAILABLE>::offset);
+	EXPECT_EQ(offsetof(state::sensor_data_t, left_encoder_counts), sensor::packet_traits<sensor::LEFT_ENCODER_COUNTS>::offset);
+	EXPECT_EQ(offsetof(state::sensor_data_t, light_bump_right_signal), sensor::packet_traits<sensor::LIGHT_BUMP_RIGHT_SIGNAL>::offset);
+	EXPECT_EQ(offsetof(state::sensor_data_t, side_brush_motor_current), sensor::packet_traits<sensor::SIDE_BRUSH_MOTOR_CURRENT>::offset);
+	EXPECT_EQ(offsetof(state::sensor_data_t, stasis), sensor::packet_traits<sensor::STASIS>::offset);
+}
+
+TEST(PacketTraits, value_type$WHENPacketIsSignedTHENValueTypeIsSigned) {
+	EXPECT_TRUE((std::is_same<int16_t, sensor::packet_traits<sensor::DISTANCE>::value_type>::value));
+	EXPECT_TRUE((std::is_same<int8_t, sensor::packet_traits<sensor::TEMPERATURE>::value_type>::value));
+	EXPECT_TRUE((std::is_same<uint16_t, sensor::packet_traits<sensor::LEFT_ENCODER_COUNTS>::value_type>::value));
+	EXPECT_TRUE((std::is_same<uint8_t, sensor::packet_traits<sensor::VIRTUAL_WALL>::value_type>::value));
+}
+
+TEST(PacketDescriptor, flag_mask$WHENPacketIsAGroupTHENEveryMemberIsFlagged) {
+	EXPECT_EQ(0x0000000007FFFF81, sensor::packetDescriptor(sensor::PACKETS_7_THRU_26).flag_mask);
+	EXPECT_EQ(0x000000000001FF82, sensor::packetDescriptor(sensor::PACKETS_7_THRU_16).flag_mask);
+	EXPECT_EQ(0x00000000001E0004, sensor::packetDescriptor(sensor::PACKETS_17_THRU_20).flag_mask);
+	EXPECT_EQ(0x0000000007E00008, sensor::packetDescriptor(sensor::PACKETS_21_THRU_26).flag_mask);
+	EXPECT_EQ(0x00000007F8000010, sensor::packetDescriptor(sensor::PACKETS_27_THRU_34).flag_mask);
+	EXPECT_EQ(0x000007F800000020, sensor::packetDescriptor(sensor::PACKETS_35_THRU_42).flag_mask);
+	EXPECT_EQ(0x000007FFFFFFFFC0, sensor::packetDescriptor(sensor::PACKETS_7_THRU_42).flag_mask);
+	EXPECT_EQ(0x0FFFFFFFFFFFFF80, sensor::packetDescriptor(sensor::PACKETS_7_THRU_58).flag_mask);
+	EXPECT_EQ(0x17FFF80000000000, sensor::packetDescriptor(sensor::PACKETS_43_THRU_58).flag_mask);
+	EXPECT_EQ(0x200FC00000000000, sensor::packetDescriptor(sensor::PACKETS_46_THRU_51).flag_mask);
+	EXPECT_EQ(0x47C0000000000000, sensor::packetDescriptor(sensor::PACKETS_54_THRU_58).flag_mask);
+}
+
+TEST(PacketDescriptor, size$WHENPacketIsAGroupTHENSizeIsTheSumOfItsMembers) {
+	for ( uint_opt8_t packet_id = sensor::PACKETS_7_THRU_26 ; packet_id <= sensor::PACKETS_7_THRU_42 ; ++packet_id ) {
+		const sensor::packet_descriptor_t & group = sensor::packetDescriptor(packet_id);
+		uint_opt16_t member_bytes(0);
+		for ( uint_opt8_t member = sensor::BUMPS_AND_WHEEL_DROPS ; member <= sensor::STASIS ; ++member ) {
+			if ( group.flag_mask & (static_cast<uint_opt64_t>(1) << member) ) { member_bytes += sensor::packetDescriptor(member).size; }
+		}
+		EXPECT_EQ(member_bytes, group.size);
+	}
+	EXPECT_EQ(80, sensor::packetDescriptor(sensor::PACKETS_7_THRU_58).size);
+	EXPECT_EQ(28, sensor::packetDescriptor(sensor::PACKETS_43_THRU_58).size);
+	EXPECT_EQ(12, sensor::packetDescriptor(sensor::PACKETS_46_THRU_51).size);
+	EXPECT_EQ(9, sensor::packetDescriptor(sensor::PACKETS_54_THRU_58).size);
 }
 
-TEST_F(StreamData$ByteCountError, parseStreamData$WHENCheckSumBytesReadDoNotMatchBytesRequestedTHENTheDirtyFlagIsSetForAllBytesRead) {
-	fail_on_call = 6;
-	ASSERT_EQ(SERIAL_TRANSFER_FAILURE, state::parseStreamData());
-	const uint_opt64_t flag_mask_dirty = state::testing::getFlagMaskDirty();
-	EXPECT_TRUE((flag_mask_dirty >> 13 ) & 0x01 );
-	EXPECT_TRUE((flag_mask_dirty >> 29 ) & 0x01 );
+TEST(PacketDescriptor, index$WHENPacketIdIsAnExtendedGroupTHENIndexIsDense) {
+	EXPECT_EQ(59, sensor::packetDescriptor(sensor::PACKETS_7_THRU_58).index);
+	EXPECT_EQ(60, sensor::packetDescriptor(sensor::PACKETS_43_THRU_58).index);
+	EXPECT_EQ(61, sensor::packetDescriptor(sensor::PACKETS_46_THRU_51).index);
+	EXPECT_EQ(62, sensor::packetDescriptor(sensor::PACKETS_54_THRU_58).index);
+}
+
+TEST(PacketDescriptor, signedFlagMask$WHENCalledTHENSignedPacketsAreFlagged) {
+	EXPECT_EQ(0x03C0078001980000, state::testing::getFlagMaskSigned());
+}
+
+TEST(PacketList, byte_count$WHENListIsKnownAtCompileTimeTHENByteCountIsConstant) {
+	static_assert(3 == sensor::packet_list<sensor::CLIFF_FRONT_LEFT_SIGNAL, sensor::VIRTUAL_WALL>::byte_count, "byte count is not folded");
+	EXPECT_EQ(0, sensor::packet_list<>::byte_count);
+	EXPECT_EQ(92, (sensor::packet_list<sensor::PACKETS_7_THRU_58, sensor::PACKETS_54_THRU_58, sensor::BUMPS_AND_WHEEL_DROPS, sensor::DISTANCE>::byte_count));
+}
+
+TEST(PacketList, flag_mask$WHENListIsKnownAtCompileTimeTHENFlagMaskIsConstant) {
+	static_assert(0x0000000020002000 == sensor::packet_list<sensor::CLIFF_FRONT_LEFT_SIGNAL, sensor::VIRTUAL_WALL>::flag_mask, "flag mask is not folded");
+	EXPECT_EQ(0x00000000001E0004, (sensor::packet_list<sensor::PACKETS_17_THRU_20, sensor::DISTANCE>::flag_mask));
+}
+
+TEST_F(StreamData, get$WHENFrameIsParsedTHENValueIsReturnedInHostByteOrder) {
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(0x0219, state::get<sensor::CLIFF_FRONT_LEFT_SIGNAL>().value);
+	EXPECT_EQ(0x00, state::get<sensor::VIRTUAL_WALL>().value);
+}
+
+TEST_F(StreamData, get$WHENPacketIsRefreshedTHENValueIsNotDirty) {
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_FALSE(state::get<sensor::CLIFF_FRONT_LEFT_SIGNAL>().dirty);
+	EXPECT_FALSE(state::get<sensor::VIRTUAL_WALL>().dirty);
+}
+
+TEST_F(StreamData, get$WHENPacketIsNotRefreshedTHENValueIsDirty) {
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_TRUE(state::get<sensor::DISTANCE>().dirty);
+}
+
+TEST_F(StreamData, get$WHENCalledWithSnapshotTHENValueIsReadFromTheSnapshot) {
+	state::sensor_snapshot_t snapshot;
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	ASSERT_EQ(SUCCESS, state::getSensorSnapshot(&snapshot));
+	const state::packet_value_t<uint16_t> cliff_front_left_signal = state::get<sensor::CLIFF_FRONT_LEFT_SIGNAL>(snapshot);
+	EXPECT_EQ(0x0219, cliff_front_left_signal.value);
+	EXPECT_FALSE(cliff_front_left_signal.dirty);
+}
+
+TEST_F(StreamData$Resynchronization, get$WHENPacketIsSignedTHENNegativeValueIsReturned) {
+	const uint_opt8_t distance_key[2] = { sizeof(distance_key), sensor::DISTANCE };
+	serial_stream = { 0x13, 0x03, 0x13, 0xFF, 0x38, 0xA0 };
+	ASSERT_EQ(SUCCESS, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(distance_key)));
+	ASSERT_EQ(SUCCESS, state::parseStreamData());
+	EXPECT_EQ(-200, state::get<sensor::DISTANCE>().value);
 }
 
 } // namespace
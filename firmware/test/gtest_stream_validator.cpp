@@ -0,0 +1,161 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../stream_validator.h"
+#include "../state.h"
+#include "TEST_state.h"
+
+#include <random>
+#include <vector>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+/// \brief The stream key of the frames built by appendFrame()
+/// \note None of the packet ids is the frame header (19).
+const uint_opt8_t STREAM_KEY[4] = { sizeof(STREAM_KEY), sensor::CLIFF_FRONT_LEFT_SIGNAL, sensor::VIRTUAL_WALL, sensor::ANGLE };
+
+/// \brief Append a stream frame of the packets of STREAM_KEY
+/// \param [in,out] stream_ The bytes of the stream
+/// \param [in] value_ Seeds the values of the packets
+void
+appendFrame (
+	std::vector<uint_opt8_t> & stream_,
+	const uint_opt8_t value_
+) {
+	const uint_opt8_t payload[8] = { sensor::CLIFF_FRONT_LEFT_SIGNAL, 0x02, value_, sensor::VIRTUAL_WALL, static_cast<uint_opt8_t>(value_ & 0x01), sensor::ANGLE, 0xFF, static_cast<uint_opt8_t>(value_ * 3) };
+	const size_t frame_begin = stream_.size();
+	stream_.push_back(state::stream_validator::FRAME_HEADER);
+	stream_.push_back(static_cast<uint_opt8_t>(sizeof(payload)));
+	stream_.insert(stream_.end(), payload, (payload + sizeof(payload)));
+	stream_.push_back(static_cast<uint_opt8_t>(0x100 - state::stream_validator::byteSum((stream_.data() + frame_begin), (stream_.size() - frame_begin))));
+}
+
+/// \brief Validate a stream with the byte-at-a-time parser
+/// \param [in] stream_ The bytes of the stream
+/// \param [in] stream_key_ The stream key, or nullptr when unknown
+/// \param [out] frames_committed_ Receives the number of frames committed
+/// \return The counters of the parser
+state::stream_statistics_t
+parseByteAtATime (
+	const std::vector<uint_opt8_t> & stream_,
+	const uint_opt8_t * const stream_key_,
+	size_t * const frames_committed_
+) {
+	state::testing::setInternalsToInitialState();
+	if ( stream_key_ ) { EXPECT_EQ(SUCCESS, state::setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key_))); }
+	*frames_committed_ = 0;
+	for ( size_t offset = 0 ; offset < stream_.size() ; ) {
+		size_t bytes_consumed;
+		if ( SUCCESS == state::parseStreamBuffer((stream_.data() + offset), (stream_.size() - offset), &bytes_consumed) ) { ++*frames_committed_; }
+		offset += bytes_consumed;
+	}
+	return state::getStreamStatistics();
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+TEST(StreamValidator, byteSum$WHENBytesAreSummedTHENSumMatchesAScalarSum) {
+	std::mt19937 generator(0x13);
+	std::vector<uint_opt8_t> bytes(320);
+	for ( uint_opt8_t & byte : bytes ) { byte = static_cast<uint_opt8_t>(generator()); }
+	for ( size_t offset = 0 ; offset < 16 ; ++offset ) {
+		uint_opt8_t expected_sum(0);
+		for ( size_t length = 0 ; length <= (bytes.size() - offset) ; ++length ) {
+			ASSERT_EQ(expected_sum, state::stream_validator::byteSum((bytes.data() + offset), length)) << "offset " << offset << ", length " << length;
+			if ( (offset + length) < bytes.size() ) { expected_sum += bytes[(offset + length)]; }
+		}
+	}
+}
+
+TEST(StreamValidator, setStreamKey$WHENPacketIdIsUndefinedTHENErrorIsReturned) {
+	const uint_opt8_t stream_key[3] = { sizeof(stream_key), sensor::VOLTAGE, 59 };
+	state::stream_validator validator;
+	EXPECT_EQ(INVALID_PARAMETER, validator.setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key)));
+}
+
+TEST(StreamValidator, validate$WHENFrameIsCorruptTHENOnlyThatFrameIsRejected) {
+	std::vector<uint_opt8_t> stream;
+	appendFrame(stream, 1);
+	appendFrame(stream, 2);
+	appendFrame(stream, 3);
+	stream[14] ^= 0x40;
+	state::stream_validator validator;
+	std::vector<state::stream_frame_t> frames;
+	state::stream_validation_t validation;
+	ASSERT_EQ(SUCCESS, validator.validate(stream.data(), stream.size(), &frames, &validation));
+	ASSERT_EQ(2u, frames.size());
+	EXPECT_EQ(0u, frames[0].offset);
+	EXPECT_EQ(22u, frames[1].offset);
+	EXPECT_EQ(1u, validation.checksum_failures);
+	EXPECT_EQ(11u, validation.bytes_discarded);
+	EXPECT_EQ(stream.size(), validation.bytes_resolved);
+}
+
+TEST(StreamValidator, validate$WHENPacketIdDoesNotMatchStreamKeyTHENHeaderIsFalse) {
+	std::vector<uint_opt8_t> stream;
+	appendFrame(stream, 1);
+	stream[7] = sensor::VOLTAGE;
+	stream[10] = static_cast<uint_opt8_t>(stream[10] + sensor::ANGLE - sensor::VOLTAGE);
+	state::stream_validator validator;
+	std::vector<state::stream_frame_t> frames;
+	state::stream_validation_t validation;
+	ASSERT_EQ(SUCCESS, validator.validate(stream.data(), stream.size(), &frames, &validation));
+	EXPECT_EQ(1u, frames.size());
+	ASSERT_EQ(SUCCESS, validator.setStreamKey(reinterpret_cast<const sensor::PacketId *>(STREAM_KEY)));
+	ASSERT_EQ(SUCCESS, validator.validate(stream.data(), stream.size(), &frames, &validation));
+	EXPECT_EQ(0u, frames.size());
+	EXPECT_EQ(1u, validation.sync_losses);
+	EXPECT_EQ(0u, validation.checksum_failures);
+}
+
+TEST(StreamValidator, validate$WHENLastFrameIsIncompleteTHENItIsNotResolved) {
+	std::vector<uint_opt8_t> stream;
+	appendFrame(stream, 1);
+	appendFrame(stream, 2);
+	stream.resize(stream.size() - 1);
+	state::stream_validator validator;
+	ASSERT_EQ(SUCCESS, validator.setStreamKey(reinterpret_cast<const sensor::PacketId *>(STREAM_KEY)));
+	std::vector<state::stream_frame_t> frames;
+	state::stream_validation_t validation;
+	ASSERT_EQ(SUCCESS, validator.validate(stream.data(), stream.size(), &frames, &validation));
+	EXPECT_EQ(1u, frames.size());
+	EXPECT_EQ(11u, validation.bytes_resolved);
+	EXPECT_EQ(0u, validation.bytes_discarded);
+}
+
+TEST(StreamValidator, validate$WHENStreamIsCorruptedTHENVerdictsMatchTheByteParser) {
+	std::mt19937 generator(0x526F6F6D);
+	std::vector<uint_opt8_t> stream;
+	for ( uint_opt8_t i = 0 ; i < 200 ; ++i ) { appendFrame(stream, i); }
+	for ( size_t i = 0 ; i < 60 ; ++i ) {
+		uint_opt8_t & byte = stream[(generator() % stream.size())];
+		byte = ( (generator() & 0x01) ? static_cast<uint_opt8_t>(state::stream_validator::FRAME_HEADER) : static_cast<uint_opt8_t>(generator()) );
+	}
+	appendFrame(stream, 0xA5);
+
+	const uint_opt8_t * const stream_keys[2] = { nullptr, STREAM_KEY };
+	for ( const uint_opt8_t * const stream_key : stream_keys ) {
+		size_t frames_committed;
+		const state::stream_statistics_t expected = parseByteAtATime(stream, stream_key, &frames_committed);
+		state::stream_validator validator;
+		if ( stream_key ) { ASSERT_EQ(SUCCESS, validator.setStreamKey(reinterpret_cast<const sensor::PacketId *>(stream_key))); }
+		std::vector<state::stream_frame_t> frames;
+		state::stream_validation_t validation;
+		ASSERT_EQ(SUCCESS, validator.validate(stream.data(), stream.size(), &frames, &validation));
+		EXPECT_EQ(frames_committed, frames.size());
+		EXPECT_EQ(expected.frames_dropped, (validation.checksum_failures + validation.sync_losses));
+		EXPECT_EQ(expected.bytes_dropped, validation.bytes_discarded);
+		EXPECT_LT(120u, frames.size());
+	}
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
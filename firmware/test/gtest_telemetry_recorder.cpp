@@ -0,0 +1,162 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../robot.h"
+#include "../telemetry_recorder.h"
+#include "../virtual_roomba.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+/// \brief A record read back from a log
+struct logged_record_t {
+	telemetry::record_header_t header;
+	std::vector<uint_opt8_t> payload;
+};
+
+/// \brief Read a log written by the recorder
+/// \param [in] path_ The path of the log file
+/// \param [out] log_header_ Receives the header of the log
+/// \param [out] records_ Receives the records of the log
+void
+readLog (
+	const std::string & path_,
+	telemetry::log_header_t * const log_header_,
+	std::vector<logged_record_t> * const records_
+) {
+	std::FILE * const log = std::fopen(path_.c_str(), "rb");
+	ASSERT_NE(nullptr, log);
+	ASSERT_EQ(1u, std::fread(log_header_, sizeof(telemetry::log_header_t), 1, log));
+
+	logged_record_t record;
+	while ( 1 == std::fread(&record.header, sizeof(telemetry::record_header_t), 1, log) ) {
+		record.payload.resize(record.header.length);
+		ASSERT_EQ(record.header.length, std::fread(record.payload.data(), 1, record.header.length, log));
+		records_->push_back(record);
+	}
+	std::fclose(log);
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class TelemetryRecorder : public ::testing::Test {
+  protected:
+	TelemetryRecorder (
+		void
+	) :
+		log_path(::testing::TempDir() + "gtest_telemetry_recorder.tlm")
+	{}
+
+	virtual void TearDown() {
+		std::remove(log_path.c_str());
+	}
+
+	const std::string log_path;
+	telemetry::log_header_t log_header;
+	std::vector<logged_record_t> records;
+};
+
+TEST_F(TelemetryRecorder, record$WHENClosedTHENErrorIsReturned) {
+	const uint_opt8_t command[1] = { 128 };
+	telemetry::telemetry_recorder recorder;
+	EXPECT_EQ(INVALID_MODE_FOR_REQUESTED_OPERATION, recorder.record(telemetry::COMMAND, command, sizeof(command)));
+}
+
+TEST_F(TelemetryRecorder, open$WHENOpenTHENErrorIsReturned) {
+	telemetry::telemetry_recorder recorder;
+	ASSERT_EQ(SUCCESS, recorder.open(log_path.c_str()));
+	EXPECT_EQ(INVALID_MODE_FOR_REQUESTED_OPERATION, recorder.open(log_path.c_str()));
+}
+
+TEST_F(TelemetryRecorder, record$WHENRecordedTHENRecordIsWrittenWithItsPayload) {
+	const uint_opt8_t command[2] = { 128, 131 };
+	telemetry::telemetry_recorder recorder;
+	ASSERT_EQ(SUCCESS, recorder.open(log_path.c_str()));
+	ASSERT_EQ(SUCCESS, recorder.record(telemetry::COMMAND, command, sizeof(command)));
+	recorder.close();
+	EXPECT_EQ(1u, recorder.recordsWritten());
+
+	readLog(log_path, &log_header, &records);
+	EXPECT_EQ(0, memcmp(telemetry::LOG_MAGIC, log_header.magic, sizeof(log_header.magic)));
+	EXPECT_EQ(telemetry::LOG_VERSION, log_header.version);
+	EXPECT_EQ(sizeof(telemetry::record_header_t), log_header.record_header_size);
+	ASSERT_EQ(1u, records.size());
+	EXPECT_EQ(telemetry::COMMAND, records[0].header.type);
+	EXPECT_EQ(0u, records[0].header.sequence);
+	EXPECT_LE(log_header.steady_origin_ns, records[0].header.timestamp_ns);
+	EXPECT_EQ(std::vector<uint_opt8_t>(command, (command + sizeof(command))), records[0].payload);
+}
+
+TEST_F(TelemetryRecorder, record$WHENPayloadIsLongerThanARecordTHENItIsSplit) {
+	const std::vector<uint_opt8_t> script(300, 0x5A);
+	telemetry::telemetry_recorder recorder;
+	ASSERT_EQ(SUCCESS, recorder.open(log_path.c_str()));
+	ASSERT_EQ(SUCCESS, recorder.record(telemetry::COMMAND, script.data(), script.size()));
+	recorder.close();
+
+	readLog(log_path, &log_header, &records);
+	ASSERT_EQ(2u, records.size());
+	EXPECT_EQ(telemetry::telemetry_recorder::RECORD_PAYLOAD_MAX, records[0].header.length);
+	EXPECT_EQ((300 - telemetry::telemetry_recorder::RECORD_PAYLOAD_MAX), records[1].header.length);
+	EXPECT_EQ(1u, records[1].header.sequence);
+}
+
+TEST_F(TelemetryRecorder, record$WHENRingIsFullTHENRecordIsDroppedAndCounted) {
+	const uint_opt8_t command[1] = { 135 };
+	telemetry::telemetry_recorder recorder(2, std::chrono::hours(1));
+	ASSERT_EQ(SUCCESS, recorder.open(log_path.c_str()));
+	EXPECT_EQ(SUCCESS, recorder.record(telemetry::COMMAND, command, sizeof(command)));
+	EXPECT_EQ(SUCCESS, recorder.record(telemetry::COMMAND, command, sizeof(command)));
+	EXPECT_EQ(NO_DATA_AVAILABLE, recorder.record(telemetry::COMMAND, command, sizeof(command)));
+	recorder.close();
+	EXPECT_EQ(2u, recorder.recordsWritten());
+	EXPECT_EQ(1u, recorder.recordsDropped());
+}
+
+TEST_F(TelemetryRecorder, setTelemetryRecorder$WHENAttachedTHENFramesAndCommandsAreRecorded) {
+	const sensor::PacketId stream_key[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+	serial::virtual_roomba roomba_port;
+	robot<OI500> roomba(roomba_port);
+	telemetry::telemetry_recorder recorder;
+	ASSERT_EQ(SUCCESS, recorder.open(log_path.c_str()));
+	ASSERT_EQ(SUCCESS, roomba.getState().setStreamKey(stream_key));
+	ASSERT_EQ(SUCCESS, roomba.getState().setTelemetryRecorder(&recorder));
+	roomba.start();
+	roomba.safe();
+	roomba.stream((stream_key + 1), 1);
+	for ( size_t i = 0 ; i < 3 ; ++i ) { ASSERT_EQ(SUCCESS, roomba.getState().parseStreamData()); }
+	ASSERT_EQ(SUCCESS, roomba.getState().setTelemetryRecorder(nullptr));
+	recorder.close();
+	EXPECT_EQ(0u, recorder.recordsDropped());
+
+	readLog(log_path, &log_header, &records);
+	ASSERT_EQ(6u, records.size());
+	EXPECT_EQ(std::vector<uint_opt8_t>{ 128 }, records[0].payload);
+	EXPECT_EQ(std::vector<uint_opt8_t>{ 131 }, records[1].payload);
+	EXPECT_EQ(148, records[2].payload[0]);
+	for ( size_t i = 3 ; i < records.size() ; ++i ) {
+		EXPECT_EQ(telemetry::STREAM_FRAME, records[i].header.type);
+		ASSERT_EQ(6u, records[i].payload.size());
+		EXPECT_EQ(19, records[i].payload[0]);
+		uint_opt8_t byte_sum(0);
+		for ( const uint_opt8_t byte : records[i].payload ) { byte_sum += byte; }
+		EXPECT_EQ(0, byte_sum);
+		EXPECT_LE(records[(i - 1)].header.timestamp_ns, records[i].header.timestamp_ns);
+	}
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,138 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../telemetry_segment.h"
+#include "TEST_state.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+/// \brief Time between stream frames (in nanoseconds)
+const int64_t FRAME_INTERVAL_NS(15000000);
+
+using state::testing::setPacket;
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class TelemetrySegment : public ::testing::Test {
+  protected:
+	TelemetrySegment (
+		void
+	) :
+		segment(4)
+	{
+		memset(&sensor_data, 0, sizeof(sensor_data));
+	}
+
+	/// \brief Append a row each frame, with a motor current swinging
+	/// from negative to positive and a steady encoder count
+	void
+	appendRows (
+		const size_t rows_
+	) {
+		for ( size_t row = 0 ; row < rows_ ; ++row ) {
+			setPacket(sensor_data, sensor::LEFT_MOTOR_CURRENT, ((static_cast<int>(row) * 3) - 20));
+			setPacket(sensor_data, sensor::LEFT_ENCODER_COUNTS, (65530 + static_cast<int>(row)));
+			ASSERT_EQ(SUCCESS, segment.append((static_cast<int64_t>(row) * FRAME_INTERVAL_NS), sensor_data));
+		}
+	}
+
+	telemetry::telemetry_segment segment;
+	state::sensor_data_t sensor_data;
+	std::vector<telemetry::sample_t> samples;
+};
+
+TEST_F(TelemetrySegment, append$WHENTimeRunsBackwardTHENErrorIsReturned) {
+	ASSERT_EQ(SUCCESS, segment.append(1000, sensor_data));
+	EXPECT_EQ(INVALID_PARAMETER, segment.append(999, sensor_data));
+	EXPECT_EQ(SUCCESS, segment.append(1000, sensor_data));
+	EXPECT_EQ(2u, segment.rows());
+}
+
+TEST_F(TelemetrySegment, query$WHENPacketIsAGroupTHENErrorIsReturned) {
+	appendRows(1);
+	EXPECT_EQ(INVALID_PARAMETER, segment.query(sensor::PACKETS_7_THRU_58, 0, 0, &samples));
+}
+
+TEST_F(TelemetrySegment, query$WHENRangeSpansBlocksTHENOnlyRowsInRangeAreReturned) {
+	appendRows(22);
+	ASSERT_EQ(SUCCESS, segment.query(sensor::LEFT_MOTOR_CURRENT, (5 * FRAME_INTERVAL_NS), (13 * FRAME_INTERVAL_NS), &samples));
+	ASSERT_EQ(9u, samples.size());
+	for ( size_t i = 0 ; i < samples.size() ; ++i ) {
+		EXPECT_EQ((static_cast<int64_t>(i + 5) * FRAME_INTERVAL_NS), samples[i].timestamp_ns);
+		EXPECT_EQ(((static_cast<int>(i + 5) * 3) - 20), samples[i].value);
+	}
+}
+
+TEST_F(TelemetrySegment, query$WHENRangeIncludesTheLastRowsTHENRowsNotYetEncodedAreReturned) {
+	appendRows(22);
+	ASSERT_EQ(SUCCESS, segment.query(sensor::LEFT_ENCODER_COUNTS, (17 * FRAME_INTERVAL_NS), INT64_MAX, &samples));
+	ASSERT_EQ(5u, samples.size());
+	EXPECT_EQ(((65530 + 17) & 0xFFFF), samples[0].value);
+	EXPECT_EQ((65530 + 21 - 65536), samples[4].value);
+	EXPECT_EQ((21 * FRAME_INTERVAL_NS), samples[4].timestamp_ns);
+}
+
+TEST_F(TelemetrySegment, query$WHENRangePrecedesTheSegmentTHENNoRowIsReturned) {
+	appendRows(8);
+	samples.resize(3);
+	ASSERT_EQ(SUCCESS, segment.query(sensor::LEFT_MOTOR_CURRENT, -10, -1, &samples));
+	EXPECT_TRUE(samples.empty());
+}
+
+TEST_F(TelemetrySegment, append$WHENPacketsChangeSteadilyTHENColumnsAreCompact) {
+	telemetry::telemetry_segment large_segment;
+	setPacket(sensor_data, sensor::BATTERY_CAPACITY, 2696);
+	setPacket(sensor_data, sensor::SONG_NUMBER, 3);
+	for ( int row = 0 ; row < 4096 ; ++row ) {
+		setPacket(sensor_data, sensor::LEFT_ENCODER_COUNTS, (row * 7));
+		setPacket(sensor_data, sensor::RIGHT_ENCODER_COUNTS, (row * 7));
+		ASSERT_EQ(SUCCESS, large_segment.append((row * FRAME_INTERVAL_NS), sensor_data));
+	}
+	EXPECT_GT((4096 * sizeof(state::sensor_data_t) / 50), large_segment.encodedSize());
+
+	ASSERT_EQ(SUCCESS, large_segment.query(sensor::BATTERY_CAPACITY, (4000 * FRAME_INTERVAL_NS), (4001 * FRAME_INTERVAL_NS), &samples));
+	ASSERT_EQ(2u, samples.size());
+	EXPECT_EQ(2696, samples[1].value);
+}
+
+TEST_F(TelemetrySegment, serialize$WHENDeserializedTHENQueriesAndAppendsContinue) {
+	std::vector<uint_opt8_t> serialized;
+	telemetry::telemetry_segment loaded;
+	appendRows(10);
+	ASSERT_EQ(SUCCESS, segment.serialize(&serialized));
+	ASSERT_EQ(SUCCESS, loaded.deserialize(serialized.data(), serialized.size()));
+	EXPECT_EQ(10u, loaded.rows());
+
+	EXPECT_EQ(INVALID_PARAMETER, loaded.append((8 * FRAME_INTERVAL_NS), sensor_data));
+	setPacket(sensor_data, sensor::LEFT_MOTOR_CURRENT, -300);
+	ASSERT_EQ(SUCCESS, loaded.append((10 * FRAME_INTERVAL_NS), sensor_data));
+	ASSERT_EQ(SUCCESS, loaded.query(sensor::LEFT_MOTOR_CURRENT, 0, INT64_MAX, &samples));
+	ASSERT_EQ(11u, samples.size());
+	EXPECT_EQ(((9 * 3) - 20), samples[9].value);
+	EXPECT_EQ(-300, samples[10].value);
+}
+
+TEST_F(TelemetrySegment, deserialize$WHENBytesAreCorruptTHENErrorIsReturned) {
+	std::vector<uint_opt8_t> serialized;
+	telemetry::telemetry_segment loaded;
+	appendRows(10);
+	ASSERT_EQ(SUCCESS, segment.serialize(&serialized));
+	EXPECT_EQ(INVALID_PARAMETER, loaded.deserialize(serialized.data(), (serialized.size() - 1)));
+	serialized[0] = 'X';
+	EXPECT_EQ(INVALID_PARAMETER, loaded.deserialize(serialized.data(), serialized.size()));
+	EXPECT_EQ(0u, loaded.rows());
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,108 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../robot.h"
+#include "../uart_scheduler.h"
+#include "TEST_port.h"
+
+#include <chrono>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+/// \brief Eight packets of two bytes each (a stream frame of 27 bytes)
+const sensor::PacketId TWO_BYTE_PACKETS[8] = { sensor::DISTANCE, sensor::ANGLE, sensor::VOLTAGE, sensor::CURRENT, sensor::BATTERY_CHARGE, sensor::BATTERY_CAPACITY, sensor::REQUESTED_VELOCITY, sensor::REQUESTED_RADIUS };
+
+using serial::testing::TestPort;
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class ScheduledRobot : public ::testing::Test {
+  protected:
+	ScheduledRobot (
+		void
+	) :
+		scheduler(port, BAUD_19200),
+		roomba(scheduler)
+	{}
+
+	TestPort port;
+	serial::uart_scheduler scheduler;
+	robot<OI500> roomba;
+};
+
+TEST(UartScheduler, streamFrameBytes$WHENCalledTHENHeaderIdsValuesAndChecksumAreCounted) {
+	const sensor::PacketId sensor_list[2] = { sensor::DISTANCE, sensor::BUMPS_AND_WHEEL_DROPS };
+	EXPECT_EQ(8u, serial::uart_scheduler::streamFrameBytes(sensor_list, 2));
+}
+
+TEST(UartScheduler, streamFrameBytes$WHENAPacketIdIsUndefinedTHENItIsIgnored) {
+	const sensor::PacketId sensor_list[2] = { sensor::DISTANCE, static_cast<sensor::PacketId>(75) };
+	EXPECT_EQ(6u, serial::uart_scheduler::streamFrameBytes(sensor_list, 2));
+}
+
+TEST_F(ScheduledRobot, slotCapacity$WHENBaudChangesTHENCapacityIsRescaled) {
+	EXPECT_EQ(28u, scheduler.slotCapacity());
+	scheduler.beginAtBaudCode(BAUD_115200);
+	EXPECT_EQ(BAUD_115200, port.baud_code);
+	EXPECT_EQ(172u, scheduler.slotCapacity());
+}
+
+TEST_F(ScheduledRobot, stream$WHENTheFrameOverflowsTheSlotTHENItIsRejected) {
+	EXPECT_EQ(SERIAL_TRANSFER_FAILURE, roomba.stream(TWO_BYTE_PACKETS, 8));
+	EXPECT_TRUE(port.tx.empty());
+	EXPECT_EQ(0u, scheduler.streamReservation());
+}
+
+TEST_F(ScheduledRobot, stream$WHENTheFrameFitsTHENItIsReserved) {
+	EXPECT_EQ(SUCCESS, roomba.stream(TWO_BYTE_PACKETS, 2));
+	EXPECT_EQ(9u, scheduler.streamReservation());
+	EXPECT_GE((scheduler.slotCapacity() - scheduler.streamReservation()), scheduler.remainingBudget());
+}
+
+TEST_F(ScheduledRobot, fitStreamList$WHENTheListOverflowsTHENItIsTrimmed) {
+	const uint_opt8_t packets_fit = scheduler.fitStreamList(TWO_BYTE_PACKETS, 8);
+	EXPECT_EQ(6, packets_fit);
+	EXPECT_EQ(SUCCESS, roomba.stream(TWO_BYTE_PACKETS, packets_fit));
+	EXPECT_EQ(21u, scheduler.streamReservation());
+}
+
+TEST_F(ScheduledRobot, pauseResumeStream$WHENPausedTHENTheReservationIsReleased) {
+	EXPECT_EQ(SUCCESS, roomba.stream(TWO_BYTE_PACKETS, 2));
+	EXPECT_EQ(SUCCESS, roomba.pauseResumeStream(false));
+	EXPECT_EQ(0u, scheduler.streamReservation());
+	EXPECT_EQ(SUCCESS, roomba.pauseResumeStream(true));
+	EXPECT_EQ(9u, scheduler.streamReservation());
+}
+
+TEST_F(ScheduledRobot, remainingBudget$WHENCommandsAreWrittenTHENTheBudgetIsSpent) {
+	const size_t budget = scheduler.remainingBudget();
+	EXPECT_EQ(SUCCESS, roomba.drive(-200, 500));
+	EXPECT_EQ((budget - 5), scheduler.remainingBudget());
+}
+
+TEST_F(ScheduledRobot, multiByteSerialWrite$WHENCommandsExceedTheBudgetTHENTheyArePacedAcrossSlots) {
+	ASSERT_EQ(SUCCESS, roomba.stream(TWO_BYTE_PACKETS, 6));
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for ( int_opt16_t velocity = 0 ; velocity < 5 ; ++velocity ) { ASSERT_EQ(SUCCESS, roomba.driveDirect(velocity, velocity)); }
+
+	EXPECT_LE(30, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+	ASSERT_EQ(33u, port.tx.size());
+	EXPECT_LT(6u, port.write_count);
+	for ( size_t i = 0 ; i < 5 ; ++i ) { EXPECT_EQ(i, port.tx[(8 + (i * 5) + 4)]); }
+}
+
+TEST_F(ScheduledRobot, multiByteSerialWrite$WHENWithinTheBudgetTHENItIsWrittenAtOnce) {
+	EXPECT_EQ(SUCCESS, roomba.driveDirect(100, -100));
+	EXPECT_EQ(1u, port.write_count);
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,141 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../uplink_codec.h"
+#include "TEST_state.h"
+
+#include <cstring>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+using state::testing::setPacket;
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class UplinkCodec : public ::testing::Test {
+  protected:
+	UplinkCodec (
+		void
+	) :
+		encoder(3),
+		frame_length(0),
+		flag_mask_changed(0)
+	{
+		memset(&snapshot, 0, sizeof(snapshot));
+		memset(&decoded, 0, sizeof(decoded));
+		setPacket(snapshot.sensor_data, sensor::VOLTAGE, 16213);
+		setPacket(snapshot.sensor_data, sensor::TEMPERATURE, -3);
+		setPacket(snapshot.sensor_data, sensor::LEFT_MOTOR_CURRENT, -118);
+		setPacket(snapshot.sensor_data, sensor::OI_MODE, 2);
+	}
+
+	/// \brief Encode the snapshot, and decode the frame
+	ReturnCode
+	transfer (
+		void
+	) {
+		EXPECT_EQ(SUCCESS, encoder.encode(snapshot, frame, sizeof(frame), &frame_length));
+		return decoder.decode(frame, frame_length, &decoded, &flag_mask_changed);
+	}
+
+	telemetry::uplink_encoder encoder;
+	telemetry::uplink_decoder decoder;
+	state::sensor_snapshot_t snapshot;
+	state::sensor_data_t decoded;
+	uint_opt8_t frame[telemetry::UPLINK_FRAME_MAX];
+	size_t frame_length;
+	uint_opt64_t flag_mask_changed;
+};
+
+TEST_F(UplinkCodec, encode$WHENBufferIsSmallerThanAFrameTHENErrorIsReturned) {
+	EXPECT_EQ(INVALID_PARAMETER, encoder.encode(snapshot, frame, (sizeof(frame) - 1), &frame_length));
+}
+
+TEST_F(UplinkCodec, encode$WHENFirstFrameTHENKeyframeIsDecodedAlone) {
+	ASSERT_EQ(SUCCESS, transfer());
+	EXPECT_EQ(telemetry::UPLINK_KEYFRAME, frame[0]);
+	EXPECT_EQ(0, memcmp(&snapshot.sensor_data, &decoded, sizeof(decoded)));
+	EXPECT_EQ(-118, state::get<sensor::LEFT_MOTOR_CURRENT>(decoded, 0).value);
+}
+
+TEST_F(UplinkCodec, encode$WHENNothingChangedTHENFrameIsThreeBytes) {
+	ASSERT_EQ(SUCCESS, transfer());
+	ASSERT_EQ(SUCCESS, transfer());
+	EXPECT_EQ(telemetry::UPLINK_DELTA, frame[0]);
+	EXPECT_EQ(3u, frame_length);
+	EXPECT_EQ(0u, flag_mask_changed);
+}
+
+TEST_F(UplinkCodec, encode$WHENOnePacketChangesTHENOnlyItIsCarried) {
+	ASSERT_EQ(SUCCESS, transfer());
+	setPacket(snapshot.sensor_data, sensor::VOLTAGE, 16211);
+	ASSERT_EQ(SUCCESS, transfer());
+	EXPECT_EQ(5u, frame_length);
+	EXPECT_EQ(sensor::packetDescriptor(sensor::VOLTAGE).flag_mask, flag_mask_changed);
+	EXPECT_EQ(16211, state::get<sensor::VOLTAGE>(decoded, 0).value);
+}
+
+TEST_F(UplinkCodec, encode$WHENPacketIsDirtyTHENItIsNotCarried) {
+	ASSERT_EQ(SUCCESS, transfer());
+	setPacket(snapshot.sensor_data, sensor::VOLTAGE, 0);
+	snapshot.flag_mask_dirty = sensor::packetDescriptor(sensor::VOLTAGE).flag_mask;
+	ASSERT_EQ(SUCCESS, transfer());
+	EXPECT_EQ(3u, frame_length);
+	EXPECT_EQ(16213, state::get<sensor::VOLTAGE>(decoded, 0).value);
+}
+
+TEST_F(UplinkCodec, encode$WHENKeyframeIsDueOrRequestedTHENKeyframeIsSent) {
+	const uint_opt8_t expected_types[6] = { telemetry::UPLINK_KEYFRAME, telemetry::UPLINK_DELTA, telemetry::UPLINK_DELTA, telemetry::UPLINK_KEYFRAME, telemetry::UPLINK_KEYFRAME, telemetry::UPLINK_DELTA };
+	for ( size_t i = 0 ; i < 6 ; ++i ) {
+		if ( 4 == i ) { encoder.requestKeyframe(); }
+		ASSERT_EQ(SUCCESS, transfer());
+		EXPECT_EQ(expected_types[i], frame[0]);
+	}
+}
+
+TEST_F(UplinkCodec, decode$WHENFrameIsLostTHENDecoderWaitsForAKeyframe) {
+	ASSERT_EQ(SUCCESS, transfer());
+	setPacket(snapshot.sensor_data, sensor::DISTANCE, -4);
+	ASSERT_EQ(SUCCESS, encoder.encode(snapshot, frame, sizeof(frame), &frame_length));
+	setPacket(snapshot.sensor_data, sensor::DISTANCE, 6);
+	EXPECT_EQ(FAILURE_TO_SYNC, transfer());
+	encoder.requestKeyframe();
+	ASSERT_EQ(SUCCESS, transfer());
+	EXPECT_EQ(6, state::get<sensor::DISTANCE>(decoded, 0).value);
+}
+
+TEST_F(UplinkCodec, decode$WHENFrameIsMalformedTHENErrorIsReturned) {
+	ASSERT_EQ(SUCCESS, encoder.encode(snapshot, frame, sizeof(frame), &frame_length));
+	EXPECT_EQ(INVALID_PARAMETER, decoder.decode(frame, (frame_length - 1), &decoded));
+	EXPECT_EQ(FAILURE_TO_SYNC, transfer());
+}
+
+TEST_F(UplinkCodec, encode$WHENRobotCruisesTHENMostFramesAreAHandfulOfBytes) {
+	telemetry::uplink_encoder cruise_encoder;
+	size_t delta_bytes(0), delta_frames(0);
+	for ( int i = 0 ; i < 256 ; ++i ) {
+		setPacket(snapshot.sensor_data, sensor::LEFT_ENCODER_COUNTS, (i * 7));
+		setPacket(snapshot.sensor_data, sensor::RIGHT_ENCODER_COUNTS, (i * 7));
+		setPacket(snapshot.sensor_data, sensor::VOLTAGE, (16213 - (i % 3)));
+		ASSERT_EQ(SUCCESS, cruise_encoder.encode(snapshot, frame, sizeof(frame), &frame_length));
+		ASSERT_EQ(SUCCESS, decoder.decode(frame, frame_length, &decoded));
+		ASSERT_EQ(0, memcmp(&snapshot.sensor_data, &decoded, sizeof(decoded)));
+		if ( telemetry::UPLINK_DELTA == frame[0] ) {
+			delta_bytes += frame_length;
+			++delta_frames;
+		}
+	}
+	EXPECT_EQ(252u, delta_frames);
+	EXPECT_GE((8 * delta_frames), delta_bytes);
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
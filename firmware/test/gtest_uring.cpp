@@ -0,0 +1,232 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../robot.h"
+#include "../uring.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+const sensor::PacketId STREAM_KEY[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+const uint_opt8_t FRAME_DISTANCE_MINUS_200[6] = { 19, 3, 19, 0xFF, 0x38, 0xA0 };
+const uint_opt8_t FRAME_DISTANCE_100[6] = { 19, 3, 19, 0x00, 0x64, 0x73 };
+
+/// \brief Poll until the expected number of frames are committed
+inline
+size_t
+pollForFrames (
+	serial::posix::uring & engine_,
+	const size_t frames_expected_
+) {
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + std::chrono::seconds(2));
+	size_t frames_committed(0);
+	while ( frames_committed < frames_expected_ && std::chrono::steady_clock::now() < deadline ) {
+		frames_committed += engine_.poll(100);
+	}
+	return frames_committed;
+}
+
+/// \brief Read the bytes written to a pseudo terminal
+inline
+std::vector<uint_opt8_t>
+readFromDevice (
+	const int master_fd_,
+	const size_t bytes_expected_
+) {
+	std::vector<uint_opt8_t> data;
+	uint_opt8_t buffer[64];
+	struct pollfd pfd = { master_fd_, POLLIN, 0 };
+	while ( data.size() < bytes_expected_ && ::poll(&pfd, 1, 1000) > 0 ) {
+		const ssize_t bytes_read = ::read(master_fd_, buffer, sizeof(buffer));
+		if ( bytes_read <= 0 ) { break; }
+		data.insert(data.end(), buffer, (buffer + bytes_read));
+	}
+	return data;
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+/// \brief Runs every scenario on io_uring and on the epoll fallback
+class PseudoTerminals : public ::testing::TestWithParam<bool> {
+  protected:
+	static const size_t PORT_COUNT = 3;
+
+	PseudoTerminals (
+		void
+	) :
+		master_fd{ -1, -1, -1 },
+		engine(GetParam())
+	{
+		for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) { robot_state[i].reset(new state::robot_state(tty[i])); }
+	}
+
+	virtual void SetUp() {
+		for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) {
+			master_fd[i] = ::posix_openpt(O_RDWR | O_NOCTTY);
+			ASSERT_LE(0, master_fd[i]);
+			ASSERT_EQ(0, ::grantpt(master_fd[i]));
+			ASSERT_EQ(0, ::unlockpt(master_fd[i]));
+			ASSERT_EQ(SUCCESS, tty[i].openSerialPort(::ptsname(master_fd[i])));
+			ASSERT_EQ(SUCCESS, robot_state[i]->setStreamKey(STREAM_KEY));
+		}
+	}
+	virtual void TearDown() {
+		for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) {
+			tty[i].closeSerialPort();
+			if ( -1 != master_fd[i] ) { ::close(master_fd[i]); }
+		}
+	}
+
+	int master_fd[PORT_COUNT];
+	serial::posix::tty tty[PORT_COUNT];
+	std::unique_ptr<state::robot_state> robot_state[PORT_COUNT];
+	serial::posix::uring engine;
+};
+
+TEST(Uring, constructor$WHENIoUringIsNotRequestedTHENEpollIsUsed) {
+	serial::posix::uring engine(false);
+	EXPECT_FALSE(engine.usingIoUring());
+}
+
+TEST(Uring, attach$WHENTtyIsClosedTHENParameterIsInvalid) {
+	serial::posix::uring engine;
+	serial::posix::tty tty;
+	state::robot_state robot_state(tty);
+	EXPECT_EQ(INVALID_PARAMETER, engine.attach(tty, robot_state));
+	EXPECT_EQ(0u, engine.attached());
+}
+
+TEST(Uring, write$WHENTtyIsNotAttachedTHENParameterIsInvalid) {
+	serial::posix::uring engine;
+	serial::posix::tty tty;
+	const uint_opt8_t command[1] = { 128 };
+	EXPECT_EQ(INVALID_PARAMETER, engine.write(tty, command, sizeof(command)));
+}
+
+TEST_P(PseudoTerminals, attach$WHENTtyIsAlreadyAttachedTHENParameterIsInvalid) {
+	EXPECT_EQ(SUCCESS, engine.attach(tty[0], *robot_state[0]));
+	EXPECT_EQ(INVALID_PARAMETER, engine.attach(tty[0], *robot_state[1]));
+	EXPECT_EQ(1u, engine.attached());
+}
+
+TEST_P(PseudoTerminals, detach$WHENTtyIsAttachedTHENItIsRemoved) {
+	EXPECT_EQ(SUCCESS, engine.attach(tty[0], *robot_state[0]));
+	EXPECT_EQ(SUCCESS, engine.attach(tty[1], *robot_state[1]));
+	EXPECT_EQ(SUCCESS, engine.detach(tty[0]));
+	EXPECT_EQ(1u, engine.attached());
+	EXPECT_EQ(INVALID_PARAMETER, engine.detach(tty[0]));
+}
+
+TEST_P(PseudoTerminals, detach$WHENTtyIsDetachedTHENItsStreamIsIgnored) {
+	ASSERT_EQ(SUCCESS, engine.attach(tty[0], *robot_state[0]));
+	ASSERT_EQ(SUCCESS, engine.detach(tty[0]));
+	ASSERT_EQ(6, ::write(master_fd[0], FRAME_DISTANCE_100, 6));
+
+	engine.poll(100);
+	EXPECT_TRUE(robot_state[0]->get<sensor::DISTANCE>().dirty);
+}
+
+TEST_P(PseudoTerminals, poll$WHENFramesArriveOnManyTtysTHENEachStateReceivesItsOwnFrame) {
+	for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) { ASSERT_EQ(SUCCESS, engine.attach(tty[i], *robot_state[i])); }
+	ASSERT_EQ(6, ::write(master_fd[0], FRAME_DISTANCE_MINUS_200, 6));
+	ASSERT_EQ(6, ::write(master_fd[1], FRAME_DISTANCE_100, 6));
+	ASSERT_EQ(6, ::write(master_fd[2], FRAME_DISTANCE_MINUS_200, 6));
+
+	EXPECT_EQ(3u, pollForFrames(engine, 3));
+	EXPECT_EQ(-200, robot_state[0]->get<sensor::DISTANCE>().value);
+	EXPECT_EQ(100, robot_state[1]->get<sensor::DISTANCE>().value);
+	EXPECT_EQ(-200, robot_state[2]->get<sensor::DISTANCE>().value);
+}
+
+TEST_P(PseudoTerminals, poll$WHENManyFramesArriveTHENReadsStayArmed) {
+	ASSERT_EQ(SUCCESS, engine.attach(tty[0], *robot_state[0]));
+	size_t frames_committed(0);
+	for ( size_t i = 0 ; i < 200 ; ++i ) {
+		ASSERT_EQ(6, ::write(master_fd[0], ((i & 0x01) ? FRAME_DISTANCE_100 : FRAME_DISTANCE_MINUS_200), 6));
+		frames_committed += engine.poll(0);
+	}
+
+	EXPECT_EQ(200u, (frames_committed + pollForFrames(engine, (200 - frames_committed))));
+	EXPECT_EQ(100, robot_state[0]->get<sensor::DISTANCE>().value);
+}
+
+TEST_P(PseudoTerminals, poll$WHENATtyIsSilentTHENTheOthersAreServicedWithoutDelay) {
+	for ( size_t i = 0 ; i < PORT_COUNT ; ++i ) { ASSERT_EQ(SUCCESS, engine.attach(tty[i], *robot_state[i])); }
+	ASSERT_EQ(6, ::write(master_fd[1], FRAME_DISTANCE_100, 6));
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EXPECT_EQ(1u, pollForFrames(engine, 1));
+	EXPECT_GT(500, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+	EXPECT_TRUE(robot_state[0]->get<sensor::DISTANCE>().dirty);
+}
+
+TEST_P(PseudoTerminals, poll$WHENTheDeviceHangsUpTHENTheTtyIsDetached) {
+	ASSERT_EQ(SUCCESS, engine.attach(tty[0], *robot_state[0]));
+	ASSERT_EQ(SUCCESS, engine.attach(tty[1], *robot_state[1]));
+	::close(master_fd[0]);
+	master_fd[0] = -1;
+
+	engine.poll(100);
+	EXPECT_EQ(1u, engine.attached());
+}
+
+TEST_P(PseudoTerminals, write$WHENCommandsAreQueuedTHENTheyArriveInOrderAfterPoll) {
+	const uint_opt8_t start[1] = { 128 };
+	const uint_opt8_t safe[1] = { 131 };
+	ASSERT_EQ(SUCCESS, engine.attach(tty[0], *robot_state[0]));
+	ASSERT_EQ(SUCCESS, engine.attach(tty[1], *robot_state[1]));
+	EXPECT_EQ(SUCCESS, engine.write(tty[0], start, sizeof(start)));
+	EXPECT_EQ(SUCCESS, engine.write(tty[0], safe, sizeof(safe)));
+	EXPECT_EQ(SUCCESS, engine.write(tty[1], safe, sizeof(safe)));
+
+	engine.poll(0);
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128, 131 }), readFromDevice(master_fd[0], 2));
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 131 }), readFromDevice(master_fd[1], 1));
+}
+
+TEST_P(PseudoTerminals, multiByteSerialWrite$WHENARobotDrivesThroughTheEngineTHENCommandsAreBatched) {
+	serial::posix::uring_port port(engine, tty[0]);
+	robot<OI500> roomba(port);
+	ASSERT_EQ(SUCCESS, engine.attach(tty[0], roomba.getState()));
+	EXPECT_EQ(SUCCESS, roomba.start());
+	EXPECT_EQ(SUCCESS, roomba.drive(-200, 500));
+
+	engine.poll(0);
+	EXPECT_EQ(std::vector<uint_opt8_t>({ 128, 137, 0xFF, 0x38, 0x01, 0xF4 }), readFromDevice(master_fd[0], 6));
+}
+
+TEST_P(PseudoTerminals, run$WHENStopIsCalledFromAnotherThreadTHENRunReturns) {
+	ASSERT_EQ(SUCCESS, engine.attach(tty[0], *robot_state[0]));
+	std::thread stopper([this] () {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		::write(master_fd[0], FRAME_DISTANCE_100, 6);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		engine.stop();
+	});
+
+	EXPECT_EQ(SUCCESS, engine.run());
+	stopper.join();
+	EXPECT_EQ(100, robot_state[0]->get<sensor::DISTANCE>().value);
+}
+
+INSTANTIATE_TEST_CASE_P(Engine, PseudoTerminals, ::testing::Values(true, false));
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
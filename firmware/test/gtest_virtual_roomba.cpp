@@ -0,0 +1,301 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "gtest/gtest.h"
+#include "gmock/gmock.h"
+#include "../robot.h"
+#include "../virtual_roomba.h"
+
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <memory>
+#include <vector>
+
+using namespace roomba;
+
+namespace {
+
+  /********************/
+ /* HELPER FUNCTIONS */
+/********************/
+const sensor::PacketId STREAM_KEY[2] = { static_cast<sensor::PacketId>(2), sensor::DISTANCE };
+
+/// \brief Read the stream frames waiting, and sum the distances
+/// \param [in] robot_ The robot bound to the virtual Roomba
+/// \param [out] frames_ Receives the number of frames committed
+/// \return The sum of the distances reported
+int_opt32_t
+sumStreamedDistance (
+	robot<OI500> & robot_,
+	size_t * const frames_
+) {
+	serial::virtual_roomba & roomba = static_cast<serial::virtual_roomba &>(robot_.getState().getSerialPort());
+	std::vector<uint_opt8_t> data(roomba.bytesAvailable());
+	const size_t length = roomba.multiByteSerialRead(data.data(), data.size(), 0);
+	int_opt32_t distance(0);
+	*frames_ = 0;
+
+	for ( size_t offset = 0 ; offset < length ; ) {
+		size_t consumed(0);
+		const ReturnCode rc = robot_.getState().parseStreamBuffer((data.data() + offset), (length - offset), &consumed);
+		offset += consumed;
+		if ( SUCCESS != rc ) { continue; }
+		distance += robot_.getState().get<sensor::DISTANCE>().value;
+		++*frames_;
+	}
+
+	return distance;
+}
+
+  /******************/
+ /* MOCK SCENARIOS */
+/******************/
+class VirtualRoomba : public ::testing::Test {
+  protected:
+	VirtualRoomba (
+		void
+	) :
+		roomba(roomba_port)
+	{}
+
+	virtual void SetUp() {
+		ASSERT_EQ(SUCCESS, roomba.getState().setStreamKey(STREAM_KEY));
+	}
+
+	serial::virtual_roomba roomba_port;
+	robot<OI500> roomba;
+};
+
+TEST_F(VirtualRoomba, multiByteSerialWrite$WHENTheOIIsNotStartedTHENCommandsAreIgnored) {
+	EXPECT_EQ(SUCCESS, roomba.safe());
+	EXPECT_EQ(OFF, roomba_port.getOIMode());
+	EXPECT_EQ(OFF, roomba_port.getPacket(sensor::OI_MODE));
+}
+
+TEST_F(VirtualRoomba, multiByteSerialWrite$WHENModesAreCommandedTHENTheModeFollows) {
+	roomba.start();
+	EXPECT_EQ(PASSIVE, roomba_port.getOIMode());
+	roomba.safe();
+	EXPECT_EQ(SAFE, roomba_port.getOIMode());
+	roomba.full();
+	EXPECT_EQ(FULL, roomba_port.getOIMode());
+	roomba.clean();
+	EXPECT_EQ(PASSIVE, roomba_port.getOIMode());
+}
+
+TEST_F(VirtualRoomba, multiByteSerialWrite$WHENACommandIsSplitAcrossWritesTHENItIsExecuted) {
+	const uint_opt8_t drive_direct[6] = { command::SAFE, command::DRIVE_DIRECT, 0x00, 0x64, 0xFF, 0xCE };
+	roomba.start();
+	roomba_port.multiByteSerialWrite(drive_direct, 3);
+	roomba_port.multiByteSerialWrite((drive_direct + 3), 3);
+
+	int_opt16_t right(0), left(0);
+	roomba_port.getWheelVelocities(&right, &left);
+	EXPECT_EQ(100, right);
+	EXPECT_EQ(-50, left);
+}
+
+TEST_F(VirtualRoomba, driveDirect$WHENPassiveTHENTheWheelsDoNotMove) {
+	roomba.start();
+	roomba.driveDirect(100, 100);
+
+	int_opt16_t right(1), left(1);
+	roomba_port.getWheelVelocities(&right, &left);
+	EXPECT_EQ(0, right);
+	EXPECT_EQ(0, left);
+}
+
+TEST_F(VirtualRoomba, drive$WHENARadiusIsGivenTHENTheWheelsFollowTheArc) {
+	roomba.start();
+	roomba.safe();
+	roomba.drive(200, 235);
+
+	int_opt16_t right(0), left(0);
+	roomba_port.getWheelVelocities(&right, &left);
+	EXPECT_EQ(300, right);
+	EXPECT_EQ(100, left);
+	EXPECT_EQ(200, roomba_port.getPacket(sensor::REQUESTED_VELOCITY));
+	EXPECT_EQ(235, roomba_port.getPacket(sensor::REQUESTED_RADIUS));
+}
+
+TEST_F(VirtualRoomba, drive$WHENTurningInPlaceTHENTheAngleAccumulates) {
+	roomba.start();
+	roomba.full();
+	roomba.drive(100, -1);
+	roomba_port.advance(std::chrono::seconds(1));
+
+	// 200 mm/s across a 235 mm wheel base, clockwise
+	const double expected_rad = -(200.0 / 235.0);
+	EXPECT_NEAR(expected_rad, roomba_port.getPose().heading_rad, 0.05);
+	EXPECT_NEAR((expected_rad * 180.0 / M_PI), roomba_port.getPacket(sensor::ANGLE), 1.0);
+	EXPECT_EQ(0, roomba_port.getPacket(sensor::DISTANCE));
+}
+
+TEST_F(VirtualRoomba, sensors$WHENRequestedTHENTheValueIsSent) {
+	uint_opt8_t response[2] = { 0 };
+	roomba.start();
+	roomba.sensors(sensor::VOLTAGE);
+
+	EXPECT_EQ(2u, roomba_port.multiByteSerialRead(response, sizeof(response), 0));
+	EXPECT_EQ(0x3E, response[0]);
+	EXPECT_EQ(0x80, response[1]);
+}
+
+TEST_F(VirtualRoomba, queryListAsync$WHENServicedTHENTheStateHoldsTheValues) {
+	const sensor::PacketId sensor_list[2] = { sensor::OI_MODE, sensor::BATTERY_CHARGE };
+	std::future<ReturnCode> completion;
+	roomba.start();
+	roomba.safe();
+
+	ASSERT_EQ(SUCCESS, roomba.queryListAsync(sensor_list, 2, &completion));
+	EXPECT_EQ(SUCCESS, roomba.getState().serviceQueries());
+	EXPECT_EQ(SUCCESS, completion.get());
+	EXPECT_EQ(SAFE, roomba.getState().get<sensor::OI_MODE>().value);
+	EXPECT_EQ(2600, roomba.getState().get<sensor::BATTERY_CHARGE>().value);
+}
+
+TEST_F(VirtualRoomba, stream$WHENStreamingTHENAValidFrameIsSentEveryStep) {
+	const sensor::PacketId sensor_list[2] = { sensor::DISTANCE, sensor::OI_MODE };
+	roomba.start();
+	roomba.stream(sensor_list, 2);
+	roomba_port.advance(std::chrono::milliseconds(45));
+	ASSERT_EQ(24u, roomba_port.bytesAvailable());
+
+	uint_opt8_t frames[24];
+	ASSERT_EQ(24u, roomba_port.multiByteSerialRead(frames, sizeof(frames), 0));
+	for ( size_t frame = 0 ; frame < 3 ; ++frame ) {
+		const uint_opt8_t * const data = (frames + (frame * 8));
+		EXPECT_EQ(19, data[0]);
+		EXPECT_EQ(5, data[1]);
+		EXPECT_EQ(sensor::DISTANCE, data[2]);
+		EXPECT_EQ(sensor::OI_MODE, data[5]);
+		EXPECT_EQ(PASSIVE, data[6]);
+		uint_opt8_t checksum(0);
+		for ( size_t i = 0 ; i < 8 ; ++i ) { checksum += data[i]; }
+		EXPECT_EQ(0, checksum);
+	}
+}
+
+TEST_F(VirtualRoomba, stream$WHENPausedTHENNoFramesAreSent) {
+	roomba.start();
+	roomba.stream(STREAM_KEY + 1, 1);
+	roomba.pauseResumeStream(false);
+	roomba_port.advance(std::chrono::milliseconds(150));
+
+	EXPECT_EQ(0u, roomba_port.bytesAvailable());
+}
+
+TEST_F(VirtualRoomba, stream$WHENDrivingTHENTheFramesReportTheDistanceTravelled) {
+	size_t frames(0);
+	roomba.start();
+	roomba.safe();
+	roomba.stream(STREAM_KEY + 1, 1);
+	roomba.driveDirect(100, 100);
+	roomba_port.advance(std::chrono::milliseconds(990));
+
+	EXPECT_EQ(99, sumStreamedDistance(roomba, &frames));
+	EXPECT_EQ(66u, frames);
+	EXPECT_NEAR(99.0, roomba_port.getPose().x_mm, 0.001);
+	EXPECT_NEAR(0.0, roomba_port.getPose().y_mm, 0.001);
+	// 508.8 counts per revolution of a 72 mm wheel
+	EXPECT_EQ(static_cast<int_opt32_t>(99.0 * 508.8 / (72.0 * M_PI)), roomba_port.getPacket(sensor::LEFT_ENCODER_COUNTS));
+	EXPECT_EQ(roomba_port.getPacket(sensor::LEFT_ENCODER_COUNTS), roomba_port.getPacket(sensor::RIGHT_ENCODER_COUNTS));
+}
+
+TEST_F(VirtualRoomba, play$WHENASongIsPlayedTHENItPlaysForItsDuration) {
+	const note_t notes[2] = { { C_4, 32 }, { D_4, 32 } };
+	roomba.start();
+	roomba.song(1, notes, 2);
+	roomba.play(1);
+	EXPECT_EQ(0, roomba_port.getPacket(sensor::SONG_PLAYING));
+
+	roomba.safe();
+	roomba.play(1);
+	roomba_port.advance(std::chrono::milliseconds(990));
+	EXPECT_EQ(1, roomba_port.getPacket(sensor::SONG_PLAYING));
+	EXPECT_EQ(1, roomba_port.getPacket(sensor::SONG_NUMBER));
+	roomba_port.advance(std::chrono::milliseconds(15));
+	EXPECT_EQ(0, roomba_port.getPacket(sensor::SONG_PLAYING));
+}
+
+TEST_F(VirtualRoomba, motors$WHENSafeTHENTheMotorsAreEngaged) {
+	roomba.start();
+	roomba.safe();
+	roomba.motors(static_cast<bitmask::MotorStates>(bitmask::MAIN_BRUSH_ENGAGED | bitmask::VACUUM_ENGAGED));
+
+	EXPECT_EQ((bitmask::MAIN_BRUSH_ENGAGED | bitmask::VACUUM_ENGAGED), roomba_port.getMotors());
+	roomba.spot();
+	EXPECT_EQ(0, roomba_port.getMotors());
+}
+
+TEST_F(VirtualRoomba, setPacket$WHENACliffIsDetectedInSafeModeTHENTheRoombaStopsInPassive) {
+	roomba.start();
+	roomba.safe();
+	roomba.driveDirect(100, 100);
+	EXPECT_EQ(SUCCESS, roomba_port.setPacket(sensor::CLIFF_FRONT_LEFT, 1));
+	roomba_port.advance(std::chrono::milliseconds(15));
+
+	int_opt16_t right(1), left(1);
+	roomba_port.getWheelVelocities(&right, &left);
+	EXPECT_EQ(PASSIVE, roomba_port.getOIMode());
+	EXPECT_EQ(0, right);
+	EXPECT_EQ(0, left);
+}
+
+TEST_F(VirtualRoomba, setPacket$WHENTheValueIsSimulatedTHENInvalidParameterIsReturned) {
+	EXPECT_EQ(INVALID_PARAMETER, roomba_port.setPacket(sensor::DISTANCE, 1));
+	EXPECT_EQ(INVALID_PARAMETER, roomba_port.setPacket(sensor::OI_MODE, FULL));
+	EXPECT_EQ(INVALID_PARAMETER, roomba_port.setPacket(sensor::PACKETS_7_THRU_58, 0));
+	EXPECT_EQ(SUCCESS, roomba_port.setPacket(sensor::TEMPERATURE, -5));
+	EXPECT_EQ(-5, roomba_port.getPacket(sensor::TEMPERATURE));
+}
+
+TEST_F(VirtualRoomba, multiByteSerialRead$WHENWaitingInSimulatedTimeTHENTheSimulationAdvances) {
+	uint_opt8_t frame[6];
+	roomba.start();
+	roomba.stream(STREAM_KEY + 1, 1);
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EXPECT_EQ(6u, roomba_port.multiByteSerialRead(frame, sizeof(frame), 1000));
+	EXPECT_GT(15, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+	EXPECT_EQ(19, frame[0]);
+}
+
+TEST(VirtualRoombaRealTime, multiByteSerialRead$WHENStreamingTHENAFrameArrivesWithinAStep) {
+	serial::virtual_roomba roomba_port(serial::virtual_roomba::REAL_TIME);
+	robot<OI500> roomba(roomba_port);
+	uint_opt8_t frame[6];
+	roomba.start();
+	roomba.stream(STREAM_KEY + 1, 1);
+
+	EXPECT_EQ(6u, roomba_port.multiByteSerialRead(frame, sizeof(frame), 100));
+	EXPECT_EQ(19, frame[0]);
+	EXPECT_EQ(0, roomba_port.multiByteSerialRead(frame, sizeof(frame), 0));
+}
+
+TEST(VirtualRoombaFleet, stream$WHENManyRoombasStreamTHENEveryFrameIsValid) {
+	const size_t ROOMBA_COUNT = 200;
+	std::vector<std::unique_ptr<serial::virtual_roomba>> roomba_ports;
+	std::vector<std::unique_ptr<robot<OI500>>> roombas;
+	for ( size_t i = 0 ; i < ROOMBA_COUNT ; ++i ) {
+		roomba_ports.emplace_back(new serial::virtual_roomba());
+		roombas.emplace_back(new robot<OI500>(*roomba_ports.back()));
+		ASSERT_EQ(SUCCESS, roombas.back()->getState().setStreamKey(STREAM_KEY));
+		roombas.back()->start();
+		roombas.back()->full();
+		roombas.back()->driveDirect(static_cast<int_opt16_t>(i), static_cast<int_opt16_t>(i));
+		roombas.back()->stream(STREAM_KEY + 1, 1);
+	}
+
+	for ( size_t i = 0 ; i < ROOMBA_COUNT ; ++i ) {
+		size_t frames(0);
+		roomba_ports[i]->advance(std::chrono::milliseconds(600));
+		EXPECT_EQ(static_cast<int_opt32_t>((i * 6) / 10), sumStreamedDistance(*roombas[i], &frames));
+		EXPECT_EQ(40u, frames);
+		EXPECT_EQ(0u, roombas[i]->getState().getStreamStatistics().frames_dropped);
+	}
+}
+
+} // namespace
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,201 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "uart_scheduler.h"
+#include "packets.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace roomba {
+namespace serial {
+
+namespace {
+	/// \brief Bytes of line time left to commands by an accepted stream
+	/// \details Enough for one drive command per slot.
+	const int_fast32_t COMMAND_RESERVE_BYTES(5);
+
+	/// \brief Duration of the sensor update loop of the Roomba (in
+	/// microseconds)
+	const int_fast32_t SLOT_US(15000);
+
+	/// \brief Duration of the sensor update loop of the Roomba
+	const std::chrono::microseconds SLOT(SLOT_US);
+
+	/// \brief Line time of one byte at a baud rate (8N1, rounded up)
+	inline
+	int_fast32_t
+	_byteTimeUs (
+		const BaudCode baud_code_
+	) {
+		const uint_opt32_t baud_rate = BAUD_RATE[std::min<uint_opt8_t>(baud_code_, BAUD_115200)];
+		return static_cast<int_fast32_t>((10000000 + baud_rate - 1) / baud_rate);
+	}
+} // namespace
+
+uart_scheduler::uart_scheduler (
+	port & port_,
+	const BaudCode baud_code_
+) :
+	_port(port_),
+	_byte_us(_byteTimeUs(baud_code_)),
+	_credit_us(SLOT_US),
+	_slot_start(std::chrono::steady_clock::now()),
+	_stream_frame_bytes(0),
+	_stream_paused(false)
+{}
+
+/// \brief Line time of a slot left to commands
+/// \details Never less than one byte, so commands are not blocked by
+/// a stream reserved at a faster rate.
+inline
+int_fast32_t
+uart_scheduler::_commandAllowanceUs (
+	void
+) const {
+	return std::max<int_fast32_t>((SLOT_US - (static_cast<int_fast32_t>(streamReservation()) * _byte_us)), _byte_us);
+}
+
+/// \brief Track the stream commands passing through the scheduler
+/// \return false when the command must be rejected
+inline
+bool
+uart_scheduler::_inspectCommand (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	if ( data_length_ < 2 ) { return true; }
+
+	if ( command::STREAM == serial_data_[0] ) {
+		const uint_opt8_t byte_length = static_cast<uint_opt8_t>(std::min<size_t>(serial_data_[1], (data_length_ - 2)));
+		const size_t frame_bytes = streamFrameBytes(reinterpret_cast<const sensor::PacketId *>(serial_data_ + 2), byte_length);
+		if ( ((static_cast<int_fast32_t>(frame_bytes) + COMMAND_RESERVE_BYTES) * _byte_us) > SLOT_US ) { return false; }
+		_stream_frame_bytes = frame_bytes;
+		_stream_paused = false;
+		_credit_us = std::min(_credit_us, _commandAllowanceUs());
+	} else if ( command::PAUSE_RESUME_STREAM == serial_data_[0] ) {
+		_stream_paused = !serial_data_[1];
+	}
+
+	return true;
+}
+
+/// \brief Begin the slots elapsed, and credit their allowance
+/// \details Credit does not accumulate beyond a single slot, so an idle
+/// period can not be spent as a burst.
+inline
+void
+uart_scheduler::_refreshSlot (
+	const std::chrono::steady_clock::time_point now_
+) {
+	const auto slots_elapsed = ((now_ - _slot_start) / SLOT);
+	if ( slots_elapsed <= 0 ) { return; }
+
+	const int_fast32_t allowance_us = _commandAllowanceUs();
+	_slot_start += (slots_elapsed * SLOT);
+	_credit_us = static_cast<int_fast32_t>(std::min<int_fast64_t>((_credit_us + (static_cast<int_fast64_t>(slots_elapsed) * allowance_us)), allowance_us));
+}
+
+void
+uart_scheduler::beginAtBaudCode (
+	const BaudCode baud_code_
+) {
+	_port.beginAtBaudCode(baud_code_);
+	_byte_us = _byteTimeUs(baud_code_);
+	_credit_us = std::min(_credit_us, _commandAllowanceUs());
+}
+
+size_t
+uart_scheduler::multiByteSerialRead (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_,
+	const uint_opt32_t timeout_ms_
+) {
+	return _port.multiByteSerialRead(data_buffer_, buffer_length_, timeout_ms_);
+}
+
+size_t
+uart_scheduler::multiByteSerialWrite (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	if ( !_inspectCommand(serial_data_, data_length_) ) { return 0; }
+
+	size_t bytes_written(0);
+	while ( bytes_written < data_length_ ) {
+		_refreshSlot(std::chrono::steady_clock::now());
+		if ( _credit_us <= 0 ) {
+			std::this_thread::sleep_until(_slot_start + SLOT);
+			continue;
+		}
+
+		const size_t chunk = std::min<size_t>((data_length_ - bytes_written), std::max<int_fast32_t>((_credit_us / _byte_us), 1));
+		const size_t chunk_written = _port.multiByteSerialWrite((serial_data_ + bytes_written), chunk);
+		bytes_written += chunk_written;
+		_credit_us -= (static_cast<int_fast32_t>(chunk_written) * _byte_us);
+		if ( chunk_written != chunk ) { break; }
+	}
+
+	return bytes_written;
+}
+
+uint_opt8_t
+uart_scheduler::fitStreamList (
+	const sensor::PacketId * const sensor_list_,
+	const uint_opt8_t byte_length_
+) const {
+	if ( !sensor_list_ ) { return 0; }
+
+	uint_opt8_t packets_fit(0);
+	for ( uint_opt8_t i = 1 ; i <= byte_length_ ; ++i ) {
+		if ( ((static_cast<int_fast32_t>(streamFrameBytes(sensor_list_, i)) + COMMAND_RESERVE_BYTES) * _byte_us) > SLOT_US ) { break; }
+		packets_fit = i;
+	}
+
+	return packets_fit;
+}
+
+size_t
+uart_scheduler::remainingBudget (
+	void
+) const {
+	const auto slots_elapsed = ((std::chrono::steady_clock::now() - _slot_start) / SLOT);
+	const int_fast32_t allowance_us = _commandAllowanceUs();
+	const int_fast32_t credit_us = static_cast<int_fast32_t>(std::min<int_fast64_t>((_credit_us + (static_cast<int_fast64_t>(slots_elapsed) * allowance_us)), allowance_us));
+
+	return ( (credit_us > 0) ? static_cast<size_t>(credit_us / _byte_us) : 0 );
+}
+
+size_t
+uart_scheduler::slotCapacity (
+	void
+) const {
+	return static_cast<size_t>(SLOT_US / _byte_us);
+}
+
+size_t
+uart_scheduler::streamReservation (
+	void
+) const {
+	return ( _stream_paused ? 0 : _stream_frame_bytes );
+}
+
+size_t
+uart_scheduler::streamFrameBytes (
+	const sensor::PacketId * const sensor_list_,
+	const uint_opt8_t byte_length_
+) {
+	if ( !sensor_list_ ) { return 0; }
+
+	size_t frame_bytes(3);
+	for ( uint_opt8_t i = 0 ; i < byte_length_ ; ++i ) {
+		if ( !sensor::isDefinedPacketId(sensor_list_[i]) ) { continue; }
+		frame_bytes += (1 + sensor::packetDescriptor(sensor_list_[i]).size);
+	}
+
+	return frame_bytes;
+}
+
+} // namespace serial
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,148 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef UART_SCHEDULER_H
+#define UART_SCHEDULER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "defines.h"
+#include "serial_port.h"
+
+namespace roomba {
+namespace serial {
+
+/// \brief Budgets the serial line of a Roomba per 15 ms slot
+/// \details The Roomba updates its sensors, and sends a stream frame,
+/// every 15 ms. The scheduler divides the time of the line in each slot
+/// between the inbound stream and the outbound commands, at the rate of
+/// the current baud code (10 bits per byte).
+/// \n A stream command is rejected when its frame, plus room for one
+/// drive command, does not fit in the slot. Otherwise the frame is
+/// reserved in every slot (until the stream is paused), and commands are
+/// paced to the remainder: a write exceeding the budget of the slot is
+/// split, and the remainder is written as the following slots begin.
+/// A burst of commands therefore can not starve the stream.
+/// \note A stream command is recognized when it begins a write.
+/// \note The line is budgeted as a whole, which is conservative for a
+/// full-duplex UART, but matches the single 15 ms loop of the Roomba
+/// servicing both directions.
+/// \see open_interface::stream
+class uart_scheduler : public port {
+  public:
+	/// \param [in] port_ The port connected to the Roomba
+	/// \param [in] baud_code_ The baud code of the line [default
+	/// value: BAUD_115200 (the Roomba default)]
+	explicit
+	uart_scheduler (
+		port & port_,
+		const BaudCode baud_code_ = BAUD_115200
+	);
+
+	/// \brief Begin the serial connection and rescale the budget
+	/// \note A stream reserved at a faster rate is kept, even when it
+	/// no longer fits in the slot.
+	/// \see port::beginAtBaudCode
+	void
+	beginAtBaudCode (
+		const BaudCode baud_code_
+	) override;
+
+	/// \see port::multiByteSerialRead
+	size_t
+	multiByteSerialRead (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_,
+		const uint_opt32_t timeout_ms_ = 1000
+	) override;
+
+	/// \brief Write to the port within the budget of each slot
+	/// \details Blocks until the last byte has been written.
+	/// \return The number of bytes written, 0 when a stream command is
+	/// rejected
+	size_t
+	multiByteSerialWrite (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	) override;
+
+	/// \brief The number of leading packet ids of a stream list which
+	/// fit in the slot at the current baud rate
+	/// \details Trims a list to its largest prefix which the scheduler
+	/// accepts (i.e. stream(list, fitStreamList(list, length))).
+	/// \param [in] sensor_list_ An array of packet ids
+	/// \param [in] byte_length_ The length of the array
+	/// \return The length of the prefix (0 when no packet fits)
+	uint_opt8_t
+	fitStreamList (
+		const sensor::PacketId * const sensor_list_,
+		const uint_opt8_t byte_length_
+	) const;
+
+	/// \brief The number of command bytes which may be written in the
+	/// current slot without waiting
+	size_t
+	remainingBudget (
+		void
+	) const;
+
+	/// \brief The number of bytes the line carries per slot
+	size_t
+	slotCapacity (
+		void
+	) const;
+
+	/// \brief The number of bytes reserved for the stream per slot
+	/// \return The size of a stream frame (0 when not streaming)
+	size_t
+	streamReservation (
+		void
+	) const;
+
+	/// \brief The size of the stream frame requested by a stream list
+	/// \param [in] sensor_list_ An array of packet ids
+	/// \param [in] byte_length_ The length of the array
+	/// \return The number of bytes of each frame (header, byte count,
+	/// packet ids, values and checksum)
+	static
+	size_t
+	streamFrameBytes (
+		const sensor::PacketId * const sensor_list_,
+		const uint_opt8_t byte_length_
+	);
+
+  private:
+	uart_scheduler (const uart_scheduler &) = delete;
+	uart_scheduler & operator= (const uart_scheduler &) = delete;
+
+	int_fast32_t
+	_commandAllowanceUs (
+		void
+	) const;
+
+	bool
+	_inspectCommand (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	);
+
+	void
+	_refreshSlot (
+		const std::chrono::steady_clock::time_point now_
+	);
+
+	port & _port; ///< port connected to the Roomba
+	int_fast32_t _byte_us; ///< line time of one byte (in microseconds)
+	int_fast32_t _credit_us; ///< line time left to commands in the slot
+	std::chrono::steady_clock::time_point _slot_start; ///< beginning of the current slot
+	size_t _stream_frame_bytes; ///< size of the stream frame requested
+	bool _stream_paused; ///< the stream has been paused
+};
+
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,255 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "uplink_codec.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace roomba {
+namespace telemetry {
+
+namespace {
+	/// \brief Flags of every individual packet (7-58)
+	const uint64_t INDIVIDUAL_PACKETS_FLAG_MASK(((static_cast<uint64_t>(2) << sensor::STASIS) - 1) & ~((static_cast<uint64_t>(1) << sensor::BUMPS_AND_WHEEL_DROPS) - 1));
+
+	/// \brief Append a varint
+	/// \param [in,out] frame_ The frame
+	/// \param [in,out] offset_ Offset of the varint, advanced past it
+	/// \param [in] value_ The value to encode
+	inline
+	void
+	_putVarint (
+		uint_opt8_t * const frame_,
+		size_t * const offset_,
+		uint64_t value_
+	) {
+		while ( value_ >= 0x80 ) {
+			frame_[(*offset_)++] = static_cast<uint_opt8_t>(value_ | 0x80);
+			value_ >>= 7;
+		}
+		frame_[(*offset_)++] = static_cast<uint_opt8_t>(value_);
+	}
+
+	/// \brief Take a varint
+	/// \param [in] frame_ The frame
+	/// \param [in] frame_length_ Size of the frame (in bytes)
+	/// \param [in,out] offset_ Offset of the varint, advanced past it
+	/// \param [out] value_ Receives the value
+	/// \return false when the varint runs past the end of the frame
+	inline
+	bool
+	_takeVarint (
+		const uint_opt8_t * const frame_,
+		const size_t frame_length_,
+		size_t * const offset_,
+		uint64_t * const value_
+	) {
+		*value_ = 0;
+		for ( uint_opt8_t shift = 0 ; *offset_ < frame_length_ && shift < 64 ; shift += 7 ) {
+			const uint_opt8_t byte = frame_[(*offset_)++];
+			*value_ |= (static_cast<uint64_t>(byte & 0x7F) << shift);
+			if ( !(byte & 0x80) ) { return true; }
+		}
+		return false;
+	}
+
+	/// \brief Append a change mask
+	/// \details The flags of the individual packets are split into eight
+	/// groups of seven, and only the groups with a flag set are written,
+	/// after a byte flagging the groups present. A frame of a few changes
+	/// (even to packets of high id) pays one or two bytes for its mask.
+	/// \param [in,out] frame_ The frame
+	/// \param [in,out] offset_ Offset of the mask, advanced past it
+	/// \param [in] flag_mask_ The flags of the packets carried
+	inline
+	void
+	_putChangeMask (
+		uint_opt8_t * const frame_,
+		size_t * const offset_,
+		const uint64_t flag_mask_
+	) {
+		const uint64_t flags = (flag_mask_ >> sensor::BUMPS_AND_WHEEL_DROPS);
+		const size_t groups_present = (*offset_)++;
+		frame_[groups_present] = 0;
+		for ( uint_opt8_t group = 0 ; group < 8 ; ++group ) {
+			const uint_opt8_t group_flags = static_cast<uint_opt8_t>((flags >> (7 * group)) & 0x7F);
+			if ( !group_flags ) { continue; }
+			frame_[groups_present] |= static_cast<uint_opt8_t>(1 << group);
+			frame_[(*offset_)++] = group_flags;
+		}
+	}
+
+	/// \brief Take a change mask
+	/// \param [in] frame_ The frame
+	/// \param [in] frame_length_ Size of the frame (in bytes)
+	/// \param [in,out] offset_ Offset of the mask, advanced past it
+	/// \param [out] flag_mask_ Receives the flags of the packets carried
+	/// \return false when the mask is malformed
+	inline
+	bool
+	_takeChangeMask (
+		const uint_opt8_t * const frame_,
+		const size_t frame_length_,
+		size_t * const offset_,
+		uint64_t * const flag_mask_
+	) {
+		uint64_t flags(0);
+		if ( *offset_ >= frame_length_ ) { return false; }
+		const uint_opt8_t groups_present = frame_[(*offset_)++];
+		for ( uint_opt8_t group = 0 ; group < 8 ; ++group ) {
+			if ( !(groups_present & (1 << group)) ) { continue; }
+			if ( *offset_ >= frame_length_ || !frame_[*offset_] || frame_[*offset_] > 0x7F ) { return false; }
+			flags |= (static_cast<uint64_t>(frame_[(*offset_)++]) << (7 * group));
+		}
+		*flag_mask_ = (flags << sensor::BUMPS_AND_WHEEL_DROPS);
+		return true;
+	}
+
+	/// \brief Read a two byte packet value
+	/// \param [in] value_ The big endian value
+	/// \return The value
+	inline
+	uint16_t
+	_value16 (
+		const uint8_t * const value_
+	) {
+		return static_cast<uint16_t>((value_[0] << 8) | value_[1]);
+	}
+} // namespace
+
+uplink_encoder::uplink_encoder (
+	const uint_opt16_t keyframe_interval_
+) :
+	_keyframe_interval(std::max<uint_opt16_t>(keyframe_interval_, 1)),
+	_frames_until_keyframe(0),
+	_sequence(0)
+{
+	memset(&_reference, 0, sizeof(_reference));
+}
+
+ReturnCode
+uplink_encoder::encode (
+	const state::sensor_snapshot_t & snapshot_,
+	uint_opt8_t * const frame_,
+	const size_t frame_capacity_,
+	size_t * const frame_length_
+) {
+	if ( !frame_ || frame_capacity_ < UPLINK_FRAME_MAX || !frame_length_ ) { return INVALID_PARAMETER; }
+	const bool keyframe = !_frames_until_keyframe;
+	const uint8_t * const sensor_data = reinterpret_cast<const uint8_t *>(&snapshot_.sensor_data);
+	uint8_t * const reference = reinterpret_cast<uint8_t *>(&_reference);
+
+	// Refreshed packets whose value differs from the decoder's
+	uint64_t flag_mask_changed(0);
+	if ( keyframe ) {
+		flag_mask_changed = INDIVIDUAL_PACKETS_FLAG_MASK;
+	} else {
+		const uint64_t flag_mask_received = (~snapshot_.flag_mask_dirty & INDIVIDUAL_PACKETS_FLAG_MASK);
+		for ( uint_opt8_t packet_id = sensor::BUMPS_AND_WHEEL_DROPS ; packet_id <= sensor::STASIS ; ++packet_id ) {
+			const sensor::packet_descriptor_t & descriptor = sensor::PACKET_DESCRIPTOR[packet_id];
+			if ( !(flag_mask_received & descriptor.flag_mask) ) { continue; }
+			if ( memcmp((sensor_data + descriptor.offset), (reference + descriptor.offset), descriptor.size) ) { flag_mask_changed |= descriptor.flag_mask; }
+		}
+	}
+
+	size_t frame_length(0);
+	frame_[frame_length++] = ( keyframe ? UPLINK_KEYFRAME : UPLINK_DELTA );
+	frame_[frame_length++] = _sequence++;
+	_putChangeMask(frame_, &frame_length, flag_mask_changed);
+	for ( uint_opt8_t packet_id = sensor::BUMPS_AND_WHEEL_DROPS ; packet_id <= sensor::STASIS ; ++packet_id ) {
+		const sensor::packet_descriptor_t & descriptor = sensor::PACKET_DESCRIPTOR[packet_id];
+		if ( !(flag_mask_changed & descriptor.flag_mask) ) { continue; }
+		const uint8_t * const value = (sensor_data + descriptor.offset);
+		if ( 1 == descriptor.size ) {
+			frame_[frame_length++] = value[0];
+		} else {
+			// A keyframe is relative to zero, so it stands alone
+			const int16_t delta = static_cast<int16_t>(_value16(value) - ( keyframe ? 0 : _value16(reference + descriptor.offset) ));
+			_putVarint(frame_, &frame_length, ((static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 15)) & 0x1FFFF);
+		}
+		memcpy((reference + descriptor.offset), value, descriptor.size);
+	}
+
+	_frames_until_keyframe = (( keyframe ? _keyframe_interval : _frames_until_keyframe ) - 1);
+	*frame_length_ = frame_length;
+
+	return SUCCESS;
+}
+
+void
+uplink_encoder::requestKeyframe (
+	void
+) {
+	_frames_until_keyframe = 0;
+}
+
+uplink_decoder::uplink_decoder (
+	void
+) :
+	_synchronized(false),
+	_sequence(0)
+{
+	memset(&_reference, 0, sizeof(_reference));
+}
+
+ReturnCode
+uplink_decoder::decode (
+	const uint_opt8_t * const frame_,
+	const size_t frame_length_,
+	state::sensor_data_t * const sensor_data_,
+	uint_opt64_t * const flag_mask_changed_
+) {
+	if ( !frame_ || !sensor_data_ ) { return INVALID_PARAMETER; }
+	if ( frame_length_ < 3 || (UPLINK_KEYFRAME != frame_[0] && UPLINK_DELTA != frame_[0]) ) {
+		_synchronized = false;
+		return INVALID_PARAMETER;
+	}
+	const bool keyframe = (UPLINK_KEYFRAME == frame_[0]);
+	if ( !keyframe && (!_synchronized || frame_[1] != _sequence) ) {
+		_synchronized = false;
+		return FAILURE_TO_SYNC;
+	}
+
+	// Decode into a copy, so a malformed frame is never half applied
+	state::sensor_data_t decoded(_reference);
+	uint8_t * const reference = reinterpret_cast<uint8_t *>(&decoded);
+	size_t offset(2);
+	uint64_t flag_mask_changed(0);
+	bool well_formed = _takeChangeMask(frame_, frame_length_, &offset, &flag_mask_changed);
+	well_formed = (well_formed && ( keyframe ? (INDIVIDUAL_PACKETS_FLAG_MASK == flag_mask_changed) : !(flag_mask_changed & ~INDIVIDUAL_PACKETS_FLAG_MASK) ));
+
+	for ( uint_opt8_t packet_id = sensor::BUMPS_AND_WHEEL_DROPS ; well_formed && packet_id <= sensor::STASIS ; ++packet_id ) {
+		const sensor::packet_descriptor_t & descriptor = sensor::PACKET_DESCRIPTOR[packet_id];
+		if ( !(flag_mask_changed & descriptor.flag_mask) ) { continue; }
+		uint8_t * const value = (reference + descriptor.offset);
+		if ( 1 == descriptor.size ) {
+			if ( offset >= frame_length_ ) { well_formed = false; break; }
+			value[0] = frame_[offset++];
+		} else {
+			uint64_t zig_zag;
+			if ( !_takeVarint(frame_, frame_length_, &offset, &zig_zag) || zig_zag > 0x1FFFF ) { well_formed = false; break; }
+			const int32_t delta = static_cast<int32_t>((zig_zag >> 1) ^ (~(zig_zag & 1) + 1));
+			const uint16_t decoded_value = static_cast<uint16_t>(( keyframe ? 0 : _value16(value) ) + delta);
+			value[0] = static_cast<uint8_t>(decoded_value >> 8);
+			value[1] = static_cast<uint8_t>(decoded_value);
+		}
+	}
+
+	if ( !well_formed || offset != frame_length_ ) {
+		_synchronized = false;
+		return INVALID_PARAMETER;
+	}
+
+	_reference = decoded;
+	_sequence = static_cast<uint8_t>(frame_[1] + 1);
+	_synchronized = true;
+	*sensor_data_ = _reference;
+	if ( flag_mask_changed_ ) { *flag_mask_changed_ = flag_mask_changed; }
+
+	return SUCCESS;
+}
+
+} // namespace telemetry
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
@@ -0,0 +1,129 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef UPLINK_CODEC_H
+#define UPLINK_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "defines.h"
+#include "packets.h"
+#include "state.h"
+
+namespace roomba {
+namespace telemetry {
+
+/// \brief The kind of an uplink frame
+enum UplinkFrameType : uint8_t {
+	UPLINK_KEYFRAME = 1, ///< every individual packet, decodable on its own
+	UPLINK_DELTA = 2, ///< the packets changed since the previous frame
+};
+
+/// \brief Largest uplink frame (in bytes)
+/// \details Type, sequence, a change mask of up to 9 bytes, then every
+/// individual packet as a 3 byte varint.
+const size_t UPLINK_FRAME_MAX = (2 + 9 + ((sensor::STASIS - sensor::BUMPS_AND_WHEEL_DROPS + 1) * 3));
+
+/// \brief Encodes the sensor data of a Roomba for a constrained link
+/// \details Each frame carries only the packets which were refreshed
+/// (by the dirty flags of the snapshot) and whose value changed since
+/// the previous frame. The frame begins with its type and sequence,
+/// followed by the change mask (the flags of the packets carried, in
+/// groups of seven), then the value of each packet carried in ascending
+/// order of packet id. Single byte packets are carried as is, two byte
+/// packets as the zig-zag varint of their difference from the previous
+/// value, so a slowly changing value costs a single byte.
+/// \n A keyframe, carrying every individual packet, is sent first and
+/// then periodically, so a decoder which has missed a frame (or joined
+/// late) is able to resynchronize.
+/// \code
+/// telemetry::uplink_encoder encoder;
+/// uint8_t frame[telemetry::UPLINK_FRAME_MAX];
+/// size_t frame_length;
+/// roomba.getState().getSensorSnapshot(&snapshot);
+/// encoder.encode(snapshot, frame, sizeof(frame), &frame_length);
+/// \endcode
+/// \note Group packets are not carried, their members are.
+/// \see telemetry::uplink_decoder
+class uplink_encoder {
+  public:
+	/// \param [in] keyframe_interval_ Frames sent between keyframes (the
+	/// keyframe included) [default value: 64]
+	explicit
+	uplink_encoder (
+		const uint_opt16_t keyframe_interval_ = 64
+	);
+
+	/// \brief Encode the sensor data of a snapshot
+	/// \param [in] snapshot_ The snapshot to encode
+	/// \param [out] frame_ Receives the frame
+	/// \param [in] frame_capacity_ Size of frame_ (in bytes), must be at
+	/// least UPLINK_FRAME_MAX
+	/// \param [out] frame_length_ Receives the size of the frame (in bytes)
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER
+	ReturnCode
+	encode (
+		const state::sensor_snapshot_t & snapshot_,
+		uint_opt8_t * const frame_,
+		const size_t frame_capacity_,
+		size_t * const frame_length_
+	);
+
+	/// \brief Send a keyframe next
+	/// \details i.e. when the receiver reports a lost frame
+	void
+	requestKeyframe (
+		void
+	);
+
+  private:
+	const uint_opt16_t _keyframe_interval; ///< frames sent between keyframes
+	uint_opt16_t _frames_until_keyframe; ///< frames to send before the next keyframe
+	uint8_t _sequence; ///< sequence of the next frame (modulo 256)
+	state::sensor_data_t _reference; ///< the sensor data held by the decoder
+};
+
+/// \brief Decodes the frames of an uplink_encoder
+/// \details Applies each frame to the sensor data of the previous
+/// frames. A delta frame which does not follow the previous frame (a
+/// frame was lost) cannot be applied, and the decoder waits for the
+/// next keyframe.
+/// \see telemetry::uplink_encoder
+class uplink_decoder {
+  public:
+	uplink_decoder (
+		void
+	);
+
+	/// \brief Apply a frame
+	/// \param [in] frame_ The frame
+	/// \param [in] frame_length_ Size of the frame (in bytes)
+	/// \param [out] sensor_data_ Receives the sensor data (big endian, as
+	/// returned by the Roomba)
+	/// \param [out] flag_mask_changed_ Receives the flags of the packets
+	/// carried by the frame [optional]
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER The frame is malformed (the decoder waits
+	/// for a keyframe)
+	/// \return FAILURE_TO_SYNC The decoder is waiting for a keyframe
+	ReturnCode
+	decode (
+		const uint_opt8_t * const frame_,
+		const size_t frame_length_,
+		state::sensor_data_t * const sensor_data_,
+		uint_opt64_t * const flag_mask_changed_ = nullptr
+	);
+
+  private:
+	bool _synchronized; ///< a keyframe has been applied, and no frame lost since
+	uint8_t _sequence; ///< sequence of the next frame (modulo 256)
+	state::sensor_data_t _reference; ///< the sensor data of the frames applied
+};
+
+} // namespace telemetry
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
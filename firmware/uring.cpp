@@ -0,0 +1,582 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#include "uring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace roomba {
+namespace serial {
+namespace posix {
+
+namespace {
+	/// \brief Entries of the submission queue
+	const unsigned RING_ENTRIES(256);
+
+	/// \brief Buffers provided to the kernel for multishot reads
+	const uint16_t BUFFER_COUNT(64);
+
+	/// \brief Size of each provided buffer
+	/// \details Large enough to hold several stream frames.
+	const uint32_t BUFFER_SIZE(512);
+
+	/// \brief Group id of the provided buffers
+	const uint16_t BUFFER_GROUP(0);
+
+	/// \brief Opcode of the multishot read
+	/// \details Introduced in Linux 6.7, newer than the <linux/io_uring.h>
+	/// shipped by some distributions, so support is probed at runtime.
+	const uint8_t OP_READ_MULTISHOT(49);
+
+	/// \brief Request kinds, encoded in the low bits of user_data
+	/// \details The remaining bits hold the address of the channel.
+	enum RequestTag : uint64_t {
+		TAG_READ = 0,
+		TAG_WRITE,
+		TAG_CONTROL, ///< cancellations and provided buffers (ignored)
+		TAG_WAKE,
+		TAG_MASK = 0x03,
+	};
+
+	inline
+	int
+	_ioUringEnter (
+		const int ring_fd_,
+		const unsigned to_submit_,
+		const unsigned min_complete_,
+		const unsigned flags_,
+		const void * const arg_,
+		const size_t arg_size_
+	) {
+		return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd_, to_submit_, min_complete_, flags_, arg_, arg_size_));
+	}
+
+	inline
+	int
+	_ioUringRegister (
+		const int ring_fd_,
+		const unsigned opcode_,
+		void * const arg_,
+		const unsigned arg_count_
+	) {
+		return static_cast<int>(::syscall(__NR_io_uring_register, ring_fd_, opcode_, arg_, arg_count_));
+	}
+
+	inline
+	int
+	_ioUringSetup (
+		const unsigned entries_,
+		io_uring_params * const params_
+	) {
+		return static_cast<int>(::syscall(__NR_io_uring_setup, entries_, params_));
+	}
+
+	/// \brief The running kernel supports the multishot read
+	inline
+	bool
+	_supportsMultishotRead (
+		const int ring_fd_
+	) {
+		const unsigned op_count(256);
+		std::vector<uint8_t> storage(sizeof(io_uring_probe) + (op_count * sizeof(io_uring_probe_op)));
+		io_uring_probe * const probe = reinterpret_cast<io_uring_probe *>(storage.data());
+		if ( _ioUringRegister(ring_fd_, IORING_REGISTER_PROBE, probe, op_count) < 0 ) { return false; }
+		return ( probe->last_op >= OP_READ_MULTISHOT && (probe->ops[OP_READ_MULTISHOT].flags & IO_URING_OP_SUPPORTED) );
+	}
+} // namespace
+
+uring::uring (
+	const bool use_io_uring_
+) :
+	_ring_fd(-1),
+	_ring(MAP_FAILED),
+	_ring_size(0),
+	_sqes(static_cast<io_uring_sqe *>(MAP_FAILED)),
+	_sqes_size(0),
+	_sq_head(nullptr),
+	_sq_tail(nullptr),
+	_sq_array(nullptr),
+	_sq_mask(0),
+	_sq_entries(0),
+	_sq_local_tail(0),
+	_cq_head(nullptr),
+	_cq_tail(nullptr),
+	_cq_mask(0),
+	_cqes(nullptr),
+	_stop_requested(false),
+	_wake_armed(false),
+	_wake_fd(-1)
+{
+	if ( use_io_uring_ && !_setupRing() ) { _closeRing(); }
+}
+
+uring::~uring (
+	void
+) {
+	_closeRing();
+}
+
+/// \brief Arm a multishot read on the tty of a channel
+inline
+void
+uring::_armRead (
+	channel_t * const channel_
+) {
+	io_uring_sqe * const sqe = _nextSqe();
+	if ( !sqe ) { return; }
+
+	sqe->opcode = OP_READ_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->fd = channel_->port->fileDescriptor();
+	sqe->off = static_cast<uint64_t>(-1);
+	sqe->buf_group = BUFFER_GROUP;
+	sqe->user_data = (reinterpret_cast<uintptr_t>(channel_) | TAG_READ);
+	channel_->read_armed = true;
+}
+
+/// \brief Submit the commands of a channel
+/// \details Resubmits the remainder of a partial write, otherwise every
+/// command queued since the last write is submitted as one write.
+inline
+void
+uring::_armWrite (
+	channel_t * const channel_
+) {
+	io_uring_sqe * const sqe = _nextSqe();
+	if ( !sqe ) { return; }
+
+	if ( channel_->in_flight.empty() ) {
+		channel_->in_flight.swap(channel_->pending);
+		channel_->in_flight_offset = 0;
+	}
+
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = channel_->port->fileDescriptor();
+	sqe->off = static_cast<uint64_t>(-1);
+	sqe->addr = reinterpret_cast<uintptr_t>(channel_->in_flight.data() + channel_->in_flight_offset);
+	sqe->len = static_cast<uint32_t>(channel_->in_flight.size() - channel_->in_flight_offset);
+	sqe->user_data = (reinterpret_cast<uintptr_t>(channel_) | TAG_WRITE);
+	channel_->write_armed = true;
+}
+
+/// \brief Release the ring and its mappings
+/// \details Closing the ring cancels every outstanding request.
+inline
+void
+uring::_closeRing (
+	void
+) {
+	if ( -1 != _ring_fd ) { ::close(_ring_fd); _ring_fd = -1; }
+	if ( MAP_FAILED != _sqes ) { ::munmap(_sqes, _sqes_size); _sqes = static_cast<io_uring_sqe *>(MAP_FAILED); }
+	if ( MAP_FAILED != _ring ) { ::munmap(_ring, _ring_size); _ring = MAP_FAILED; }
+	if ( -1 != _wake_fd ) { ::close(_wake_fd); _wake_fd = -1; }
+	_buffers.clear();
+}
+
+/// \brief Publish the queued submissions and optionally wait
+/// \details Submits every published entry the kernel has yet to
+/// consume, so entries left by a short or failed submission are
+/// retried rather than published again.
+/// \param [in] min_complete_ Completions to wait for (0 to submit only)
+/// \param [in] timeout_ms_ Maximum time to wait (-1 waits indefinitely)
+/// \return The number of submissions consumed, or -1 on error
+inline
+int
+uring::_enter (
+	const unsigned min_complete_,
+	const int timeout_ms_
+) {
+	__atomic_store_n(_sq_tail, _sq_local_tail, __ATOMIC_RELEASE);
+	const unsigned to_submit = (_sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE));
+
+	struct __kernel_timespec timeout = { (timeout_ms_ / 1000), ((timeout_ms_ % 1000) * 1000000) };
+	struct io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	if ( timeout_ms_ >= 0 ) { arg.ts = reinterpret_cast<uintptr_t>(&timeout); }
+
+	const unsigned flags = ( min_complete_ ? (IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG) : 0 );
+	const int result = _ioUringEnter(_ring_fd, to_submit, min_complete_, flags, (min_complete_ ? &arg : nullptr), (min_complete_ ? sizeof(arg) : 0));
+	if ( result < 0 ) { return -1; }
+
+	return result;
+}
+
+inline
+uring::channel_t *
+uring::_findChannel (
+	const tty & tty_
+) const {
+	for ( const std::unique_ptr<channel_t> & channel : _channels ) {
+		if ( channel->port == &tty_ && !channel->detached ) { return channel.get(); }
+	}
+	return nullptr;
+}
+
+/// \brief Submit the commands queued on every idle channel
+inline
+void
+uring::_flushWrites (
+	void
+) {
+	for ( const std::unique_ptr<channel_t> & channel : _channels ) {
+		if ( channel->detached || channel->pending.empty() ) { continue; }
+		if ( -1 == _ring_fd ) {
+			channel->port->multiByteSerialWrite(channel->pending.data(), channel->pending.size());
+			channel->pending.clear();
+		} else if ( !channel->write_armed ) {
+			_armWrite(channel.get());
+		}
+	}
+}
+
+/// \brief Claim the next submission queue entry
+/// \details The queue is submitted when full.
+/// \return A zeroed entry, or nullptr when the kernel is not consuming
+inline
+io_uring_sqe *
+uring::_nextSqe (
+	void
+) {
+	if ( (_sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE)) >= _sq_entries ) {
+		_enter(0, 0);
+		if ( (_sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE)) >= _sq_entries ) { return nullptr; }
+	}
+
+	const unsigned index = (_sq_local_tail & _sq_mask);
+	_sq_array[index] = index;
+	++_sq_local_tail;
+
+	io_uring_sqe * const sqe = (_sqes + index);
+	memset(sqe, 0, sizeof(io_uring_sqe));
+	return sqe;
+}
+
+/// \brief Provide buffers to the kernel
+/// \details The request is submitted with the next batch.
+/// \param [in] buffer_id_ The first buffer
+/// \param [in] buffer_count_ The number of consecutive buffers
+inline
+void
+uring::_provideBuffers (
+	const uint16_t buffer_id_,
+	const uint16_t buffer_count_
+) {
+	io_uring_sqe * const sqe = _nextSqe();
+	if ( !sqe ) { return; }
+
+	sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+	sqe->fd = buffer_count_;
+	sqe->addr = reinterpret_cast<uintptr_t>(_buffers.data() + (buffer_id_ * BUFFER_SIZE));
+	sqe->len = BUFFER_SIZE;
+	sqe->off = buffer_id_;
+	sqe->buf_group = BUFFER_GROUP;
+	sqe->user_data = TAG_CONTROL;
+}
+
+/// \brief Process every completion waiting on the ring
+/// \return The number of stream frames committed
+inline
+size_t
+uring::_reapCompletions (
+	void
+) {
+	size_t frames_committed(0);
+
+	for ( unsigned head = *_cq_head ; head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE) ; ) {
+		const io_uring_cqe cqe = _cqes[(head & _cq_mask)];
+		__atomic_store_n(_cq_head, ++head, __ATOMIC_RELEASE);
+
+		channel_t * const channel = reinterpret_cast<channel_t *>(cqe.user_data & ~static_cast<uint64_t>(TAG_MASK));
+		switch ( cqe.user_data & TAG_MASK ) {
+		  case TAG_READ:
+			if ( cqe.flags & IORING_CQE_F_BUFFER ) {
+				const uint16_t buffer_id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+				if ( cqe.res > 0 && !channel->detached ) {
+					frames_committed += parseStreamChunk(*channel->robot_state, (_buffers.data() + (buffer_id * BUFFER_SIZE)), cqe.res);
+				}
+				_provideBuffers(buffer_id, 1);
+			}
+			if ( cqe.flags & IORING_CQE_F_MORE ) { break; }
+			channel->read_armed = false;
+			if ( channel->detached ) { break; }
+			// Rearm when the kernel ran out of buffers, otherwise the tty hung up
+			if ( cqe.res > 0 || -ENOBUFS == cqe.res ) {
+				_armRead(channel);
+			} else {
+				channel->detached = true;
+				channel->pending.clear();
+			}
+			break;
+		  case TAG_WRITE:
+			if ( cqe.res > 0 ) { channel->in_flight_offset += cqe.res; }
+			if ( cqe.res > 0 && !channel->detached && channel->in_flight_offset < channel->in_flight.size() ) {
+				_armWrite(channel);
+				break;
+			}
+			channel->in_flight.clear();
+			channel->write_armed = false;
+			if ( !channel->detached && !channel->pending.empty() ) { _armWrite(channel); }
+			break;
+		  case TAG_WAKE:
+			{
+				uint64_t wakeups;
+				while ( ::read(_wake_fd, &wakeups, sizeof(wakeups)) > 0 ) {}
+				_wake_armed = false;
+			}
+			break;
+		  default:
+			break;
+		}
+	}
+
+	_releaseChannels();
+	return frames_committed;
+}
+
+/// \brief Free the detached channels without outstanding requests
+inline
+void
+uring::_releaseChannels (
+	void
+) {
+	for ( std::vector<std::unique_ptr<channel_t>>::iterator channel = _channels.begin() ; channel != _channels.end() ; ) {
+		if ( (*channel)->detached && !(*channel)->read_armed && !(*channel)->write_armed ) {
+			channel = _channels.erase(channel);
+		} else {
+			++channel;
+		}
+	}
+}
+
+/// \brief Create the ring, map its queues and provide the read buffers
+/// \details Buffers are provided with IORING_OP_PROVIDE_BUFFERS, which
+/// is batched with the other submissions, rather than a registered
+/// buffer ring (not functional on every kernel).
+/// \return false when io_uring (or a required feature) is unavailable
+inline
+bool
+uring::_setupRing (
+	void
+) {
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	_ring_fd = _ioUringSetup(RING_ENTRIES, &params);
+	if ( _ring_fd < 0 ) { _ring_fd = -1; return false; }
+	if ( !(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG) ) { return false; }
+	if ( !_supportsMultishotRead(_ring_fd) ) { return false; }
+
+	// Submission and completion rings share a single mapping
+	_ring_size = std::max((params.sq_off.array + (params.sq_entries * sizeof(unsigned))), (params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe))));
+	_ring = ::mmap(nullptr, _ring_size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), _ring_fd, IORING_OFF_SQ_RING);
+	if ( MAP_FAILED == _ring ) { return false; }
+	_sqes_size = (params.sq_entries * sizeof(io_uring_sqe));
+	_sqes = static_cast<io_uring_sqe *>(::mmap(nullptr, _sqes_size, (PROT_READ | PROT_WRITE), (MAP_SHARED | MAP_POPULATE), _ring_fd, IORING_OFF_SQES));
+	if ( MAP_FAILED == _sqes ) { return false; }
+
+	uint8_t * const ring = static_cast<uint8_t *>(_ring);
+	_sq_head = reinterpret_cast<unsigned *>(ring + params.sq_off.head);
+	_sq_tail = reinterpret_cast<unsigned *>(ring + params.sq_off.tail);
+	_sq_local_tail = *_sq_tail;
+	_sq_array = reinterpret_cast<unsigned *>(ring + params.sq_off.array);
+	_sq_mask = *reinterpret_cast<unsigned *>(ring + params.sq_off.ring_mask);
+	_sq_entries = params.sq_entries;
+	_cq_head = reinterpret_cast<unsigned *>(ring + params.cq_off.head);
+	_cq_tail = reinterpret_cast<unsigned *>(ring + params.cq_off.tail);
+	_cq_mask = *reinterpret_cast<unsigned *>(ring + params.cq_off.ring_mask);
+	_cqes = reinterpret_cast<io_uring_cqe *>(ring + params.cq_off.cqes);
+
+	// Hand every read buffer to the kernel
+	_buffers.resize(BUFFER_COUNT * BUFFER_SIZE);
+	_provideBuffers(0, BUFFER_COUNT);
+	if ( _enter(0, 0) < 0 ) { return false; }
+
+	_wake_fd = ::eventfd(0, (EFD_NONBLOCK | EFD_CLOEXEC));
+	return ( -1 != _wake_fd );
+}
+
+ReturnCode
+uring::attach (
+	tty & tty_,
+	state::robot_state & robot_state_
+) {
+	if ( -1 == tty_.fileDescriptor() ) { return INVALID_PARAMETER; }
+	if ( _findChannel(tty_) ) { return INVALID_PARAMETER; }
+
+	if ( -1 == _ring_fd ) {
+		const ReturnCode rc = _reactor.attach(tty_, robot_state_);
+		if ( SUCCESS != rc ) { return rc; }
+	}
+
+	std::unique_ptr<channel_t> channel(new channel_t{ &tty_, &robot_state_, {}, {}, 0, false, false, false });
+	if ( -1 != _ring_fd ) {
+		_armRead(channel.get());
+		if ( _enter(0, 0) < 0 ) { return SERIAL_TRANSFER_FAILURE; }
+	}
+
+	_channels.push_back(std::move(channel));
+	return SUCCESS;
+}
+
+size_t
+uring::attached (
+	void
+) const {
+	if ( -1 == _ring_fd ) { return _reactor.attached(); }
+
+	size_t count(0);
+	for ( const std::unique_ptr<channel_t> & channel : _channels ) {
+		if ( !channel->detached ) { ++count; }
+	}
+	return count;
+}
+
+ReturnCode
+uring::detach (
+	tty & tty_
+) {
+	channel_t * const channel = _findChannel(tty_);
+	if ( !channel ) { return INVALID_PARAMETER; }
+
+	channel->detached = true;
+	channel->pending.clear();
+	if ( -1 == _ring_fd ) {
+		_reactor.detach(tty_);
+	} else if ( channel->read_armed ) {
+		io_uring_sqe * const sqe = _nextSqe();
+		if ( sqe ) {
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->addr = (reinterpret_cast<uintptr_t>(channel) | TAG_READ);
+			sqe->user_data = TAG_CONTROL;
+			_enter(0, 0);
+		}
+	}
+
+	_releaseChannels();
+	return SUCCESS;
+}
+
+size_t
+uring::poll (
+	const int timeout_ms_
+) {
+	_flushWrites();
+	if ( -1 == _ring_fd ) { return _reactor.poll(timeout_ms_); }
+
+	if ( !_wake_armed ) {
+		io_uring_sqe * const sqe = _nextSqe();
+		if ( sqe ) {
+			sqe->opcode = IORING_OP_POLL_ADD;
+			sqe->fd = _wake_fd;
+			sqe->poll32_events = POLLIN;
+			sqe->user_data = TAG_WAKE;
+			_wake_armed = true;
+		}
+	}
+
+	// Wait only when no completions are already waiting
+	const bool completions_waiting = (*_cq_head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE));
+	_enter(((completions_waiting || !timeout_ms_) ? 0 : 1), timeout_ms_);
+	const size_t frames_committed = _reapCompletions();
+	for ( const std::unique_ptr<channel_t> & channel : _channels ) {
+		if ( !channel->detached ) { channel->robot_state->expireQueries(); }
+	}
+
+	// Submit any reads or writes rearmed by the completions
+	if ( _sq_local_tail != __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) ) { _enter(0, 0); }
+	return frames_committed;
+}
+
+ReturnCode
+uring::run (
+	void
+) {
+	while ( !_stop_requested.exchange(false) ) {
+		poll(-1);
+	}
+
+	return SUCCESS;
+}
+
+void
+uring::stop (
+	void
+) {
+	_stop_requested = true;
+	if ( -1 == _wake_fd ) {
+		_reactor.stop();
+	} else {
+		const uint64_t wakeup(1);
+		if ( ::write(_wake_fd, &wakeup, sizeof(wakeup)) ) {}
+	}
+}
+
+bool
+uring::usingIoUring (
+	void
+) const {
+	return ( -1 != _ring_fd );
+}
+
+ReturnCode
+uring::write (
+	tty & tty_,
+	const uint_opt8_t * const data_,
+	const size_t data_length_
+) {
+	if ( !data_ ) { return INVALID_PARAMETER; }
+	channel_t * const channel = _findChannel(tty_);
+	if ( !channel ) { return INVALID_PARAMETER; }
+
+	channel->pending.insert(channel->pending.end(), data_, (data_ + data_length_));
+	return SUCCESS;
+}
+
+uring_port::uring_port (
+	uring & engine_,
+	tty & tty_
+) :
+	_engine(engine_),
+	_tty(tty_)
+{}
+
+void
+uring_port::beginAtBaudCode (
+	const BaudCode baud_code_
+) {
+	_tty.beginAtBaudCode(baud_code_);
+}
+
+size_t
+uring_port::multiByteSerialRead (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_,
+	const uint_opt32_t timeout_ms_
+) {
+	return _tty.multiByteSerialRead(data_buffer_, buffer_length_, timeout_ms_);
+}
+
+size_t
+uring_port::multiByteSerialWrite (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	return ( (SUCCESS == _engine.write(_tty, serial_data_, data_length_)) ? data_length_ : 0 );
+}
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
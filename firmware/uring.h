@@ -0,0 +1,265 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#if defined(__linux__)
+
+#ifndef URING_H
+#define URING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "defines.h"
+#include "posix.h"
+#include "reactor.h"
+#include "serial_port.h"
+#include "state.h"
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace roomba {
+namespace serial {
+namespace posix {
+
+/// \brief Services the serial traffic of many Roombas through io_uring
+/// \details Keeps a multishot read armed on the tty of every Roomba,
+/// with the received bytes landing in a pool of buffers shared by all
+/// ttys, and feeds them into the incremental stream parser of the
+/// corresponding robot state. Commands are queued per tty and
+/// submitted together, along with the wait for completions, in a
+/// single io_uring_enter() per call to poll(). The syscall count is
+/// therefore independent of the number of Roombas and commands.
+/// \n When io_uring is unavailable (kernel older than 6.7, disabled by
+/// sysctl or seccomp) the engine falls back to the epoll reactor, and
+/// queued commands are written with one write() per tty per poll().
+/// \note No liburing dependency, the raw syscalls are used.
+/// \note attach(), detach(), write() and poll() must be called from the
+/// same thread. stop() may be called from any thread.
+/// \see posix::reactor
+class uring {
+  public:
+	/// \brief Create the engine
+	/// \param [in] use_io_uring_ Request io_uring (otherwise epoll is
+	/// used) [default value: true]
+	explicit
+	uring (
+		const bool use_io_uring_ = true
+	);
+	~uring (void);
+
+	/// \brief Register the tty of a Roomba
+	/// \see reactor::attach
+	ReturnCode
+	attach (
+		tty & tty_,
+		state::robot_state & robot_state_
+	);
+
+	/// \brief The number of ttys attached
+	size_t
+	attached (
+		void
+	) const;
+
+	/// \brief Unregister the tty of a Roomba
+	/// \details Queued commands which have not been submitted are
+	/// discarded.
+	/// \see reactor::detach
+	ReturnCode
+	detach (
+		tty & tty_
+	);
+
+	/// \brief Submit the queued commands, then wait for stream data and
+	/// service every ready tty
+	/// \see reactor::poll
+	size_t
+	poll (
+		const int timeout_ms_
+	);
+
+	/// \brief Service the attached ttys until stop() is called
+	/// \see reactor::run
+	ReturnCode
+	run (
+		void
+	);
+
+	/// \brief Wake the engine and end run()
+	/// \see reactor::stop
+	void
+	stop (
+		void
+	);
+
+	/// \brief The engine is backed by io_uring
+	/// \return false when the epoll reactor is in use
+	bool
+	usingIoUring (
+		void
+	) const;
+
+	/// \brief Queue data to be written to a tty
+	/// \details The data is copied, and submitted with the commands
+	/// queued for the same tty by the next call to poll(). The order of
+	/// the writes to each tty is preserved.
+	/// \param [in] tty_ An attached tty
+	/// \param [in] data_ The data to write
+	/// \param [in] data_length_ The number of bytes to write
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER The tty is not attached
+	ReturnCode
+	write (
+		tty & tty_,
+		const uint_opt8_t * const data_,
+		const size_t data_length_
+	);
+
+  private:
+	/// \brief An attached tty and its traffic
+	struct channel_t {
+		tty * port;
+		state::robot_state * robot_state;
+		std::vector<uint8_t> pending; ///< commands queued by write()
+		std::vector<uint8_t> in_flight; ///< commands submitted to the kernel
+		size_t in_flight_offset; ///< bytes of in_flight already written
+		bool detached; ///< awaiting the completion of outstanding requests
+		bool read_armed; ///< a multishot read is outstanding
+		bool write_armed; ///< a write is outstanding
+	};
+
+	uring (const uring &) = delete;
+	uring & operator= (const uring &) = delete;
+
+	void
+	_armRead (
+		channel_t * const channel_
+	);
+
+	void
+	_armWrite (
+		channel_t * const channel_
+	);
+
+	void
+	_closeRing (
+		void
+	);
+
+	int
+	_enter (
+		const unsigned min_complete_,
+		const int timeout_ms_
+	);
+
+	channel_t *
+	_findChannel (
+		const tty & tty_
+	) const;
+
+	void
+	_flushWrites (
+		void
+	);
+
+	io_uring_sqe *
+	_nextSqe (
+		void
+	);
+
+	void
+	_provideBuffers (
+		const uint16_t buffer_id_,
+		const uint16_t buffer_count_
+	);
+
+	size_t
+	_reapCompletions (
+		void
+	);
+
+	void
+	_releaseChannels (
+		void
+	);
+
+	bool
+	_setupRing (
+		void
+	);
+
+	std::vector<std::unique_ptr<channel_t>> _channels; ///< attached (and draining) ttys
+	reactor _reactor; ///< epoll fallback
+	int _ring_fd; ///< io_uring instance (-1 when using epoll)
+	void * _ring; ///< submission and completion ring mapping
+	size_t _ring_size; ///< size of the ring mapping
+	io_uring_sqe * _sqes; ///< submission queue entries
+	size_t _sqes_size; ///< size of the submission entry mapping
+	unsigned * _sq_head; ///< kernel owned submission head
+	unsigned * _sq_tail; ///< published submission tail
+	unsigned * _sq_array; ///< submission index array
+	unsigned _sq_mask; ///< submission ring mask
+	unsigned _sq_entries; ///< submission ring size
+	unsigned _sq_local_tail; ///< submission tail including the entries queued since the last enter
+	unsigned * _cq_head; ///< completion head
+	unsigned * _cq_tail; ///< kernel owned completion tail
+	unsigned _cq_mask; ///< completion ring mask
+	io_uring_cqe * _cqes; ///< completion queue entries
+	std::vector<uint8_t> _buffers; ///< storage of the provided buffers
+	std::atomic<bool> _stop_requested; ///< run() should return
+	bool _wake_armed; ///< a poll of the wake eventfd is outstanding
+	int _wake_fd; ///< eventfd used to interrupt the wait
+};
+
+/// \brief A tty serviced by an io_uring engine
+/// \details Commands written to the port are queued on the engine and
+/// submitted in a batch, allowing robot<OI500> to drive a Roomba through
+/// the engine. Reads go straight to the tty.
+/// \warning The stream is delivered by the engine, do not read a port
+/// attached to an engine (i.e. sensor queries).
+class uring_port : public port {
+  public:
+	/// \param [in] engine_ The engine servicing the tty
+	/// \param [in] tty_ A tty attached to the engine
+	uring_port (
+		uring & engine_,
+		tty & tty_
+	);
+
+	void
+	beginAtBaudCode (
+		const BaudCode baud_code_
+	) override;
+
+	size_t
+	multiByteSerialRead (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_,
+		const uint_opt32_t timeout_ms_ = 1000
+	) override;
+
+	/// \brief Queue a command on the engine
+	/// \return data_length_ once queued, 0 when the tty is not attached
+	size_t
+	multiByteSerialWrite (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	) override;
+
+  private:
+	uring & _engine; ///< engine servicing the tty
+	tty & _tty; ///< tty connected to the Roomba
+};
+
+} // namespace posix
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
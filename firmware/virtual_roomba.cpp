@@ -0,0 +1,703 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#include "virtual_roomba.h"
+#include "packets.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace roomba {
+namespace serial {
+
+namespace {
+	/// \brief Length of each command (indexed by opcode - 128)
+	/// \details The header length is given for commands of variable
+	/// length (SONG, STREAM and QUERY_LIST), 0 for undefined opcodes.
+	const uint_opt8_t COMMAND_LENGTH[41] = {
+		1,  // START
+		2,  // BAUD
+		1,  // CONTROL
+		1,  // SAFE
+		1,  // FULL
+		1,  // POWER
+		1,  // SPOT
+		1,  // CLEAN
+		1,  // MAX
+		5,  // DRIVE
+		2,  // MOTORS
+		4,  // LEDS
+		3,  // SONG (header)
+		2,  // PLAY
+		2,  // SENSORS
+		1,  // SEEK_DOCK
+		4,  // PWM_MOTORS
+		5,  // DRIVE_DIRECT
+		5,  // DRIVE_PWM
+		0,
+		2,  // STREAM (header)
+		2,  // QUERY_LIST (header)
+		2,  // PAUSE_RESUME_STREAM
+		0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		3,  // SCHEDULING_LEDS
+		5,  // DIGIT_LEDS_RAW
+		5,  // DIGIT_LEDS_ASCII
+		2,  // BUTTONS
+		0,
+		16, // SCHEDULE
+		4,  // SET_DAY_TIME
+	};
+
+	/// \brief Encoder counts per millimeter of wheel travel
+	/// \details 508.8 counts per revolution of a 72 mm wheel.
+	const double COUNTS_PER_MM(508.8 / (72.0 * M_PI));
+
+	/// \brief Largest stream frame payload (in bytes)
+	/// \details The byte count of a frame is a single byte.
+	const size_t FRAME_PAYLOAD_CAPACITY(255);
+
+	/// \brief Stream frame header
+	const uint_opt8_t STREAM_HEADER(19);
+
+	/// \brief Distance between the wheels (in millimeters)
+	const double WHEEL_BASE_MM(235.0);
+
+	/// \brief Clamp a value to a range
+	inline
+	int_opt32_t
+	_clamp (
+		const int_opt32_t value_,
+		const int_opt32_t minimum_,
+		const int_opt32_t maximum_
+	) {
+		return std::min(std::max(value_, minimum_), maximum_);
+	}
+
+	/// \brief Tests whether the value of a packet is computed by the
+	/// simulation
+	inline
+	bool
+	_isSimulatedPacket (
+		const uint_opt8_t packet_id_
+	) {
+		switch ( packet_id_ ) {
+		  case sensor::DISTANCE:
+		  case sensor::ANGLE:
+		  case sensor::OI_MODE:
+		  case sensor::SONG_NUMBER:
+		  case sensor::SONG_PLAYING:
+		  case sensor::NUMBER_OF_STREAM_PACKETS:
+		  case sensor::REQUESTED_VELOCITY:
+		  case sensor::REQUESTED_RADIUS:
+		  case sensor::REQUESTED_RIGHT_VELOCITY:
+		  case sensor::REQUESTED_LEFT_VELOCITY:
+		  case sensor::RIGHT_ENCODER_COUNTS:
+		  case sensor::LEFT_ENCODER_COUNTS:
+			return true;
+		  default:
+			return false;
+		}
+	}
+
+	/// \brief Decode a big-endian 16-bit value
+	inline
+	int_opt16_t
+	_toInt16 (
+		const uint_opt8_t * const data_
+	) {
+		return static_cast<int16_t>((data_[0] << 8) | data_[1]);
+	}
+} // namespace
+
+virtual_roomba::virtual_roomba (
+	const ClockMode clock_mode_
+) :
+	_clock_mode(clock_mode_),
+	_epoch(std::chrono::steady_clock::now()),
+	_elapsed_us(0),
+	_next_step_us(STEP_US),
+	_command_index(0),
+	_command_length(0),
+	_output_head(0),
+	_output_length(0),
+	_bytes_dropped(0),
+	_oi_mode(OFF),
+	_motors(0),
+	_requested_velocity(0),
+	_requested_radius(0),
+	_right_velocity(0),
+	_left_velocity(0),
+	_pose{ 0.0, 0.0, 0.0 },
+	_distance_um(0),
+	_angle_deg(0.0),
+	_right_travel_um(0),
+	_left_travel_um(0),
+	_song_end_us(0),
+	_stream_key_length(0),
+	_streaming(false)
+{
+	::memset(_song_length, 0, sizeof(_song_length));
+	::memset(_raw_data, 0, sizeof(_raw_data));
+
+	// A Roomba with a full battery
+	_setRaw(sensor::CHARGING_STATE, NOT_CHARGING);
+	_setRaw(sensor::VOLTAGE, 16000);
+	_setRaw(sensor::CURRENT, -200);
+	_setRaw(sensor::TEMPERATURE, 25);
+	_setRaw(sensor::BATTERY_CHARGE, 2600);
+	_setRaw(sensor::BATTERY_CAPACITY, 2600);
+	_refreshRawData();
+}
+
+/// \brief Run every step due by a point in simulated time
+inline
+void
+virtual_roomba::_advanceTo (
+	const int_fast64_t elapsed_us_
+) {
+	while ( _next_step_us <= elapsed_us_ ) {
+		_elapsed_us = _next_step_us;
+		_step();
+		_next_step_us += STEP_US;
+	}
+	_elapsed_us = std::max(_elapsed_us, elapsed_us_);
+}
+
+/// \brief Send bytes to the host
+/// \details Bytes arriving at a full buffer are dropped, as a UART
+/// would drop them.
+inline
+void
+virtual_roomba::_appendOutput (
+	const uint_opt8_t * const data_,
+	const size_t data_length_
+) {
+	for ( size_t i = 0 ; i < data_length_ ; ++i ) {
+		if ( OUTPUT_CAPACITY == _output_length ) {
+			_bytes_dropped += (data_length_ - i);
+			return;
+		}
+		_output[((_output_head + _output_length) % OUTPUT_CAPACITY)] = data_[i];
+		++_output_length;
+	}
+}
+
+/// \brief Copy the value of a packet, as it is sent
+/// \details Reporting DISTANCE or ANGLE resets it, the fraction not
+/// reported is carried over.
+/// \return The number of bytes copied
+inline
+size_t
+virtual_roomba::_copyPacket (
+	const uint_opt8_t packet_id_,
+	uint_opt8_t * const data_buffer_
+) {
+	const sensor::packet_descriptor_t & descriptor = sensor::packetDescriptor(packet_id_);
+	::memcpy(data_buffer_, (_raw_data + descriptor.offset), descriptor.size);
+
+	if ( descriptor.flag_mask & sensor::packetDescriptor(sensor::DISTANCE).flag_mask ) {
+		_distance_um -= (_toInt16(_raw_data + sensor::packetDescriptor(sensor::DISTANCE).offset) * 1000);
+		_setRaw(sensor::DISTANCE, _clamp(static_cast<int_opt32_t>(_distance_um / 1000), INT16_MIN, INT16_MAX));
+	}
+	if ( descriptor.flag_mask & sensor::packetDescriptor(sensor::ANGLE).flag_mask ) {
+		_angle_deg -= _toInt16(_raw_data + sensor::packetDescriptor(sensor::ANGLE).offset);
+		_setRaw(sensor::ANGLE, _clamp(static_cast<int_opt32_t>(_angle_deg), INT16_MIN, INT16_MAX));
+	}
+
+	return descriptor.size;
+}
+
+/// \brief Execute the command decoded
+inline
+void
+virtual_roomba::_execute (
+	void
+) {
+	const uint_opt8_t * const data = (_command + 1);
+	const bool actuators_available = ( SAFE == _oi_mode || FULL == _oi_mode );
+
+	if ( command::START == _command[0] ) {
+		_oi_mode = PASSIVE;
+		return;
+	}
+	if ( OFF == _oi_mode ) { return; }
+
+	switch ( _command[0] ) {
+	  case command::CONTROL:
+	  case command::SAFE:
+		_oi_mode = SAFE;
+		break;
+	  case command::FULL:
+		_oi_mode = FULL;
+		break;
+	  case command::POWER:
+	  case command::SPOT:
+	  case command::CLEAN:
+	  case command::MAX:
+	  case command::SEEK_DOCK:
+		_stop();
+		_oi_mode = PASSIVE;
+		break;
+	  case command::DRIVE:
+		if ( !actuators_available ) { break; }
+		_requested_velocity = static_cast<int_opt16_t>(_clamp(_toInt16(data), -500, 500));
+		_requested_radius = _toInt16(data + 2);
+		if ( 0x7FFF == _requested_radius || INT16_MIN == _requested_radius ) {
+			_right_velocity = _left_velocity = _requested_velocity;
+		} else if ( -1 == _requested_radius ) {
+			_right_velocity = -_requested_velocity;
+			_left_velocity = _requested_velocity;
+		} else if ( 1 == _requested_radius ) {
+			_right_velocity = _requested_velocity;
+			_left_velocity = -_requested_velocity;
+		} else {
+			const double radius_mm = _clamp(_requested_radius, -2000, 2000);
+			_right_velocity = static_cast<int_opt16_t>(std::lround(_requested_velocity * (radius_mm + (WHEEL_BASE_MM / 2)) / radius_mm));
+			_left_velocity = static_cast<int_opt16_t>(std::lround(_requested_velocity * (radius_mm - (WHEEL_BASE_MM / 2)) / radius_mm));
+		}
+		break;
+	  case command::DRIVE_DIRECT:
+		if ( !actuators_available ) { break; }
+		_right_velocity = static_cast<int_opt16_t>(_clamp(_toInt16(data), -500, 500));
+		_left_velocity = static_cast<int_opt16_t>(_clamp(_toInt16(data + 2), -500, 500));
+		break;
+	  case command::DRIVE_PWM:
+		if ( !actuators_available ) { break; }
+		_right_velocity = static_cast<int_opt16_t>(_clamp(_toInt16(data), -255, 255) * 500 / 255);
+		_left_velocity = static_cast<int_opt16_t>(_clamp(_toInt16(data + 2), -255, 255) * 500 / 255);
+		break;
+	  case command::MOTORS:
+		if ( !actuators_available ) { break; }
+		_motors = data[0];
+		break;
+	  case command::PWM_MOTORS:
+		if ( !actuators_available ) { break; }
+		_motors = 0;
+		if ( data[0] ) { _motors |= ( bitmask::MAIN_BRUSH_ENGAGED | ((data[0] & 0x80) ? bitmask::MAIN_BRUSH_OUTWARD : 0) ); }
+		if ( data[1] ) { _motors |= ( bitmask::SIDE_BRUSH_ENGAGED | ((data[1] & 0x80) ? bitmask::SIDE_BRUSH_CLOCKWISE : 0) ); }
+		if ( data[2] ) { _motors |= bitmask::VACUUM_ENGAGED; }
+		break;
+	  case command::SONG:
+		if ( data[0] > 4 ) { break; }
+		_song_length[data[0]] = static_cast<uint_opt8_t>(std::min<size_t>(data[1], 16));
+		for ( uint_opt8_t i = 0 ; i < _song_length[data[0]] ; ++i ) {
+			_songs[data[0]][i].pitch = data[(2 + (i * 2))];
+			_songs[data[0]][i].duration = data[(3 + (i * 2))];
+		}
+		break;
+	  case command::PLAY:
+		if ( !actuators_available || data[0] > 4 || !_song_length[data[0]] || _song_end_us > _elapsed_us ) { break; }
+		{
+			int_fast64_t duration_64ths(0);
+			for ( uint_opt8_t i = 0 ; i < _song_length[data[0]] ; ++i ) { duration_64ths += _songs[data[0]][i].duration; }
+			_song_end_us = (_elapsed_us + ((duration_64ths * 1000000) / 64));
+		}
+		_setRaw(sensor::SONG_NUMBER, data[0]);
+		break;
+	  case command::SENSORS:
+	  case command::QUERY_LIST:
+	  {
+		const bool single = ( command::SENSORS == _command[0] );
+		const uint_opt8_t * const packet_ids = ( single ? data : (data + 1) );
+		const size_t packet_count = ( single ? 1 : data[0] );
+		uint_opt8_t value[80];
+		_refreshRawData();
+		for ( size_t i = 0 ; i < packet_count ; ++i ) {
+			if ( !sensor::isDefinedPacketId(packet_ids[i]) ) { continue; }
+			_appendOutput(value, _copyPacket(packet_ids[i], value));
+		}
+		break;
+	  }
+	  case command::STREAM:
+		_stream_key_length = 0;
+		for ( size_t i = 0 ; i < data[0] ; ++i ) {
+			if ( !sensor::isDefinedPacketId(data[(1 + i)]) ) { continue; }
+			_stream_key[_stream_key_length++] = data[(1 + i)];
+		}
+		_streaming = ( _stream_key_length > 0 );
+		break;
+	  case command::PAUSE_RESUME_STREAM:
+		_streaming = ( data[0] && _stream_key_length );
+		break;
+	  case command::BUTTONS:
+		// Pressed until the next step
+		_setRaw(sensor::BUTTONS, data[0]);
+		break;
+	  default:
+		// BAUD, LEDS, SCHEDULING_LEDS, DIGIT_LEDS_RAW, DIGIT_LEDS_ASCII,
+		// SCHEDULE and SET_DAY_TIME are accepted without effect
+		break;
+	}
+}
+
+/// \brief Update the values computed by the simulation
+inline
+void
+virtual_roomba::_refreshRawData (
+	void
+) {
+	_setRaw(sensor::DISTANCE, _clamp(static_cast<int_opt32_t>(_distance_um / 1000), INT16_MIN, INT16_MAX));
+	_setRaw(sensor::ANGLE, _clamp(static_cast<int_opt32_t>(_angle_deg), INT16_MIN, INT16_MAX));
+	_setRaw(sensor::OI_MODE, _oi_mode);
+	_setRaw(sensor::SONG_PLAYING, ( _song_end_us > _elapsed_us ));
+	_setRaw(sensor::NUMBER_OF_STREAM_PACKETS, _stream_key_length);
+	_setRaw(sensor::REQUESTED_VELOCITY, _requested_velocity);
+	_setRaw(sensor::REQUESTED_RADIUS, _requested_radius);
+	_setRaw(sensor::REQUESTED_RIGHT_VELOCITY, _right_velocity);
+	_setRaw(sensor::REQUESTED_LEFT_VELOCITY, _left_velocity);
+	_setRaw(sensor::RIGHT_ENCODER_COUNTS, static_cast<int_opt32_t>(static_cast<int_fast64_t>(std::floor(_right_travel_um * COUNTS_PER_MM / 1000)) & 0xFFFF));
+	_setRaw(sensor::LEFT_ENCODER_COUNTS, static_cast<int_opt32_t>(static_cast<int_fast64_t>(std::floor(_left_travel_um * COUNTS_PER_MM / 1000)) & 0xFFFF));
+}
+
+/// \brief Store the value of a packet (big-endian)
+inline
+void
+virtual_roomba::_setRaw (
+	const uint_opt8_t packet_id_,
+	const int_opt32_t value_
+) {
+	const sensor::packet_descriptor_t & descriptor = sensor::packetDescriptor(packet_id_);
+	if ( 2 == descriptor.size ) {
+		_raw_data[descriptor.offset] = static_cast<uint_opt8_t>((value_ >> 8) & 0xFF);
+		_raw_data[(descriptor.offset + 1)] = static_cast<uint_opt8_t>(value_ & 0xFF);
+	} else {
+		_raw_data[descriptor.offset] = static_cast<uint_opt8_t>(value_ & 0xFF);
+	}
+}
+
+/// \brief Run one step of the sensor update loop
+/// \details Moves the body, applies the safety checks of Safe mode, and
+/// sends a stream frame.
+inline
+void
+virtual_roomba::_step (
+	void
+) {
+	// Travel is kept in whole micrometers (mm/s * 15 ms), so odometry does not drift
+	const int_fast64_t right_um = ((static_cast<int_fast64_t>(_right_velocity) * STEP_US) / 1000);
+	const int_fast64_t left_um = ((static_cast<int_fast64_t>(_left_velocity) * STEP_US) / 1000);
+	const double distance_mm = ((right_um + left_um) / 2000.0);
+	const double angle_rad = ((right_um - left_um) / (WHEEL_BASE_MM * 1000));
+
+	_pose.x_mm += (distance_mm * std::cos(_pose.heading_rad + (angle_rad / 2)));
+	_pose.y_mm += (distance_mm * std::sin(_pose.heading_rad + (angle_rad / 2)));
+	_pose.heading_rad += angle_rad;
+	_distance_um += ((right_um + left_um) / 2);
+	_angle_deg += (angle_rad * 180.0 / M_PI);
+	_right_travel_um += right_um;
+	_left_travel_um += left_um;
+
+	// Safe mode reverts to Passive on a cliff or wheel drop
+	if ( SAFE == _oi_mode ) {
+		const bool wheel_drop = ( _raw_data[sensor::packetDescriptor(sensor::BUMPS_AND_WHEEL_DROPS).offset] & (bitmask::WHEEL_DROP_RIGHT | bitmask::WHEEL_DROP_LEFT) );
+		bool cliff = false;
+		for ( uint_opt8_t packet_id = sensor::CLIFF_LEFT ; packet_id <= sensor::CLIFF_RIGHT ; ++packet_id ) { cliff |= ( 0 != _raw_data[sensor::packetDescriptor(packet_id).offset] ); }
+		if ( wheel_drop || cliff ) {
+			_stop();
+			_oi_mode = PASSIVE;
+		}
+	}
+
+	_refreshRawData();
+	if ( _streaming ) { _stream(); }
+
+	// Buttons are released after a step
+	_setRaw(sensor::BUTTONS, 0);
+}
+
+/// \brief Stop the wheels and motors
+inline
+void
+virtual_roomba::_stop (
+	void
+) {
+	_requested_velocity = 0;
+	_requested_radius = 0;
+	_right_velocity = 0;
+	_left_velocity = 0;
+	_motors = 0;
+}
+
+/// \brief Send a stream frame
+/// \details [19][n-bytes][packet id 1][data 1]...[checksum], where the
+/// checksum makes the sum of every byte of the frame 0. Packets beyond
+/// the capacity of the frame are left out.
+inline
+void
+virtual_roomba::_stream (
+	void
+) {
+	uint_opt8_t frame[(FRAME_PAYLOAD_CAPACITY + 3)];
+	size_t payload_length(0);
+
+	for ( uint_opt8_t i = 0 ; i < _stream_key_length ; ++i ) {
+		if ( (payload_length + 1 + sensor::packetDescriptor(_stream_key[i]).size) > FRAME_PAYLOAD_CAPACITY ) { continue; }
+		frame[(2 + payload_length)] = _stream_key[i];
+		payload_length += (1 + _copyPacket(_stream_key[i], (frame + 3 + payload_length)));
+	}
+
+	frame[0] = STREAM_HEADER;
+	frame[1] = static_cast<uint_opt8_t>(payload_length);
+	uint_opt8_t checksum(0);
+	for ( size_t i = 0 ; i < (payload_length + 2) ; ++i ) { checksum += frame[i]; }
+	frame[(payload_length + 2)] = static_cast<uint_opt8_t>(-checksum);
+
+	_appendOutput(frame, (payload_length + 3));
+}
+
+/// \brief Read bytes from the output of the Roomba
+/// \return The number of bytes read
+inline
+size_t
+virtual_roomba::_takeOutput (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_
+) {
+	const size_t bytes_read = std::min(buffer_length_, _output_length);
+	for ( size_t i = 0 ; i < bytes_read ; ++i ) {
+		data_buffer_[i] = _output[((_output_head + i) % OUTPUT_CAPACITY)];
+	}
+	_output_head = ((_output_head + bytes_read) % OUTPUT_CAPACITY);
+	_output_length -= bytes_read;
+
+	return bytes_read;
+}
+
+void
+virtual_roomba::advance (
+	const std::chrono::microseconds duration_
+) {
+	{  // Critical section: Update shared memory
+		_mutex.lock();
+		if ( REAL_TIME == _clock_mode ) {
+			_advanceTo(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _epoch).count());
+		} else {
+			_advanceTo(_elapsed_us + duration_.count());
+		}
+		_mutex.unlock();
+	}
+}
+
+void
+virtual_roomba::beginAtBaudCode (
+	const BaudCode
+) {}
+
+size_t
+virtual_roomba::bytesAvailable (
+	void
+) const {
+	size_t bytes_available;
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		bytes_available = _output_length;
+		_mutex.unlock();
+	}
+
+	return bytes_available;
+}
+
+size_t
+virtual_roomba::bytesDropped (
+	void
+) const {
+	size_t bytes_dropped;
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		bytes_dropped = _bytes_dropped;
+		_mutex.unlock();
+	}
+
+	return bytes_dropped;
+}
+
+OIMode
+virtual_roomba::getOIMode (
+	void
+) const {
+	OIMode oi_mode;
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		oi_mode = _oi_mode;
+		_mutex.unlock();
+	}
+
+	return oi_mode;
+}
+
+uint_opt8_t
+virtual_roomba::getMotors (
+	void
+) const {
+	uint_opt8_t motors;
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		motors = _motors;
+		_mutex.unlock();
+	}
+
+	return motors;
+}
+
+int_opt32_t
+virtual_roomba::getPacket (
+	const sensor::PacketId packet_id_
+) const {
+	if ( packet_id_ < sensor::BUMPS_AND_WHEEL_DROPS || packet_id_ > sensor::STASIS ) { return 0; }
+	const sensor::packet_descriptor_t & descriptor = sensor::packetDescriptor(packet_id_);
+	uint_opt8_t value[2];
+
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		::memcpy(value, (_raw_data + descriptor.offset), descriptor.size);
+		_mutex.unlock();
+	}
+
+	if ( 2 == descriptor.size ) { return ( descriptor.is_signed ? _toInt16(value) : static_cast<int_opt32_t>((value[0] << 8) | value[1]) ); }
+	return ( descriptor.is_signed ? static_cast<int8_t>(value[0]) : static_cast<int_opt32_t>(value[0]) );
+}
+
+virtual_roomba::pose_t
+virtual_roomba::getPose (
+	void
+) const {
+	pose_t pose;
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		pose = _pose;
+		_mutex.unlock();
+	}
+
+	return pose;
+}
+
+void
+virtual_roomba::getWheelVelocities (
+	int_opt16_t * const right_mm_per_sec_,
+	int_opt16_t * const left_mm_per_sec_
+) const {
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		if ( right_mm_per_sec_ ) { *right_mm_per_sec_ = _right_velocity; }
+		if ( left_mm_per_sec_ ) { *left_mm_per_sec_ = _left_velocity; }
+		_mutex.unlock();
+	}
+}
+
+std::chrono::steady_clock::time_point
+virtual_roomba::nextStepTime (
+	void
+) const {
+	int_fast64_t next_step_us;
+	{  // Critical section: Read shared memory
+		_mutex.lock();
+		next_step_us = _next_step_us;
+		_mutex.unlock();
+	}
+
+	return (_epoch + std::chrono::microseconds(next_step_us));
+}
+
+size_t
+virtual_roomba::multiByteSerialRead (
+	uint_opt8_t * const data_buffer_,
+	const size_t buffer_length_,
+	const uint_opt32_t timeout_ms_
+) {
+	if ( !data_buffer_ ) { return 0; }
+	size_t bytes_read(0);
+
+	if ( SIMULATED_TIME == _clock_mode ) {
+		{  // Critical section: Update shared memory
+			_mutex.lock();
+			const int_fast64_t deadline_us = (_elapsed_us + (static_cast<int_fast64_t>(timeout_ms_) * 1000));
+			bytes_read = _takeOutput(data_buffer_, buffer_length_);
+			// Wait in simulated time, one step at a time
+			while ( bytes_read < buffer_length_ && _next_step_us <= deadline_us ) {
+				_advanceTo(_next_step_us);
+				bytes_read += _takeOutput((data_buffer_ + bytes_read), (buffer_length_ - bytes_read));
+			}
+			if ( bytes_read < buffer_length_ ) { _advanceTo(deadline_us); }
+			_mutex.unlock();
+		}
+		return bytes_read;
+	}
+
+	const std::chrono::steady_clock::time_point deadline = (std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms_));
+	for (;;) {
+		int_fast64_t next_step_us;
+		{  // Critical section: Update shared memory
+			_mutex.lock();
+			_advanceTo(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _epoch).count());
+			bytes_read += _takeOutput((data_buffer_ + bytes_read), (buffer_length_ - bytes_read));
+			next_step_us = _next_step_us;
+			_mutex.unlock();
+		}
+		if ( bytes_read == buffer_length_ || std::chrono::steady_clock::now() >= deadline ) { break; }
+
+		// Sleep until the next step, when the Roomba may send more data
+		std::this_thread::sleep_until(std::min(deadline, (_epoch + std::chrono::microseconds(next_step_us))));
+	}
+
+	return bytes_read;
+}
+
+size_t
+virtual_roomba::multiByteSerialWrite (
+	const uint_opt8_t * const serial_data_,
+	const size_t data_length_
+) {
+	if ( !serial_data_ ) { return 0; }
+
+	{  // Critical section: Update shared memory
+		_mutex.lock();
+		if ( REAL_TIME == _clock_mode ) { _advanceTo(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _epoch).count()); }
+
+		for ( size_t i = 0 ; i < data_length_ ; ++i ) {
+			if ( !_command_length ) {
+				// Bytes outside of a command are ignored
+				if ( serial_data_[i] < command::START || serial_data_[i] > command::SET_DAY_TIME || !COMMAND_LENGTH[(serial_data_[i] - command::START)] ) { continue; }
+				_command_length = COMMAND_LENGTH[(serial_data_[i] - command::START)];
+			}
+			_command[_command_index++] = serial_data_[i];
+
+			// The header of a variable length command gives its length
+			if ( command::SONG == _command[0] && 3 == _command_index ) {
+				_command_length = (3 + (2 * _command[2]));
+			} else if ( (command::STREAM == _command[0] || command::QUERY_LIST == _command[0]) && 2 == _command_index ) {
+				_command_length = (2 + _command[1]);
+			}
+			if ( _command_index < _command_length ) { continue; }
+
+			_execute();
+			_command_index = 0;
+			_command_length = 0;
+		}
+		_refreshRawData();
+		_mutex.unlock();
+	}
+
+	return data_length_;
+}
+
+ReturnCode
+virtual_roomba::setPacket (
+	const sensor::PacketId packet_id_,
+	const int_opt32_t value_
+) {
+	if ( packet_id_ < sensor::BUMPS_AND_WHEEL_DROPS || packet_id_ > sensor::STASIS || _isSimulatedPacket(packet_id_) ) { return INVALID_PARAMETER; }
+
+	{  // Critical section: Update shared memory
+		_mutex.lock();
+		_setRaw(packet_id_, value_);
+		_mutex.unlock();
+	}
+
+	return SUCCESS;
+}
+
+} // namespace serial
+} // namespace roomba
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
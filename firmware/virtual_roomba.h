@@ -0,0 +1,301 @@
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */
+
+#ifndef VIRTUAL_ROOMBA_H
+#define VIRTUAL_ROOMBA_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "defines.h"
+#include "serial_port.h"
+
+namespace roomba {
+namespace serial {
+
+/// \brief A Roomba simulated in-process
+/// \details A port whose far end is a simulated Roomba rather than a
+/// serial line. The bytes written are decoded as Open Interface (OI500)
+/// commands, which drive the operating mode, wheels, motors and songs
+/// of the simulation. Sensor, query list and stream requests are
+/// answered with responses laid out exactly as the Roomba sends them,
+/// stream frames (with checksums) are sent every 15 ms, and a
+/// differential-drive body turns the wheel velocities into distance,
+/// angle and encoder counts.
+/// \n The simulation advances in 15 ms steps, as the sensor update loop
+/// of the Roomba does. In simulated time the clock only moves when
+/// advanced, or when a read waits for data (a read waits in simulated
+/// time rather than sleeping), so hundreds of Roombas can be driven from
+/// one thread faster than real time. In real time the clock follows the
+/// steady clock, and reads block as a tty would.
+/// \note Commands requiring Safe or Full mode are ignored in Passive
+/// mode, and every command except START is ignored while the OI is off,
+/// as on the Roomba. Safe mode reverts to Passive when a cliff or wheel
+/// drop is detected.
+/// \note The methods are thread-safe.
+/// \see open_interface
+class virtual_roomba : public port {
+  public:
+	/// \brief The clock driving the simulation
+	enum ClockMode : uint_opt8_t {
+		SIMULATED_TIME = 0, ///< advanced by the caller and by reads
+		REAL_TIME, ///< follows the steady clock
+	};
+
+	/// \brief Position of the Roomba
+	/// \details Integrated from the wheel velocities, starting at the
+	/// origin facing the positive x axis.
+	struct pose_t {
+		double x_mm; ///< position along the x axis (millimeters)
+		double y_mm; ///< position along the y axis (millimeters)
+		double heading_rad; ///< heading (radians, counter-clockwise positive)
+	};
+
+	/// \param [in] clock_mode_ The clock driving the simulation [default
+	/// value: SIMULATED_TIME]
+	explicit
+	virtual_roomba (
+		const ClockMode clock_mode_ = SIMULATED_TIME
+	);
+
+	/// \brief Advance the simulation
+	/// \details Runs every 15 ms step elapsed (moving the body, ending
+	/// songs and sending stream frames).
+	/// \param [in] duration_ The time to simulate
+	/// \note In real time, the steps elapsed on the steady clock are run
+	/// instead (the duration is ignored). The accessors report the
+	/// simulation as of the last advance, read or write.
+	void
+	advance (
+		const std::chrono::microseconds duration_
+	);
+
+	/// \brief Change the rate of the line
+	/// \details Accepted for compatibility, the simulation does not
+	/// model the line rate.
+	void
+	beginAtBaudCode (
+		const BaudCode baud_code_
+	) override;
+
+	/// \brief The number of bytes sent by the Roomba, but not read
+	size_t
+	bytesAvailable (
+		void
+	) const;
+
+	/// \brief The number of bytes discarded because they were not read
+	/// \details The output of the Roomba is buffered as a UART would,
+	/// and bytes are dropped once the buffer is full.
+	size_t
+	bytesDropped (
+		void
+	) const;
+
+	/// \brief Accessor method for the operating mode of the simulation
+	OIMode
+	getOIMode (
+		void
+	) const;
+
+	/// \brief Accessor method for the motor state (OpCode 138)
+	/// \return The bitmask of the motors engaged
+	uint_opt8_t
+	getMotors (
+		void
+	) const;
+
+	/// \brief Accessor method for the current value of a sensor packet
+	/// \param [in] packet_id_ An individual packet id (7-58)
+	/// \return The value (sign extended for signed packets), 0 for an
+	/// invalid packet id
+	/// \note Reading DISTANCE or ANGLE here does not reset them.
+	int_opt32_t
+	getPacket (
+		const sensor::PacketId packet_id_
+	) const;
+
+	/// \brief Accessor method for the position of the Roomba
+	pose_t
+	getPose (
+		void
+	) const;
+
+	/// \brief Accessor method for the wheel velocities
+	/// \param [out] right_mm_per_sec_ Receives the velocity of the right
+	/// wheel
+	/// \param [out] left_mm_per_sec_ Receives the velocity of the left
+	/// wheel
+	void
+	getWheelVelocities (
+		int_opt16_t * const right_mm_per_sec_,
+		int_opt16_t * const left_mm_per_sec_
+	) const;
+
+	/// \brief The time of the next 15 ms step (in real time)
+	/// \details Lets a caller servicing the simulation sleep until the
+	/// Roomba may send more data.
+	std::chrono::steady_clock::time_point
+	nextStepTime (
+		void
+	) const;
+
+	/// \brief Read the bytes sent by the Roomba
+	/// \details Returns once the buffer is filled or the timeout
+	/// expires. In simulated time, waiting advances the simulation.
+	/// \see port::multiByteSerialRead
+	size_t
+	multiByteSerialRead (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_,
+		const uint_opt32_t timeout_ms_ = 1000
+	) override;
+
+	/// \brief Send bytes to the Roomba
+	/// \details The bytes are decoded as they arrive, a command may be
+	/// split across several writes.
+	/// \see port::multiByteSerialWrite
+	size_t
+	multiByteSerialWrite (
+		const uint_opt8_t * const serial_data_,
+		const size_t data_length_
+	) override;
+
+	/// \brief Set the value reported by a sensor packet
+	/// \details Scripts the environment of the Roomba (i.e. bumps,
+	/// cliffs, walls or the battery).
+	/// \param [in] packet_id_ An individual packet id (7-58)
+	/// \param [in] value_ The value to report (truncated to the size of
+	/// the packet)
+	/// \return SUCCESS
+	/// \return INVALID_PARAMETER The packet id is not an individual
+	/// packet, or its value is computed by the simulation (odometry, OI
+	/// mode, songs, stream and requested velocities)
+	ReturnCode
+	setPacket (
+		const sensor::PacketId packet_id_,
+		const int_opt32_t value_
+	);
+
+	/// \brief Duration of a step, the sensor update loop of the Roomba
+	/// (in microseconds)
+	static const int_fast32_t STEP_US = 15000;
+
+  private:
+	/// \brief Capacity of the output of the Roomba (in bytes)
+	static const size_t OUTPUT_CAPACITY = 4096;
+
+	/// \brief Capacity of the command being decoded (in bytes)
+	/// \details A song of 255 notes is the longest command.
+	static const size_t COMMAND_CAPACITY = 513;
+
+	/// \brief A note of a song
+	struct song_note_t {
+		uint_opt8_t pitch; ///< MIDI note number
+		uint_opt8_t duration; ///< duration (1/64ths of a second)
+	};
+
+	virtual_roomba (const virtual_roomba &) = delete;
+	virtual_roomba & operator= (const virtual_roomba &) = delete;
+
+	void
+	_advanceTo (
+		const int_fast64_t elapsed_us_
+	);
+
+	void
+	_appendOutput (
+		const uint_opt8_t * const data_,
+		const size_t data_length_
+	);
+
+	size_t
+	_copyPacket (
+		const uint_opt8_t packet_id_,
+		uint_opt8_t * const data_buffer_
+	);
+
+	void
+	_execute (
+		void
+	);
+
+	void
+	_refreshRawData (
+		void
+	);
+
+	void
+	_setRaw (
+		const uint_opt8_t packet_id_,
+		const int_opt32_t value_
+	);
+
+	void
+	_step (
+		void
+	);
+
+	void
+	_stop (
+		void
+	);
+
+	void
+	_stream (
+		void
+	);
+
+	size_t
+	_takeOutput (
+		uint_opt8_t * const data_buffer_,
+		const size_t buffer_length_
+	);
+
+	const ClockMode _clock_mode; ///< clock driving the simulation
+	const std::chrono::steady_clock::time_point _epoch; ///< beginning of real time
+	mutable std::mutex _mutex; ///< guards the simulation
+
+	int_fast64_t _elapsed_us; ///< time simulated
+	int_fast64_t _next_step_us; ///< time of the next 15 ms step
+
+	uint_opt8_t _command[COMMAND_CAPACITY]; ///< command being decoded
+	size_t _command_index; ///< bytes of the command received
+	size_t _command_length; ///< bytes of the command expected (0 between commands)
+
+	uint_opt8_t _output[OUTPUT_CAPACITY]; ///< bytes sent, but not read (ring)
+	size_t _output_head; ///< index of the oldest byte
+	size_t _output_length; ///< number of bytes waiting
+	size_t _bytes_dropped; ///< bytes discarded on overflow
+
+	OIMode _oi_mode; ///< operating mode of the Open Interface
+	uint_opt8_t _motors; ///< motors engaged (OpCode 138)
+	int_opt16_t _requested_velocity; ///< drive velocity (OpCode 137)
+	int_opt16_t _requested_radius; ///< drive radius (OpCode 137)
+	int_opt16_t _right_velocity; ///< right wheel velocity (mm/s)
+	int_opt16_t _left_velocity; ///< left wheel velocity (mm/s)
+
+	pose_t _pose; ///< position of the body
+	int_fast64_t _distance_um; ///< distance travelled since last reported (micrometers)
+	double _angle_deg; ///< angle turned since last reported
+	int_fast64_t _right_travel_um; ///< distance travelled by the right wheel (micrometers)
+	int_fast64_t _left_travel_um; ///< distance travelled by the left wheel (micrometers)
+
+	song_note_t _songs[5][16]; ///< songs defined (OpCode 140)
+	uint_opt8_t _song_length[5]; ///< number of notes of each song
+	int_fast64_t _song_end_us; ///< time the song playing ends
+
+	uint_opt8_t _stream_key[256]; ///< packet ids streamed
+	uint_opt8_t _stream_key_length; ///< number of packet ids streamed
+	bool _streaming; ///< stream frames are sent each step
+
+	uint_opt8_t _raw_data[80]; ///< sensor values (laid out as sent)
+};
+
+} // namespace serial
+} // namespace roomba
+
+#endif
+
+/* Created and copyrighted by Zachary J. Fields. Offered as open source under the MIT License (MIT). */